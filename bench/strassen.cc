@@ -0,0 +1,136 @@
+/** @file Strassen-Winograd products against gemm
+ *
+ * Times linalg::gemm and linalg::strassen_gemm on random n x n matrices,
+ * for every size and crossover given on the command line:
+ *   strassen [-c crossover,...] [n...]
+ * Each timing is the best of a few runs. The error column is the largest
+ * difference with the gemm result, relative to n ||A|| ||B|| eps.
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <limits>
+#include <random>
+#include <vector>
+#include "strassen.hh"
+
+using namespace opl;
+
+namespace
+{
+
+	using clock_type = std::chrono::steady_clock;
+
+	const int runs = 3;
+
+	template <class F>
+	double
+	best_time (F f)
+	{
+		double best = std::numeric_limits<double>::infinity ();
+		for (int r = 0; r < runs; ++r)
+		{
+			auto start = clock_type::now ();
+			f ();
+			std::chrono::duration<double> d = clock_type::now () - start;
+			best = std::min (best, d.count ());
+		}
+		return best;
+	}
+
+	double
+	gflops (std::size_t n, double seconds)
+	{
+		double nd = static_cast<double> (n);
+		return 2 * nd * nd * nd / seconds * 1e-9;
+	}
+
+	double
+	max_abs (const std::vector<double>& v)
+	{
+		double res = 0;
+		for (double x : v)
+			res = std::max (res, std::abs (x));
+		return res;
+	}
+
+	void
+	bench (std::size_t n, const std::vector<std::size_t>& crossovers)
+	{
+		std::mt19937 gen (static_cast<unsigned> (n));
+		std::uniform_real_distribution<double> dist (-1.0, 1.0);
+		std::vector<double> a (n * n);
+		std::vector<double> b (n * n);
+		for (std::size_t i = 0; i < n * n; ++i)
+		{
+			a[i] = dist (gen);
+			b[i] = dist (gen);
+		}
+		std::vector<double> c (n * n);
+		std::vector<double> s (n * n);
+
+		double t = best_time ([&]
+		{
+			linalg::gemm (n, n, n, 1.0, a.data (), n, std::size_t (1),
+						  b.data (), n, std::size_t (1), 0.0,
+						  c.data (), n, std::size_t (1));
+		});
+		std::printf ("%6zu %9s %10.4f %8.2f\n", n, "gemm", t, gflops (n, t));
+
+		double scale = static_cast<double> (n) * max_abs (a) * max_abs (b)
+			* std::numeric_limits<double>::epsilon ();
+		for (std::size_t crossover : crossovers)
+		{
+			double ts = best_time ([&]
+			{
+				linalg::strassen_gemm (n, a.data (), n, std::size_t (1),
+									   b.data (), n, std::size_t (1),
+									   s.data (), n, std::size_t (1),
+									   crossover);
+			});
+			double err = 0;
+			for (std::size_t i = 0; i < n * n; ++i)
+				err = std::max (err, std::abs (s[i] - c[i]));
+			std::printf ("%6zu %9zu %10.4f %8.2f %8.3f %8.2e\n", n, crossover,
+						 ts, gflops (n, ts), t / ts, err / scale);
+		}
+	}
+
+}
+
+int
+main (int argc, char** argv)
+{
+	std::vector<std::size_t> sizes;
+	std::vector<std::size_t> crossovers;
+	for (int i = 1; i < argc; ++i)
+	{
+		bool list = !std::strcmp (argv[i], "-c") && i + 1 < argc;
+		const char* arg = list ? argv[++i] : argv[i];
+		for (char* end; *arg; arg = *end ? end + 1 : end)
+		{
+			std::size_t x = std::strtoul (arg, &end, 10);
+			if (!x || (*end && (!list || *end != ',')))
+			{
+				std::fprintf (stderr, "usage: %s [-c crossover,...] [n...]\n",
+							  argv[0]);
+				return 1;
+			}
+			(list ? crossovers : sizes).push_back (x);
+		}
+	}
+	if (sizes.empty ())
+		sizes = {256, 512, 768, 1024, 1536, 2048};
+	if (crossovers.empty ())
+		crossovers = {64, 128, 256, OPL_STRASSEN_CROSSOVER};
+
+	std::printf ("%6s %9s %10s %8s %8s %8s\n", "n", "crossover", "seconds",
+				 "GFLOP/s", "speedup", "error");
+	for (std::size_t n : sizes)
+		bench (n, crossovers);
+	return 0;
+}
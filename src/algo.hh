@@ -6,18 +6,35 @@
 
 # include <cmath>
 # include <cstddef>
+# include <cstdint>
 # include <algorithm>
 # include <iostream>
+# include <iterator>
+# include <type_traits>
+# include <vector>
+# include "frequency-table.hh"
+# include "simd-reduce.hh"
 
 
 #define OPL_ALGO_ZERO 1e-10
 
+///From this range of values, mode and distinct_count count integers in a
+///hash table instead of an array
+#define OPL_ALGO_COUNTING_RANGE (1 << 20)
+
 namespace opl
 {
 
 	namespace algo
 	{
 
+		///Return type R of the overloads for contiguous arithmetic values,
+		///which dispatch to the vectorized kernels of simd-reduce.hh
+		template <class T, class R>
+		using simd_if_ = std::enable_if_t<
+			std::is_arithmetic<T>::value
+			&& !std::is_same<std::remove_const_t<T>, bool>::value, R>;
+
 		template<class It>
 		void
 		log (It begin, It end)
@@ -507,6 +524,13 @@ namespace opl
 			return ns;
 		}
 
+		template <class T>
+		simd_if_<T, std::remove_const_t<T>>
+		norm_square (T* begin, T* end)
+		{
+			return simd::norm_square<std::remove_const_t<T>> (begin, end - begin);
+		}
+
 		template <class It>
 		typename std::iterator_traits<It>::value_type
 		norm (It begin, It end)
@@ -516,42 +540,106 @@ namespace opl
 
 		template <class It>
 		typename std::iterator_traits<It>::value_type
-		p_norm (It begin, It end, size_t p)
+		sum (It begin, It end)
 		{
 			using value_type = typename std::iterator_traits<It>::value_type;
-
-			if(p == static_cast<size_t> (-1))
-				return std::abs (max_abs (begin, end));
-
-		    value_type norm = 0;
-			value_type pow (p);
+		    value_type x = 0;
 			for (It i = begin; i != end; ++i)
-				norm += std::pow (std::abs (*i), pow);
-			return std::pow (norm, 1 / pow);
+				x += *i;
+			return x;
+		}
+
+		template <class T>
+		simd_if_<T, std::remove_const_t<T>>
+		sum (T* begin, T* end)
+		{
+			return simd::sum<std::remove_const_t<T>> (begin, end - begin);
 		}
 
 		template <class It>
 		typename std::iterator_traits<It>::value_type
-		sum (It begin, It end)
+		sum_abs (It begin, It end)
 		{
 			using value_type = typename std::iterator_traits<It>::value_type;
 		    value_type x = 0;
 			for (It i = begin; i != end; ++i)
-				x += *i;
+				x += std::abs(*i);
 			return x;
 		}
 
+		template <class T>
+		simd_if_<T, std::remove_const_t<T>>
+		sum_abs (T* begin, T* end)
+		{
+			return simd::sum_abs<std::remove_const_t<T>> (begin, end - begin);
+		}
+
+		///Sum of halves, recursively: the rounding error grows with log(n)
+		///instead of n
 		template <class It>
 		typename std::iterator_traits<It>::value_type
-		sum_abs (It begin, It end)
+		sum_pairwise (It begin, It end)
+		{
+			auto n = std::distance (begin, end);
+			if (n <= OPL_SIMD_PAIRWISE_BLOCK)
+				return sum (begin, end);
+			It mid = std::next (begin, n / 2);
+			return sum_pairwise (begin, mid) + sum_pairwise (mid, end);
+		}
+
+		template <class T>
+		simd_if_<T, std::remove_const_t<T>>
+		sum_pairwise (T* begin, T* end)
+		{
+			return simd::sum_pairwise<std::remove_const_t<T>> (begin,
+															   end - begin);
+		}
+
+		///Compensated (Kahan) sum: the rounding error doesn't grow with n
+		template <class It>
+		typename std::iterator_traits<It>::value_type
+		sum_kahan (It begin, It end)
 		{
 			using value_type = typename std::iterator_traits<It>::value_type;
-		    value_type x = 0;
+			value_type x = 0;
+			value_type c = 0;
 			for (It i = begin; i != end; ++i)
-				x += std::abs(*i);
+			{
+				value_type y = *i - c;
+				value_type t = x + y;
+				c = (t - x) - y;
+				x = t;
+			}
 			return x;
 		}
 
+		template <class T>
+		simd_if_<T, std::remove_const_t<T>>
+		sum_kahan (T* begin, T* end)
+		{
+			return simd::sum_kahan<std::remove_const_t<T>> (begin, end - begin);
+		}
+
+		template <class It>
+		typename std::iterator_traits<It>::value_type
+		p_norm (It begin, It end, size_t p)
+		{
+			using value_type = typename std::iterator_traits<It>::value_type;
+
+			if(p == static_cast<size_t> (-1))
+				return std::abs (max_abs (begin, end));
+			if (p == 1)
+				return sum_abs (begin, end);
+			if (p == 2)
+				return norm (begin, end);
+
+		    value_type norm = 0;
+			value_type pow (p);
+			for (It i = begin; i != end; ++i)
+				norm += std::pow (std::abs (*i), pow);
+			return std::pow (norm, 1 / pow);
+		}
+
 		template <class It>
 		typename std::iterator_traits<It>::value_type
 		product (It begin, It end)
@@ -563,6 +651,13 @@ namespace opl
 			return x;
 		}
 
+		template <class T>
+		simd_if_<T, std::remove_const_t<T>>
+		product (T* begin, T* end)
+		{
+			return simd::product<std::remove_const_t<T>> (begin, end - begin);
+		}
+
 		template <class It>
 		typename std::iterator_traits<It>::value_type
 		product_abs (It begin, It end)
@@ -617,6 +712,16 @@ namespace opl
 			return x;
 		}
 
+		template <class T, class U>
+		simd_if_<T, std::enable_if_t<std::is_same<std::remove_const_t<T>,
+												  std::remove_const_t<U>>::value,
+									  std::remove_const_t<T>>>
+		dot_product (T* begin1, T* end1, U* begin2)
+		{
+			using value_type = std::remove_const_t<T>;
+			return simd::dot<value_type> (begin1, begin2, end1 - begin1);
+		}
+
 		template <class It1, class It2>
 		typename std::iterator_traits<It1>::value_type
 		distance_square (It1 begin1, It1 end1, It2 begin2)
@@ -630,6 +735,16 @@ namespace opl
 			return x;
 		}
 
+		template <class T, class U>
+		simd_if_<T, std::enable_if_t<std::is_same<std::remove_const_t<T>,
+												  std::remove_const_t<U>>::value,
+									  std::remove_const_t<T>>>
+		distance_square (T* begin1, T* end1, U* begin2)
+		{
+			using value_type = std::remove_const_t<T>;
+			return simd::distance_square<value_type> (begin1, begin2, end1 - begin1);
+		}
+
 		template <class It1, class It2>
 		typename std::iterator_traits<It1>::value_type
 		distance (It1 begin1, It1 end1, It2 begin2)
@@ -814,14 +929,116 @@ namespace opl
 			return sum / size;
 		}
 
+		template <class It, class RIt>
+		void
+		nth_elements_ (It begin, std::size_t first, std::size_t last,
+					   RIt rbegin, RIt rend)
+		{
+			if (rbegin == rend)
+				return;
+
+			//Selects the middle rank, then the ranks on each side only look
+			//at their side
+			RIt mid = rbegin + (rend - rbegin) / 2;
+			std::size_t r = *mid;
+			std::nth_element (begin + first, begin + r, begin + last);
+			nth_elements_ (begin, first, r, rbegin,
+						   std::lower_bound (rbegin, mid, r));
+			nth_elements_ (begin, r + 1, last,
+						   std::upper_bound (mid, rend, r), rend);
+		}
+
+		///Reorders [begin, end) so that for each rank r of [rbegin, rend)
+		///(sorted in increasing order), begin[r] is the value that would be
+		///at r if the range was sorted, with smaller values before it and
+		///bigger ones after. Expected O(n log k) for k ranks
+		template <class It, class RIt>
+		void
+		nth_elements (It begin, It end, RIt rbegin, RIt rend)
+		{
+			nth_elements_ (begin, 0, std::distance (begin, end), rbegin, rend);
+		}
+
+		///Rank of the quantile q (in [0, 1]) in a sorted range of n values
+		inline std::size_t
+		quantile_rank (std::size_t n, double q)
+		{
+			std::size_t r = static_cast<std::size_t> (q * n);
+			return r < n ? r : n - 1;
+		}
+
+		///Quantiles of [begin, end) at the ranks of [qbegin, qend), written
+		///to out, in one selection pass. The range is reordered
+		template <class It, class QIt, class OIt>
+		void
+		quantiles_in_place (It begin, It end, QIt qbegin, QIt qend, OIt out)
+		{
+			std::size_t n = std::distance (begin, end);
+			std::vector<std::size_t> ranks;
+			for (QIt q = qbegin; q != qend; ++q)
+				ranks.push_back (quantile_rank (n, *q));
+			std::vector<std::size_t> sorted (ranks);
+			std::sort (sorted.begin (), sorted.end ());
+			nth_elements (begin, end, sorted.begin (), sorted.end ());
+			for (std::size_t r : ranks)
+				*out++ = begin[r];
+		}
+
+		///Same as quantiles_in_place, working on a copy of the values in
+		///buf, which may be reused between calls to avoid reallocations
+		template <class It, class QIt, class OIt>
+		void
+		quantiles (It begin, It end, QIt qbegin, QIt qend, OIt out,
+				   std::vector<typename std::iterator_traits<It>::value_type>& buf)
+		{
+			buf.assign (begin, end);
+			quantiles_in_place (buf.begin (), buf.end (), qbegin, qend, out);
+		}
+
+		template <class It, class QIt, class OIt>
+		void
+		quantiles (It begin, It end, QIt qbegin, QIt qend, OIt out)
+		{
+			std::vector<typename std::iterator_traits<It>::value_type> buf;
+			quantiles (begin, end, qbegin, qend, out, buf);
+		}
+
+		///Value at rank n / 2, the range is reordered
+		template <class It>
+		typename std::iterator_traits<It>::value_type
+		median_in_place (It begin, It end)
+		{
+			It nth = begin + std::distance (begin, end) / 2;
+			std::nth_element (begin, nth, end);
+			return *nth;
+		}
+
+		template <class It>
+		typename std::iterator_traits<It>::value_type
+		median (It begin, It end,
+				std::vector<typename std::iterator_traits<It>::value_type>& buf)
+		{
+			buf.assign (begin, end);
+			return median_in_place (buf.begin (), buf.end ());
+		}
+
 	    template <class It>
 		typename std::iterator_traits<It>::value_type
 		median (It begin, It end)
 		{
 			using value_type = typename std::iterator_traits<It>::value_type;
-			std::vector<value_type> v (begin, end);
-			std::sort (v.begin (), v.end ());
-		    return v[v.size () / 2];
+			std::vector<value_type> v;
+			return median (begin, end, v);
+		}
+
+		///Value at rank n / 4, the range is reordered
+		template <class It>
+		typename std::iterator_traits<It>::value_type
+		quartile1_in_place (It begin, It end)
+		{
+			It nth = begin + std::distance (begin, end) / 4;
+			std::nth_element (begin, nth, end);
+			return *nth;
 		}
 
 		template <class It>
@@ -830,8 +1047,17 @@ namespace opl
 		{
 			using value_type = typename std::iterator_traits<It>::value_type;
 			std::vector<value_type> v (begin, end);
-			std::sort (v.begin (), v.end ());
-		    return v[v.size () / 4];
+			return quartile1_in_place (v.begin (), v.end ());
+		}
+
+		///Value at rank 3n / 4, the range is reordered
+		template <class It>
+		typename std::iterator_traits<It>::value_type
+		quartile3_in_place (It begin, It end)
+		{
+			It nth = begin + std::distance (begin, end) * 3 / 4;
+			std::nth_element (begin, nth, end);
+			return *nth;
 		}
 
 		template <class It>
@@ -840,88 +1066,241 @@ namespace opl
 		{
 			using value_type = typename std::iterator_traits<It>::value_type;
 			std::vector<value_type> v (begin, end);
-			std::sort (v.begin (), v.end ());
-		    return v[v.size () * 3 / 4];
+			return quartile3_in_place (v.begin (), v.end ());
 		}
 
+		///Copies the sorted values of ranks n / 4 to 3n / 4 to begin2
+		///Only the values between the quartiles are sorted
 		template <class It1, class It2>
 		void
 		interquartile (It1 begin1, It1 end1, It2 begin2)
 		{
 			using value_type = typename std::iterator_traits<It1>::value_type;
 			std::vector<value_type> v (begin1, end1);
-			std::sort (v.begin (), v.end ());
-			std::copy (v.begin () + v.size () / 4,
-					   v.begin () + v.size () * 3 / 4 + 1,
+			if (v.empty ())
+				return;
+			std::size_t ranks[] = {v.size () / 4, v.size () * 3 / 4};
+			nth_elements (v.begin (), v.end (), ranks, ranks + 2);
+			if (ranks[1] > ranks[0])
+				std::sort (v.begin () + ranks[0] + 1, v.begin () + ranks[1]);
+			std::copy (v.begin () + ranks[0], v.begin () + ranks[1] + 1,
 					   begin2);
 		}
 
+		///Value at rank 3n / 4 minus value at rank n / 4, the range is
+		///reordered
+		template <class It>
+		typename std::iterator_traits<It>::value_type
+		interquartile_range_in_place (It begin, It end)
+		{
+			std::size_t n = std::distance (begin, end);
+			std::size_t ranks[] = {n / 4, n * 3 / 4};
+			nth_elements (begin, end, ranks, ranks + 2);
+			return begin[ranks[1]] - begin[ranks[0]];
+		}
+
+		template <class It>
+		typename std::iterator_traits<It>::value_type
+		interquartile_range (It begin, It end,
+							 std::vector<typename std::iterator_traits<It>::value_type>& buf)
+		{
+			buf.assign (begin, end);
+			return interquartile_range_in_place (buf.begin (), buf.end ());
+		}
+
 	    template <class It>
 		typename std::iterator_traits<It>::value_type
 		interquartile_range (It begin, It end)
 		{
 			using value_type = typename std::iterator_traits<It>::value_type;
-			std::vector<value_type> v (begin, end);
-			std::sort (v.begin (), v.end ());
-		    return v[v.size () * 3 / 4] - v[v.size () / 4];
+			std::vector<value_type> v;
+			return interquartile_range (begin, end, v);
+		}
+
+
+		///Counts of the integers of [begin, end) in an array indexed by
+		///x - min, empty when max - min is too big for an array
+		template <class It>
+		std::vector<std::size_t>
+		counting_ (It begin, It end,
+				   typename std::iterator_traits<It>::value_type& min)
+		{
+			using value_type = typename std::iterator_traits<It>::value_type;
+			if (begin == end)
+				return {};
+			min = *begin;
+			value_type max = *begin;
+			std::size_t n = 0;
+			for (It i = begin; i != end; ++i, ++n)
+			{
+				//*i may be a proxy, as for std::vector<bool>
+				value_type x = *i;
+				min = std::min (min, x);
+				max = std::max (max, x);
+			}
+
+			//The array must stay small compared to the values
+			std::uintmax_t range = static_cast<std::uintmax_t> (max)
+				- static_cast<std::uintmax_t> (min);
+			if (range >= OPL_ALGO_COUNTING_RANGE || range > 4 * n + 1024)
+				return {};
+			std::vector<std::size_t> counts (range + 1, 0);
+			for (It i = begin; i != end; ++i)
+				++counts[static_cast<std::uintmax_t> (*i)
+						 - static_cast<std::uintmax_t> (min)];
+			return counts;
 		}
 
+		template <class It>
+		typename std::iterator_traits<It>::value_type
+		mode_ (It begin, It end, std::false_type)
+		{
+			using value_type = typename std::iterator_traits<It>::value_type;
+			FrequencyTable<value_type> table;
+			table.add (begin, end);
+			return table.mode ();
+		}
 
+		template <class It>
+		typename std::iterator_traits<It>::value_type
+		mode_ (It begin, It end, std::true_type)
+		{
+			using value_type = typename std::iterator_traits<It>::value_type;
+			value_type min {};
+			std::vector<std::size_t> counts = counting_ (begin, end, min);
+			if (counts.empty ())
+				return mode_ (begin, end, std::false_type {});
+			std::size_t best = std::max_element (counts.begin (), counts.end ())
+				- counts.begin ();
+			return static_cast<value_type> (static_cast<std::uintmax_t> (min)
+											+ best);
+		}
+
+		///Most frequent value, the smallest one on ties
+		///Integers in a small range are counted in an array, other values
+		///in a hash table
 		template <class It>
 		typename std::iterator_traits<It>::value_type
 		mode (It begin, It end)
 		{
 			using value_type = typename std::iterator_traits<It>::value_type;
-			std::vector<value_type> v (begin, end);
-			std::sort (v.begin (), v.end ());
+			return mode_ (begin, end, std::is_integral<value_type> {});
+		}
 
-			value_type mode = v[0];
-			value_type current = mode;
-			size_t mode_n = 1;
-			size_t current_n = 1;
+		///Occurrences of every value of [begin, end)
+		template <class It>
+		FrequencyTable<typename std::iterator_traits<It>::value_type>
+		frequencies (It begin, It end)
+		{
+			FrequencyTable<typename std::iterator_traits<It>::value_type> table;
+			table.add (begin, end);
+			return table;
+		}
 
-			for (size_t i = 1; i < v.size (); ++i)
+		template <class It>
+		std::size_t
+		distinct_count_ (It begin, It end, std::false_type)
+		{
+			return frequencies (begin, end).distinct ();
+		}
+
+		template <class It>
+		std::size_t
+		distinct_count_ (It begin, It end, std::true_type)
+		{
+			typename std::iterator_traits<It>::value_type min {};
+			std::vector<std::size_t> counts = counting_ (begin, end, min);
+			if (counts.empty ())
+				return distinct_count_ (begin, end, std::false_type {});
+			return counts.size () - std::count (counts.begin (), counts.end (),
+												std::size_t (0));
+		}
+
+		///Number of distinct values
+		template <class It>
+		std::size_t
+		distinct_count (It begin, It end)
+		{
+			using value_type = typename std::iterator_traits<It>::value_type;
+			return distinct_count_ (begin, end, std::is_integral<value_type> {});
+		}
+
+		///Counts of the values of [begin, end) in bins equal-width bins
+		///between lo and hi: bin i is [lo + i w, lo + (i + 1) w), the last
+		///bin includes hi, values out of [lo, hi] are not counted
+		template <class It, class T>
+		std::vector<std::size_t>
+		histogram (It begin, It end, const T& lo, const T& hi,
+				   std::size_t bins)
+		{
+			std::vector<std::size_t> res (bins, 0);
+			if (!bins || !(lo < hi))
+				return res;
+			double scale = bins / (static_cast<double> (hi)
+								   - static_cast<double> (lo));
+			for (It i = begin; i != end; ++i)
 			{
-				if (current == v[i])
-				{
-					++current_n;
-					if (current_n > mode_n)
-					{
-						mode_n = current_n;
-						mode = current;
-					}
-				}
-				else
-				{
-					current_n = 1;
-					current = v[i];
-				}
+				if (*i < lo || hi < *i)
+					continue;
+				std::size_t b = static_cast<std::size_t>
+					((static_cast<double> (*i) - static_cast<double> (lo)) * scale);
+				++res[b < bins ? b : bins - 1];
 			}
+			return res;
+		}
 
-		    return mode;
+		///Histogram between the min and the max of [begin, end)
+		template <class It>
+		std::vector<std::size_t>
+		histogram (It begin, It end, std::size_t bins)
+		{
+			if (begin == end)
+				return std::vector<std::size_t> (bins, 0);
+			auto range = std::minmax_element (begin, end);
+			auto lo = *range.first;
+			auto hi = *range.second;
+			if (!(lo < hi))
+			{
+				std::vector<std::size_t> res (bins, 0);
+				if (bins)
+					res[0] = std::distance (begin, end);
+				return res;
+			}
+			return histogram (begin, end, lo, hi, bins);
 		}
 
+		///Floating type the variance of T is accumulated in
+		template <class T>
+		using variance_type_ = typename std::conditional<
+			std::is_floating_point<T>::value, T, double>::type;
+
+		///Population variance, integer values are accumulated and returned
+		///as double
 		template <class It>
-		typename std::iterator_traits<It>::value_type
+		variance_type_<typename std::iterator_traits<It>::value_type>
 		variance (It begin, It end)
 		{
 			using value_type = typename std::iterator_traits<It>::value_type;
-			value_type n = static_cast<value_type> (0);
-			value_type sum = static_cast<value_type> (0);
-			value_type square = static_cast<value_type> (0);
+			using acc_type = variance_type_<value_type>;
+			acc_type n = 0;
+			acc_type mean = 0;
+			acc_type m2 = 0;
 
+			//Welford's update: no cancellation between E[x^2] and E[x]^2
 			for (It i = begin; i != end; ++i)
 			{
-				sum += *i;
-				square += *i * *i;
-				n += static_cast<value_type> (1);
+				acc_type x = static_cast<acc_type> (*i);
+				n += 1;
+				acc_type delta = x - mean;
+				mean += delta / n;
+				m2 += delta * (x - mean);
 			}
 
-			return square / n - (sum * sum) / (n * n);
+			return m2 / n;
 		}
 
 		template <class It>
-		typename std::iterator_traits<It>::value_type
+		variance_type_<typename std::iterator_traits<It>::value_type>
 		standard_deviation (It begin, It end)
 		{
 		    return std::sqrt (variance (begin, end));
@@ -938,6 +1317,13 @@ namespace opl
 				*i1 += x * *i2;
 		}
 
+		template <class T>
+		simd_if_<T, void>
+		saxpy (T* begin1, T* end1, const T& x, const T* begin2)
+		{
+			simd::axpy (end1 - begin1, x, begin2, begin1);
+		}
+
 		///c <- a + xb
 		template <class It1, class It2, class It3, class T>
 		void
@@ -950,6 +1336,14 @@ namespace opl
 				*i3 = *i1 + x * *i2;
 		}
 
+		template <class T>
+		simd_if_<T, void>
+		saxpy (const T* begin1, const T* end1, const T& x, const T* begin2,
+			   T* begin3)
+		{
+			simd::axpy (end1 - begin1, begin1, x, begin2, begin3);
+		}
+
 	}
 
 }
@@ -0,0 +1,418 @@
+/** @file Array files: Vector and Matrix values stored for memory mapping
+ *
+ * A file is a 64 bytes header followed by the raw values, in the byte order
+ * of the machine that wrote it. The values start at an offset multiple of
+ * the alignment written in the header, so a mapped file can be read in
+ * place, with SIMD loads, without any copy.
+ * Header (all fields in the writer byte order):
+ *  - magic "OPLARRAY" (8 bytes), version (u32), byte order mark 0x01020304 (u32)
+ *  - value kind (u32: 0 unsigned, 1 signed, 2 floating point), value size (u32)
+ *  - storage order (u32: 0 row-major, 1 column-major), rank (u32: 1 or 2)
+ *  - rows, cols (u64, cols = 1 for vectors), offset, alignment (u64)
+ * Readers reject files of a newer version, another byte order or another
+ * value type instead of converting them.
+ */
+
+#ifndef ARRAY_FILE_HH_
+# define ARRAY_FILE_HH_
+
+# include <cassert>
+# include <cstddef>
+# include <cstdint>
+# include <cstring>
+# include <fstream>
+# include <stdexcept>
+# include <string>
+# include <type_traits>
+# include "mapped-file.hh"
+# include "matrix.hh"
+# include "vector.hh"
+
+///Alignment of the values written by ArrayWriter, in bytes
+# define OPL_ARRAY_FILE_ALIGNMENT 64
+
+namespace opl
+{
+
+	struct ArrayFileHeader
+	{
+		static constexpr std::uint32_t version_current = 1;
+		static constexpr std::uint32_t byte_order_mark = 0x01020304;
+
+		char magic[8];
+		std::uint32_t version;
+		std::uint32_t byte_order;
+		std::uint32_t kind;
+		std::uint32_t value_size;
+		std::uint32_t order;
+		std::uint32_t rank;
+		std::uint64_t rows;
+		std::uint64_t cols;
+		std::uint64_t offset;
+		std::uint64_t alignment;
+
+		///Header of a rank 1 or 2 array of T
+		template <class T>
+		static ArrayFileHeader
+		make (std::uint32_t rank, std::uint64_t rows, std::uint64_t cols,
+			  StorageOrder order);
+
+		///Throws std::runtime_error if the file can't be read as values of T
+		template <class T>
+		void
+		check (std::size_t file_size) const;
+	};
+
+	static_assert (sizeof (ArrayFileHeader) == 64,
+				   "ArrayFileHeader must not be padded");
+
+
+	///Writes an array file value by value, without keeping the values:
+	///arrays larger than the memory can be produced by blocks
+	template <class T>
+	class ArrayWriter
+	{
+		static_assert (std::is_arithmetic<T>::value,
+					   "array files only store arithmetic values");
+
+	public:
+		using size_type = std::size_t;
+
+		///rows x cols matrix, values are then written in the given order
+		ArrayWriter (const std::string& path, size_type rows, size_type cols,
+					 StorageOrder order = StorageOrder::row_major);
+
+		///Vector of n values
+		ArrayWriter (const std::string& path, size_type n);
+
+		ArrayWriter (const ArrayWriter&) = delete;
+
+		ArrayWriter&
+		operator= (const ArrayWriter&) = delete;
+
+		///Closes the file, see close ()
+		~ArrayWriter ();
+
+		///Appends the n values starting at values
+		void
+		write (const T* values, size_type n);
+
+		void
+		write (const T& x);
+
+		///Number of values written
+		size_type
+		written () const;
+
+		///Number of values of the array
+		size_type
+		size () const;
+
+		///Flushes the file, throws std::runtime_error if all the values
+		///weren't written, or if the writes failed
+		void
+		close ();
+
+	private:
+		void
+		open_ (const std::string& path, const ArrayFileHeader& header);
+
+		std::ofstream os_;
+		size_type size_;
+		size_type written_;
+
+	};
+
+	///Writes m to path, directly from its storage
+	template <class T, StorageOrder O>
+	void
+	array_write (const std::string& path, const Matrix<T, O>& m);
+
+	///Writes v to path, directly from its storage
+	template <class T>
+	void
+	array_write (const std::string& path, const Vector<T>& v);
+
+
+	///Array file mapped in memory, read-only
+	///Values are only read from the disk when accessed. The views
+	///returned reference the mapping and must not outlive the MappedArray
+	template <class T>
+	class MappedArray
+	{
+
+	public:
+		using size_type = std::size_t;
+
+		///Maps the file at path, throws std::runtime_error if it isn't
+		///an array file of T
+		explicit MappedArray (const std::string& path);
+
+		size_type
+		rows () const;
+
+		size_type
+		cols () const;
+
+		size_type
+		size () const;
+
+		///true for a file written from a Vector
+		bool
+		is_vector () const;
+
+		StorageOrder
+		order () const;
+
+		///Values, in storage order
+		const T*
+		data () const;
+
+		///The array as a rows x cols matrix
+		MatrixView<const T>
+		matrix () const;
+
+		///All the values, in storage order
+		VectorView<const T>
+		vector () const;
+
+		const MappedFile&
+		file () const;
+
+	private:
+		MappedFile file_;
+		ArrayFileHeader header_;
+
+	};
+
+
+	template <class T>
+	ArrayFileHeader
+	ArrayFileHeader::make (std::uint32_t rank, std::uint64_t rows,
+						   std::uint64_t cols, StorageOrder order)
+	{
+		ArrayFileHeader h;
+		std::memcpy (h.magic, "OPLARRAY", 8);
+		h.version = version_current;
+		h.byte_order = byte_order_mark;
+		h.kind = std::is_floating_point<T>::value ? 2
+			: std::is_signed<T>::value ? 1 : 0;
+		h.value_size = sizeof (T);
+		h.order = order == StorageOrder::row_major ? 0 : 1;
+		h.rank = rank;
+		h.rows = rows;
+		h.cols = cols;
+		h.alignment = OPL_ARRAY_FILE_ALIGNMENT;
+		h.offset = (sizeof (ArrayFileHeader) + h.alignment - 1)
+			/ h.alignment * h.alignment;
+		return h;
+	}
+
+	template <class T>
+	void
+	ArrayFileHeader::check (std::size_t file_size) const
+	{
+		ArrayFileHeader ref = make<T> (rank, rows, cols, StorageOrder::row_major);
+		if (std::memcmp (magic, ref.magic, 8))
+			throw std::runtime_error ("array file: bad magic");
+		if (byte_order != byte_order_mark)
+			throw std::runtime_error ("array file: other byte order");
+		if (version > version_current)
+			throw std::runtime_error ("array file: unknown version");
+		if (kind != ref.kind || value_size != ref.value_size)
+			throw std::runtime_error ("array file: other value type");
+		if (order > 1 || rank < 1 || rank > 2 || (rank == 1 && cols != 1))
+			throw std::runtime_error ("array file: bad shape");
+		if (!alignment || offset % alignment || offset % alignof (T)
+			|| offset < sizeof (ArrayFileHeader))
+			throw std::runtime_error ("array file: bad offset");
+
+		if (offset > file_size)
+			throw std::runtime_error ("array file: truncated");
+
+		//rows * cols * value_size must not overflow before the comparison
+		std::uint64_t avail = (file_size - offset) / value_size;
+		if (rows && cols > avail / rows)
+			throw std::runtime_error ("array file: truncated");
+	}
+
+
+	template <class T>
+	ArrayWriter<T>::ArrayWriter (const std::string& path,
+								 size_type rows, size_type cols,
+								 StorageOrder order)
+		: size_ (rows * cols)
+		, written_ (0)
+	{
+		open_ (path, ArrayFileHeader::make<T> (2, rows, cols, order));
+	}
+
+	template <class T>
+	ArrayWriter<T>::ArrayWriter (const std::string& path, size_type n)
+		: size_ (n)
+		, written_ (0)
+	{
+		open_ (path, ArrayFileHeader::make<T> (1, n, 1,
+											   StorageOrder::row_major));
+	}
+
+	template <class T>
+	ArrayWriter<T>::~ArrayWriter ()
+	{
+		if (os_.is_open ())
+			os_.close ();
+	}
+
+	template <class T>
+	void
+	ArrayWriter<T>::write (const T* values, size_type n)
+	{
+		assert (written_ + n <= size_);
+		os_.write (reinterpret_cast<const char*> (values), n * sizeof (T));
+		written_ += n;
+	}
+
+	template <class T>
+	void
+	ArrayWriter<T>::write (const T& x)
+	{
+		write (&x, 1);
+	}
+
+	template <class T>
+	typename ArrayWriter<T>::size_type
+	ArrayWriter<T>::written () const
+	{
+		return written_;
+	}
+
+	template <class T>
+	typename ArrayWriter<T>::size_type
+	ArrayWriter<T>::size () const
+	{
+		return size_;
+	}
+
+	template <class T>
+	void
+	ArrayWriter<T>::close ()
+	{
+		os_.close ();
+		if (written_ != size_)
+			throw std::runtime_error ("ArrayWriter: missing values");
+		if (os_.fail ())
+			throw std::runtime_error ("ArrayWriter: write error");
+	}
+
+	template <class T>
+	void
+	ArrayWriter<T>::open_ (const std::string& path,
+						   const ArrayFileHeader& header)
+	{
+		os_.open (path, std::ios::out | std::ios::binary | std::ios::trunc);
+		if (!os_)
+			throw std::runtime_error ("ArrayWriter: cannot open " + path);
+		os_.write (reinterpret_cast<const char*> (&header), sizeof (header));
+		for (std::uint64_t i = sizeof (header); i < header.offset; ++i)
+			os_.put (0);
+	}
+
+
+	template <class T, StorageOrder O>
+	void
+	array_write (const std::string& path, const Matrix<T, O>& m)
+	{
+		ArrayWriter<T> w (path, m.rows (), m.cols (), O);
+		w.write (m.data (), m.size ());
+		w.close ();
+	}
+
+	template <class T>
+	void
+	array_write (const std::string& path, const Vector<T>& v)
+	{
+		ArrayWriter<T> w (path, v.size ());
+		w.write (v.data (), v.size ());
+		w.close ();
+	}
+
+
+	template <class T>
+	MappedArray<T>::MappedArray (const std::string& path)
+		: file_ (path)
+	{
+		if (file_.size () < sizeof (ArrayFileHeader))
+			throw std::runtime_error ("array file: truncated");
+		std::memcpy (&header_, file_.data (), sizeof (header_));
+		header_.check<T> (file_.size ());
+	}
+
+	template <class T>
+	typename MappedArray<T>::size_type
+	MappedArray<T>::rows () const
+	{
+		return header_.rows;
+	}
+
+	template <class T>
+	typename MappedArray<T>::size_type
+	MappedArray<T>::cols () const
+	{
+		return header_.cols;
+	}
+
+	template <class T>
+	typename MappedArray<T>::size_type
+	MappedArray<T>::size () const
+	{
+		return header_.rows * header_.cols;
+	}
+
+	template <class T>
+	bool
+	MappedArray<T>::is_vector () const
+	{
+		return header_.rank == 1;
+	}
+
+	template <class T>
+	StorageOrder
+	MappedArray<T>::order () const
+	{
+		return header_.order ? StorageOrder::col_major
+			: StorageOrder::row_major;
+	}
+
+	template <class T>
+	const T*
+	MappedArray<T>::data () const
+	{
+		return reinterpret_cast<const T*> (file_.data () + header_.offset);
+	}
+
+	template <class T>
+	MatrixView<const T>
+	MappedArray<T>::matrix () const
+	{
+		if (order () == StorageOrder::row_major)
+			return MatrixView<const T> (data (), rows (), cols (), cols (), 1);
+		return MatrixView<const T> (data (), rows (), cols (), 1, rows ());
+	}
+
+	template <class T>
+	VectorView<const T>
+	MappedArray<T>::vector () const
+	{
+		return VectorView<const T> (data (), size ());
+	}
+
+	template <class T>
+	const MappedFile&
+	MappedArray<T>::file () const
+	{
+		return file_;
+	}
+
+}
+
+#endif //!ARRAY_FILE_HH_
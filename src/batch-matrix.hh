@@ -0,0 +1,508 @@
+/** @file BatchMatrix class definition and batched factorizations
+ *
+ * A BatchMatrix holds many matrices of the same dimensions, interleaved
+ * (structure of arrays): value (i, j) of all the matrices is stored
+ * contiguously, at data () + (i * cols + j) * batch.
+ * The batched kernels below work on one SIMD register of matrices at once:
+ * lane l belongs to matrix k + l, and every operation on a value is done
+ * for all the lanes. There are no branches on the values: pivot choices
+ * are lane selections. The registers of the batch are split over the
+ * threads of the parallel backend, matrices left after the last full
+ * register go through the same code one lane at a time.
+ * Meant for many tiny systems (3x3, 6x6), where a Matrix per system would
+ * pay one allocation and scalar code for a few dozen operations.
+ */
+
+#ifndef BATCH_MATRIX_HH_
+# define BATCH_MATRIX_HH_
+
+# include <algorithm>
+# include <cassert>
+# include <cstddef>
+# include <vector>
+# include "matrix.hh"
+# include "parallel.hh"
+# include "simd-reduce.hh"
+# include "vector.hh"
+
+namespace opl
+{
+
+	template <class T>
+	class BatchMatrix
+	{
+
+	public:
+		typedef T value_type;
+		typedef std::size_t size_type;
+
+		///batch null matrices of rows x cols
+		BatchMatrix (size_type batch, size_type rows, size_type cols);
+
+		///Number of matrices
+		size_type
+		batch () const;
+
+		size_type
+		rows () const;
+
+		size_type
+		cols () const;
+
+		T*
+		data ();
+
+		const T*
+		data () const;
+
+		///Value (i, j) of matrix k
+		T&
+		at (size_type k, size_type i, size_type j);
+
+		const T&
+		at (size_type k, size_type i, size_type j) const;
+
+		///Copies m, of the same dimensions, into matrix k
+		template <StorageOrder O>
+		void
+		set (size_type k, const Matrix<T, O>& m);
+
+		Matrix<T>
+		matrix_get (size_type k) const;
+
+	private:
+		size_type batch_;
+		size_type rows_;
+		size_type cols_;
+		std::vector<T> data_;
+
+	};
+
+
+	template <class T>
+	BatchMatrix<T>::BatchMatrix (size_type batch, size_type rows,
+								 size_type cols)
+		: batch_ (batch)
+		, rows_ (rows)
+		, cols_ (cols)
+		, data_ (batch * rows * cols, static_cast<T> (0))
+	{
+
+	}
+
+	template <class T>
+	typename BatchMatrix<T>::size_type
+	BatchMatrix<T>::batch () const
+	{
+		return batch_;
+	}
+
+	template <class T>
+	typename BatchMatrix<T>::size_type
+	BatchMatrix<T>::rows () const
+	{
+		return rows_;
+	}
+
+	template <class T>
+	typename BatchMatrix<T>::size_type
+	BatchMatrix<T>::cols () const
+	{
+		return cols_;
+	}
+
+	template <class T>
+	T*
+	BatchMatrix<T>::data ()
+	{
+		return data_.data ();
+	}
+
+	template <class T>
+	const T*
+	BatchMatrix<T>::data () const
+	{
+		return data_.data ();
+	}
+
+	template <class T>
+	T&
+	BatchMatrix<T>::at (size_type k, size_type i, size_type j)
+	{
+		assert (k < batch_ && i < rows_ && j < cols_);
+		return data_[(i * cols_ + j) * batch_ + k];
+	}
+
+	template <class T>
+	const T&
+	BatchMatrix<T>::at (size_type k, size_type i, size_type j) const
+	{
+		assert (k < batch_ && i < rows_ && j < cols_);
+		return data_[(i * cols_ + j) * batch_ + k];
+	}
+
+	template <class T>
+	template <StorageOrder O>
+	void
+	BatchMatrix<T>::set (size_type k, const Matrix<T, O>& m)
+	{
+		assert (m.rows () == rows_ && m.cols () == cols_);
+		for (size_type i = 0; i < rows_; ++i)
+			for (size_type j = 0; j < cols_; ++j)
+				at (k, i, j) = m.at (i, j);
+	}
+
+	template <class T>
+	Matrix<T>
+	BatchMatrix<T>::matrix_get (size_type k) const
+	{
+		Matrix<T> m (rows_, cols_);
+		for (size_type i = 0; i < rows_; ++i)
+			for (size_type j = 0; j < cols_; ++j)
+				m.at (i, j) = at (k, i, j);
+		return m;
+	}
+
+
+	namespace linalg
+	{
+
+		///Calls f (simd::Ops<T> (), k) for each full register of matrices
+		///starting at k, then f (simd::Scalar<T> (), k) for the others
+		///cost is the work for one matrix, in multiply-adds
+		template <class T, class F>
+		void
+		batch_for_ (std::size_t batch, std::size_t cost, F f)
+		{
+			constexpr std::size_t w = simd::Ops<T>::width;
+			std::size_t regs = batch / w;
+			parallel::for_range (regs, regs * w * cost,
+								 [&](std::size_t r0, std::size_t r1) {
+					for (std::size_t r = r0; r < r1; ++r)
+						f (simd::Ops<T> (), r * w);
+				});
+			for (std::size_t k = regs * w; k < batch; ++k)
+				f (simd::Scalar<T> (), k);
+		}
+
+		///LU of the n x n matrices at a (stride nb between two values),
+		///pivots stored in piv, returns the sign of the permutations
+		template <class S, class T>
+		typename S::reg
+		batch_lu_ (std::size_t n, T* a, T* piv, std::size_t nb)
+		{
+			typedef typename S::reg reg;
+			typedef typename S::mask mask;
+			reg zero = S::zero ();
+			reg one = S::set1 (static_cast<T> (1));
+			reg sign = one;
+
+			for (std::size_t j = 0; j < n; ++j)
+			{
+				T* aj = a + j * n * nb;
+				reg best = S::abs (S::load (aj + j * nb));
+				reg p = S::set1 (static_cast<T> (j));
+				for (std::size_t i = j + 1; i < n; ++i)
+				{
+					reg v = S::abs (S::load (a + (i * n + j) * nb));
+					mask m = S::gt (v, best);
+					best = S::select (m, v, best);
+					p = S::select (m, S::set1 (static_cast<T> (i)), p);
+				}
+				S::store (piv + j * nb, p);
+				sign = S::select (S::eq (p, S::set1 (static_cast<T> (j))),
+								  sign, S::sub (zero, sign));
+
+				//Row j is swapped with row p in the lanes where p == i
+				for (std::size_t i = j + 1; i < n; ++i)
+				{
+					mask m = S::eq (p, S::set1 (static_cast<T> (i)));
+					T* ai = a + i * n * nb;
+					for (std::size_t c = 0; c < n; ++c)
+					{
+						reg x = S::load (aj + c * nb);
+						reg y = S::load (ai + c * nb);
+						S::store (aj + c * nb, S::select (m, y, x));
+						S::store (ai + c * nb, S::select (m, x, y));
+					}
+				}
+
+				//A zero pivot has a null column under it: dividing by 1
+				//leaves it as is
+				reg d = S::load (aj + j * nb);
+				d = S::select (S::gt (S::abs (d), zero), d, one);
+				for (std::size_t i = j + 1; i < n; ++i)
+				{
+					T* ai = a + i * n * nb;
+					reg l = S::div (S::load (ai + j * nb), d);
+					S::store (ai + j * nb, l);
+					for (std::size_t c = j + 1; c < n; ++c)
+						S::store (ai + c * nb,
+								  S::sub (S::load (ai + c * nb),
+										  S::mul (l, S::load (aj + c * nb))));
+				}
+			}
+
+			return sign;
+		}
+
+		///Solves the n x m systems at b with the factors of batch_lu_
+		template <class S, class T>
+		void
+		batch_lu_solve_ (std::size_t n, std::size_t m, const T* lu,
+						 const T* piv, T* b, std::size_t nb)
+		{
+			typedef typename S::reg reg;
+
+			for (std::size_t j = 0; j < n; ++j)
+			{
+				reg p = S::load (piv + j * nb);
+				T* bj = b + j * m * nb;
+				for (std::size_t i = j + 1; i < n; ++i)
+				{
+					typename S::mask s = S::eq (p, S::set1 (static_cast<T> (i)));
+					T* bi = b + i * m * nb;
+					for (std::size_t c = 0; c < m; ++c)
+					{
+						reg x = S::load (bj + c * nb);
+						reg y = S::load (bi + c * nb);
+						S::store (bj + c * nb, S::select (s, y, x));
+						S::store (bi + c * nb, S::select (s, x, y));
+					}
+				}
+			}
+
+			for (std::size_t i = 1; i < n; ++i)
+				for (std::size_t k = 0; k < i; ++k)
+				{
+					reg l = S::load (lu + (i * n + k) * nb);
+					for (std::size_t c = 0; c < m; ++c)
+						S::store (b + (i * m + c) * nb,
+								  S::sub (S::load (b + (i * m + c) * nb),
+										  S::mul (l, S::load (b + (k * m + c) * nb))));
+				}
+
+			for (std::size_t i = n; i-- > 0;)
+			{
+				for (std::size_t k = i + 1; k < n; ++k)
+				{
+					reg u = S::load (lu + (i * n + k) * nb);
+					for (std::size_t c = 0; c < m; ++c)
+						S::store (b + (i * m + c) * nb,
+								  S::sub (S::load (b + (i * m + c) * nb),
+										  S::mul (u, S::load (b + (k * m + c) * nb))));
+				}
+				reg d = S::load (lu + (i * n + i) * nb);
+				for (std::size_t c = 0; c < m; ++c)
+					S::store (b + (i * m + c) * nb,
+							  S::div (S::load (b + (i * m + c) * nb), d));
+			}
+		}
+
+		///Cholesky of the n x n matrices at a, the upper part is zeroed
+		template <class S, class T>
+		void
+		batch_cholesky_ (std::size_t n, T* a, std::size_t nb)
+		{
+			typedef typename S::reg reg;
+
+			for (std::size_t j = 0; j < n; ++j)
+			{
+				T* aj = a + j * n * nb;
+				reg d = S::load (aj + j * nb);
+				for (std::size_t k = 0; k < j; ++k)
+				{
+					reg x = S::load (aj + k * nb);
+					d = S::sub (d, S::mul (x, x));
+				}
+				d = S::sqrt (d);
+				S::store (aj + j * nb, d);
+				for (std::size_t c = j + 1; c < n; ++c)
+					S::store (aj + c * nb, S::zero ());
+
+				for (std::size_t i = j + 1; i < n; ++i)
+				{
+					T* ai = a + i * n * nb;
+					reg v = S::load (ai + j * nb);
+					for (std::size_t k = 0; k < j; ++k)
+						v = S::sub (v, S::mul (S::load (ai + k * nb),
+											   S::load (aj + k * nb)));
+					S::store (ai + j * nb, S::div (v, d));
+				}
+			}
+		}
+
+		///Solves the n x m systems LL^T X = B at b
+		template <class S, class T>
+		void
+		batch_cholesky_solve_ (std::size_t n, std::size_t m, const T* l,
+							   T* b, std::size_t nb)
+		{
+			typedef typename S::reg reg;
+
+			for (std::size_t i = 0; i < n; ++i)
+			{
+				for (std::size_t k = 0; k < i; ++k)
+				{
+					reg x = S::load (l + (i * n + k) * nb);
+					for (std::size_t c = 0; c < m; ++c)
+						S::store (b + (i * m + c) * nb,
+								  S::sub (S::load (b + (i * m + c) * nb),
+										  S::mul (x, S::load (b + (k * m + c) * nb))));
+				}
+				reg d = S::load (l + (i * n + i) * nb);
+				for (std::size_t c = 0; c < m; ++c)
+					S::store (b + (i * m + c) * nb,
+							  S::div (S::load (b + (i * m + c) * nb), d));
+			}
+
+			for (std::size_t i = n; i-- > 0;)
+			{
+				for (std::size_t k = i + 1; k < n; ++k)
+				{
+					reg x = S::load (l + (k * n + i) * nb);
+					for (std::size_t c = 0; c < m; ++c)
+						S::store (b + (i * m + c) * nb,
+								  S::sub (S::load (b + (i * m + c) * nb),
+										  S::mul (x, S::load (b + (k * m + c) * nb))));
+				}
+				reg d = S::load (l + (i * n + i) * nb);
+				for (std::size_t c = 0; c < m; ++c)
+					S::store (b + (i * m + c) * nb,
+							  S::div (S::load (b + (i * m + c) * nb), d));
+			}
+		}
+
+
+		///PA = LU of each matrix, in place, as lu_factorize
+		///Returns the pivots, a batch of n x 1 matrices holding the row
+		///indices as T values
+		template <class T>
+		BatchMatrix<T>
+		batch_lu_factorize (BatchMatrix<T>& a)
+		{
+			assert (a.rows () == a.cols ());
+			std::size_t n = a.rows ();
+			std::size_t nb = a.batch ();
+			BatchMatrix<T> piv (nb, n, 1);
+			batch_for_<T> (nb, n * n * n, [&](auto ops, std::size_t k) {
+					batch_lu_<decltype (ops)> (n, a.data () + k, piv.data () + k,
+											   nb);
+				});
+			return piv;
+		}
+
+		///Solves AX = B in place, with lu and piv computed by
+		///batch_lu_factorize, B is a batch of n x nrhs matrices
+		///Singular matrices give infinite or NaN solutions
+		template <class T>
+		void
+		batch_lu_solve (const BatchMatrix<T>& lu, const BatchMatrix<T>& piv,
+						BatchMatrix<T>& b)
+		{
+			std::size_t n = lu.rows ();
+			std::size_t nb = lu.batch ();
+			assert (piv.batch () == nb && piv.rows () == n);
+			assert (b.batch () == nb && b.rows () == n);
+			std::size_t m = b.cols ();
+			batch_for_<T> (nb, n * n * m, [&](auto ops, std::size_t k) {
+					batch_lu_solve_<decltype (ops)> (n, m, lu.data () + k,
+													 piv.data () + k,
+													 b.data () + k, nb);
+				});
+		}
+
+		///Solves AX = B in place, for each matrix of the batch
+		template <class T>
+		void
+		batch_solve (const BatchMatrix<T>& a, BatchMatrix<T>& b)
+		{
+			BatchMatrix<T> lu (a);
+			BatchMatrix<T> piv = batch_lu_factorize (lu);
+			batch_lu_solve (lu, piv, b);
+		}
+
+		///Inverse of each matrix, singular ones give infinite or NaN values
+		template <class T>
+		BatchMatrix<T>
+		batch_inverse (const BatchMatrix<T>& a)
+		{
+			std::size_t n = a.rows ();
+			std::size_t nb = a.batch ();
+			BatchMatrix<T> res (nb, n, n);
+			for (std::size_t i = 0; i < n; ++i)
+				std::fill_n (res.data () + i * (n + 1) * nb, nb,
+							 static_cast<T> (1));
+			batch_solve (a, res);
+			return res;
+		}
+
+		///Determinant of each matrix
+		template <class T>
+		Vector<T>
+		batch_determinant (const BatchMatrix<T>& a)
+		{
+			assert (a.rows () == a.cols ());
+			std::size_t n = a.rows ();
+			std::size_t nb = a.batch ();
+			BatchMatrix<T> lu (a);
+			BatchMatrix<T> piv (nb, n, 1);
+			Vector<T> res (nb);
+			batch_for_<T> (nb, n * n * n, [&](auto ops, std::size_t k) {
+					using S = decltype (ops);
+					typename S::reg det = batch_lu_<S> (n, lu.data () + k,
+														piv.data () + k, nb);
+					for (std::size_t i = 0; i < n; ++i)
+						det = S::mul (det, S::load (lu.data () + k
+													+ i * (n + 1) * nb));
+					S::store (res.data () + k, det);
+				});
+			return res;
+		}
+
+		///A = LL^T for each matrix, A <- L in place (upper part zeroed)
+		///Returns the number of matrices not symmetric positive definite,
+		///their factors hold NaN values
+		template <class T>
+		std::size_t
+		batch_cholesky_factorize (BatchMatrix<T>& a)
+		{
+			assert (a.rows () == a.cols ());
+			std::size_t n = a.rows ();
+			std::size_t nb = a.batch ();
+			batch_for_<T> (nb, n * n * n / 3, [&](auto ops, std::size_t k) {
+					batch_cholesky_<decltype (ops)> (n, a.data () + k, nb);
+				});
+
+			std::size_t fails = 0;
+			for (std::size_t k = 0; k < nb; ++k)
+				for (std::size_t i = 0; i < n; ++i)
+					if (!(a.at (k, i, i) > static_cast<T> (0)))
+					{
+						++fails;
+						break;
+					}
+			return fails;
+		}
+
+		///Solves AX = B in place, with l computed by
+		///batch_cholesky_factorize, B is a batch of n x nrhs matrices
+		template <class T>
+		void
+		batch_cholesky_solve (const BatchMatrix<T>& l, BatchMatrix<T>& b)
+		{
+			std::size_t n = l.rows ();
+			std::size_t nb = l.batch ();
+			assert (b.batch () == nb && b.rows () == n);
+			std::size_t m = b.cols ();
+			batch_for_<T> (nb, 2 * n * n * m, [&](auto ops, std::size_t k) {
+					batch_cholesky_solve_<decltype (ops)> (n, m, l.data () + k,
+														   b.data () + k, nb);
+				});
+		}
+
+	}
+
+}
+
+#endif //!BATCH_MATRIX_HH_
@@ -0,0 +1,144 @@
+#include <stdexcept>
+#include "block-file.hh"
+#include "system.hh"
+
+#if defined (PLATFORM_UNIX_)
+# include <fcntl.h>
+# include <sys/stat.h>
+# include <unistd.h>
+#endif
+
+
+namespace opl
+{
+
+	BlockFile::BlockFile (const std::string& path, bool create)
+		: path_ (path)
+		, fd_ (-1)
+	{
+
+#if defined (PLATFORM_UNIX_)
+
+		int flags = create ? O_RDWR | O_CREAT | O_TRUNC : O_RDWR;
+		fd_ = open (path.c_str (), flags, 0644);
+		if (fd_ < 0)
+			throw std::runtime_error ("BlockFile: cannot open " + path);
+
+#else
+
+		(void) create;
+		throw std::runtime_error ("BlockFile win not implemented");
+
+#endif
+
+	}
+
+	BlockFile::~BlockFile ()
+	{
+
+#if defined (PLATFORM_UNIX_)
+
+		if (fd_ >= 0)
+			close (fd_);
+
+#endif
+
+	}
+
+	void
+	BlockFile::read (std::size_t offset, void* data, std::size_t n) const
+	{
+
+#if defined (PLATFORM_UNIX_)
+
+		char* p = static_cast<char*> (data);
+		while (n)
+		{
+			ssize_t r = pread (fd_, p, n, offset);
+			if (r <= 0)
+				throw std::runtime_error ("BlockFile: read error " + path_);
+			p += r;
+			offset += r;
+			n -= r;
+		}
+
+#else
+
+		(void) offset;
+		(void) data;
+		(void) n;
+
+#endif
+
+	}
+
+	void
+	BlockFile::write (std::size_t offset, const void* data, std::size_t n)
+	{
+
+#if defined (PLATFORM_UNIX_)
+
+		const char* p = static_cast<const char*> (data);
+		while (n)
+		{
+			ssize_t r = pwrite (fd_, p, n, offset);
+			if (r <= 0)
+				throw std::runtime_error ("BlockFile: write error " + path_);
+			p += r;
+			offset += r;
+			n -= r;
+		}
+
+#else
+
+		(void) offset;
+		(void) data;
+		(void) n;
+
+#endif
+
+	}
+
+	void
+	BlockFile::resize (std::size_t n)
+	{
+
+#if defined (PLATFORM_UNIX_)
+
+		if (ftruncate (fd_, n))
+			throw std::runtime_error ("BlockFile: resize error " + path_);
+
+#else
+
+		(void) n;
+
+#endif
+
+	}
+
+	std::size_t
+	BlockFile::size () const
+	{
+
+#if defined (PLATFORM_UNIX_)
+
+		struct stat buffer;
+		if (fstat (fd_, &buffer))
+			throw std::runtime_error ("BlockFile: stat error " + path_);
+		return buffer.st_size;
+
+#else
+
+		return 0;
+
+#endif
+
+	}
+
+	const std::string&
+	BlockFile::path () const
+	{
+		return path_;
+	}
+
+}
@@ -0,0 +1,59 @@
+/** @file BlockFile class definition
+ *
+ * Binary file read and written at explicit offsets (pread / pwrite).
+ * There is no shared file position: reads and writes of disjoint ranges
+ * can run from several threads at once.
+ */
+
+#ifndef BLOCK_FILE_HH_
+# define BLOCK_FILE_HH_
+
+# include <cstddef>
+# include <string>
+
+namespace opl
+{
+
+	class BlockFile
+	{
+
+	public:
+		///Opens the file at path for reading and writing, it is created
+		///(or truncated) if create is true
+		///Throws std::runtime_error on failure
+		BlockFile (const std::string& path, bool create);
+
+		BlockFile (const BlockFile&) = delete;
+
+		BlockFile&
+		operator= (const BlockFile&) = delete;
+
+		~BlockFile ();
+
+		///Reads n bytes at offset, throws std::runtime_error on failure
+		void
+		read (std::size_t offset, void* data, std::size_t n) const;
+
+		///Writes n bytes at offset, throws std::runtime_error on failure
+		void
+		write (std::size_t offset, const void* data, std::size_t n);
+
+		///Grows or shrinks the file, new bytes are zero
+		void
+		resize (std::size_t n);
+
+		std::size_t
+		size () const;
+
+		const std::string&
+		path () const;
+
+	private:
+		std::string path_;
+		int fd_;
+
+	};
+
+}
+
+#endif //!BLOCK_FILE_HH_
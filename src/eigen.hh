@@ -0,0 +1,770 @@
+/** @file Eigenvalue kernels
+ *
+ * Symmetric matrices are reduced to tridiagonal form, then diagonalized by
+ * implicit QR steps with a Wilkinson shift. Other matrices are reduced to
+ * upper Hessenberg form, then to real Schur form by Francis double shift
+ * QR steps. Both iterate on O(n) (tridiagonal) or O(n^2) (Hessenberg)
+ * values per sweep, deflate as soon as a subdiagonal value vanishes, and
+ * only accumulate the orthogonal transforms when eigenvectors are wanted.
+ * hessenberg_shift_step is a single QR step with given shifts, as the
+ * implicitly restarted Krylov eigensolvers need.
+ * Matrices are row-major n x n.
+ */
+
+#ifndef EIGEN_HH_
+# define EIGEN_HH_
+
+# include <algorithm>
+# include <cmath>
+# include <complex>
+# include <cstddef>
+# include <limits>
+# include <vector>
+# include "parallel.hh"
+
+///Maximum number of QR sweeps per eigenvalue
+# define OPL_EIGEN_MAX_SWEEPS 30
+
+namespace opl
+{
+
+	namespace linalg
+	{
+
+		///Turns x (len values, stride incx) into the reflector H = I - tau v v^T
+		///with H x = beta e0: x[0] <- beta, x[1:] <- v[1:] (v[0] = 1)
+		///Returns tau, 0 if x is already a multiple of e0
+		template <class T>
+		T
+		make_reflector_ (std::size_t len, T* x, std::size_t incx)
+		{
+			T xnorm2 = 0;
+			for (std::size_t i = 1; i < len; ++i)
+				xnorm2 += x[i * incx] * x[i * incx];
+			if (xnorm2 == static_cast<T> (0))
+				return 0;
+
+			T alpha = x[0];
+			T norm = std::sqrt (alpha * alpha + xnorm2);
+			T beta = alpha >= 0 ? -norm : norm;
+			T scale = 1 / (alpha - beta);
+			for (std::size_t i = 1; i < len; ++i)
+				x[i * incx] *= scale;
+			x[0] = beta;
+			return (beta - alpha) / beta;
+		}
+
+		///Reduces the symmetric A to tridiagonal form A = Q T Q^T
+		///d (n values) gets the diagonal of T, e (n - 1 values) its subdiagonal
+		///If z is not null, it gets Q^T (n x n), A is destroyed
+		template <class T>
+		void
+		tridiagonal_reduce (std::size_t n, T* a, std::size_t lda,
+							T* d, T* e, T* z, std::size_t ldz)
+		{
+			std::vector<T> v (n);
+			std::vector<T> w (n);
+
+			if (z)
+				for (std::size_t i = 0; i < n; ++i)
+					for (std::size_t j = 0; j < n; ++j)
+						z[i * ldz + j] = i == j ? static_cast<T> (1)
+							: static_cast<T> (0);
+
+			for (std::size_t k = 0; k + 2 < n; ++k)
+			{
+				std::size_t k1 = k + 1;
+				std::size_t len = n - k1;
+				T tau = make_reflector_ (len, a + k1 * lda + k, lda);
+				if (tau == static_cast<T> (0))
+					continue;
+
+				v[0] = 1;
+				for (std::size_t i = 1; i < len; ++i)
+				{
+					v[i] = a[(k1 + i) * lda + k];
+					a[(k1 + i) * lda + k] = 0;
+				}
+
+				//A22 <- H A22 H = A22 - v w^T - w v^T,
+				//with p = tau A22 v and w = p - tau / 2 (p.v) v
+				parallel::for_range (len, len * len,
+									 [&](std::size_t i0, std::size_t i1) {
+						for (std::size_t i = i0; i < i1; ++i)
+						{
+							const T* ai = a + (k1 + i) * lda + k1;
+							T val = 0;
+							for (std::size_t j = 0; j < len; ++j)
+								val += ai[j] * v[j];
+							w[i] = tau * val;
+						}
+					});
+				T pv = 0;
+				for (std::size_t i = 0; i < len; ++i)
+					pv += w[i] * v[i];
+				for (std::size_t i = 0; i < len; ++i)
+					w[i] -= tau / 2 * pv * v[i];
+
+				parallel::for_range (len, len * len,
+									 [&](std::size_t i0, std::size_t i1) {
+						for (std::size_t i = i0; i < i1; ++i)
+						{
+							T* ai = a + (k1 + i) * lda + k1;
+							for (std::size_t j = 0; j < len; ++j)
+								ai[j] -= v[i] * w[j] + w[i] * v[j];
+						}
+					});
+
+				//Z <- H Z
+				if (z)
+					parallel::for_range (n, len * n,
+										 [&](std::size_t j0, std::size_t j1) {
+							std::vector<T> s (j1 - j0, static_cast<T> (0));
+							for (std::size_t i = 0; i < len; ++i)
+							{
+								const T* zi = z + (k1 + i) * ldz;
+								for (std::size_t j = j0; j < j1; ++j)
+									s[j - j0] += v[i] * zi[j];
+							}
+							for (std::size_t i = 0; i < len; ++i)
+							{
+								T* zi = z + (k1 + i) * ldz;
+								T tv = tau * v[i];
+								for (std::size_t j = j0; j < j1; ++j)
+									zi[j] -= tv * s[j - j0];
+							}
+						});
+			}
+
+			for (std::size_t i = 0; i < n; ++i)
+				d[i] = a[i * lda + i];
+			for (std::size_t i = 0; i + 1 < n; ++i)
+				e[i] = a[(i + 1) * lda + i];
+		}
+
+		///Diagonalizes the symmetric tridiagonal (d, e) with implicit
+		///Wilkinson shifted QR steps, d gets the eigenvalues and e is destroyed
+		///If z is not null, its rows are rotated along, so that with Q^T
+		///from tridiagonal_reduce, row i of z is the eigenvector of d[i]
+		///Returns false if an eigenvalue did not converge
+		template <class T>
+		bool
+		tridiagonal_qr (std::size_t n, T* d, T* e, T* z, std::size_t ldz)
+		{
+			const T eps = std::numeric_limits<T>::epsilon ();
+			std::size_t h = n ? n - 1 : 0;
+			std::size_t sweeps = 0;
+
+			while (h > 0)
+			{
+				if (std::abs (e[h - 1])
+					<= eps * (std::abs (d[h - 1]) + std::abs (d[h])))
+				{
+					e[h - 1] = 0;
+					--h;
+					sweeps = 0;
+					continue;
+				}
+
+				if (++sweeps > OPL_EIGEN_MAX_SWEEPS)
+					return false;
+
+				std::size_t l = h - 1;
+				while (l > 0 && std::abs (e[l - 1])
+					   > eps * (std::abs (d[l - 1]) + std::abs (d[l])))
+					--l;
+
+				//Wilkinson shift: eigenvalue of the trailing 2 x 2 closest to d[h]
+				T dd = (d[h - 1] - d[h]) / 2;
+				T eh = e[h - 1];
+				T r = std::sqrt (dd * dd + eh * eh);
+				T mu = d[h] - eh * eh / (dd + (dd >= 0 ? r : -r));
+
+				T x = d[l] - mu;
+				T y = e[l];
+				for (std::size_t k = l; k < h; ++k)
+				{
+					//G = [c s; -s c] with G [x; y] = [r; 0], T <- G T G^T
+					r = std::sqrt (x * x + y * y);
+					T c = r == static_cast<T> (0) ? static_cast<T> (1) : x / r;
+					T s = r == static_cast<T> (0) ? static_cast<T> (0) : y / r;
+					if (k > l)
+						e[k - 1] = r;
+
+					T a = d[k];
+					T b = e[k];
+					T cc = d[k + 1];
+					d[k] = c * c * a + 2 * c * s * b + s * s * cc;
+					d[k + 1] = s * s * a - 2 * c * s * b + c * c * cc;
+					e[k] = c * s * (cc - a) + (c * c - s * s) * b;
+
+					if (k + 1 < h)
+					{
+						x = e[k];
+						y = s * e[k + 1];
+						e[k + 1] *= c;
+					}
+
+					if (z)
+					{
+						T* zk = z + k * ldz;
+						T* zk1 = zk + ldz;
+						for (std::size_t j = 0; j < n; ++j)
+						{
+							T zkj = zk[j];
+							zk[j] = c * zkj + s * zk1[j];
+							zk1[j] = c * zk1[j] - s * zkj;
+						}
+					}
+				}
+			}
+
+			return true;
+		}
+
+		///Reduces A to upper Hessenberg form A = U H U^T, H overwrites A
+		///If u is not null, it gets U (n x n)
+		template <class T>
+		void
+		hessenberg_reduce (std::size_t n, T* a, std::size_t lda,
+						   T* u, std::size_t ldu)
+		{
+			std::vector<T> v (n);
+			std::vector<T> w (n);
+
+			if (u)
+				for (std::size_t i = 0; i < n; ++i)
+					for (std::size_t j = 0; j < n; ++j)
+						u[i * ldu + j] = i == j ? static_cast<T> (1)
+							: static_cast<T> (0);
+
+			for (std::size_t k = 0; k + 2 < n; ++k)
+			{
+				std::size_t k1 = k + 1;
+				std::size_t len = n - k1;
+				T tau = make_reflector_ (len, a + k1 * lda + k, lda);
+				if (tau == static_cast<T> (0))
+					continue;
+
+				v[0] = 1;
+				for (std::size_t i = 1; i < len; ++i)
+				{
+					v[i] = a[(k1 + i) * lda + k];
+					a[(k1 + i) * lda + k] = 0;
+				}
+
+				//A[k1:n, k1:n] <- H A[k1:n, k1:n]
+				std::fill (w.begin (), w.end (), static_cast<T> (0));
+				for (std::size_t i = 0; i < len; ++i)
+				{
+					const T* ai = a + (k1 + i) * lda;
+					for (std::size_t j = k1; j < n; ++j)
+						w[j] += v[i] * ai[j];
+				}
+				parallel::for_range (len, len * len,
+									 [&](std::size_t i0, std::size_t i1) {
+						for (std::size_t i = i0; i < i1; ++i)
+						{
+							T* ai = a + (k1 + i) * lda;
+							T tv = tau * v[i];
+							for (std::size_t j = k1; j < n; ++j)
+								ai[j] -= tv * w[j];
+						}
+					});
+
+				//A[:, k1:n] <- A[:, k1:n] H, and U <- U H
+				auto right = [&](T* m, std::size_t ldm) {
+					parallel::for_range (n, n * len,
+										 [&](std::size_t i0, std::size_t i1) {
+							for (std::size_t i = i0; i < i1; ++i)
+							{
+								T* mi = m + i * ldm + k1;
+								T s = 0;
+								for (std::size_t j = 0; j < len; ++j)
+									s += mi[j] * v[j];
+								s *= tau;
+								for (std::size_t j = 0; j < len; ++j)
+									mi[j] -= s * v[j];
+							}
+						});
+				};
+				right (a, lda);
+				if (u)
+					right (u, ldu);
+			}
+		}
+
+		///Reduces the upper Hessenberg H to real Schur form H = U T U^T with
+		///Francis double shift QR steps, T overwrites H
+		///T is upper triangular, but for a 2 x 2 diagonal block per complex
+		///conjugate pair of eigenvalues
+		///wr and wi get the real and imaginary parts of the eigenvalues
+		///If u is not null, it is multiplied by U, so that with U from
+		///hessenberg_reduce, A = U T U^T
+		///Returns false if an eigenvalue did not converge
+		template <class T>
+		bool
+		hessenberg_qr (std::size_t n, T* h, std::size_t ldh,
+					   T* u, std::size_t ldu, T* wr, T* wi)
+		{
+			const T eps = std::numeric_limits<T>::epsilon ();
+			auto at = [&](std::size_t i, std::size_t j) -> T& {
+				return h[i * ldh + j];
+			};
+
+			T norm = 0;
+			for (std::size_t i = 0; i < n; ++i)
+				for (std::size_t j = i ? i - 1 : 0; j < n; ++j)
+					norm += std::abs (at (i, j));
+
+			T exshift = 0;
+			T p = 0;
+			T q = 0;
+			T r = 0;
+			T s = 0;
+			T w = 0;
+			T x = 0;
+			T y = 0;
+			T z = 0;
+			std::size_t iter = 0;
+			std::size_t hi = n - 1;
+
+			while (hi < n)
+			{
+				//Looks for a single small subdiagonal value
+				std::size_t l = hi;
+				while (l > 0)
+				{
+					s = std::abs (at (l - 1, l - 1)) + std::abs (at (l, l));
+					if (s == static_cast<T> (0))
+						s = norm;
+					if (std::abs (at (l, l - 1)) < eps * s)
+						break;
+					--l;
+				}
+
+				if (l > 0)
+					at (l, l - 1) = 0;
+
+				if (l == hi)
+				{
+					//One root found
+					at (hi, hi) += exshift;
+					wr[hi] = at (hi, hi);
+					wi[hi] = 0;
+					--hi;
+					iter = 0;
+					continue;
+				}
+
+				if (l + 1 == hi)
+				{
+					//Two roots found
+					std::size_t lo = hi - 1;
+					w = at (hi, lo) * at (lo, hi);
+					p = (at (lo, lo) - at (hi, hi)) / 2;
+					q = p * p + w;
+					z = std::sqrt (std::abs (q));
+					at (hi, hi) += exshift;
+					at (lo, lo) += exshift;
+					x = at (hi, hi);
+
+					if (q >= 0)
+					{
+						//Real pair, the block is made upper triangular
+						z = p >= 0 ? p + z : p - z;
+						wr[lo] = x + z;
+						wr[hi] = z != static_cast<T> (0) ? x - w / z : wr[lo];
+						wi[lo] = 0;
+						wi[hi] = 0;
+
+						x = at (hi, lo);
+						s = std::abs (x) + std::abs (z);
+						p = x / s;
+						q = z / s;
+						r = std::sqrt (p * p + q * q);
+						p /= r;
+						q /= r;
+
+						for (std::size_t j = lo; j < n; ++j)
+						{
+							z = at (lo, j);
+							at (lo, j) = q * z + p * at (hi, j);
+							at (hi, j) = q * at (hi, j) - p * z;
+						}
+						for (std::size_t i = 0; i <= hi; ++i)
+						{
+							z = at (i, lo);
+							at (i, lo) = q * z + p * at (i, hi);
+							at (i, hi) = q * at (i, hi) - p * z;
+						}
+						if (u)
+							for (std::size_t i = 0; i < n; ++i)
+							{
+								T* ui = u + i * ldu;
+								z = ui[lo];
+								ui[lo] = q * z + p * ui[hi];
+								ui[hi] = q * ui[hi] - p * z;
+							}
+						at (hi, lo) = 0;
+					}
+					else
+					{
+						//Complex pair
+						wr[lo] = x + p;
+						wr[hi] = x + p;
+						wi[lo] = z;
+						wi[hi] = -z;
+					}
+
+					hi -= 2;
+					iter = 0;
+					continue;
+				}
+
+				if (iter >= OPL_EIGEN_MAX_SWEEPS * 2)
+					return false;
+
+				//Shifts from the trailing 2 x 2 block
+				x = at (hi, hi);
+				y = at (hi - 1, hi - 1);
+				w = at (hi, hi - 1) * at (hi - 1, hi);
+
+				//Exceptional shifts, to break cycles
+				if (iter == 10)
+				{
+					exshift += x;
+					for (std::size_t i = 0; i <= hi; ++i)
+						at (i, i) -= x;
+					s = std::abs (at (hi, hi - 1)) + std::abs (at (hi - 1, hi - 2));
+					x = y = static_cast<T> (0.75) * s;
+					w = static_cast<T> (-0.4375) * s * s;
+				}
+				if (iter == 30)
+				{
+					s = (y - x) / 2;
+					s = s * s + w;
+					if (s > 0)
+					{
+						s = std::sqrt (s);
+						if (y < x)
+							s = -s;
+						s = x - w / ((y - x) / 2 + s);
+						for (std::size_t i = 0; i <= hi; ++i)
+							at (i, i) -= s;
+						exshift += s;
+						x = y = w = static_cast<T> (0.964);
+					}
+				}
+				++iter;
+
+				//Looks for two consecutive small subdiagonal values
+				std::size_t m = hi - 2;
+				while (true)
+				{
+					z = at (m, m);
+					r = x - z;
+					s = y - z;
+					p = (r * s - w) / at (m + 1, m) + at (m, m + 1);
+					q = at (m + 1, m + 1) - z - r - s;
+					r = at (m + 2, m + 1);
+					s = std::abs (p) + std::abs (q) + std::abs (r);
+					p /= s;
+					q /= s;
+					r /= s;
+					if (m == l)
+						break;
+					if (std::abs (at (m, m - 1)) * (std::abs (q) + std::abs (r))
+						< eps * (std::abs (p) * (std::abs (at (m - 1, m - 1))
+												 + std::abs (z)
+												 + std::abs (at (m + 1, m + 1)))))
+						break;
+					--m;
+				}
+
+				for (std::size_t i = m + 2; i <= hi; ++i)
+				{
+					at (i, i - 2) = 0;
+					if (i > m + 2)
+						at (i, i - 3) = 0;
+				}
+
+				//Double shift QR step on rows and columns m to hi
+				for (std::size_t k = m; k < hi; ++k)
+				{
+					bool notlast = k + 1 != hi;
+					if (k != m)
+					{
+						p = at (k, k - 1);
+						q = at (k + 1, k - 1);
+						r = notlast ? at (k + 2, k - 1) : static_cast<T> (0);
+						x = std::abs (p) + std::abs (q) + std::abs (r);
+						if (x == static_cast<T> (0))
+							continue;
+						p /= x;
+						q /= x;
+						r /= x;
+					}
+
+					s = std::sqrt (p * p + q * q + r * r);
+					if (p < 0)
+						s = -s;
+					if (s == static_cast<T> (0))
+						continue;
+
+					if (k != m)
+						at (k, k - 1) = -s * x;
+					else if (l != m)
+						at (k, k - 1) = -at (k, k - 1);
+					p += s;
+					x = p / s;
+					y = q / s;
+					z = r / s;
+					q /= p;
+					r /= p;
+
+					for (std::size_t j = k; j < n; ++j)
+					{
+						p = at (k, j) + q * at (k + 1, j);
+						if (notlast)
+						{
+							p += r * at (k + 2, j);
+							at (k + 2, j) -= p * z;
+						}
+						at (k, j) -= p * x;
+						at (k + 1, j) -= p * y;
+					}
+
+					std::size_t imax = std::min (hi, k + 3);
+					for (std::size_t i = 0; i <= imax; ++i)
+					{
+						p = x * at (i, k) + y * at (i, k + 1);
+						if (notlast)
+						{
+							p += z * at (i, k + 2);
+							at (i, k + 2) -= p * r;
+						}
+						at (i, k) -= p;
+						at (i, k + 1) -= p * q;
+					}
+
+					if (u)
+						for (std::size_t i = 0; i < n; ++i)
+						{
+							T* ui = u + i * ldu;
+							p = x * ui[k] + y * ui[k + 1];
+							if (notlast)
+							{
+								p += z * ui[k + 2];
+								ui[k + 2] -= p * r;
+							}
+							ui[k] -= p;
+							ui[k + 1] -= p * q;
+						}
+				}
+			}
+
+			//Values below the subdiagonal are leftovers of the bulges
+			for (std::size_t i = 2; i < n; ++i)
+				for (std::size_t j = 0; j + 1 < i; ++j)
+					at (i, j) = 0;
+			return true;
+		}
+
+		///Eigenvector y of the real eigenvalue t[k, k] of the real Schur form t
+		///by back substitution: y[k] = 1, y[k+1:n] = 0
+		template <class T>
+		void
+		schur_eigenvector (std::size_t n, const T* t, std::size_t ldt,
+						   std::size_t k, T* y)
+		{
+			const T eps = std::numeric_limits<T>::epsilon ();
+			T lambda = t[k * ldt + k];
+			T small = 0;
+			for (std::size_t i = 0; i < n; ++i)
+				small = std::max (small, std::abs (t[i * ldt + i]));
+			small = std::max (small, static_cast<T> (1)) * eps;
+
+			std::fill (y, y + n, static_cast<T> (0));
+			y[k] = 1;
+
+			auto rhs = [&](std::size_t i) {
+				T val = 0;
+				for (std::size_t j = i + 1; j <= k; ++j)
+					val += t[i * ldt + j] * y[j];
+				return val;
+			};
+
+			for (std::size_t i = k - 1; i < k; --i)
+			{
+				if (i > 0 && t[i * ldt + i - 1] != static_cast<T> (0))
+				{
+					//2 x 2 block on rows i - 1 and i
+					T a = t[(i - 1) * ldt + i - 1] - lambda;
+					T b = t[(i - 1) * ldt + i];
+					T c = t[i * ldt + i - 1];
+					T d = t[i * ldt + i] - lambda;
+					T r0 = -rhs (i - 1);
+					T r1 = -rhs (i);
+					T det = a * d - b * c;
+					if (det == static_cast<T> (0))
+						det = small;
+					y[i - 1] = (r0 * d - b * r1) / det;
+					y[i] = (a * r1 - c * r0) / det;
+					--i;
+				}
+				else
+				{
+					T diag = t[i * ldt + i] - lambda;
+					if (std::abs (diag) < small)
+						diag = small;
+					y[i] = -rhs (i) / diag;
+				}
+			}
+		}
+
+		///Eigenvector y of the eigenvalue with a positive imaginary part of the
+		///2 x 2 diagonal block at rows k, k + 1 of the real Schur form t
+		///by back substitution: y[k+2:n] = 0
+		template <class T>
+		void
+		schur_complex_eigenvector (std::size_t n, const T* t, std::size_t ldt,
+								   std::size_t k, std::complex<T>* y)
+		{
+			using C = std::complex<T>;
+			const T eps = std::numeric_limits<T>::epsilon ();
+			T a = t[k * ldt + k];
+			T b = t[k * ldt + k + 1];
+			T c = t[(k + 1) * ldt + k];
+			T d = t[(k + 1) * ldt + k + 1];
+			T p = (a - d) / 2;
+			C lambda ((a + d) / 2, std::sqrt (std::abs (p * p + b * c)));
+			T small = 0;
+			for (std::size_t i = 0; i < n; ++i)
+				small = std::max (small, std::abs (t[i * ldt + i]));
+			small = std::max (small, static_cast<T> (1)) * eps;
+
+			std::fill (y, y + n, C (0));
+			y[k] = b;
+			y[k + 1] = lambda - a;
+
+			auto rhs = [&](std::size_t i) {
+				C val = 0;
+				for (std::size_t j = i + 1; j <= k + 1; ++j)
+					val += t[i * ldt + j] * y[j];
+				return val;
+			};
+
+			for (std::size_t i = k - 1; i < k; --i)
+			{
+				if (i > 0 && t[i * ldt + i - 1] != static_cast<T> (0))
+				{
+					//2 x 2 block on rows i - 1 and i
+					C e = t[(i - 1) * ldt + i - 1] - lambda;
+					T f = t[(i - 1) * ldt + i];
+					T g = t[i * ldt + i - 1];
+					C h = t[i * ldt + i] - lambda;
+					C r0 = -rhs (i - 1);
+					C r1 = -rhs (i);
+					C det = e * h - f * g;
+					if (std::abs (det) < small)
+						det = small;
+					y[i - 1] = (r0 * h - f * r1) / det;
+					y[i] = (e * r1 - g * r0) / det;
+					--i;
+				}
+				else
+				{
+					C diag = t[i * ldt + i] - lambda;
+					if (std::abs (diag) < small)
+						diag = small;
+					y[i] = -rhs (i) / diag;
+				}
+			}
+		}
+
+		///QR step on the n x n upper Hessenberg H with the shift wr if wi = 0,
+		///or the pair of shifts wr +- i wi: H <- Q^T H Q, with Q e0 along
+		///(H - wr I) e0 or ((H - wr I)^2 + wi^2 I) e0
+		///The shifted first column is reduced, then the bulge is chased down
+		///with Householder reflectors
+		///If q is not null, it is multiplied by Q
+		template <class T>
+		void
+		hessenberg_shift_step (std::size_t n, T* h, std::size_t ldh, T wr, T wi,
+							   T* q, std::size_t ldq)
+		{
+			if (n < 2)
+				return;
+
+			auto at = [&](std::size_t i, std::size_t j) -> T& {
+				return h[i * ldh + j];
+			};
+
+			std::size_t l = 2;
+			T v[3];
+			if (wi == static_cast<T> (0))
+			{
+				v[0] = at (0, 0) - wr;
+				v[1] = at (1, 0);
+			}
+			else
+			{
+				l = 3;
+				v[0] = at (0, 0) * (at (0, 0) - 2 * wr) + at (0, 1) * at (1, 0)
+					+ wr * wr + wi * wi;
+				v[1] = at (1, 0) * (at (0, 0) + at (1, 1) - 2 * wr);
+				v[2] = n > 2 ? at (1, 0) * at (2, 1) : static_cast<T> (0);
+			}
+
+			for (std::size_t k = 0; k + 1 < n; ++k)
+			{
+				std::size_t len = std::min (l, n - k);
+				if (k > 0)
+					for (std::size_t i = 0; i < len; ++i)
+						v[i] = at (k + i, k - 1);
+				T tau = make_reflector_ (len, v, std::size_t (1));
+				if (tau == static_cast<T> (0))
+					continue;
+
+				if (k > 0)
+				{
+					at (k, k - 1) = v[0];
+					for (std::size_t i = 1; i < len; ++i)
+						at (k + i, k - 1) = 0;
+				}
+				v[0] = 1;
+
+				for (std::size_t j = k; j < n; ++j)
+				{
+					T s = 0;
+					for (std::size_t i = 0; i < len; ++i)
+						s += v[i] * at (k + i, j);
+					s *= tau;
+					for (std::size_t i = 0; i < len; ++i)
+						at (k + i, j) -= s * v[i];
+				}
+
+				auto right = [&](T* m, std::size_t ldm, std::size_t rows) {
+					for (std::size_t i = 0; i < rows; ++i)
+					{
+						T* mi = m + i * ldm + k;
+						T s = 0;
+						for (std::size_t j = 0; j < len; ++j)
+							s += mi[j] * v[j];
+						s *= tau;
+						for (std::size_t j = 0; j < len; ++j)
+							mi[j] -= s * v[j];
+					}
+				};
+				right (h, ldh, std::min (k + len, n - 1) + 1);
+				if (q)
+					right (q, ldq, n);
+			}
+		}
+
+	}
+
+}
+
+#endif //!EIGEN_HH_
@@ -0,0 +1,1587 @@
+/** @file Expression templates for element-wise Vector and Matrix arithmetic
+ *
+ * Arithmetic operators on vectors and matrices do not compute anything:
+ * they build a lightweight expression tree, and the tree is evaluated in a
+ * single loop when it is assigned to a Vector or a Matrix, or reduced
+ * (sum, norm, dot_product ...).
+ * Vector and Matrix operands are referenced, not copied: an expression must
+ * not outlive its operands (don't store one in an auto variable when an
+ * operand is a temporary).
+ * Values are written in place, unless an operand reads the destination
+ * storage at other positions (m = m.transpose_view (), overlapping
+ * regions): the expression is then evaluated in a temporary first.
+ * Large evaluations are split between threads by the parallel backend.
+ */
+
+#ifndef EXPRESSION_HH_
+# define EXPRESSION_HH_
+
+# include <cassert>
+# include <cmath>
+# include <cstddef>
+# include <functional>
+# include <iterator>
+# include <vector>
+# include "algo.hh"
+# include "parallel.hh"
+
+namespace opl
+{
+
+	template <class T>
+	class Vector;
+
+	///Order of the values of a Matrix in its storage
+	enum class StorageOrder
+	{
+		row_major,
+		col_major
+	};
+
+	template <class T, StorageOrder O = StorageOrder::row_major>
+	class Matrix;
+
+	template <class T>
+	class MatrixView;
+
+	///Random access iterator over the values of an expression
+	template <class E, class T>
+	class ExprIterator
+	{
+
+	public:
+		typedef std::ptrdiff_t difference_type;
+		typedef T value_type;
+		typedef T reference;
+		typedef const T* pointer;
+		typedef std::random_access_iterator_tag iterator_category;
+
+		ExprIterator ()
+			: e_ (nullptr), i_ (0)
+		{
+
+		}
+
+		ExprIterator (const E* e, std::size_t i)
+			: e_ (e), i_ (i)
+		{
+
+		}
+
+		bool
+		operator== (const ExprIterator& it) const
+		{
+			return i_ == it.i_;
+		}
+
+		bool
+		operator!= (const ExprIterator& it) const
+		{
+			return i_ != it.i_;
+		}
+
+		bool
+		operator< (const ExprIterator& it) const
+		{
+			return i_ < it.i_;
+		}
+
+		bool
+		operator<= (const ExprIterator& it) const
+		{
+			return i_ <= it.i_;
+		}
+
+		bool
+		operator> (const ExprIterator& it) const
+		{
+			return i_ > it.i_;
+		}
+
+		bool
+		operator>= (const ExprIterator& it) const
+		{
+			return i_ >= it.i_;
+		}
+
+		ExprIterator&
+		operator++ ()
+		{
+			++i_;
+			return *this;
+		}
+
+		ExprIterator
+		operator++ (int)
+		{
+			ExprIterator it = *this;
+			++i_;
+			return it;
+		}
+
+		ExprIterator&
+		operator-- ()
+		{
+			--i_;
+			return *this;
+		}
+
+		ExprIterator
+		operator-- (int)
+		{
+			ExprIterator it = *this;
+			--i_;
+			return it;
+		}
+
+		ExprIterator&
+		operator+= (difference_type n)
+		{
+			i_ += n;
+			return *this;
+		}
+
+		ExprIterator
+		operator+ (difference_type n) const
+		{
+			return ExprIterator (e_, i_ + n);
+		}
+
+		ExprIterator&
+		operator-= (difference_type n)
+		{
+			i_ -= n;
+			return *this;
+		}
+
+		ExprIterator
+		operator- (difference_type n) const
+		{
+			return ExprIterator (e_, i_ - n);
+		}
+
+		difference_type
+		operator- (const ExprIterator& it) const
+		{
+			return static_cast<difference_type> (i_)
+				- static_cast<difference_type> (it.i_);
+		}
+
+		T
+		operator* () const
+		{
+			return (*e_)[i_];
+		}
+
+		T
+		operator[] (difference_type n) const
+		{
+			return (*e_)[i_ + n];
+		}
+
+	private:
+		const E* e_;
+		std::size_t i_;
+
+	};
+
+
+	///Base class of every vector expression, Vector included
+	template <class E, class T>
+	class VectorExpr
+	{
+
+	public:
+		typedef T value_type;
+		typedef ExprIterator<E, T> const_iterator;
+
+		const E&
+		self () const
+		{
+			return static_cast<const E&> (*this);
+		}
+
+		std::size_t
+		size () const
+		{
+			return self ().size ();
+		}
+
+		bool
+		empty () const
+		{
+			return !size ();
+		}
+
+		T
+		operator[] (std::size_t i) const
+		{
+			return self ()[i];
+		}
+
+		const_iterator
+		begin () const
+		{
+			return const_iterator (&self (), 0);
+		}
+
+		const_iterator
+		end () const
+		{
+			return const_iterator (&self (), size ());
+		}
+
+		///Evaluates the expression in a new vector
+		Vector<T>
+		eval () const
+		{
+			return Vector<T> (*this);
+		}
+
+		T
+		min () const
+		{
+			return algo::min (begin (), end ());
+		}
+
+		T
+		max () const
+		{
+			return algo::max (begin (), end ());
+		}
+
+		T
+		min_abs () const
+		{
+			return algo::min_abs (begin (), end ());
+		}
+
+		T
+		max_abs () const
+		{
+			return algo::max_abs (begin (), end ());
+		}
+
+		T
+		norm_square () const
+		{
+			return algo::norm_square (begin (), end ());
+		}
+
+		T
+		norm () const
+		{
+			return algo::norm (begin (), end ());
+		}
+
+		T
+		p_norm (std::size_t p) const
+		{
+			return algo::p_norm (begin (), end (), p);
+		}
+
+		T
+		sum () const
+		{
+			return algo::sum (begin (), end ());
+		}
+
+		T
+		sum_abs () const
+		{
+			return algo::sum_abs (begin (), end ());
+		}
+
+		T
+		product () const
+		{
+			return algo::product (begin (), end ());
+		}
+
+		T
+		product_abs () const
+		{
+			return algo::product_abs (begin (), end ());
+		}
+
+		bool
+		is_unit () const
+		{
+			return algo::is_unit (begin (), end ());
+		}
+
+		bool
+		is_null () const
+		{
+			return algo::is_null (begin (), end ());
+		}
+
+		template <class F>
+		T
+		dot_product (const VectorExpr<F, T>& v) const
+		{
+			assert (size () == v.size ());
+			return algo::dot_product (begin (), end (), v.begin ());
+		}
+
+		template <class F>
+		T
+		distance_square (const VectorExpr<F, T>& v) const
+		{
+			assert (size () == v.size ());
+			return algo::distance_square (begin (), end (), v.begin ());
+		}
+
+		template <class F>
+		T
+		distance (const VectorExpr<F, T>& v) const
+		{
+			assert (size () == v.size ());
+			return algo::distance (begin (), end (), v.begin ());
+		}
+
+		template <class F>
+		bool
+		equals (const VectorExpr<F, T>& v) const
+		{
+			if (size () != v.size ())
+				return false;
+			return algo::equals (begin (), end (), v.begin ());
+		}
+
+		T
+		mean () const
+		{
+			return algo::mean (begin (), end ());
+		}
+
+		T
+		median () const
+		{
+			return algo::median (begin (), end ());
+		}
+
+		T
+		quartile1 () const
+		{
+			return algo::quartile1 (begin (), end ());
+		}
+
+		T
+		quartile3 () const
+		{
+			return algo::quartile3 (begin (), end ());
+		}
+
+		T
+		interquartile_range () const
+		{
+			return algo::interquartile_range (begin (), end ());
+		}
+
+		T
+		mode () const
+		{
+			return algo::mode (begin (), end ());
+		}
+
+		T
+		variance () const
+		{
+			return algo::variance (begin (), end ());
+		}
+
+		T
+		standard_deviation () const
+		{
+			return algo::standard_deviation (begin (), end ());
+		}
+
+		friend std::ostream&
+		operator<< (std::ostream& os, const VectorExpr& e)
+		{
+			return os << e.eval ();
+		}
+
+	};
+
+
+	///Base class of every matrix expression, Matrix included
+	///Elements are indexed in row-major order
+	template <class E, class T>
+	class MatrixExpr
+	{
+
+	public:
+		typedef T value_type;
+		typedef ExprIterator<E, T> const_iterator;
+
+		const E&
+		self () const
+		{
+			return static_cast<const E&> (*this);
+		}
+
+		std::size_t
+		rows () const
+		{
+			return self ().rows ();
+		}
+
+		std::size_t
+		cols () const
+		{
+			return self ().cols ();
+		}
+
+		std::size_t
+		size () const
+		{
+			return rows () * cols ();
+		}
+
+		bool
+		empty () const
+		{
+			return !size ();
+		}
+
+		T
+		at (std::size_t i, std::size_t j) const
+		{
+			assert (i < rows ());
+			assert (j < cols ());
+			return self ()[i * cols () + j];
+		}
+
+		const_iterator
+		begin () const
+		{
+			return const_iterator (&self (), 0);
+		}
+
+		const_iterator
+		end () const
+		{
+			return const_iterator (&self (), size ());
+		}
+
+		///Evaluates the expression in a new matrix
+		Matrix<T>
+		eval () const
+		{
+			return Matrix<T> (*this);
+		}
+
+		T
+		min () const
+		{
+			return algo::min (begin (), end ());
+		}
+
+		T
+		max () const
+		{
+			return algo::max (begin (), end ());
+		}
+
+		T
+		min_abs () const
+		{
+			return algo::min_abs (begin (), end ());
+		}
+
+		T
+		max_abs () const
+		{
+			return algo::max_abs (begin (), end ());
+		}
+
+		T
+		norm_square () const
+		{
+			return algo::norm_square (begin (), end ());
+		}
+
+		T
+		norm () const
+		{
+			return algo::norm (begin (), end ());
+		}
+
+		T
+		p_norm (std::size_t p) const
+		{
+			return algo::p_norm (begin (), end (), p);
+		}
+
+		T
+		sum () const
+		{
+			return algo::sum (begin (), end ());
+		}
+
+		T
+		sum_abs () const
+		{
+			return algo::sum_abs (begin (), end ());
+		}
+
+		T
+		product () const
+		{
+			return algo::product (begin (), end ());
+		}
+
+		T
+		product_abs () const
+		{
+			return algo::product_abs (begin (), end ());
+		}
+
+		bool
+		is_unit () const
+		{
+			return algo::is_unit (begin (), end ());
+		}
+
+		bool
+		is_null () const
+		{
+			return algo::is_null (begin (), end ());
+		}
+
+		template <class F>
+		T
+		dot_product (const MatrixExpr<F, T>& m) const
+		{
+			assert (rows () == m.rows () && cols () == m.cols ());
+			return algo::dot_product (begin (), end (), m.begin ());
+		}
+
+		template <class F>
+		T
+		distance_square (const MatrixExpr<F, T>& m) const
+		{
+			assert (rows () == m.rows () && cols () == m.cols ());
+			return algo::distance_square (begin (), end (), m.begin ());
+		}
+
+		template <class F>
+		T
+		distance (const MatrixExpr<F, T>& m) const
+		{
+			assert (rows () == m.rows () && cols () == m.cols ());
+			return algo::distance (begin (), end (), m.begin ());
+		}
+
+		template <class F>
+		bool
+		equals (const MatrixExpr<F, T>& m) const
+		{
+			if (rows () != m.rows () || cols () != m.cols ())
+				return false;
+			return algo::equals (begin (), end (), m.begin ());
+		}
+
+		T
+		mean () const
+		{
+			return algo::mean (begin (), end ());
+		}
+
+		T
+		median () const
+		{
+			return algo::median (begin (), end ());
+		}
+
+		T
+		quartile1 () const
+		{
+			return algo::quartile1 (begin (), end ());
+		}
+
+		T
+		quartile3 () const
+		{
+			return algo::quartile3 (begin (), end ());
+		}
+
+		T
+		interquartile_range () const
+		{
+			return algo::interquartile_range (begin (), end ());
+		}
+
+		T
+		mode () const
+		{
+			return algo::mode (begin (), end ());
+		}
+
+		T
+		variance () const
+		{
+			return algo::variance (begin (), end ());
+		}
+
+		T
+		standard_deviation () const
+		{
+			return algo::standard_deviation (begin (), end ());
+		}
+
+		//The remaining Matrix methods evaluate the expression first
+
+		auto
+		transpose () const
+		{
+			return eval ().transpose ();
+		}
+
+		bool
+		is_symmetric () const
+		{
+			return eval ().is_symmetric ();
+		}
+
+		auto
+		vector_get () const
+		{
+			return eval ().vector_get ();
+		}
+
+		auto
+		row_vector_get (std::size_t row) const
+		{
+			return eval ().row_vector_get (row);
+		}
+
+		auto
+		col_vector_get (std::size_t col) const
+		{
+			return eval ().col_vector_get (col);
+		}
+
+		auto
+		rows_vectors_get () const
+		{
+			return eval ().rows_vectors_get ();
+		}
+
+		auto
+		cols_vectors_get () const
+		{
+			return eval ().cols_vectors_get ();
+		}
+
+		auto
+		sub_matrix (std::size_t i, std::size_t j) const
+		{
+			return eval ().sub_matrix (i, j);
+		}
+
+		auto
+		region_matrix (std::size_t i0, std::size_t j0,
+					   std::size_t n, std::size_t p) const
+		{
+			return eval ().region_matrix (i0, j0, n, p);
+		}
+
+		bool
+		is_id () const
+		{
+			return eval ().is_id ();
+		}
+
+		template <class M>
+		bool
+		is_inverse_of (const M& m) const
+		{
+			return eval ().is_inverse_of (m);
+		}
+
+		bool
+		is_lower_triangular () const
+		{
+			return eval ().is_lower_triangular ();
+		}
+
+		bool
+		is_upper_triangular () const
+		{
+			return eval ().is_upper_triangular ();
+		}
+
+		bool
+		is_diagonal () const
+		{
+			return eval ().is_diagonal ();
+		}
+
+		bool
+		is_orthogonal () const
+		{
+			return eval ().is_orthogonal ();
+		}
+
+		auto
+		diagonal_to_vector () const
+		{
+			return eval ().diagonal_to_vector ();
+		}
+
+		template <class B>
+		auto
+		lower_triangular_solve_system (const B& b) const
+		{
+			return eval ().lower_triangular_solve_system (b);
+		}
+
+		template <class B>
+		auto
+		lower_triangular_solve_systems (const B& b) const
+		{
+			return eval ().lower_triangular_solve_systems (b);
+		}
+
+		template <class B>
+		auto
+		upper_triangular_solve_system (const B& b) const
+		{
+			return eval ().upper_triangular_solve_system (b);
+		}
+
+		template <class B>
+		auto
+		upper_triangular_solve_systems (const B& b) const
+		{
+			return eval ().upper_triangular_solve_systems (b);
+		}
+
+		auto
+		lower_triangular_inverse () const
+		{
+			return eval ().lower_triangular_inverse ();
+		}
+
+		auto
+		upper_triangular_inverse () const
+		{
+			return eval ().upper_triangular_inverse ();
+		}
+
+		T
+		triangular_determinant () const
+		{
+			return eval ().triangular_determinant ();
+		}
+
+		auto
+		gauss_to_echelon_form () const
+		{
+			return eval ().gauss_to_echelon_form ();
+		}
+
+		auto
+		gauss_rank () const
+		{
+			return eval ().gauss_rank ();
+		}
+
+		auto
+		gauss_inverse () const
+		{
+			return eval ().gauss_inverse ();
+		}
+
+		auto
+		rank () const
+		{
+			return eval ().rank ();
+		}
+
+		T
+		qr_determinant () const
+		{
+			return eval ().qr_determinant ();
+		}
+
+		template <class B>
+		auto
+		qr_solve_system (const B& b) const
+		{
+			return eval ().qr_solve_system (b);
+		}
+
+		template <class B>
+		auto
+		qr_solve_systems (const B& b) const
+		{
+			return eval ().qr_solve_systems (b);
+		}
+
+		auto
+		qr_inverse () const
+		{
+			return eval ().qr_inverse ();
+		}
+
+		template <class B>
+		auto
+		qr_least_squares (const B& b) const
+		{
+			return eval ().qr_least_squares (b);
+		}
+
+		auto
+		cholesky_decomposition () const
+		{
+			return eval ().cholesky_decomposition ();
+		}
+
+		template <class B>
+		auto
+		cholesky_solve_system (const B& b) const
+		{
+			return eval ().cholesky_solve_system (b);
+		}
+
+		template <class B>
+		auto
+		cholesky_solve_systems (const B& b) const
+		{
+			return eval ().cholesky_solve_systems (b);
+		}
+
+		auto
+		cholesky_inverse () const
+		{
+			return eval ().cholesky_inverse ();
+		}
+
+		T
+		cholesky_determinant () const
+		{
+			return eval ().cholesky_determinant ();
+		}
+
+		T
+		plu_determinant () const
+		{
+			return eval ().plu_determinant ();
+		}
+
+		template <class B>
+		auto
+		plu_solve_system (const B& b) const
+		{
+			return eval ().plu_solve_system (b);
+		}
+
+		template <class B>
+		auto
+		plu_solve_systems (const B& b) const
+		{
+			return eval ().plu_solve_systems (b);
+		}
+
+		auto
+		plu_inverse () const
+		{
+			return eval ().plu_inverse ();
+		}
+
+		friend std::ostream&
+		operator<< (std::ostream& os, const MatrixExpr& e)
+		{
+			return os << e.eval ();
+		}
+
+	};
+
+
+	///Storage written by an evaluation: value i of the rows x cols
+	///destination is at data[i / cols * rs + i % cols * cs]
+	template <class T>
+	class ExprTarget
+	{
+
+	public:
+		ExprTarget (const T* data, std::size_t rows, std::size_t cols,
+					std::size_t rs, std::size_t cs)
+			: data_ (data), rows_ (rows), cols_ (cols), rs_ (rs), cs_ (cs)
+		{
+
+		}
+
+		///Returns true if the values described the same way can't be read
+		///while the destination is written: they share some storage, but
+		///not at the same positions
+		bool
+		conflicts (const T* data, std::size_t rows, std::size_t cols,
+				   std::size_t rs, std::size_t cs) const
+		{
+			if (!rows || !cols || !rows_ || !cols_)
+				return false;
+
+			std::less<const T*> less;
+			const T* last = data + (rows - 1) * rs + (cols - 1) * cs;
+			const T* target_last = data_ + (rows_ - 1) * rs_ + (cols_ - 1) * cs_;
+			if (less (last, data_) || less (target_last, data))
+				return false;
+
+			if (data != data_ || rows * cols != rows_ * cols_)
+				return true;
+			if (dense_ (rows, cols, rs, cs) && dense_ (rows_, cols_, rs_, cs_))
+				return false;
+			return rows != rows_ || cols != cols_
+				|| (rows > 1 && rs != rs_) || (cols > 1 && cs != cs_);
+		}
+
+	private:
+		///Value i at data[i]
+		static bool
+		dense_ (std::size_t rows, std::size_t cols, std::size_t rs,
+				std::size_t cs)
+		{
+			return (cols <= 1 || cs == 1) && (rows <= 1 || rs == cols);
+		}
+
+		const T* data_;
+		std::size_t rows_;
+		std::size_t cols_;
+		std::size_t rs_;
+		std::size_t cs_;
+
+	};
+
+	///Leaf over the contiguous storage of a Vector or a Matrix
+	template <template <class, class> class Base, class T>
+	class DenseExpr : public Base<DenseExpr<Base, T>, T>
+	{
+
+	public:
+		DenseExpr (const T* data, std::size_t rows, std::size_t cols)
+			: data_ (data), rows_ (rows), cols_ (cols)
+		{
+
+		}
+
+		std::size_t
+		rows () const
+		{
+			return rows_;
+		}
+
+		std::size_t
+		cols () const
+		{
+			return cols_;
+		}
+
+		std::size_t
+		size () const
+		{
+			return rows_ * cols_;
+		}
+
+		const T&
+		operator[] (std::size_t i) const
+		{
+			return data_[i];
+		}
+
+		///Returns true if evaluating into t must go through a temporary
+		bool
+		aliases (const ExprTarget<T>& t) const
+		{
+			return t.conflicts (data_, rows_, cols_, cols_, 1);
+		}
+
+	private:
+		const T* data_;
+		std::size_t rows_;
+		std::size_t cols_;
+
+	};
+
+	///Leaf repeating the same scalar
+	template <template <class, class> class Base, class T>
+	class ScalarExpr : public Base<ScalarExpr<Base, T>, T>
+	{
+
+	public:
+		ScalarExpr (const T& x, std::size_t rows, std::size_t cols)
+			: x_ (x), rows_ (rows), cols_ (cols)
+		{
+
+		}
+
+		std::size_t
+		rows () const
+		{
+			return rows_;
+		}
+
+		std::size_t
+		cols () const
+		{
+			return cols_;
+		}
+
+		std::size_t
+		size () const
+		{
+			return rows_ * cols_;
+		}
+
+		const T&
+		operator[] (std::size_t) const
+		{
+			return x_;
+		}
+
+		bool
+		aliases (const ExprTarget<T>&) const
+		{
+			return false;
+		}
+
+	private:
+		T x_;
+		std::size_t rows_;
+		std::size_t cols_;
+
+	};
+
+	///op (e[i])
+	template <template <class, class> class Base, class E, class Op>
+	class UnaryExpr : public Base<UnaryExpr<Base, E, Op>,
+								  typename E::value_type>
+	{
+
+	public:
+		typedef typename E::value_type value_type;
+
+		UnaryExpr (const E& e)
+			: e_ (e)
+		{
+
+		}
+
+		std::size_t
+		rows () const
+		{
+			return e_.rows ();
+		}
+
+		std::size_t
+		cols () const
+		{
+			return e_.cols ();
+		}
+
+		std::size_t
+		size () const
+		{
+			return e_.size ();
+		}
+
+		value_type
+		operator[] (std::size_t i) const
+		{
+			return Op () (e_[i]);
+		}
+
+		bool
+		aliases (const ExprTarget<value_type>& t) const
+		{
+			return e_.aliases (t);
+		}
+
+	private:
+		E e_;
+
+	};
+
+	///l[i] op r[i]
+	template <template <class, class> class Base, class L, class R, class Op>
+	class BinaryExpr : public Base<BinaryExpr<Base, L, R, Op>,
+								   typename L::value_type>
+	{
+
+	public:
+		typedef typename L::value_type value_type;
+
+		BinaryExpr (const L& l, const R& r)
+			: l_ (l), r_ (r)
+		{
+			assert (l.rows () == r.rows () && l.cols () == r.cols ());
+		}
+
+		std::size_t
+		rows () const
+		{
+			return l_.rows ();
+		}
+
+		std::size_t
+		cols () const
+		{
+			return l_.cols ();
+		}
+
+		std::size_t
+		size () const
+		{
+			return l_.size ();
+		}
+
+		value_type
+		operator[] (std::size_t i) const
+		{
+			return Op () (l_[i], r_[i]);
+		}
+
+		bool
+		aliases (const ExprTarget<value_type>& t) const
+		{
+			return l_.aliases (t) || r_.aliases (t);
+		}
+
+	private:
+		L l_;
+		R r_;
+
+	};
+
+	///|x|
+	struct AbsOp
+	{
+		template <class T>
+		T
+		operator() (const T& x) const
+		{
+			return std::abs (x);
+		}
+	};
+
+
+	///Node type stored in a tree for an operand of type E
+	///Expressions are stored by value, Vector and Matrix as a DenseExpr
+	template <class E>
+	struct ExprOperand
+	{
+		typedef E type;
+
+		static const E&
+		get (const E& e)
+		{
+			return e;
+		}
+	};
+
+	template <class T>
+	struct ExprOperand<Vector<T>>
+	{
+		typedef DenseExpr<VectorExpr, T> type;
+
+		static type
+		get (const Vector<T>& v)
+		{
+			return type (v.data (), v.size (), 1);
+		}
+	};
+
+	template <class T>
+	struct ExprOperand<Matrix<T>>
+	{
+		typedef DenseExpr<MatrixExpr, T> type;
+
+		static type
+		get (const Matrix<T>& m)
+		{
+			return type (m.data (), m.rows (), m.cols ());
+		}
+	};
+
+	///Column-major matrices are read through a strided view
+	template <class T>
+	struct ExprOperand<Matrix<T, StorageOrder::col_major>>
+	{
+		typedef MatrixView<const T> type;
+
+		static type
+		get (const Matrix<T, StorageOrder::col_major>& m)
+		{
+			return m.view ();
+		}
+	};
+
+	template <template <class, class> class Base, class L, class R, class Op>
+	BinaryExpr<Base, typename ExprOperand<L>::type,
+			   typename ExprOperand<R>::type, Op>
+	make_binary_expr (const L& l, const R& r)
+	{
+		return BinaryExpr<Base, typename ExprOperand<L>::type,
+						  typename ExprOperand<R>::type, Op>
+			(ExprOperand<L>::get (l), ExprOperand<R>::get (r));
+	}
+
+	template <template <class, class> class Base, class E, class Op>
+	BinaryExpr<Base, typename ExprOperand<E>::type,
+			   ScalarExpr<Base, typename E::value_type>, Op>
+	make_expr_scalar (const E& e, const typename E::value_type& x)
+	{
+		auto l = ExprOperand<E>::get (e);
+		return BinaryExpr<Base, decltype (l),
+						  ScalarExpr<Base, typename E::value_type>, Op>
+			(l, ScalarExpr<Base, typename E::value_type> (x, l.rows (),
+														  l.cols ()));
+	}
+
+	template <template <class, class> class Base, class E, class Op>
+	BinaryExpr<Base, ScalarExpr<Base, typename E::value_type>,
+			   typename ExprOperand<E>::type, Op>
+	make_scalar_expr (const typename E::value_type& x, const E& e)
+	{
+		auto r = ExprOperand<E>::get (e);
+		return BinaryExpr<Base, ScalarExpr<Base, typename E::value_type>,
+						  decltype (r), Op>
+			(ScalarExpr<Base, typename E::value_type> (x, r.rows (),
+													   r.cols ()), r);
+	}
+
+	template <template <class, class> class Base, class E, class Op>
+	UnaryExpr<Base, typename ExprOperand<E>::type, Op>
+	make_unary_expr (const E& e)
+	{
+		return UnaryExpr<Base, typename ExprOperand<E>::type, Op>
+			(ExprOperand<E>::get (e));
+	}
+
+
+	///x <- y
+	struct AssignOp
+	{
+		template <class T>
+		void
+		operator() (T& x, const T& y) const
+		{
+			x = y;
+		}
+	};
+
+	///Returns true if e reads the storage described by t at other positions
+	///than the ones being written
+	template <class E, class T>
+	bool
+	expr_aliases (const E& e, const ExprTarget<T>& t)
+	{
+		return ExprOperand<E>::get (e).aliases (t);
+	}
+
+	///Calls op (out[i], e[i]) for every value of e, in a single loop
+	///split between threads for large expressions
+	///e must not alias out
+	template <class E, class T, class Op>
+	void
+	evaluate_loop_ (const E& e, T* out, Op op)
+	{
+		std::size_t n = e.size ();
+		parallel::for_range (n, n, [&](std::size_t begin, std::size_t end) {
+				for (std::size_t i = begin; i < end; ++i)
+					op (out[i], e[i]);
+			});
+	}
+
+	///Values of e in a new buffer, in row-major order
+	template <class E>
+	std::vector<typename E::value_type>
+	evaluate_copy_ (const E& e)
+	{
+		std::vector<typename E::value_type> res (e.size ());
+		evaluate_loop_ (e, res.data (), AssignOp ());
+		return res;
+	}
+
+	///Calls op (out[i], e[i]) for every value of e, in a single loop
+	///split between threads for large expressions
+	///If e aliases out, it is evaluated in a temporary first
+	template <class E, class T, class Op>
+	void
+	evaluate_into (const E& e, T* out, Op op)
+	{
+		std::size_t n = e.size ();
+		if (!expr_aliases (e, ExprTarget<T> (out, n, 1, 1, 1)))
+		{
+			evaluate_loop_ (e, out, op);
+			return;
+		}
+
+		std::vector<T> tmp = evaluate_copy_ (e);
+		evaluate_loop_ (DenseExpr<VectorExpr, T> (tmp.data (), n, 1), out, op);
+	}
+
+	///Returns v itself, without any copy
+	template <class T>
+	const Vector<T>&
+	evaluate (const Vector<T>& v)
+	{
+		return v;
+	}
+
+	///Evaluates e in a new vector
+	template <class E, class T>
+	Vector<T>
+	evaluate (const VectorExpr<E, T>& e)
+	{
+		return e.eval ();
+	}
+
+	///Returns m itself, without any copy
+	template <class T, StorageOrder O>
+	const Matrix<T, O>&
+	evaluate (const Matrix<T, O>& m)
+	{
+		return m;
+	}
+
+	///Evaluates e in a new matrix
+	template <class E, class T>
+	Matrix<T>
+	evaluate (const MatrixExpr<E, T>& e)
+	{
+		return e.eval ();
+	}
+
+
+	//Vector expressions operators
+
+	template <class L, class R, class T>
+	auto
+	operator+ (const VectorExpr<L, T>& a, const VectorExpr<R, T>& b)
+	{
+		return make_binary_expr<VectorExpr, L, R, std::plus<T>>
+			(a.self (), b.self ());
+	}
+
+	template <class E, class T>
+	auto
+	operator+ (const VectorExpr<E, T>& v,
+			   const typename VectorExpr<E, T>::value_type& x)
+	{
+		return make_expr_scalar<VectorExpr, E, std::plus<T>> (v.self (), x);
+	}
+
+	template <class E, class T>
+	auto
+	operator+ (const typename VectorExpr<E, T>::value_type& x,
+			   const VectorExpr<E, T>& v)
+	{
+		return make_scalar_expr<VectorExpr, E, std::plus<T>> (x, v.self ());
+	}
+
+	template <class L, class R, class T>
+	auto
+	operator- (const VectorExpr<L, T>& a, const VectorExpr<R, T>& b)
+	{
+		return make_binary_expr<VectorExpr, L, R, std::minus<T>>
+			(a.self (), b.self ());
+	}
+
+	template <class E, class T>
+	auto
+	operator- (const VectorExpr<E, T>& v,
+			   const typename VectorExpr<E, T>::value_type& x)
+	{
+		return make_expr_scalar<VectorExpr, E, std::minus<T>> (v.self (), x);
+	}
+
+	template <class E, class T>
+	auto
+	operator- (const typename VectorExpr<E, T>::value_type& x,
+			   const VectorExpr<E, T>& v)
+	{
+		return make_scalar_expr<VectorExpr, E, std::minus<T>> (x, v.self ());
+	}
+
+	template <class E, class T>
+	auto
+	operator* (const VectorExpr<E, T>& v,
+			   const typename VectorExpr<E, T>::value_type& x)
+	{
+		return make_expr_scalar<VectorExpr, E, std::multiplies<T>>
+			(v.self (), x);
+	}
+
+	template <class E, class T>
+	auto
+	operator* (const typename VectorExpr<E, T>::value_type& x,
+			   const VectorExpr<E, T>& v)
+	{
+		return make_scalar_expr<VectorExpr, E, std::multiplies<T>>
+			(x, v.self ());
+	}
+
+	template <class E, class T>
+	auto
+	operator/ (const VectorExpr<E, T>& v,
+			   const typename VectorExpr<E, T>::value_type& x)
+	{
+		return make_expr_scalar<VectorExpr, E, std::divides<T>>
+			(v.self (), x);
+	}
+
+	template <class E, class T>
+	auto
+	operator/ (const typename VectorExpr<E, T>::value_type& x,
+			   const VectorExpr<E, T>& v)
+	{
+		return make_scalar_expr<VectorExpr, E, std::divides<T>>
+			(x, v.self ());
+	}
+
+	template <class E, class T>
+	auto
+	operator% (const VectorExpr<E, T>& v,
+			   const typename VectorExpr<E, T>::value_type& x)
+	{
+		return make_expr_scalar<VectorExpr, E, std::modulus<T>>
+			(v.self (), x);
+	}
+
+	template <class E, class T>
+	auto
+	operator% (const typename VectorExpr<E, T>::value_type& x,
+			   const VectorExpr<E, T>& v)
+	{
+		return make_scalar_expr<VectorExpr, E, std::modulus<T>>
+			(x, v.self ());
+	}
+
+	template <class E, class T>
+	auto
+	operator- (const VectorExpr<E, T>& v)
+	{
+		return make_unary_expr<VectorExpr, E, std::negate<T>> (v.self ());
+	}
+
+
+	//Matrix expressions operators
+	//Matrix products are not element-wise, see matrix.hh
+
+	template <class L, class R, class T>
+	auto
+	operator+ (const MatrixExpr<L, T>& a, const MatrixExpr<R, T>& b)
+	{
+		return make_binary_expr<MatrixExpr, L, R, std::plus<T>>
+			(a.self (), b.self ());
+	}
+
+	template <class E, class T>
+	auto
+	operator+ (const MatrixExpr<E, T>& m,
+			   const typename MatrixExpr<E, T>::value_type& x)
+	{
+		return make_expr_scalar<MatrixExpr, E, std::plus<T>> (m.self (), x);
+	}
+
+	template <class E, class T>
+	auto
+	operator+ (const typename MatrixExpr<E, T>::value_type& x,
+			   const MatrixExpr<E, T>& m)
+	{
+		return make_scalar_expr<MatrixExpr, E, std::plus<T>> (x, m.self ());
+	}
+
+	template <class L, class R, class T>
+	auto
+	operator- (const MatrixExpr<L, T>& a, const MatrixExpr<R, T>& b)
+	{
+		return make_binary_expr<MatrixExpr, L, R, std::minus<T>>
+			(a.self (), b.self ());
+	}
+
+	template <class E, class T>
+	auto
+	operator- (const MatrixExpr<E, T>& m,
+			   const typename MatrixExpr<E, T>::value_type& x)
+	{
+		return make_expr_scalar<MatrixExpr, E, std::minus<T>> (m.self (), x);
+	}
+
+	template <class E, class T>
+	auto
+	operator- (const typename MatrixExpr<E, T>::value_type& x,
+			   const MatrixExpr<E, T>& m)
+	{
+		return make_scalar_expr<MatrixExpr, E, std::minus<T>> (x, m.self ());
+	}
+
+	template <class E, class T>
+	auto
+	operator* (const MatrixExpr<E, T>& m,
+			   const typename MatrixExpr<E, T>::value_type& x)
+	{
+		return make_expr_scalar<MatrixExpr, E, std::multiplies<T>>
+			(m.self (), x);
+	}
+
+	template <class E, class T>
+	auto
+	operator* (const typename MatrixExpr<E, T>::value_type& x,
+			   const MatrixExpr<E, T>& m)
+	{
+		return make_scalar_expr<MatrixExpr, E, std::multiplies<T>>
+			(x, m.self ());
+	}
+
+	template <class E, class T>
+	auto
+	operator/ (const MatrixExpr<E, T>& m,
+			   const typename MatrixExpr<E, T>::value_type& x)
+	{
+		return make_expr_scalar<MatrixExpr, E, std::divides<T>>
+			(m.self (), x);
+	}
+
+	template <class E, class T>
+	auto
+	operator/ (const typename MatrixExpr<E, T>::value_type& x,
+			   const MatrixExpr<E, T>& m)
+	{
+		return make_scalar_expr<MatrixExpr, E, std::divides<T>>
+			(x, m.self ());
+	}
+
+	template <class E, class T>
+	auto
+	operator% (const MatrixExpr<E, T>& m,
+			   const typename MatrixExpr<E, T>::value_type& x)
+	{
+		return make_expr_scalar<MatrixExpr, E, std::modulus<T>>
+			(m.self (), x);
+	}
+
+	template <class E, class T>
+	auto
+	operator% (const typename MatrixExpr<E, T>::value_type& x,
+			   const MatrixExpr<E, T>& m)
+	{
+		return make_scalar_expr<MatrixExpr, E, std::modulus<T>>
+			(x, m.self ());
+	}
+
+	template <class E, class T>
+	auto
+	operator- (const MatrixExpr<E, T>& m)
+	{
+		return make_unary_expr<MatrixExpr, E, std::negate<T>> (m.self ());
+	}
+
+}
+
+#endif //!EXPRESSION_HH_
@@ -0,0 +1,770 @@
+/** @file FixedMatrix class definition
+ * Matrix with compile-time dimensions and inline storage
+ */
+
+#ifndef FIXED_MATRIX_HH_
+# define FIXED_MATRIX_HH_
+
+# include <cstddef>
+# include <cassert>
+# include <algorithm>
+# include <cmath>
+# include <initializer_list>
+# include <iostream>
+# include "algo.hh"
+# include "fixed-vector.hh"
+# include "matrix.hh"
+# include "types.hh"
+
+namespace opl
+{
+
+	///Determinant and inverse of N*N row-major arrays
+	///Closed forms up to 4*4, Gauss-Jordan elimination above
+	template <class T, std::size_t N>
+	struct FixedSquare
+	{
+		static T
+		determinant (const T* a)
+		{
+			T m[N * N];
+			std::copy_n (a, N * N, m);
+			T det = 1;
+			for (std::size_t j = 0; j < N; ++j)
+			{
+				std::size_t pivot = j;
+				for (std::size_t i = j + 1; i < N; ++i)
+					if (std::abs (m[i * N + j]) > std::abs (m[pivot * N + j]))
+						pivot = i;
+				if (m[pivot * N + j] == 0)
+					return 0;
+				if (pivot != j)
+				{
+					std::swap_ranges (m + j * N, m + j * N + N, m + pivot * N);
+					det = -det;
+				}
+				det *= m[j * N + j];
+				for (std::size_t i = j + 1; i < N; ++i)
+				{
+					T x = m[i * N + j] / m[j * N + j];
+					for (std::size_t k = j; k < N; ++k)
+						m[i * N + k] -= x * m[j * N + k];
+				}
+			}
+			return det;
+		}
+
+		static T
+		inverse (const T* a, T* res)
+		{
+			T m[N * N];
+			std::copy_n (a, N * N, m);
+			std::fill_n (res, N * N, static_cast<T> (0));
+			for (std::size_t i = 0; i < N; ++i)
+				res[i * N + i] = 1;
+
+			T det = 1;
+			for (std::size_t j = 0; j < N; ++j)
+			{
+				std::size_t pivot = j;
+				for (std::size_t i = j + 1; i < N; ++i)
+					if (std::abs (m[i * N + j]) > std::abs (m[pivot * N + j]))
+						pivot = i;
+				assert (m[pivot * N + j] != 0);
+				if (pivot != j)
+				{
+					std::swap_ranges (m + j * N, m + j * N + N, m + pivot * N);
+					std::swap_ranges (res + j * N, res + j * N + N,
+									  res + pivot * N);
+					det = -det;
+				}
+
+				T p = m[j * N + j];
+				det *= p;
+				for (std::size_t k = 0; k < N; ++k)
+				{
+					m[j * N + k] /= p;
+					res[j * N + k] /= p;
+				}
+
+				for (std::size_t i = 0; i < N; ++i)
+				{
+					if (i == j)
+						continue;
+					T x = m[i * N + j];
+					for (std::size_t k = 0; k < N; ++k)
+					{
+						m[i * N + k] -= x * m[j * N + k];
+						res[i * N + k] -= x * res[j * N + k];
+					}
+				}
+			}
+			return det;
+		}
+	};
+
+	template <class T>
+	struct FixedSquare<T, 1>
+	{
+		static T
+		determinant (const T* a)
+		{
+			return a[0];
+		}
+
+		static T
+		inverse (const T* a, T* res)
+		{
+			assert (a[0] != 0);
+			res[0] = 1 / a[0];
+			return a[0];
+		}
+	};
+
+	template <class T>
+	struct FixedSquare<T, 2>
+	{
+		static T
+		determinant (const T* a)
+		{
+			return a[0] * a[3] - a[1] * a[2];
+		}
+
+		static T
+		inverse (const T* a, T* res)
+		{
+			T det = determinant (a);
+			assert (det != 0);
+			T inv = 1 / det;
+			res[0] = a[3] * inv;
+			res[1] = - a[1] * inv;
+			res[2] = - a[2] * inv;
+			res[3] = a[0] * inv;
+			return det;
+		}
+	};
+
+	template <class T>
+	struct FixedSquare<T, 3>
+	{
+		static T
+		determinant (const T* a)
+		{
+			return a[0] * (a[4] * a[8] - a[5] * a[7])
+				- a[1] * (a[3] * a[8] - a[5] * a[6])
+				+ a[2] * (a[3] * a[7] - a[4] * a[6]);
+		}
+
+		static T
+		inverse (const T* a, T* res)
+		{
+			T c0 = a[4] * a[8] - a[5] * a[7];
+			T c1 = a[5] * a[6] - a[3] * a[8];
+			T c2 = a[3] * a[7] - a[4] * a[6];
+			T det = a[0] * c0 + a[1] * c1 + a[2] * c2;
+			assert (det != 0);
+			T inv = 1 / det;
+
+			res[0] = c0 * inv;
+			res[1] = (a[2] * a[7] - a[1] * a[8]) * inv;
+			res[2] = (a[1] * a[5] - a[2] * a[4]) * inv;
+			res[3] = c1 * inv;
+			res[4] = (a[0] * a[8] - a[2] * a[6]) * inv;
+			res[5] = (a[2] * a[3] - a[0] * a[5]) * inv;
+			res[6] = c2 * inv;
+			res[7] = (a[1] * a[6] - a[0] * a[7]) * inv;
+			res[8] = (a[0] * a[4] - a[1] * a[3]) * inv;
+			return det;
+		}
+	};
+
+	template <class T>
+	struct FixedSquare<T, 4>
+	{
+		static T
+		determinant (const T* a)
+		{
+			T s0 = a[0] * a[5] - a[4] * a[1];
+			T s1 = a[0] * a[6] - a[4] * a[2];
+			T s2 = a[0] * a[7] - a[4] * a[3];
+			T s3 = a[1] * a[6] - a[5] * a[2];
+			T s4 = a[1] * a[7] - a[5] * a[3];
+			T s5 = a[2] * a[7] - a[6] * a[3];
+
+			T c5 = a[10] * a[15] - a[14] * a[11];
+			T c4 = a[9] * a[15] - a[13] * a[11];
+			T c3 = a[9] * a[14] - a[13] * a[10];
+			T c2 = a[8] * a[15] - a[12] * a[11];
+			T c1 = a[8] * a[14] - a[12] * a[10];
+			T c0 = a[8] * a[13] - a[12] * a[9];
+
+			return s0 * c5 - s1 * c4 + s2 * c3 + s3 * c2 - s4 * c1 + s5 * c0;
+		}
+
+		///Inverse through the 2*2 minors of the two upper and lower rows
+		static T
+		inverse (const T* a, T* res)
+		{
+			T s0 = a[0] * a[5] - a[4] * a[1];
+			T s1 = a[0] * a[6] - a[4] * a[2];
+			T s2 = a[0] * a[7] - a[4] * a[3];
+			T s3 = a[1] * a[6] - a[5] * a[2];
+			T s4 = a[1] * a[7] - a[5] * a[3];
+			T s5 = a[2] * a[7] - a[6] * a[3];
+
+			T c5 = a[10] * a[15] - a[14] * a[11];
+			T c4 = a[9] * a[15] - a[13] * a[11];
+			T c3 = a[9] * a[14] - a[13] * a[10];
+			T c2 = a[8] * a[15] - a[12] * a[11];
+			T c1 = a[8] * a[14] - a[12] * a[10];
+			T c0 = a[8] * a[13] - a[12] * a[9];
+
+			T det = s0 * c5 - s1 * c4 + s2 * c3 + s3 * c2 - s4 * c1 + s5 * c0;
+			assert (det != 0);
+			T inv = 1 / det;
+
+			res[0] = (a[5] * c5 - a[6] * c4 + a[7] * c3) * inv;
+			res[1] = (- a[1] * c5 + a[2] * c4 - a[3] * c3) * inv;
+			res[2] = (a[13] * s5 - a[14] * s4 + a[15] * s3) * inv;
+			res[3] = (- a[9] * s5 + a[10] * s4 - a[11] * s3) * inv;
+
+			res[4] = (- a[4] * c5 + a[6] * c2 - a[7] * c1) * inv;
+			res[5] = (a[0] * c5 - a[2] * c2 + a[3] * c1) * inv;
+			res[6] = (- a[12] * s5 + a[14] * s2 - a[15] * s1) * inv;
+			res[7] = (a[8] * s5 - a[10] * s2 + a[11] * s1) * inv;
+
+			res[8] = (a[4] * c4 - a[5] * c2 + a[7] * c0) * inv;
+			res[9] = (- a[0] * c4 + a[1] * c2 - a[3] * c0) * inv;
+			res[10] = (a[12] * s4 - a[13] * s2 + a[15] * s0) * inv;
+			res[11] = (- a[8] * s4 + a[9] * s2 - a[11] * s0) * inv;
+
+			res[12] = (- a[4] * c3 + a[5] * c1 - a[6] * c0) * inv;
+			res[13] = (a[0] * c3 - a[1] * c1 + a[2] * c0) * inv;
+			res[14] = (- a[12] * s3 + a[13] * s1 - a[14] * s0) * inv;
+			res[15] = (a[8] * s3 - a[9] * s1 + a[10] * s0) * inv;
+			return det;
+		}
+	};
+
+	template <class T, std::size_t R, std::size_t C>
+	class FixedMatrix
+	{
+
+		static_assert (R > 0 && C > 0, "FixedMatrix must not be empty");
+
+	public:
+		typedef T value_type;
+		typedef std::size_t size_type;
+		typedef std::ptrdiff_t difference_type;
+		typedef T& reference;
+		typedef const T& const_reference;
+		typedef T* pointer;
+		typedef const T* const_pointer;
+		typedef T* iterator;
+		typedef const T* const_iterator;
+
+		using row_type = FixedVector<T, C>;
+		using col_type = FixedVector<T, R>;
+
+		///Values are left uninitialized
+		FixedMatrix () = default;
+
+		explicit FixedMatrix (const T& x)
+		{
+			assign (x);
+		}
+
+		///Row-major list of the R * C values
+		FixedMatrix (std::initializer_list<T> list)
+		{
+			assert (list.size () == R * C);
+			std::copy_n (list.begin (), R * C, data_);
+		}
+
+		template <class It>
+		explicit FixedMatrix (It begin)
+		{
+			std::copy_n (begin, R * C, data_);
+		}
+
+		explicit FixedMatrix (const Matrix<T>& m)
+		{
+			assert (m.rows () == R && m.cols () == C);
+			std::copy_n (m.data (), R * C, data_);
+		}
+
+		static FixedMatrix
+		id ()
+		{
+			static_assert (R == C, "identity must be square");
+			FixedMatrix m (static_cast<T> (0));
+			FixedLoop<R>::run ([&](size_type i) { m.data_[i * C + i] = 1; });
+			return m;
+		}
+
+		static FixedMatrix
+		null ()
+		{
+			return FixedMatrix (static_cast<T> (0));
+		}
+
+		static FixedMatrix
+		from_rows_vectors (const std::initializer_list<row_type>& rows)
+		{
+			assert (rows.size () == R);
+			FixedMatrix m;
+			T* out = m.data_;
+			for (const auto& row : rows)
+				out = std::copy (row.begin (), row.end (), out);
+			return m;
+		}
+
+		void
+		assign (const T& x)
+		{
+			FixedLoop<R * C>::run ([&](size_type i) { data_[i] = x; });
+		}
+
+		///Copy in a dynamic matrix
+		Matrix<T>
+		matrix_get () const
+		{
+			return Matrix<T> (R, C, data_);
+		}
+
+		static constexpr size_type
+		rows ()
+		{
+			return R;
+		}
+
+		static constexpr size_type
+		cols ()
+		{
+			return C;
+		}
+
+		static constexpr size_type
+		size ()
+		{
+			return R * C;
+		}
+
+		static constexpr bool
+		empty ()
+		{
+			return false;
+		}
+
+		reference
+		at (size_type i, size_type j)
+		{
+			assert (i < R);
+			assert (j < C);
+			return data_[i * C + j];
+		}
+
+		const_reference
+		at (size_type i, size_type j) const
+		{
+			assert (i < R);
+			assert (j < C);
+			return data_[i * C + j];
+		}
+
+		T*
+		data ()
+		{
+			return data_;
+		}
+
+		const T*
+		data () const
+		{
+			return data_;
+		}
+
+		iterator
+		begin ()
+		{
+			return data_;
+		}
+
+		iterator
+		end ()
+		{
+			return data_ + R * C;
+		}
+
+		const_iterator
+		begin () const
+		{
+			return data_;
+		}
+
+		const_iterator
+		end () const
+		{
+			return data_ + R * C;
+		}
+
+		iterator
+		begin_row (size_type i)
+		{
+			assert (i < R);
+			return data_ + i * C;
+		}
+
+		iterator
+		end_row (size_type i)
+		{
+			assert (i < R);
+			return data_ + (i + 1) * C;
+		}
+
+		const_iterator
+		begin_row (size_type i) const
+		{
+			assert (i < R);
+			return data_ + i * C;
+		}
+
+		const_iterator
+		end_row (size_type i) const
+		{
+			assert (i < R);
+			return data_ + (i + 1) * C;
+		}
+
+		void
+		swap (FixedMatrix& m)
+		{
+			std::swap_ranges (data_, data_ + R * C, m.data_);
+		}
+
+		row_type
+		row_vector_get (size_type i) const
+		{
+			return row_type (begin_row (i), end_row (i));
+		}
+
+		col_type
+		col_vector_get (size_type j) const
+		{
+			assert (j < C);
+			col_type v;
+			FixedLoop<R>::run ([&](size_type i) { v[i] = data_[i * C + j]; });
+			return v;
+		}
+
+		FixedVector<T, R>
+		diagonal_to_vector () const
+		{
+			static_assert (R == C, "diagonal of a non square matrix");
+			FixedVector<T, R> v;
+			FixedLoop<R>::run ([&](size_type i) { v[i] = data_[i * C + i]; });
+			return v;
+		}
+
+		FixedMatrix<T, C, R>
+		transpose () const
+		{
+			FixedMatrix<T, C, R> m;
+			FixedLoop<R>::run ([&](size_type i) {
+					FixedLoop<C>::run ([&](size_type j) {
+							m.at (j, i) = data_[i * C + j];
+						});
+				});
+			return m;
+		}
+
+		bool
+		is_symmetric () const
+		{
+			if (R != C)
+				return false;
+			for (size_type i = 0; i < R; ++i)
+				for (size_type j = 0; j < i; ++j)
+					if (std::abs (data_[i * C + j] - data_[j * C + i])
+						>= OPL_ALGO_ZERO)
+						return false;
+			return true;
+		}
+
+		bool
+		is_id () const
+		{
+			if (R != C)
+				return false;
+			for (size_type i = 0; i < R; ++i)
+				for (size_type j = 0; j < C; ++j)
+					if (std::abs (data_[i * C + j] - static_cast<T> (i == j))
+						>= OPL_ALGO_ZERO)
+						return false;
+			return true;
+		}
+
+		bool
+		is_null () const
+		{
+			return algo::is_null (data_, data_ + R * C);
+		}
+
+		bool
+		equals (const FixedMatrix& m) const
+		{
+			return algo::equals (data_, data_ + R * C, m.data_);
+		}
+
+		friend std::ostream&
+		operator<< (std::ostream& os, const FixedMatrix& m)
+		{
+			os << "[";
+			for (size_type i = 0; i < R; ++i)
+			{
+				for (size_type j = 0; j < C; ++j)
+				{
+					os << m.at (i, j);
+					if (i + 1 != R || j + 1 != C)
+						os << ", ";
+				}
+				if (i + 1 != R)
+					os << "\n";
+			}
+			os << "]\n";
+			return os;
+		}
+
+		friend bool
+		operator== (const FixedMatrix& a, const FixedMatrix& b)
+		{
+			return std::equal (a.data_, a.data_ + R * C, b.data_);
+		}
+
+		friend bool
+		operator!= (const FixedMatrix& a, const FixedMatrix& b)
+		{
+			return !(a == b);
+		}
+
+		FixedMatrix
+		operator- () const
+		{
+			FixedMatrix res;
+			FixedLoop<R * C>::run ([&](size_type i) {
+					res.data_[i] = - data_[i];
+				});
+			return res;
+		}
+
+		FixedMatrix&
+		operator+= (const FixedMatrix& m)
+		{
+			FixedLoop<R * C>::run ([&](size_type i) { data_[i] += m.data_[i]; });
+			return *this;
+		}
+
+		FixedMatrix&
+		operator-= (const FixedMatrix& m)
+		{
+			FixedLoop<R * C>::run ([&](size_type i) { data_[i] -= m.data_[i]; });
+			return *this;
+		}
+
+		FixedMatrix&
+		operator*= (const T& x)
+		{
+			FixedLoop<R * C>::run ([&](size_type i) { data_[i] *= x; });
+			return *this;
+		}
+
+		FixedMatrix&
+		operator/= (const T& x)
+		{
+			FixedLoop<R * C>::run ([&](size_type i) { data_[i] /= x; });
+			return *this;
+		}
+
+		FixedMatrix&
+		operator*= (const FixedMatrix& m)
+		{
+			static_assert (R == C, "in-place product needs a square matrix");
+			*this = *this * m;
+			return *this;
+		}
+
+		friend FixedMatrix
+		operator+ (FixedMatrix a, const FixedMatrix& b)
+		{
+			return a += b;
+		}
+
+		friend FixedMatrix
+		operator- (FixedMatrix a, const FixedMatrix& b)
+		{
+			return a -= b;
+		}
+
+		friend FixedMatrix
+		operator* (FixedMatrix m, const T& x)
+		{
+			return m *= x;
+		}
+
+		friend FixedMatrix
+		operator* (const T& x, FixedMatrix m)
+		{
+			return m *= x;
+		}
+
+		friend FixedMatrix
+		operator/ (FixedMatrix m, const T& x)
+		{
+			return m /= x;
+		}
+
+		friend col_type
+		operator* (const FixedMatrix& m, const row_type& v)
+		{
+			col_type res;
+			FixedLoop<R>::run ([&](size_type i) {
+					T x = 0;
+					FixedLoop<C>::run ([&](size_type j) {
+							x += m.data_[i * C + j] * v[j];
+						});
+					res[i] = x;
+				});
+			return res;
+		}
+
+		friend row_type
+		operator* (const col_type& v, const FixedMatrix& m)
+		{
+			row_type res (static_cast<T> (0));
+			FixedLoop<R>::run ([&](size_type i) {
+					FixedLoop<C>::run ([&](size_type j) {
+							res[j] += v[i] * m.data_[i * C + j];
+						});
+				});
+			return res;
+		}
+
+		T
+		sum () const
+		{
+			T res = 0;
+			FixedLoop<R * C>::run ([&](size_type i) { res += data_[i]; });
+			return res;
+		}
+
+		T
+		norm_square () const
+		{
+			T res = 0;
+			FixedLoop<R * C>::run ([&](size_type i) {
+					res += data_[i] * data_[i];
+				});
+			return res;
+		}
+
+		T
+		norm () const
+		{
+			return std::sqrt (norm_square ());
+		}
+
+		T
+		min () const
+		{
+			return algo::min (data_, data_ + R * C);
+		}
+
+		T
+		max () const
+		{
+			return algo::max (data_, data_ + R * C);
+		}
+
+		T
+		trace () const
+		{
+			static_assert (R == C, "trace of a non square matrix");
+			T res = 0;
+			FixedLoop<R>::run ([&](size_type i) { res += data_[i * C + i]; });
+			return res;
+		}
+
+		///Closed form up to 4*4
+		T
+		determinant () const
+		{
+			static_assert (R == C, "determinant of a non square matrix");
+			return FixedSquare<T, R>::determinant (data_);
+		}
+
+		///Closed form up to 4*4, the matrix must be inversible
+		FixedMatrix
+		inverse () const
+		{
+			static_assert (R == C, "inverse of a non square matrix");
+			FixedMatrix res;
+			FixedSquare<T, R>::inverse (data_, res.data_);
+			return res;
+		}
+
+		///Solves Ax = b
+		col_type
+		solve_system (const col_type& b) const
+		{
+			return inverse () * b;
+		}
+
+		///Same as determinant (), keeps the Matrix interface
+		T
+		plu_determinant () const
+		{
+			return determinant ();
+		}
+
+		///Same as inverse (), keeps the Matrix interface
+		FixedMatrix
+		plu_inverse () const
+		{
+			return inverse ();
+		}
+
+		///Same as solve_system (), keeps the Matrix interface
+		col_type
+		plu_solve_system (const col_type& b) const
+		{
+			return solve_system (b);
+		}
+
+	private:
+		alignas (fixed_alignment<T> (R * C)) T data_[R * C];
+
+	};
+
+	template <class T, std::size_t R, std::size_t K, std::size_t C>
+	FixedMatrix<T, R, C>
+	operator* (const FixedMatrix<T, R, K>& a, const FixedMatrix<T, K, C>& b)
+	{
+		FixedMatrix<T, R, C> m;
+		FixedLoop<R>::run ([&](std::size_t i) {
+				FixedLoop<C>::run ([&](std::size_t j) {
+						T x = 0;
+						FixedLoop<K>::run ([&](std::size_t k) {
+								x += a.at (i, k) * b.at (k, j);
+							});
+						m.at (i, j) = x;
+					});
+			});
+		return m;
+	}
+
+	template <std::size_t R, std::size_t C>
+	using rfmat_type = FixedMatrix<r_type, R, C>;
+
+}
+
+#endif //!FIXED_MATRIX_HH_
@@ -0,0 +1,664 @@
+/** @file FixedVector class definition
+ * Vector with compile-time size and inline storage
+ */
+
+#ifndef FIXED_VECTOR_HH_
+# define FIXED_VECTOR_HH_
+
+# include <cstddef>
+# include <cassert>
+# include <algorithm>
+# include <cmath>
+# include <initializer_list>
+# include <iostream>
+# include <stdexcept>
+# include "algo.hh"
+# include "vector.hh"
+# include "types.hh"
+
+namespace opl
+{
+
+	///Calls f (0), f (1), ..., f (N - 1), fully unrolled at compile-time
+	template <std::size_t N>
+	struct FixedLoop
+	{
+		template <class F>
+		static void
+		run (F&& f)
+		{
+			FixedLoop<N - 1>::run (f);
+			f (N - 1);
+		}
+	};
+
+	template <>
+	struct FixedLoop<0>
+	{
+		template <class F>
+		static void
+		run (F&&)
+		{
+		}
+	};
+
+	///Alignment of an inline array of n T
+	///Kept under max_align_t so heap-allocated objects stay aligned
+	template <class T>
+	constexpr std::size_t
+	fixed_alignment (std::size_t n)
+	{
+		return (n * sizeof (T)) % alignof (std::max_align_t) == 0
+			&& alignof (std::max_align_t) > alignof (T)
+			? alignof (std::max_align_t) : alignof (T);
+	}
+
+	template <class T, std::size_t N>
+	class FixedVector
+	{
+
+		static_assert (N > 0, "FixedVector must have at least one element");
+
+	public:
+		typedef T value_type;
+		typedef std::size_t size_type;
+		typedef std::ptrdiff_t difference_type;
+		typedef T& reference;
+		typedef const T& const_reference;
+		typedef T* pointer;
+		typedef const T* const_pointer;
+		typedef T* iterator;
+		typedef const T* const_iterator;
+
+		///Values are left uninitialized
+		FixedVector () = default;
+
+		explicit FixedVector (const T& x)
+		{
+			assign (x);
+		}
+
+		FixedVector (std::initializer_list<T> list)
+		{
+			assert (list.size () == N);
+			std::copy_n (list.begin (), N, data_);
+		}
+
+		template <class It>
+		FixedVector (It begin, It end)
+		{
+			assert (static_cast<size_type> (end - begin) == N);
+			std::copy_n (begin, N, data_);
+		}
+
+		explicit FixedVector (const Vector<T>& v)
+		{
+			assert (v.size () == N);
+			std::copy_n (v.data (), N, data_);
+		}
+
+		static FixedVector
+		null ()
+		{
+			return FixedVector (static_cast<T> (0));
+		}
+
+		void
+		assign (const T& x)
+		{
+			FixedLoop<N>::run ([&](size_type i) { data_[i] = x; });
+		}
+
+		///Copy in a dynamic vector
+		Vector<T>
+		vector_get () const
+		{
+			return Vector<T> (data_, data_ + N);
+		}
+
+		static constexpr size_type
+		size ()
+		{
+			return N;
+		}
+
+		static constexpr bool
+		empty ()
+		{
+			return false;
+		}
+
+		reference
+		at (size_type n)
+		{
+			if (n >= N)
+				throw std::out_of_range {"FixedVector: index out of range"};
+			return data_[n];
+		}
+
+		const_reference
+		at (size_type n) const
+		{
+			if (n >= N)
+				throw std::out_of_range {"FixedVector: index out of range"};
+			return data_[n];
+		}
+
+		reference
+		operator[] (size_type n)
+		{
+			assert (n < N);
+			return data_[n];
+		}
+
+		const_reference
+		operator[] (size_type n) const
+		{
+			assert (n < N);
+			return data_[n];
+		}
+
+		T*
+		data ()
+		{
+			return data_;
+		}
+
+		const T*
+		data () const
+		{
+			return data_;
+		}
+
+		iterator
+		begin ()
+		{
+			return data_;
+		}
+
+		iterator
+		end ()
+		{
+			return data_ + N;
+		}
+
+		const_iterator
+		begin () const
+		{
+			return data_;
+		}
+
+		const_iterator
+		end () const
+		{
+			return data_ + N;
+		}
+
+		const_iterator
+		cbegin () const
+		{
+			return data_;
+		}
+
+		const_iterator
+		cend () const
+		{
+			return data_ + N;
+		}
+
+		void
+		swap (FixedVector& v)
+		{
+			std::swap_ranges (data_, data_ + N, v.data_);
+		}
+
+		friend std::ostream&
+		operator<< (std::ostream& os, const FixedVector& v)
+		{
+			os << "[";
+			for (size_type i = 0; i < N; ++i)
+			{
+				if (i)
+					os << ", ";
+				os << v.data_[i];
+			}
+			os << "]";
+			return os;
+		}
+
+		friend bool
+		operator== (const FixedVector& a, const FixedVector& b)
+		{
+			return std::equal (a.data_, a.data_ + N, b.data_);
+		}
+
+		friend bool
+		operator!= (const FixedVector& a, const FixedVector& b)
+		{
+			return !(a == b);
+		}
+
+		FixedVector
+		operator- () const
+		{
+			FixedVector res;
+			FixedLoop<N>::run ([&](size_type i) { res.data_[i] = - data_[i]; });
+			return res;
+		}
+
+		FixedVector&
+		operator+= (const FixedVector& v)
+		{
+			FixedLoop<N>::run ([&](size_type i) { data_[i] += v.data_[i]; });
+			return *this;
+		}
+
+		FixedVector&
+		operator-= (const FixedVector& v)
+		{
+			FixedLoop<N>::run ([&](size_type i) { data_[i] -= v.data_[i]; });
+			return *this;
+		}
+
+		FixedVector&
+		operator+= (const T& x)
+		{
+			FixedLoop<N>::run ([&](size_type i) { data_[i] += x; });
+			return *this;
+		}
+
+		FixedVector&
+		operator-= (const T& x)
+		{
+			FixedLoop<N>::run ([&](size_type i) { data_[i] -= x; });
+			return *this;
+		}
+
+		FixedVector&
+		operator*= (const T& x)
+		{
+			FixedLoop<N>::run ([&](size_type i) { data_[i] *= x; });
+			return *this;
+		}
+
+		FixedVector&
+		operator/= (const T& x)
+		{
+			FixedLoop<N>::run ([&](size_type i) { data_[i] /= x; });
+			return *this;
+		}
+
+		FixedVector&
+		operator%= (const T& x)
+		{
+			FixedLoop<N>::run ([&](size_type i) { data_[i] %= x; });
+			return *this;
+		}
+
+		friend FixedVector
+		operator+ (FixedVector a, const FixedVector& b)
+		{
+			return a += b;
+		}
+
+		friend FixedVector
+		operator- (FixedVector a, const FixedVector& b)
+		{
+			return a -= b;
+		}
+
+		friend FixedVector
+		operator+ (FixedVector v, const T& x)
+		{
+			return v += x;
+		}
+
+		friend FixedVector
+		operator+ (const T& x, FixedVector v)
+		{
+			return v += x;
+		}
+
+		friend FixedVector
+		operator- (FixedVector v, const T& x)
+		{
+			return v -= x;
+		}
+
+		friend FixedVector
+		operator- (const T& x, const FixedVector& v)
+		{
+			FixedVector res;
+			FixedLoop<N>::run ([&](size_type i) { res.data_[i] = x - v.data_[i]; });
+			return res;
+		}
+
+		friend FixedVector
+		operator* (FixedVector v, const T& x)
+		{
+			return v *= x;
+		}
+
+		friend FixedVector
+		operator* (const T& x, FixedVector v)
+		{
+			return v *= x;
+		}
+
+		friend FixedVector
+		operator/ (FixedVector v, const T& x)
+		{
+			return v /= x;
+		}
+
+		friend FixedVector
+		operator/ (const T& x, const FixedVector& v)
+		{
+			FixedVector res;
+			FixedLoop<N>::run ([&](size_type i) { res.data_[i] = x / v.data_[i]; });
+			return res;
+		}
+
+		friend FixedVector
+		operator% (FixedVector v, const T& x)
+		{
+			return v %= x;
+		}
+
+		void
+		plus (const FixedVector& v)
+		{
+			*this += v;
+		}
+
+		FixedVector
+		plus_get (const FixedVector& v) const
+		{
+			return *this + v;
+		}
+
+		void
+		minus (const FixedVector& v)
+		{
+			*this -= v;
+		}
+
+		FixedVector
+		minus_get (const FixedVector& v) const
+		{
+			return *this - v;
+		}
+
+		void
+		multiplies (const FixedVector& v)
+		{
+			FixedLoop<N>::run ([&](size_type i) { data_[i] *= v.data_[i]; });
+		}
+
+		FixedVector
+		multiplies_get (const FixedVector& v) const
+		{
+			FixedVector res (*this);
+			res.multiplies (v);
+			return res;
+		}
+
+		void
+		divides (const FixedVector& v)
+		{
+			FixedLoop<N>::run ([&](size_type i) { data_[i] /= v.data_[i]; });
+		}
+
+		FixedVector
+		divides_get (const FixedVector& v) const
+		{
+			FixedVector res (*this);
+			res.divides (v);
+			return res;
+		}
+
+		void
+		negate ()
+		{
+			*this = - *this;
+		}
+
+		FixedVector
+		negate_get () const
+		{
+			return - *this;
+		}
+
+		void
+		abs ()
+		{
+			FixedLoop<N>::run ([&](size_type i) {
+					data_[i] = std::abs (data_[i]);
+				});
+		}
+
+		FixedVector
+		abs_get () const
+		{
+			FixedVector res (*this);
+			res.abs ();
+			return res;
+		}
+
+		T
+		min () const
+		{
+			return algo::min (data_, data_ + N);
+		}
+
+		T
+		max () const
+		{
+			return algo::max (data_, data_ + N);
+		}
+
+		T
+		min_abs () const
+		{
+			return algo::min_abs (data_, data_ + N);
+		}
+
+		T
+		max_abs () const
+		{
+			return algo::max_abs (data_, data_ + N);
+		}
+
+		T
+		norm_square () const
+		{
+			return dot_product (*this);
+		}
+
+		T
+		norm () const
+		{
+			return std::sqrt (norm_square ());
+		}
+
+		T
+		p_norm (size_type p) const
+		{
+			return algo::p_norm (data_, data_ + N, p);
+		}
+
+		T
+		sum () const
+		{
+			T res = 0;
+			FixedLoop<N>::run ([&](size_type i) { res += data_[i]; });
+			return res;
+		}
+
+		T
+		sum_abs () const
+		{
+			return algo::sum_abs (data_, data_ + N);
+		}
+
+		T
+		product () const
+		{
+			T res = 1;
+			FixedLoop<N>::run ([&](size_type i) { res *= data_[i]; });
+			return res;
+		}
+
+		T
+		product_abs () const
+		{
+			return algo::product_abs (data_, data_ + N);
+		}
+
+		void
+		normalize ()
+		{
+			*this /= norm ();
+		}
+
+		FixedVector
+		normalize_get () const
+		{
+			return *this / norm ();
+		}
+
+		bool
+		is_unit () const
+		{
+			return std::abs (norm_square () - 1) < OPL_ALGO_ZERO;
+		}
+
+		bool
+		is_null () const
+		{
+			return algo::is_null (data_, data_ + N);
+		}
+
+		T
+		dot_product (const FixedVector& v) const
+		{
+			T res = 0;
+			FixedLoop<N>::run ([&](size_type i) { res += data_[i] * v.data_[i]; });
+			return res;
+		}
+
+		T
+		distance_square (const FixedVector& v) const
+		{
+			return (*this - v).norm_square ();
+		}
+
+		T
+		distance (const FixedVector& v) const
+		{
+			return std::sqrt (distance_square (v));
+		}
+
+		bool
+		is_orthogonal (const FixedVector& v) const
+		{
+			return std::abs (dot_product (v)) < OPL_ALGO_ZERO;
+		}
+
+		bool
+		is_orthonormal (const FixedVector& v) const
+		{
+			return is_unit () && v.is_unit () && is_orthogonal (v);
+		}
+
+		bool
+		equals (const FixedVector& v) const
+		{
+			return algo::equals (data_, data_ + N, v.data_);
+		}
+
+		void
+		project_along (const FixedVector& v)
+		{
+			*this = project_along_get (v);
+		}
+
+		FixedVector
+		project_along_get (const FixedVector& v) const
+		{
+			T den = v.norm_square ();
+			if (den < OPL_ALGO_ZERO)
+				return null ();
+			return v * (dot_product (v) / den);
+		}
+
+		void
+		project_orthogonal (const FixedVector& v)
+		{
+			*this -= project_along_get (v);
+		}
+
+		FixedVector
+		project_orthogonal_get (const FixedVector& v) const
+		{
+			return *this - project_along_get (v);
+		}
+
+		void
+		saxpy (const T& x, const FixedVector& v)
+		{
+			FixedLoop<N>::run ([&](size_type i) { data_[i] += x * v.data_[i]; });
+		}
+
+		FixedVector
+		saxpy_get (const T& x, const FixedVector& v) const
+		{
+			FixedVector res (*this);
+			res.saxpy (x, v);
+			return res;
+		}
+
+		T
+		mean () const
+		{
+			return sum () / static_cast<T> (N);
+		}
+
+		T
+		median () const
+		{
+			return algo::median (data_, data_ + N);
+		}
+
+		T
+		variance () const
+		{
+			return algo::variance (data_, data_ + N);
+		}
+
+		T
+		standard_deviation () const
+		{
+			return algo::standard_deviation (data_, data_ + N);
+		}
+
+	private:
+		alignas (fixed_alignment<T> (N)) T data_[N];
+
+	};
+
+	template <class T>
+	FixedVector<T, 3>
+	cross_product (const FixedVector<T, 3>& a, const FixedVector<T, 3>& b)
+	{
+		return {a[1] * b[2] - a[2] * b[1],
+				a[2] * b[0] - a[0] * b[2],
+				a[0] * b[1] - a[1] * b[0]};
+	}
+
+	template <std::size_t N>
+	using rfvec_type = FixedVector<r_type, N>;
+
+}
+
+#endif //!FIXED_VECTOR_HH_
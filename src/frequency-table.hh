@@ -0,0 +1,245 @@
+/** @file FrequencyTable class definition
+ *
+ * Counts the occurrences of values in an open-addressed hash table: keys
+ * and counts are stored in two flat arrays, collisions go to the next slot
+ * (linear probing), and the table doubles when half full.
+ * std::hash is mixed by a multiplicative (Fibonacci) hash first, so identity
+ * hashes of integers don't pile up in neighbour slots.
+ */
+
+#ifndef FREQUENCY_TABLE_HH_
+# define FREQUENCY_TABLE_HH_
+
+# include <algorithm>
+# include <cstddef>
+# include <cstdint>
+# include <functional>
+# include <utility>
+# include <vector>
+
+namespace opl
+{
+
+	template <class T, class Hash = std::hash<T>>
+	class FrequencyTable
+	{
+
+	public:
+		using size_type = std::size_t;
+
+		///Table for n distinct values without rehashing
+		explicit FrequencyTable (size_type n = 8);
+
+		///Counts n more occurrences of x
+		void
+		add (const T& x, size_type n = 1);
+
+		template <class It>
+		void
+		add (It begin, It end);
+
+		///Number of occurrences of x
+		size_type
+		count (const T& x) const;
+
+		///Number of distinct values
+		size_type
+		distinct () const;
+
+		///Number of occurrences counted
+		size_type
+		total () const;
+
+		bool
+		empty () const;
+
+		///Most frequent value, the smallest one on ties
+		T
+		mode () const;
+
+		///Calls f (value, count) for every distinct value, in no order
+		template <class F>
+		void
+		for_each (F f) const;
+
+		///Pairs (value, count), in no order
+		std::vector<std::pair<T, size_type>>
+		values () const;
+
+		void
+		reserve (size_type n);
+
+		void
+		clear ();
+
+	private:
+		size_type
+		slot_ (const T& x) const;
+
+		void
+		rehash_ (unsigned bits);
+
+		std::vector<T> keys_;
+
+		///0 marks an empty slot
+		std::vector<size_type> counts_;
+		unsigned bits_;
+		size_type distinct_;
+		size_type total_;
+
+	};
+
+	template <class T, class Hash>
+	FrequencyTable<T, Hash>::FrequencyTable (size_type n)
+		: bits_ (0)
+		, distinct_ (0)
+		, total_ (0)
+	{
+		reserve (n);
+	}
+
+	template <class T, class Hash>
+	void
+	FrequencyTable<T, Hash>::add (const T& x, size_type n)
+	{
+		if (!n)
+			return;
+		if (2 * (distinct_ + 1) > counts_.size ())
+			rehash_ (bits_ + 1);
+		size_type i = slot_ (x);
+		if (!counts_[i])
+		{
+			keys_[i] = x;
+			++distinct_;
+		}
+		counts_[i] += n;
+		total_ += n;
+	}
+
+	template <class T, class Hash>
+	template <class It>
+	void
+	FrequencyTable<T, Hash>::add (It begin, It end)
+	{
+		for (It i = begin; i != end; ++i)
+			add (*i);
+	}
+
+	template <class T, class Hash>
+	typename FrequencyTable<T, Hash>::size_type
+	FrequencyTable<T, Hash>::count (const T& x) const
+	{
+		return counts_[slot_ (x)];
+	}
+
+	template <class T, class Hash>
+	typename FrequencyTable<T, Hash>::size_type
+	FrequencyTable<T, Hash>::distinct () const
+	{
+		return distinct_;
+	}
+
+	template <class T, class Hash>
+	typename FrequencyTable<T, Hash>::size_type
+	FrequencyTable<T, Hash>::total () const
+	{
+		return total_;
+	}
+
+	template <class T, class Hash>
+	bool
+	FrequencyTable<T, Hash>::empty () const
+	{
+		return !total_;
+	}
+
+	template <class T, class Hash>
+	T
+	FrequencyTable<T, Hash>::mode () const
+	{
+		T res {};
+		size_type best = 0;
+		for (size_type i = 0; i < counts_.size (); ++i)
+			if (counts_[i] > best || (counts_[i] && counts_[i] == best
+									  && keys_[i] < res))
+			{
+				res = keys_[i];
+				best = counts_[i];
+			}
+		return res;
+	}
+
+	template <class T, class Hash>
+	template <class F>
+	void
+	FrequencyTable<T, Hash>::for_each (F f) const
+	{
+		for (size_type i = 0; i < counts_.size (); ++i)
+			if (counts_[i])
+				f (keys_[i], counts_[i]);
+	}
+
+	template <class T, class Hash>
+	std::vector<std::pair<T, typename FrequencyTable<T, Hash>::size_type>>
+	FrequencyTable<T, Hash>::values () const
+	{
+		std::vector<std::pair<T, size_type>> res;
+		res.reserve (distinct_);
+		for_each ([&](const T& x, size_type n) { res.emplace_back (x, n); });
+		return res;
+	}
+
+	template <class T, class Hash>
+	void
+	FrequencyTable<T, Hash>::reserve (size_type n)
+	{
+		unsigned bits = 1;
+		while ((size_type (1) << bits) < 2 * n)
+			++bits;
+		if (bits > bits_)
+			rehash_ (bits);
+	}
+
+	template <class T, class Hash>
+	void
+	FrequencyTable<T, Hash>::clear ()
+	{
+		std::fill (counts_.begin (), counts_.end (), size_type (0));
+		distinct_ = 0;
+		total_ = 0;
+	}
+
+	template <class T, class Hash>
+	typename FrequencyTable<T, Hash>::size_type
+	FrequencyTable<T, Hash>::slot_ (const T& x) const
+	{
+		std::uint64_t h = static_cast<std::uint64_t> (Hash {} (x));
+		size_type i = static_cast<size_type> ((h * 0x9e3779b97f4a7c15ull)
+											  >> (64 - bits_));
+		size_type mask = counts_.size () - 1;
+		while (counts_[i] && !(keys_[i] == x))
+			i = (i + 1) & mask;
+		return i;
+	}
+
+	template <class T, class Hash>
+	void
+	FrequencyTable<T, Hash>::rehash_ (unsigned bits)
+	{
+		std::vector<T> keys (size_type (1) << bits);
+		std::vector<size_type> counts (size_type (1) << bits, 0);
+		keys_.swap (keys);
+		counts_.swap (counts);
+		bits_ = bits;
+		for (size_type i = 0; i < counts.size (); ++i)
+			if (counts[i])
+			{
+				size_type j = slot_ (keys[i]);
+				keys_[j] = std::move (keys[i]);
+				counts_[j] = counts[i];
+			}
+	}
+
+}
+
+#endif //!FREQUENCY_TABLE_HH_
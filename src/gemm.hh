@@ -0,0 +1,558 @@
+/** @file Packed, cache-blocked matrix products
+ *
+ * C <- alpha * A * B + beta * C, with every operand described by a pointer,
+ * a row stride and a column stride, so transposed or column-major operands
+ * cost nothing more than a different stride.
+ * Blocks of B (kc x nc) are packed for the L3 cache, blocks of A (mc x kc)
+ * for the L2 cache, and a register-tiled mr x nr micro-kernel streams
+ * micro-panels from the L1 cache.
+ * float and double use SSE2 or AVX2 micro-kernels depending on the target
+ * flags (-msse2, -mavx2, -mfma), other types use a generic kernel.
+ * With the parallel backend enabled, the row blocks of A and the packing
+ * of B are shared between threads.
+ */
+
+#ifndef GEMM_HH_
+# define GEMM_HH_
+
+# include <cstddef>
+# include <algorithm>
+# include <vector>
+# include "parallel.hh"
+
+# if defined (__AVX2__)
+#  include <immintrin.h>
+#  define OPL_GEMM_AVX2
+# elif defined (__SSE2__)
+#  include <emmintrin.h>
+#  define OPL_GEMM_SSE2
+# endif
+
+///Under this number of multiply-adds, gemm runs a plain loop without packing
+# define OPL_GEMM_SMALL 32768
+
+namespace opl
+{
+
+	namespace linalg
+	{
+
+		///Blocking sizes and micro-kernel for the type T
+		template <class T>
+		struct GemmKernel
+		{
+			static constexpr std::size_t mr = 4;
+			static constexpr std::size_t nr = 4;
+			static constexpr std::size_t mc = 64;
+			static constexpr std::size_t kc = 128;
+			static constexpr std::size_t nc = 2048;
+
+			///ab <- a * b, a a packed mr x kc panel, b a packed kc x nr panel
+			static void
+			run (std::size_t k, const T* a, const T* b, T* ab)
+			{
+				T acc[mr * nr];
+				std::fill (acc, acc + mr * nr, static_cast<T> (0));
+				for (std::size_t p = 0; p < k; ++p, a += mr, b += nr)
+					for (std::size_t i = 0; i < mr; ++i)
+						for (std::size_t j = 0; j < nr; ++j)
+							acc[i * nr + j] += a[i] * b[j];
+				std::copy (acc, acc + mr * nr, ab);
+			}
+		};
+
+# if defined (OPL_GEMM_AVX2)
+
+		inline __m256d
+		fmadd_ (__m256d a, __m256d b, __m256d c)
+		{
+#  if defined (__FMA__)
+			return _mm256_fmadd_pd (a, b, c);
+#  else
+			return _mm256_add_pd (_mm256_mul_pd (a, b), c);
+#  endif
+		}
+
+		inline __m256
+		fmadd_ (__m256 a, __m256 b, __m256 c)
+		{
+#  if defined (__FMA__)
+			return _mm256_fmadd_ps (a, b, c);
+#  else
+			return _mm256_add_ps (_mm256_mul_ps (a, b), c);
+#  endif
+		}
+
+		template <>
+		struct GemmKernel<double>
+		{
+			static constexpr std::size_t mr = 4;
+			static constexpr std::size_t nr = 8;
+			static constexpr std::size_t mc = 96;
+			static constexpr std::size_t kc = 256;
+			static constexpr std::size_t nc = 4096;
+
+			static void
+			run (std::size_t k, const double* a, const double* b, double* ab)
+			{
+				__m256d c00 = _mm256_setzero_pd ();
+				__m256d c01 = _mm256_setzero_pd ();
+				__m256d c10 = _mm256_setzero_pd ();
+				__m256d c11 = _mm256_setzero_pd ();
+				__m256d c20 = _mm256_setzero_pd ();
+				__m256d c21 = _mm256_setzero_pd ();
+				__m256d c30 = _mm256_setzero_pd ();
+				__m256d c31 = _mm256_setzero_pd ();
+
+				for (std::size_t p = 0; p < k; ++p, a += mr, b += nr)
+				{
+					__m256d b0 = _mm256_loadu_pd (b);
+					__m256d b1 = _mm256_loadu_pd (b + 4);
+					__m256d ai = _mm256_broadcast_sd (a);
+					c00 = fmadd_ (ai, b0, c00);
+					c01 = fmadd_ (ai, b1, c01);
+					ai = _mm256_broadcast_sd (a + 1);
+					c10 = fmadd_ (ai, b0, c10);
+					c11 = fmadd_ (ai, b1, c11);
+					ai = _mm256_broadcast_sd (a + 2);
+					c20 = fmadd_ (ai, b0, c20);
+					c21 = fmadd_ (ai, b1, c21);
+					ai = _mm256_broadcast_sd (a + 3);
+					c30 = fmadd_ (ai, b0, c30);
+					c31 = fmadd_ (ai, b1, c31);
+				}
+
+				_mm256_storeu_pd (ab, c00);
+				_mm256_storeu_pd (ab + 4, c01);
+				_mm256_storeu_pd (ab + 8, c10);
+				_mm256_storeu_pd (ab + 12, c11);
+				_mm256_storeu_pd (ab + 16, c20);
+				_mm256_storeu_pd (ab + 20, c21);
+				_mm256_storeu_pd (ab + 24, c30);
+				_mm256_storeu_pd (ab + 28, c31);
+			}
+		};
+
+		template <>
+		struct GemmKernel<float>
+		{
+			static constexpr std::size_t mr = 4;
+			static constexpr std::size_t nr = 16;
+			static constexpr std::size_t mc = 128;
+			static constexpr std::size_t kc = 384;
+			static constexpr std::size_t nc = 4096;
+
+			static void
+			run (std::size_t k, const float* a, const float* b, float* ab)
+			{
+				__m256 c00 = _mm256_setzero_ps ();
+				__m256 c01 = _mm256_setzero_ps ();
+				__m256 c10 = _mm256_setzero_ps ();
+				__m256 c11 = _mm256_setzero_ps ();
+				__m256 c20 = _mm256_setzero_ps ();
+				__m256 c21 = _mm256_setzero_ps ();
+				__m256 c30 = _mm256_setzero_ps ();
+				__m256 c31 = _mm256_setzero_ps ();
+
+				for (std::size_t p = 0; p < k; ++p, a += mr, b += nr)
+				{
+					__m256 b0 = _mm256_loadu_ps (b);
+					__m256 b1 = _mm256_loadu_ps (b + 8);
+					__m256 ai = _mm256_broadcast_ss (a);
+					c00 = fmadd_ (ai, b0, c00);
+					c01 = fmadd_ (ai, b1, c01);
+					ai = _mm256_broadcast_ss (a + 1);
+					c10 = fmadd_ (ai, b0, c10);
+					c11 = fmadd_ (ai, b1, c11);
+					ai = _mm256_broadcast_ss (a + 2);
+					c20 = fmadd_ (ai, b0, c20);
+					c21 = fmadd_ (ai, b1, c21);
+					ai = _mm256_broadcast_ss (a + 3);
+					c30 = fmadd_ (ai, b0, c30);
+					c31 = fmadd_ (ai, b1, c31);
+				}
+
+				_mm256_storeu_ps (ab, c00);
+				_mm256_storeu_ps (ab + 8, c01);
+				_mm256_storeu_ps (ab + 16, c10);
+				_mm256_storeu_ps (ab + 24, c11);
+				_mm256_storeu_ps (ab + 32, c20);
+				_mm256_storeu_ps (ab + 40, c21);
+				_mm256_storeu_ps (ab + 48, c30);
+				_mm256_storeu_ps (ab + 56, c31);
+			}
+		};
+
+# elif defined (OPL_GEMM_SSE2)
+
+		template <>
+		struct GemmKernel<double>
+		{
+			static constexpr std::size_t mr = 4;
+			static constexpr std::size_t nr = 4;
+			static constexpr std::size_t mc = 96;
+			static constexpr std::size_t kc = 256;
+			static constexpr std::size_t nc = 4096;
+
+			static void
+			run (std::size_t k, const double* a, const double* b, double* ab)
+			{
+				__m128d c00 = _mm_setzero_pd ();
+				__m128d c01 = _mm_setzero_pd ();
+				__m128d c10 = _mm_setzero_pd ();
+				__m128d c11 = _mm_setzero_pd ();
+				__m128d c20 = _mm_setzero_pd ();
+				__m128d c21 = _mm_setzero_pd ();
+				__m128d c30 = _mm_setzero_pd ();
+				__m128d c31 = _mm_setzero_pd ();
+
+				for (std::size_t p = 0; p < k; ++p, a += mr, b += nr)
+				{
+					__m128d b0 = _mm_loadu_pd (b);
+					__m128d b1 = _mm_loadu_pd (b + 2);
+					__m128d ai = _mm_set1_pd (a[0]);
+					c00 = _mm_add_pd (_mm_mul_pd (ai, b0), c00);
+					c01 = _mm_add_pd (_mm_mul_pd (ai, b1), c01);
+					ai = _mm_set1_pd (a[1]);
+					c10 = _mm_add_pd (_mm_mul_pd (ai, b0), c10);
+					c11 = _mm_add_pd (_mm_mul_pd (ai, b1), c11);
+					ai = _mm_set1_pd (a[2]);
+					c20 = _mm_add_pd (_mm_mul_pd (ai, b0), c20);
+					c21 = _mm_add_pd (_mm_mul_pd (ai, b1), c21);
+					ai = _mm_set1_pd (a[3]);
+					c30 = _mm_add_pd (_mm_mul_pd (ai, b0), c30);
+					c31 = _mm_add_pd (_mm_mul_pd (ai, b1), c31);
+				}
+
+				_mm_storeu_pd (ab, c00);
+				_mm_storeu_pd (ab + 2, c01);
+				_mm_storeu_pd (ab + 4, c10);
+				_mm_storeu_pd (ab + 6, c11);
+				_mm_storeu_pd (ab + 8, c20);
+				_mm_storeu_pd (ab + 10, c21);
+				_mm_storeu_pd (ab + 12, c30);
+				_mm_storeu_pd (ab + 14, c31);
+			}
+		};
+
+		template <>
+		struct GemmKernel<float>
+		{
+			static constexpr std::size_t mr = 4;
+			static constexpr std::size_t nr = 8;
+			static constexpr std::size_t mc = 128;
+			static constexpr std::size_t kc = 384;
+			static constexpr std::size_t nc = 4096;
+
+			static void
+			run (std::size_t k, const float* a, const float* b, float* ab)
+			{
+				__m128 c00 = _mm_setzero_ps ();
+				__m128 c01 = _mm_setzero_ps ();
+				__m128 c10 = _mm_setzero_ps ();
+				__m128 c11 = _mm_setzero_ps ();
+				__m128 c20 = _mm_setzero_ps ();
+				__m128 c21 = _mm_setzero_ps ();
+				__m128 c30 = _mm_setzero_ps ();
+				__m128 c31 = _mm_setzero_ps ();
+
+				for (std::size_t p = 0; p < k; ++p, a += mr, b += nr)
+				{
+					__m128 b0 = _mm_loadu_ps (b);
+					__m128 b1 = _mm_loadu_ps (b + 4);
+					__m128 ai = _mm_set1_ps (a[0]);
+					c00 = _mm_add_ps (_mm_mul_ps (ai, b0), c00);
+					c01 = _mm_add_ps (_mm_mul_ps (ai, b1), c01);
+					ai = _mm_set1_ps (a[1]);
+					c10 = _mm_add_ps (_mm_mul_ps (ai, b0), c10);
+					c11 = _mm_add_ps (_mm_mul_ps (ai, b1), c11);
+					ai = _mm_set1_ps (a[2]);
+					c20 = _mm_add_ps (_mm_mul_ps (ai, b0), c20);
+					c21 = _mm_add_ps (_mm_mul_ps (ai, b1), c21);
+					ai = _mm_set1_ps (a[3]);
+					c30 = _mm_add_ps (_mm_mul_ps (ai, b0), c30);
+					c31 = _mm_add_ps (_mm_mul_ps (ai, b1), c31);
+				}
+
+				_mm_storeu_ps (ab, c00);
+				_mm_storeu_ps (ab + 4, c01);
+				_mm_storeu_ps (ab + 8, c10);
+				_mm_storeu_ps (ab + 12, c11);
+				_mm_storeu_ps (ab + 16, c20);
+				_mm_storeu_ps (ab + 20, c21);
+				_mm_storeu_ps (ab + 24, c30);
+				_mm_storeu_ps (ab + 28, c31);
+			}
+		};
+
+# endif
+
+		///c <- beta * c on a m x n block
+		template <class T>
+		void
+		scale_ (std::size_t m, std::size_t n, T beta,
+				T* c, std::size_t rsc, std::size_t csc)
+		{
+			for (std::size_t i = 0; i < m; ++i)
+				for (std::size_t j = 0; j < n; ++j)
+				{
+					T& cij = c[i * rsc + j * csc];
+					cij = beta == static_cast<T> (0)
+						? static_cast<T> (0) : beta * cij;
+				}
+		}
+
+		///Packs a m x k block of A into panels of mr rows, padded with 0
+		template <class T>
+		void
+		pack_a_ (std::size_t m, std::size_t k, const T* a,
+				 std::size_t rsa, std::size_t csa, T* buf)
+		{
+			constexpr std::size_t mr = GemmKernel<T>::mr;
+			for (std::size_t i0 = 0; i0 < m; i0 += mr)
+			{
+				std::size_t rows = std::min (mr, m - i0);
+				for (std::size_t p = 0; p < k; ++p)
+				{
+					const T* src = a + i0 * rsa + p * csa;
+					for (std::size_t i = 0; i < rows; ++i)
+						buf[i] = src[i * rsa];
+					for (std::size_t i = rows; i < mr; ++i)
+						buf[i] = static_cast<T> (0);
+					buf += mr;
+				}
+			}
+		}
+
+		///Packs a k x n block of B into panels of nr columns, padded with 0
+		template <class T>
+		void
+		pack_b_ (std::size_t k, std::size_t n, const T* b,
+				 std::size_t rsb, std::size_t csb, T* buf)
+		{
+			constexpr std::size_t nr = GemmKernel<T>::nr;
+			for (std::size_t j0 = 0; j0 < n; j0 += nr)
+			{
+				std::size_t cols = std::min (nr, n - j0);
+				for (std::size_t p = 0; p < k; ++p)
+				{
+					const T* src = b + p * rsb + j0 * csb;
+					for (std::size_t j = 0; j < cols; ++j)
+						buf[j] = src[j * csb];
+					for (std::size_t j = cols; j < nr; ++j)
+						buf[j] = static_cast<T> (0);
+					buf += nr;
+				}
+			}
+		}
+
+		///Runs the micro-kernel over a packed mc x kc block of A
+		///and a packed kc x nc block of B
+		template <class T>
+		void
+		macro_kernel_ (std::size_t mc, std::size_t nc, std::size_t kc,
+					   T alpha, const T* ap, const T* bp, T beta,
+					   T* c, std::size_t rsc, std::size_t csc)
+		{
+			constexpr std::size_t mr = GemmKernel<T>::mr;
+			constexpr std::size_t nr = GemmKernel<T>::nr;
+			T ab[mr * nr];
+
+			for (std::size_t jr = 0; jr < nc; jr += nr)
+			{
+				std::size_t cols = std::min (nr, nc - jr);
+				for (std::size_t ir = 0; ir < mc; ir += mr)
+				{
+					std::size_t rows = std::min (mr, mc - ir);
+					GemmKernel<T>::run (kc, ap + ir * kc, bp + jr * kc, ab);
+
+					T* cij = c + ir * rsc + jr * csc;
+					for (std::size_t i = 0; i < rows; ++i)
+						for (std::size_t j = 0; j < cols; ++j)
+						{
+							T& dst = cij[i * rsc + j * csc];
+							if (beta == static_cast<T> (0))
+								dst = alpha * ab[i * nr + j];
+							else
+								dst = alpha * ab[i * nr + j] + beta * dst;
+						}
+				}
+			}
+		}
+
+		///Plain i-p-j loop, used when packing costs more than it saves
+		template <class T>
+		void
+		gemm_small_ (std::size_t m, std::size_t n, std::size_t k, T alpha,
+					 const T* a, std::size_t rsa, std::size_t csa,
+					 const T* b, std::size_t rsb, std::size_t csb,
+					 T beta, T* c, std::size_t rsc, std::size_t csc)
+		{
+			scale_ (m, n, beta, c, rsc, csc);
+			for (std::size_t i = 0; i < m; ++i)
+				for (std::size_t p = 0; p < k; ++p)
+				{
+					T aip = alpha * a[i * rsa + p * csa];
+					const T* bp = b + p * rsb;
+					T* ci = c + i * rsc;
+					for (std::size_t j = 0; j < n; ++j)
+						ci[j * csc] += aip * bp[j * csb];
+				}
+		}
+
+		///C <- alpha * A * B + beta * C
+		///A is m x k, B is k x n and C is m x n
+		///Element (i, j) of X is x[i * rsx + j * csx]
+		///C must not overlap A or B. When beta = 0, C is not read
+		template <class T>
+		void
+		gemm (std::size_t m, std::size_t n, std::size_t k, T alpha,
+			  const T* a, std::size_t rsa, std::size_t csa,
+			  const T* b, std::size_t rsb, std::size_t csb,
+			  T beta, T* c, std::size_t rsc, std::size_t csc)
+		{
+			constexpr std::size_t mr = GemmKernel<T>::mr;
+			constexpr std::size_t nr = GemmKernel<T>::nr;
+			constexpr std::size_t mc_block = GemmKernel<T>::mc;
+			constexpr std::size_t kc_block = GemmKernel<T>::kc;
+			constexpr std::size_t nc_block = GemmKernel<T>::nc;
+
+			if (!m || !n)
+				return;
+			if (!k || alpha == static_cast<T> (0))
+			{
+				scale_ (m, n, beta, c, rsc, csc);
+				return;
+			}
+			if (m * n * k <= OPL_GEMM_SMALL)
+			{
+				gemm_small_ (m, n, k, alpha, a, rsa, csa, b, rsb, csb,
+							 beta, c, rsc, csc);
+				return;
+			}
+
+			std::size_t mc_max = std::min (mc_block, (m + mr - 1) / mr * mr);
+			std::size_t nc_max = std::min (nc_block, (n + nr - 1) / nr * nr);
+			std::size_t kc_max = std::min (kc_block, k);
+			std::size_t mblocks = (m + mc_block - 1) / mc_block;
+			std::size_t chunks = std::min (parallel::chunks (m * n * k),
+										   mblocks);
+			//One packed block of A per thread
+			std::vector<T> abuf (chunks * mc_max * kc_max);
+			std::vector<T> bbuf (kc_max * nc_max);
+
+			for (std::size_t jc = 0; jc < n; jc += nc_block)
+			{
+				std::size_t nc = std::min (nc_block, n - jc);
+				std::size_t npanels = (nc + nr - 1) / nr;
+				for (std::size_t pc = 0; pc < k; pc += kc_block)
+				{
+					std::size_t kc = std::min (kc_block, k - pc);
+					T beta_pc = pc ? static_cast<T> (1) : beta;
+					const T* bpc = b + pc * rsb + jc * csb;
+
+					parallel::for_range (npanels, kc * nc, [&](std::size_t p0,
+																std::size_t p1) {
+							std::size_t j0 = p0 * nr;
+							std::size_t j1 = std::min (p1 * nr, nc);
+							pack_b_ (kc, j1 - j0, bpc + j0 * csb, rsb, csb,
+									 bbuf.data () + j0 * kc);
+						});
+
+					auto blocks = [&](std::size_t t) {
+						T* ap = abuf.data () + t * mc_max * kc_max;
+						std::size_t b0 = mblocks * t / chunks;
+						std::size_t b1 = mblocks * (t + 1) / chunks;
+						for (std::size_t ib = b0; ib < b1; ++ib)
+						{
+							std::size_t ic = ib * mc_block;
+							std::size_t mc = std::min (mc_block, m - ic);
+							pack_a_ (mc, kc, a + ic * rsa + pc * csa, rsa, csa,
+									 ap);
+							macro_kernel_ (mc, nc, kc, alpha, ap, bbuf.data (),
+										   beta_pc, c + ic * rsc + jc * csc,
+										   rsc, csc);
+						}
+					};
+
+					if (chunks > 1)
+						parallel::run (chunks, blocks);
+					else
+						blocks (0);
+				}
+			}
+		}
+
+		///C <- A * B, all operands contiguous and row-major
+		template <class T>
+		void
+		gemm (std::size_t m, std::size_t n, std::size_t k,
+			  const T* a, const T* b, T* c)
+		{
+			gemm (m, n, k, static_cast<T> (1), a, k, 1, b, n, 1,
+				  static_cast<T> (0), c, n, 1);
+		}
+
+		///Dot product of n elements of contiguous x and strided y
+		template <class T>
+		T
+		dot_ (std::size_t n, const T* x, const T* y, std::size_t incy)
+		{
+			T s0 = static_cast<T> (0);
+			T s1 = static_cast<T> (0);
+			T s2 = static_cast<T> (0);
+			T s3 = static_cast<T> (0);
+			std::size_t i = 0;
+
+			if (incy == 1)
+				for (; i + 4 <= n; i += 4)
+				{
+					s0 += x[i] * y[i];
+					s1 += x[i + 1] * y[i + 1];
+					s2 += x[i + 2] * y[i + 2];
+					s3 += x[i + 3] * y[i + 3];
+				}
+			for (; i < n; ++i)
+				s0 += x[i] * y[i * incy];
+			return (s0 + s1) + (s2 + s3);
+		}
+
+		///y <- alpha * A * x + beta * y
+		///A is m x n, x has n elements and y has m elements
+		///When beta = 0, y is not read
+		template <class T>
+		void
+		gemv (std::size_t m, std::size_t n, T alpha,
+			  const T* a, std::size_t rsa, std::size_t csa,
+			  const T* x, std::size_t incx,
+			  T beta, T* y, std::size_t incy)
+		{
+			parallel::for_range (m, m * n, [&](std::size_t i0, std::size_t i1) {
+					if (csa == 1)
+					{
+						for (std::size_t i = i0; i < i1; ++i)
+						{
+							T val = alpha * dot_ (n, a + i * rsa, x, incx);
+							T& yi = y[i * incy];
+							yi = beta == static_cast<T> (0)
+								? val : val + beta * yi;
+						}
+						return;
+					}
+
+					scale_ (i1 - i0, 1, beta, y + i0 * incy, incy, 0);
+					for (std::size_t j = 0; j < n; ++j)
+					{
+						T xj = alpha * x[j * incx];
+						const T* aj = a + j * csa;
+						for (std::size_t i = i0; i < i1; ++i)
+							y[i * incy] += xj * aj[i * rsa];
+					}
+				});
+		}
+
+	}
+
+}
+
+#endif //!GEMM_HH_
@@ -0,0 +1,95 @@
+#include "io-worker.hh"
+
+namespace opl
+{
+
+	IoWorker::IoWorker ()
+		: queued_ (0)
+		, completed_ (0)
+		, stop_ (false)
+	{
+		worker_ = std::thread (&IoWorker::worker_loop_, this);
+	}
+
+	IoWorker::~IoWorker ()
+	{
+		{
+			std::lock_guard<std::mutex> lock (mutex_);
+			stop_ = true;
+		}
+		wake_.notify_all ();
+		worker_.join ();
+	}
+
+	IoWorker::ticket_type
+	IoWorker::read (const BlockFile& file, std::size_t offset, void* data,
+					std::size_t n)
+	{
+		ticket_type t;
+		{
+			std::lock_guard<std::mutex> lock (mutex_);
+			t = ++queued_;
+			jobs_.push_back (Job {t, &file, offset, data, n});
+		}
+		wake_.notify_one ();
+		return t;
+	}
+
+	void
+	IoWorker::wait (ticket_type t)
+	{
+		std::unique_lock<std::mutex> lock (mutex_);
+		done_.wait (lock, [&] { return completed_ >= t; });
+
+		auto it = errors_.find (t);
+		if (it == errors_.end ())
+			return;
+		std::exception_ptr error = it->second;
+		errors_.erase (it);
+		lock.unlock ();
+		std::rethrow_exception (error);
+	}
+
+	IoWorker&
+	IoWorker::shared ()
+	{
+		static IoWorker worker;
+		return worker;
+	}
+
+	void
+	IoWorker::worker_loop_ ()
+	{
+		std::unique_lock<std::mutex> lock (mutex_);
+
+		while (true)
+		{
+			//Queued reads are still run when stopping, their buffers may
+			//be waited for
+			wake_.wait (lock, [this] { return stop_ || !jobs_.empty (); });
+			if (jobs_.empty ())
+				return;
+
+			Job job = jobs_.front ();
+			jobs_.pop_front ();
+			lock.unlock ();
+
+			std::exception_ptr error;
+			try
+			{
+				job.file->read (job.offset, job.data, job.n);
+			}
+			catch (...)
+			{
+				error = std::current_exception ();
+			}
+
+			lock.lock ();
+			if (error)
+				errors_.emplace (job.t, error);
+			completed_ = job.t;
+			done_.notify_all ();
+		}
+	}
+
+}
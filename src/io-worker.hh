@@ -0,0 +1,78 @@
+/** @file IoWorker class definition
+ */
+
+#ifndef IO_WORKER_HH_
+#define IO_WORKER_HH_
+
+# include <condition_variable>
+# include <cstddef>
+# include <cstdint>
+# include <deque>
+# include <exception>
+# include <mutex>
+# include <thread>
+# include <unordered_map>
+# include "block-file.hh"
+
+namespace opl
+{
+
+	/// One persistent thread running BlockFile reads in the background
+	/// Reads are run in the order they are queued
+	class IoWorker
+	{
+
+	public:
+		///Identifies a queued read, 0 is never used
+		using ticket_type = std::uint64_t;
+
+		IoWorker ();
+		~IoWorker ();
+
+		IoWorker (const IoWorker&) = delete;
+		IoWorker& operator= (const IoWorker&) = delete;
+
+		///Queues file.read (offset, data, n)
+		///file and data must stay valid until wait () returns
+		ticket_type
+		read (const BlockFile& file, std::size_t offset, void* data,
+			  std::size_t n);
+
+		///Waits for the read t, every read must be waited for once
+		///Throws the std::runtime_error of the read if it failed
+		void
+		wait (ticket_type t);
+
+		///Worker shared by the whole program, started on the first call
+		static IoWorker&
+		shared ();
+
+	private:
+		struct Job
+		{
+			ticket_type t;
+			const BlockFile* file;
+			std::size_t offset;
+			void* data;
+			std::size_t n;
+		};
+
+		void
+		worker_loop_ ();
+
+		std::thread worker_;
+		std::mutex mutex_;
+		std::condition_variable wake_;
+		std::condition_variable done_;
+		std::deque<Job> jobs_;
+		///Errors of the reads not waited for yet
+		std::unordered_map<ticket_type, std::exception_ptr> errors_;
+		ticket_type queued_;
+		ticket_type completed_;
+		bool stop_;
+
+	};
+
+}
+
+#endif //!IO_WORKER_HH_
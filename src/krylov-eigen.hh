@@ -0,0 +1,663 @@
+/** @file Krylov eigensolvers
+ *
+ * A few eigenpairs of a large n x n operator A: a dense Matrix, a
+ * SparseMatrix, or a functor op (x, y) computing y <- Ax, as for the Krylov
+ * solvers.
+ * An m-step Arnoldi factorization A V = V H + f e_m^T is built with full
+ * reorthogonalization: classical Gram-Schmidt, done again when cancellation
+ * is detected (DGKS). When A is symmetric, H is tridiagonal and this is a
+ * Lanczos factorization.
+ * The eigenvalues of H (Ritz values) approximate those of A. Once the basis
+ * is full, the unwanted ones are the shifts of implicit QR steps on H, which
+ * compress the factorization to the wanted part without any product by A
+ * (implicit restart with exact shifts, Sorensen; Lehoucq, Sorensen).
+ * m stays small: the dense problems on H cost little next to the products.
+ * Every work array is allocated before the first iteration, so iterations
+ * themselves never allocate.
+ * A Ritz pair (lambda, x) is converged once ||Ax - lambda x||, known from the
+ * factorization without a product, is below tolerance |lambda|.
+ */
+
+#ifndef KRYLOV_EIGEN_HH_
+# define KRYLOV_EIGEN_HH_
+
+# include <algorithm>
+# include <cassert>
+# include <cmath>
+# include <complex>
+# include <cstddef>
+# include <limits>
+# include <random>
+# include <vector>
+# include "eigen.hh"
+# include "gemm.hh"
+# include "krylov.hh"
+# include "parallel.hh"
+# include "simd-reduce.hh"
+# include "vector.hh"
+
+///Minimum size of the Krylov basis of the eigensolvers
+# define OPL_KRYLOV_EIGEN_BASIS 20
+
+namespace opl
+{
+
+	///Eigenvalues looked for by the Krylov eigensolvers
+	enum class EigenTarget
+	{
+		///Largest modulus
+		largest_magnitude,
+		///Largest real part
+		largest,
+		///Smallest real part
+		smallest
+	};
+
+	template <class T>
+	struct KrylovEigenOptions
+	{
+		EigenTarget target = EigenTarget::largest_magnitude;
+		///Relative residual ||Ax - lambda x|| / |lambda| to reach
+		T tolerance = static_cast<T> (1e-10);
+		std::size_t max_restarts = 300;
+		///Krylov basis size, 0 for max(2k + 1, OPL_KRYLOV_EIGEN_BASIS)
+		///At least k + 3, at most n
+		std::size_t basis = 0;
+		///Seed of the random start vector
+		unsigned long seed = 5489;
+	};
+
+	template <class T>
+	struct KrylovEigenResult
+	{
+		bool converged = false;
+		std::size_t restarts = 0;
+		///Products by A
+		std::size_t products = 0;
+		///Number of converged eigenpairs among the returned ones
+		std::size_t converged_values = 0;
+	};
+
+	///k eigenpairs of the symmetric n x n A, by implicitly restarted Lanczos
+	///vals gets them in the target order (decreasing for largest),
+	///vects[i] the unit eigenvector of vals[i]
+	template <class Op, class T>
+	KrylovEigenResult<T>
+	lanczos_eigen (const Op& a, std::size_t n, std::size_t k, Vector<T>& vals,
+				   std::vector<Vector<T>>& vects,
+				   const KrylovEigenOptions<T>& options
+				   = KrylovEigenOptions<T> ());
+
+	template <class Op, class T>
+	KrylovEigenResult<T>
+	lanczos_eigen (const Op& a, std::size_t n, std::size_t k, Vector<T>& vals,
+				   const KrylovEigenOptions<T>& options
+				   = KrylovEigenOptions<T> ());
+
+	///k eigenpairs of the n x n A, by implicitly restarted Arnoldi
+	///Eigenvalue i is re[i] + i im[i], in the target order
+	///A complex conjugate pair is never split: its positive imaginary part
+	///comes first, and k + 1 values are returned if the k-th one starts a pair
+	///vects[i] is the unit eigenvector of a real eigenvalue, for a pair
+	///vects[i] + i vects[i + 1] is the unit eigenvector of re[i] + i im[i]
+	template <class Op, class T>
+	KrylovEigenResult<T>
+	arnoldi_eigen (const Op& a, std::size_t n, std::size_t k, Vector<T>& re,
+				   Vector<T>& im, std::vector<Vector<T>>& vects,
+				   const KrylovEigenOptions<T>& options
+				   = KrylovEigenOptions<T> ());
+
+	template <class Op, class T>
+	KrylovEigenResult<T>
+	arnoldi_eigen (const Op& a, std::size_t n, std::size_t k, Vector<T>& re,
+				   Vector<T>& im,
+				   const KrylovEigenOptions<T>& options
+				   = KrylovEigenOptions<T> ());
+
+
+	namespace krylov_eigen_
+	{
+
+		///Implicitly restarted Arnoldi, or Lanczos if A is symmetric
+		template <class T>
+		class Solver
+		{
+
+		public:
+			Solver (std::size_t n, std::size_t k, bool symmetric,
+					const KrylovEigenOptions<T>& options);
+
+			template <class Op>
+			KrylovEigenResult<T>
+			run (const Op& a);
+
+			///Wanted eigenpairs, vects may be null
+			void
+			extract (Vector<T>& re, Vector<T>& im,
+					 std::vector<Vector<T>>* vects);
+
+		private:
+			///Row j of V <- random unit vector orthogonal to the previous rows
+			void
+			random_ (std::size_t j);
+
+			///w <- w minus its projection on the rows 0 to j of V, c gets the
+			///coefficients
+			///Returns the norm of w, 0 if it was in the span of the rows
+			T
+			orthogonalize_ (std::size_t j, T* w, T* c);
+
+			///Arnoldi steps from j0 until the basis is full
+			template <class Op>
+			void
+			extend_ (const Op& a, std::size_t j0);
+
+			///Ritz values, sorted units, number of wanted values, and how many
+			///of them converged
+			void
+			ritz_ ();
+
+			///Eigenvector of H (xr + i xi) for the unit starting at i
+			void
+			ritz_vector_ (std::size_t i);
+
+			///Applies the unwanted shifts and compresses the factorization
+			///Returns the new factorization size, 0 if it can't be restarted
+			std::size_t
+			restart_ ();
+
+			T
+			key_ (std::size_t i) const;
+
+			std::size_t
+			unit_size_ (std::size_t i) const
+			{
+				return wi_[i] == static_cast<T> (0) ? 1 : 2;
+			}
+
+			std::size_t n_;
+			std::size_t k_;
+			std::size_t m_;
+			bool symmetric_;
+			KrylovEigenOptions<T> options_;
+			KrylovEigenResult<T> res_;
+			std::mt19937 gen_;
+
+			///Rows 0 to m - 1: basis, row m: f / ||f||
+			std::vector<T> v_;
+			std::vector<T> work_;
+			///m x m Hessenberg, f = beta_ v_m
+			std::vector<T> h_;
+			T beta_;
+			std::vector<T> hc_;
+			std::vector<T> z_;
+			std::vector<T> q_;
+			Vector<T> x_;
+			Vector<T> y_;
+			std::vector<T> c_;
+			std::vector<T> c2_;
+			std::vector<T> wr_;
+			std::vector<T> wi_;
+			std::vector<T> e_;
+			std::vector<T> yr_;
+			std::vector<T> yi_;
+			std::vector<std::complex<T>> yc_;
+			std::vector<T> xr_;
+			std::vector<T> xi_;
+			///First value of each unit (a real value or a pair), best first
+			std::vector<std::size_t> units_;
+			std::size_t nunits_;
+			std::size_t nwant_;
+			std::size_t nconv_;
+		};
+
+		template <class T>
+		Solver<T>::Solver (std::size_t n, std::size_t k, bool symmetric,
+						   const KrylovEigenOptions<T>& options)
+			: n_ (n)
+			, k_ (k)
+			, symmetric_ (symmetric)
+			, options_ (options)
+			, gen_ (options.seed)
+			, beta_ (0)
+			, x_ (n)
+			, y_ (n)
+			, nunits_ (0)
+			, nwant_ (0)
+			, nconv_ (0)
+		{
+			assert (k > 0 && k <= n);
+			std::size_t m = options.basis ? options.basis
+				: std::max (2 * k + 1, std::size_t (OPL_KRYLOV_EIGEN_BASIS));
+			m_ = std::min (std::max (m, k + 3), n);
+
+			v_.resize ((m_ + 1) * n, static_cast<T> (0));
+			work_.resize (m_ * n);
+			h_.resize (m_ * m_, static_cast<T> (0));
+			hc_.resize (m_ * m_);
+			z_.resize (m_ * m_);
+			q_.resize (m_ * m_);
+			c_.resize (m_);
+			c2_.resize (m_);
+			wr_.resize (m_);
+			wi_.resize (m_);
+			e_.resize (m_);
+			yr_.resize (m_);
+			yi_.resize (m_);
+			yc_.resize (m_);
+			xr_.resize (m_);
+			xi_.resize (m_);
+			units_.resize (m_);
+		}
+
+		template <class T>
+		template <class Op>
+		KrylovEigenResult<T>
+		Solver<T>::run (const Op& a)
+		{
+			random_ (0);
+			extend_ (a, 0);
+
+			while (true)
+			{
+				ritz_ ();
+				res_.converged_values = nconv_;
+				res_.converged = nconv_ == nwant_;
+				if (res_.converged || res_.restarts == options_.max_restarts)
+					break;
+
+				std::size_t kept = restart_ ();
+				if (!kept)
+					break;
+				++res_.restarts;
+				extend_ (a, kept);
+			}
+
+			return res_;
+		}
+
+		template <class T>
+		void
+		Solver<T>::extract (Vector<T>& re, Vector<T>& im,
+							std::vector<Vector<T>>* vects)
+		{
+			re = Vector<T> (nwant_);
+			im = Vector<T> (nwant_);
+			if (vects)
+				vects->resize (nwant_);
+
+			std::size_t one = 1;
+			std::size_t j = 0;
+			for (std::size_t u = 0; j < nwant_; ++u)
+			{
+				std::size_t i = units_[u];
+				std::size_t len = unit_size_ (i);
+				for (std::size_t l = 0; l < len; ++l)
+				{
+					re[j + l] = wr_[i + l];
+					im[j + l] = wi_[i + l];
+				}
+
+				if (vects)
+				{
+					//x = V (xr + i xi)
+					ritz_vector_ (i);
+					for (std::size_t l = 0; l < len; ++l)
+					{
+						Vector<T>& x = (*vects)[j + l];
+						x = Vector<T> (n_);
+						linalg::gemv (n_, m_, static_cast<T> (1), v_.data (), one, n_,
+									  l ? xi_.data () : xr_.data (), one,
+									  static_cast<T> (0), x.data (), one);
+					}
+					T norm = (*vects)[j].norm ();
+					if (len == 2)
+						norm = std::hypot (norm, (*vects)[j + 1].norm ());
+					for (std::size_t l = 0; l < len && norm > 0; ++l)
+						(*vects)[j + l] *= 1 / norm;
+				}
+				j += len;
+			}
+		}
+
+		template <class T>
+		void
+		Solver<T>::random_ (std::size_t j)
+		{
+			std::uniform_real_distribution<double> uniform (-1, 1);
+			T* w = v_.data () + j * n_;
+			T norm = 0;
+			while (norm == static_cast<T> (0))
+			{
+				for (std::size_t i = 0; i < n_; ++i)
+					w[i] = static_cast<T> (uniform (gen_));
+				norm = j ? orthogonalize_ (j - 1, w, c2_.data ())
+					: std::sqrt (simd::norm_square (w, n_));
+			}
+			for (std::size_t i = 0; i < n_; ++i)
+				w[i] /= norm;
+		}
+
+		template <class T>
+		T
+		Solver<T>::orthogonalize_ (std::size_t j, T* w, T* c)
+		{
+			//A second pass is only needed when the first one removed most of w
+			const T ratio = static_cast<T> (0.717);
+			std::size_t one = 1;
+			std::size_t len = j + 1;
+			T norm = std::sqrt (simd::norm_square (w, n_));
+			std::fill_n (c, len, static_cast<T> (0));
+
+			for (int pass = 0; pass < 2; ++pass)
+			{
+				linalg::gemv (len, n_, static_cast<T> (1), v_.data (), n_, one,
+							  w, one, static_cast<T> (0), c2_.data (), one);
+				linalg::gemv (n_, len, static_cast<T> (-1), v_.data (), one, n_,
+							  c2_.data (), one, static_cast<T> (1), w, one);
+				for (std::size_t i = 0; i < len; ++i)
+					c[i] += c2_[i];
+
+				T next = std::sqrt (simd::norm_square (w, n_));
+				if (next > ratio * norm)
+					return next;
+				norm = next;
+			}
+			return 0;
+		}
+
+		template <class T>
+		template <class Op>
+		void
+		Solver<T>::extend_ (const Op& a, std::size_t j0)
+		{
+			for (std::size_t j = j0; j < m_; ++j)
+			{
+				T* vj = v_.data () + j * n_;
+				std::copy_n (vj, n_, x_.data ());
+				apply_operator (a, x_, y_);
+				++res_.products;
+
+				T beta = orthogonalize_ (j, y_.data (), c_.data ());
+				for (std::size_t i = 0; i <= j; ++i)
+					h_[i * m_ + j] = c_[i];
+				if (symmetric_)
+				{
+					//Other values are rounding errors
+					for (std::size_t i = 0; i + 1 < j; ++i)
+						h_[i * m_ + j] = 0;
+					if (j)
+						h_[(j - 1) * m_ + j] = h_[j * m_ + j - 1];
+				}
+
+				T* next = vj + n_;
+				if (j + 1 == m_)
+					beta_ = beta;
+				else if (beta == static_cast<T> (0))
+				{
+					//Invariant subspace, the factorization goes on from a new
+					//direction
+					random_ (j + 1);
+					h_[(j + 1) * m_ + j] = 0;
+					continue;
+				}
+				else
+					h_[(j + 1) * m_ + j] = beta;
+
+				for (std::size_t i = 0; i < n_; ++i)
+					next[i] = beta == static_cast<T> (0) ? static_cast<T> (0)
+						: y_[i] / beta;
+			}
+		}
+
+		template <class T>
+		void
+		Solver<T>::ritz_ ()
+		{
+			std::size_t m = m_;
+			for (std::size_t i = 0; i < m; ++i)
+				for (std::size_t j = 0; j < m; ++j)
+					z_[i * m + j] = i == j ? static_cast<T> (1) : static_cast<T> (0);
+
+			if (symmetric_)
+			{
+				//Row i of z_ is the eigenvector of wr_[i]
+				for (std::size_t i = 0; i < m; ++i)
+				{
+					wr_[i] = h_[i * m + i];
+					wi_[i] = 0;
+					if (i + 1 < m)
+						e_[i] = h_[(i + 1) * m + i];
+				}
+				bool ok = linalg::tridiagonal_qr (m, wr_.data (), e_.data (),
+												  z_.data (), m);
+				assert (ok);
+				(void) ok;
+			}
+			else
+			{
+				//H = Z T Z^T, T in hc_
+				std::copy (h_.begin (), h_.end (), hc_.begin ());
+				bool ok = linalg::hessenberg_qr (m, hc_.data (), m, z_.data (), m,
+												 wr_.data (), wi_.data ());
+				assert (ok);
+				(void) ok;
+			}
+
+			nunits_ = 0;
+			for (std::size_t i = 0; i < m; i += unit_size_ (i))
+				units_[nunits_++] = i;
+			std::sort (units_.begin (), units_.begin () + nunits_,
+					   [this](std::size_t i, std::size_t j) {
+						   T ki = key_ (i);
+						   T kj = key_ (j);
+						   return ki > kj || (ki == kj && i < j);
+					   });
+
+			//||A V y - lambda V y|| = beta |e_m^T y| for H y = lambda y
+			const T eps23 = std::pow (std::numeric_limits<T>::epsilon (),
+									  static_cast<T> (2) / 3);
+			nwant_ = 0;
+			nconv_ = 0;
+			for (std::size_t u = 0; nwant_ < k_; ++u)
+			{
+				std::size_t i = units_[u];
+				ritz_vector_ (i);
+				T norm = std::sqrt (simd::norm_square (xr_.data (), m)
+									+ simd::norm_square (xi_.data (), m));
+				T resid = beta_ * std::hypot (xr_[m - 1], xi_[m - 1]) / norm;
+				T lambda = std::hypot (wr_[i], wi_[i]);
+				std::size_t len = unit_size_ (i);
+				if (resid <= options_.tolerance * std::max (lambda, eps23))
+					nconv_ += len;
+				nwant_ += len;
+			}
+		}
+
+		template <class T>
+		void
+		Solver<T>::ritz_vector_ (std::size_t i)
+		{
+			std::size_t m = m_;
+			std::size_t one = 1;
+			std::fill (xi_.begin (), xi_.end (), static_cast<T> (0));
+			if (symmetric_)
+			{
+				std::copy_n (z_.data () + i * m, m, xr_.data ());
+				return;
+			}
+
+			//y eigenvector of T, x = Z y
+			if (wi_[i] == static_cast<T> (0))
+			{
+				linalg::schur_eigenvector (m, hc_.data (), m, i, yr_.data ());
+				linalg::gemv (m, i + 1, static_cast<T> (1), z_.data (), m, one,
+							  yr_.data (), one, static_cast<T> (0), xr_.data (), one);
+				return;
+			}
+
+			linalg::schur_complex_eigenvector (m, hc_.data (), m, i, yc_.data ());
+			for (std::size_t j = 0; j < m; ++j)
+			{
+				yr_[j] = yc_[j].real ();
+				yi_[j] = yc_[j].imag ();
+			}
+			linalg::gemv (m, i + 2, static_cast<T> (1), z_.data (), m, one,
+						  yr_.data (), one, static_cast<T> (0), xr_.data (), one);
+			linalg::gemv (m, i + 2, static_cast<T> (1), z_.data (), m, one,
+						  yi_.data (), one, static_cast<T> (0), xi_.data (), one);
+		}
+
+		template <class T>
+		std::size_t
+		Solver<T>::restart_ ()
+		{
+			std::size_t m = m_;
+
+			//Keeping some converged unwanted values speeds up convergence
+			std::size_t target = nwant_ + std::min (nconv_, (m - nwant_) / 2);
+			std::size_t kept = 0;
+			std::size_t u = 0;
+			for (; u < nunits_ && kept < target; ++u)
+			{
+				std::size_t len = unit_size_ (units_[u]);
+				if (kept + len >= m)
+					break;
+				kept += len;
+			}
+			if (kept < nwant_)
+				return 0;
+
+			//H <- Q^T H Q, with Q e_m^T having zeros in the first kept values
+			for (std::size_t i = 0; i < m; ++i)
+				for (std::size_t j = 0; j < m; ++j)
+					q_[i * m + j] = i == j ? static_cast<T> (1) : static_cast<T> (0);
+			for (; u < nunits_; ++u)
+			{
+				std::size_t i = units_[u];
+				linalg::hessenberg_shift_step (m, h_.data (), m, wr_[i], wi_[i],
+											   q_.data (), m);
+			}
+
+			//V <- V Q, f <- V q_kept h[kept, kept - 1] + f Q[m - 1, kept - 1]
+			//By blocks of columns, gemm would allocate its packing buffers
+			parallel::for_range (n_, (kept + 1) * m * n_,
+								 [&](std::size_t c0, std::size_t c1) {
+					constexpr std::size_t block = 256;
+					for (std::size_t b0 = c0; b0 < c1; b0 += block)
+					{
+						std::size_t len = std::min (block, c1 - b0);
+						for (std::size_t i = 0; i <= kept; ++i)
+						{
+							T* wi = work_.data () + i * n_ + b0;
+							std::fill_n (wi, len, static_cast<T> (0));
+							for (std::size_t j = 0; j < m; ++j)
+								simd::axpy (len, q_[j * m + i], v_.data () + j * n_ + b0,
+											wi);
+						}
+					}
+				});
+			T hk = h_[kept * m + kept - 1];
+			T fq = beta_ * q_[(m - 1) * m + kept - 1];
+			const T* vk = work_.data () + kept * n_;
+			const T* vm = v_.data () + m * n_;
+			for (std::size_t i = 0; i < n_; ++i)
+				y_[i] = hk * vk[i] + fq * vm[i];
+			std::copy_n (work_.data (), kept * n_, v_.data ());
+
+			for (std::size_t i = 0; i < m; ++i)
+				for (std::size_t j = 0; j < m; ++j)
+					if (j >= kept || i > j + 1)
+						h_[i * m + j] = 0;
+			if (symmetric_)
+				for (std::size_t i = 0; i + 1 < kept; ++i)
+				{
+					h_[i * m + i + 1] = h_[(i + 1) * m + i];
+					for (std::size_t j = i + 2; j < kept; ++j)
+						h_[i * m + j] = 0;
+				}
+
+			T beta = orthogonalize_ (kept - 1, y_.data (), c_.data ());
+			if (beta == static_cast<T> (0))
+			{
+				random_ (kept);
+				h_[kept * m + kept - 1] = 0;
+			}
+			else
+			{
+				T* next = v_.data () + kept * n_;
+				for (std::size_t i = 0; i < n_; ++i)
+					next[i] = y_[i] / beta;
+				h_[kept * m + kept - 1] = beta;
+			}
+			return kept;
+		}
+
+		template <class T>
+		T
+		Solver<T>::key_ (std::size_t i) const
+		{
+			switch (options_.target)
+			{
+			case EigenTarget::largest:
+				return wr_[i];
+			case EigenTarget::smallest:
+				return -wr_[i];
+			default:
+				return std::hypot (wr_[i], wi_[i]);
+			}
+		}
+
+	}
+
+	template <class Op, class T>
+	KrylovEigenResult<T>
+	lanczos_eigen (const Op& a, std::size_t n, std::size_t k, Vector<T>& vals,
+				   std::vector<Vector<T>>& vects,
+				   const KrylovEigenOptions<T>& options)
+	{
+		krylov_eigen_::Solver<T> solver (n, k, true, options);
+		KrylovEigenResult<T> res = solver.run (a);
+		Vector<T> im;
+		solver.extract (vals, im, &vects);
+		return res;
+	}
+
+	template <class Op, class T>
+	KrylovEigenResult<T>
+	lanczos_eigen (const Op& a, std::size_t n, std::size_t k, Vector<T>& vals,
+				   const KrylovEigenOptions<T>& options)
+	{
+		krylov_eigen_::Solver<T> solver (n, k, true, options);
+		KrylovEigenResult<T> res = solver.run (a);
+		Vector<T> im;
+		solver.extract (vals, im, nullptr);
+		return res;
+	}
+
+	template <class Op, class T>
+	KrylovEigenResult<T>
+	arnoldi_eigen (const Op& a, std::size_t n, std::size_t k, Vector<T>& re,
+				   Vector<T>& im, std::vector<Vector<T>>& vects,
+				   const KrylovEigenOptions<T>& options)
+	{
+		krylov_eigen_::Solver<T> solver (n, k, false, options);
+		KrylovEigenResult<T> res = solver.run (a);
+		solver.extract (re, im, &vects);
+		return res;
+	}
+
+	template <class Op, class T>
+	KrylovEigenResult<T>
+	arnoldi_eigen (const Op& a, std::size_t n, std::size_t k, Vector<T>& re,
+				   Vector<T>& im, const KrylovEigenOptions<T>& options)
+	{
+		krylov_eigen_::Solver<T> solver (n, k, false, options);
+		KrylovEigenResult<T> res = solver.run (a);
+		solver.extract (re, im, nullptr);
+		return res;
+	}
+
+}
+
+#endif //!KRYLOV_EIGEN_HH_
@@ -0,0 +1,405 @@
+/** @file Krylov iterative solvers
+ *
+ * Solve Ax = b for any linear operator A: a dense Matrix, a SparseMatrix,
+ * or a functor op (x, y) computing y <- Ax.
+ * x holds the initial guess and gets the solution.
+ * Every work vector is allocated before the first iteration, so iterations
+ * themselves never allocate.
+ * Iterations stop once ||b - Ax|| <= tolerance ||b||.
+ */
+
+#ifndef KRYLOV_HH_
+# define KRYLOV_HH_
+
+# include <cassert>
+# include <cmath>
+# include <cstddef>
+# include <vector>
+# include "gemm.hh"
+# include "matrix.hh"
+# include "preconditioner.hh"
+# include "sparse-matrix.hh"
+# include "vector.hh"
+
+namespace opl
+{
+
+	template <class T>
+	struct KrylovOptions
+	{
+		///Relative residual to reach
+		T tolerance = static_cast<T> (1e-10);
+		std::size_t max_iterations = 1000;
+		///Krylov space size of GMRES before a restart
+		std::size_t restart = 30;
+		///Keeps the relative residual of each iteration
+		bool history = false;
+	};
+
+	template <class T>
+	struct KrylovResult
+	{
+		bool converged = false;
+		std::size_t iterations = 0;
+		///Last relative residual
+		T residual = 0;
+		///Relative residual before the first iteration, then after each one
+		std::vector<T> history;
+	};
+
+	///y <- Ax
+	template <class T>
+	void
+	apply_operator (const Matrix<T>& a, const Vector<T>& x, Vector<T>& y)
+	{
+		assert (a.cols () == x.size ());
+		y.resize (a.rows ());
+		linalg::gemv (a.rows (), a.cols (), static_cast<T> (1),
+					  a.data (), a.cols (), std::size_t (1),
+					  x.data (), std::size_t (1),
+					  static_cast<T> (0), y.data (), std::size_t (1));
+	}
+
+	template <class T>
+	void
+	apply_operator (const SparseMatrix<T>& a, const Vector<T>& x,
+					Vector<T>& y)
+	{
+		a.apply (x, y);
+	}
+
+	template <class Op, class T>
+	void
+	apply_operator (const Op& a, const Vector<T>& x, Vector<T>& y)
+	{
+		a (x, y);
+	}
+
+	///Conjugate gradient with preconditioner m, A and M SPD
+	template <class Op, class T, class Prec>
+	KrylovResult<T>
+	pcg_solve (const Op& a, const Vector<T>& b, Vector<T>& x, const Prec& m,
+			   const KrylovOptions<T>& options = KrylovOptions<T> ());
+
+	///Conjugate gradient, A SPD
+	template <class Op, class T>
+	KrylovResult<T>
+	cg_solve (const Op& a, const Vector<T>& b, Vector<T>& x,
+			  const KrylovOptions<T>& options = KrylovOptions<T> ());
+
+	///Restarted GMRES, right preconditioned by m
+	template <class Op, class T, class Prec>
+	KrylovResult<T>
+	gmres_solve (const Op& a, const Vector<T>& b, Vector<T>& x, const Prec& m,
+				 const KrylovOptions<T>& options = KrylovOptions<T> ());
+
+	template <class Op, class T>
+	KrylovResult<T>
+	gmres_solve (const Op& a, const Vector<T>& b, Vector<T>& x,
+				 const KrylovOptions<T>& options = KrylovOptions<T> ());
+
+	///BiCGSTAB, right preconditioned by m
+	template <class Op, class T, class Prec>
+	KrylovResult<T>
+	bicgstab_solve (const Op& a, const Vector<T>& b, Vector<T>& x,
+					const Prec& m,
+					const KrylovOptions<T>& options = KrylovOptions<T> ());
+
+	template <class Op, class T>
+	KrylovResult<T>
+	bicgstab_solve (const Op& a, const Vector<T>& b, Vector<T>& x,
+					const KrylovOptions<T>& options = KrylovOptions<T> ());
+
+
+	namespace krylov_
+	{
+
+		///Starts a solve: x is resized to b, residual history is reserved
+		///Returns false if b is null, x is then the solution
+		template <class T>
+		bool
+		start (const Vector<T>& b, Vector<T>& x, const KrylovOptions<T>& options,
+			   KrylovResult<T>& res, T& bnorm)
+		{
+			if (x.size () != b.size ())
+				x = Vector<T> (b.size (), static_cast<T> (0));
+			if (options.history)
+				res.history.reserve (options.max_iterations + 1);
+
+			bnorm = b.norm ();
+			if (bnorm == static_cast<T> (0))
+			{
+				x.assign (static_cast<T> (0));
+				res.converged = true;
+				if (options.history)
+					res.history.push_back (0);
+				return false;
+			}
+			return true;
+		}
+
+		///Records the residual norm rnorm, returns true once converged
+		template <class T>
+		bool
+		record (T rnorm, T bnorm, const KrylovOptions<T>& options,
+				KrylovResult<T>& res)
+		{
+			res.residual = rnorm / bnorm;
+			if (options.history)
+				res.history.push_back (res.residual);
+			res.converged = res.residual <= options.tolerance;
+			return res.converged;
+		}
+
+	}
+
+	template <class Op, class T, class Prec>
+	KrylovResult<T>
+	pcg_solve (const Op& a, const Vector<T>& b, Vector<T>& x, const Prec& m,
+			   const KrylovOptions<T>& options)
+	{
+		KrylovResult<T> res;
+		T bnorm;
+		if (!krylov_::start (b, x, options, res, bnorm))
+			return res;
+
+		std::size_t n = b.size ();
+		Vector<T> r (n);
+		Vector<T> z (n);
+		Vector<T> p (n);
+		Vector<T> q (n);
+
+		apply_operator (a, x, q);
+		r = b - q;
+		if (krylov_::record (r.norm (), bnorm, options, res))
+			return res;
+
+		m.apply (r, z);
+		p.assign (z);
+		T rz = r.dot_product (z);
+
+		while (res.iterations < options.max_iterations)
+		{
+			++res.iterations;
+			apply_operator (a, p, q);
+			T pq = p.dot_product (q);
+			if (pq == static_cast<T> (0))
+				break;
+
+			T alpha = rz / pq;
+			x += alpha * p;
+			r -= alpha * q;
+			if (krylov_::record (r.norm (), bnorm, options, res))
+				break;
+
+			m.apply (r, z);
+			T rz_next = r.dot_product (z);
+			T beta = rz_next / rz;
+			rz = rz_next;
+			p = z + beta * p;
+		}
+
+		return res;
+	}
+
+	template <class Op, class T>
+	KrylovResult<T>
+	cg_solve (const Op& a, const Vector<T>& b, Vector<T>& x,
+			  const KrylovOptions<T>& options)
+	{
+		return pcg_solve (a, b, x, IdentityPreconditioner<T> (), options);
+	}
+
+	template <class Op, class T, class Prec>
+	KrylovResult<T>
+	gmres_solve (const Op& a, const Vector<T>& b, Vector<T>& x, const Prec& m,
+				 const KrylovOptions<T>& options)
+	{
+		KrylovResult<T> res;
+		T bnorm;
+		if (!krylov_::start (b, x, options, res, bnorm))
+			return res;
+
+		std::size_t n = b.size ();
+		std::size_t k = std::max (std::min (options.restart, n), std::size_t (1));
+		std::vector<Vector<T>> v (k + 1, Vector<T> (n));
+		Matrix<T> h (k + 1, k, static_cast<T> (0));
+		Vector<T> g (k + 1);
+		Vector<T> cs (k);
+		Vector<T> sn (k);
+		Vector<T> y (k);
+		Vector<T> w (n);
+		Vector<T> z (n);
+
+		apply_operator (a, x, w);
+		v[0] = b - w;
+		T beta = v[0].norm ();
+		if (krylov_::record (beta, bnorm, options, res))
+			return res;
+
+		while (res.iterations < options.max_iterations)
+		{
+			v[0] *= 1 / beta;
+			g.assign (static_cast<T> (0));
+			g[0] = beta;
+
+			//Arnoldi with modified Gram-Schmidt, H kept upper triangular
+			//by Givens rotations so that |g[j + 1]| is the residual norm
+			std::size_t j = 0;
+			while (j < k && res.iterations < options.max_iterations)
+			{
+				++res.iterations;
+				m.apply (v[j], z);
+				apply_operator (a, z, w);
+				for (std::size_t i = 0; i <= j; ++i)
+				{
+					T hij = w.dot_product (v[i]);
+					h.at (i, j) = hij;
+					w -= hij * v[i];
+				}
+				T hnext = w.norm ();
+				h.at (j + 1, j) = hnext;
+				if (hnext != static_cast<T> (0))
+					v[j + 1] = w * (1 / hnext);
+
+				for (std::size_t i = 0; i < j; ++i)
+				{
+					T hi = h.at (i, j);
+					T hi1 = h.at (i + 1, j);
+					h.at (i, j) = cs[i] * hi + sn[i] * hi1;
+					h.at (i + 1, j) = cs[i] * hi1 - sn[i] * hi;
+				}
+				T hjj = h.at (j, j);
+				T r = std::sqrt (hjj * hjj + hnext * hnext);
+				cs[j] = r == static_cast<T> (0) ? static_cast<T> (1) : hjj / r;
+				sn[j] = r == static_cast<T> (0) ? static_cast<T> (0) : hnext / r;
+				h.at (j, j) = r;
+				h.at (j + 1, j) = 0;
+				g[j + 1] = -sn[j] * g[j];
+				g[j] = cs[j] * g[j];
+
+				++j;
+				if (krylov_::record (std::abs (g[j]), bnorm, options, res)
+					|| hnext == static_cast<T> (0))
+					break;
+			}
+
+			//x <- x + M^-1 V y, H y = g
+			for (std::size_t i = j - 1; i < j; --i)
+			{
+				T val = g[i];
+				for (std::size_t l = i + 1; l < j; ++l)
+					val -= h.at (i, l) * y[l];
+				y[i] = h.at (i, i) == static_cast<T> (0) ? static_cast<T> (0)
+					: val / h.at (i, i);
+			}
+			w.assign (static_cast<T> (0));
+			for (std::size_t i = 0; i < j; ++i)
+				w += y[i] * v[i];
+			m.apply (w, z);
+			x += z;
+
+			//True residual, both to restart and to confirm convergence
+			apply_operator (a, x, w);
+			v[0] = b - w;
+			beta = v[0].norm ();
+			res.residual = beta / bnorm;
+			res.converged = res.residual <= options.tolerance;
+			if (res.converged || beta == static_cast<T> (0))
+				break;
+		}
+
+		return res;
+	}
+
+	template <class Op, class T>
+	KrylovResult<T>
+	gmres_solve (const Op& a, const Vector<T>& b, Vector<T>& x,
+				 const KrylovOptions<T>& options)
+	{
+		return gmres_solve (a, b, x, IdentityPreconditioner<T> (), options);
+	}
+
+	template <class Op, class T, class Prec>
+	KrylovResult<T>
+	bicgstab_solve (const Op& a, const Vector<T>& b, Vector<T>& x,
+					const Prec& m, const KrylovOptions<T>& options)
+	{
+		KrylovResult<T> res;
+		T bnorm;
+		if (!krylov_::start (b, x, options, res, bnorm))
+			return res;
+
+		std::size_t n = b.size ();
+		Vector<T> r (n);
+		Vector<T> r0 (n);
+		Vector<T> p (n, static_cast<T> (0));
+		Vector<T> v (n, static_cast<T> (0));
+		Vector<T> ph (n);
+		Vector<T> s (n);
+		Vector<T> sh (n);
+		Vector<T> t (n);
+
+		apply_operator (a, x, t);
+		r = b - t;
+		r0.assign (r);
+		if (krylov_::record (r.norm (), bnorm, options, res))
+			return res;
+
+		T rho = 1;
+		T alpha = 1;
+		T omega = 1;
+
+		while (res.iterations < options.max_iterations)
+		{
+			++res.iterations;
+			T rho_next = r0.dot_product (r);
+			if (rho_next == static_cast<T> (0))
+				break;
+
+			T beta = (rho_next / rho) * (alpha / omega);
+			rho = rho_next;
+			p = r + beta * (p - omega * v);
+			m.apply (p, ph);
+			apply_operator (a, ph, v);
+			T r0v = r0.dot_product (v);
+			if (r0v == static_cast<T> (0))
+				break;
+			alpha = rho / r0v;
+			s = r - alpha * v;
+
+			T snorm = s.norm ();
+			if (snorm <= options.tolerance * bnorm)
+			{
+				x += alpha * ph;
+				krylov_::record (snorm, bnorm, options, res);
+				break;
+			}
+
+			m.apply (s, sh);
+			apply_operator (a, sh, t);
+			T tt = t.dot_product (t);
+			omega = tt == static_cast<T> (0) ? static_cast<T> (0)
+				: t.dot_product (s) / tt;
+			x += alpha * ph + omega * sh;
+			r = s - omega * t;
+
+			if (krylov_::record (r.norm (), bnorm, options, res)
+				|| omega == static_cast<T> (0))
+				break;
+		}
+
+		return res;
+	}
+
+	template <class Op, class T>
+	KrylovResult<T>
+	bicgstab_solve (const Op& a, const Vector<T>& b, Vector<T>& x,
+					const KrylovOptions<T>& options)
+	{
+		return bicgstab_solve (a, b, x, IdentityPreconditioner<T> (), options);
+	}
+
+}
+
+#endif //!KRYLOV_HH_
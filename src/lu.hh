@@ -0,0 +1,246 @@
+/** @file In-place blocked LU factorization with partial pivoting
+ *
+ * The n x n row-major matrix A is overwritten by L and U (PA = LU):
+ * U on and above the diagonal, the multipliers of the unit lower L below it.
+ * Row interchanges are kept in a pivot vector, LAPACK style: row i was
+ * swapped with row piv[i] at step i.
+ * Factorization is right-looking: each panel of OPL_LU_BLOCK columns is
+ * factorized, then the trailing matrix is updated with a single gemm.
+ * lu_solve_mixed factorizes in a lower precision (long double -> double,
+ * double -> float) with the vectorized kernels, and refines the solution
+ * with residuals computed in the full precision.
+ */
+
+#ifndef LU_HH_
+# define LU_HH_
+
+# include <algorithm>
+# include <cmath>
+# include <cstddef>
+# include <cstdlib>
+# include <limits>
+# include <vector>
+# include "gemm.hh"
+# include "parallel.hh"
+# include "triangular.hh"
+
+///Panel width of the blocked LU
+# define OPL_LU_BLOCK 64
+
+///Maximum refinement steps of lu_solve_mixed
+# define OPL_LU_REFINE_ITERATIONS 30
+
+namespace opl
+{
+
+	namespace linalg
+	{
+
+		///Factorizes A in place, piv must hold n values
+		///Returns the number of row interchanges
+		///A zero pivot is left as is, the matrix is then singular
+		template <class T>
+		std::size_t
+		lu_factorize (std::size_t n, T* a, std::size_t lda, std::size_t* piv)
+		{
+			constexpr std::size_t nb = OPL_LU_BLOCK;
+			std::size_t swaps = 0;
+
+			for (std::size_t j0 = 0; j0 < n; j0 += nb)
+			{
+				std::size_t jb = std::min (nb, n - j0);
+				std::size_t j1 = j0 + jb;
+
+				//Unblocked factorization of the panel A[j0:n, j0:j1]
+				for (std::size_t j = j0; j < j1; ++j)
+				{
+					std::size_t p = j;
+					for (std::size_t i = j + 1; i < n; ++i)
+						if (std::abs (a[i * lda + j]) > std::abs (a[p * lda + j]))
+							p = i;
+
+					piv[j] = p;
+					if (p != j)
+					{
+						std::swap_ranges (a + j * lda, a + j * lda + n,
+										  a + p * lda);
+						++swaps;
+					}
+
+					T d = a[j * lda + j];
+					if (d == static_cast<T> (0))
+						continue;
+
+					const T* uj = a + j * lda;
+					parallel::for_range (n - j - 1, (n - j) * (j1 - j),
+										 [&](std::size_t i0, std::size_t i1) {
+							for (std::size_t i = j + 1 + i0; i < j + 1 + i1; ++i)
+							{
+								T* ai = a + i * lda;
+								T lij = ai[j] / d;
+								ai[j] = lij;
+								for (std::size_t k = j + 1; k < j1; ++k)
+									ai[k] -= lij * uj[k];
+							}
+						});
+				}
+
+				if (j1 == n)
+					break;
+
+				//U12 <- L11^-1 A12
+				for (std::size_t i = j0 + 1; i < j1; ++i)
+				{
+					T* ai = a + i * lda;
+					for (std::size_t k = j0; k < i; ++k)
+					{
+						T lik = ai[k];
+						const T* ak = a + k * lda;
+						for (std::size_t c = j1; c < n; ++c)
+							ai[c] -= lik * ak[c];
+					}
+				}
+
+				//A22 <- A22 - L21 U12
+				std::size_t m = n - j1;
+				gemm (m, m, jb, static_cast<T> (-1),
+					  a + j1 * lda + j0, lda, std::size_t (1),
+					  a + j0 * lda + j1, lda, std::size_t (1),
+					  static_cast<T> (1), a + j1 * lda + j1, lda, std::size_t (1));
+			}
+
+			return swaps;
+		}
+
+		///Solves AX = B in place, with lu and piv computed by lu_factorize
+		///B is n x nrhs, row-major
+		template <class T>
+		void
+		lu_solve (std::size_t n, std::size_t nrhs, const T* lu, std::size_t lda,
+				  const std::size_t* piv, T* b, std::size_t ldb)
+		{
+			for (std::size_t i = 0; i < n; ++i)
+				if (piv[i] != i)
+					std::swap_ranges (b + i * ldb, b + i * ldb + nrhs,
+									  b + piv[i] * ldb);
+
+			lower_unit_solve (n, nrhs, lu, lda, b, ldb);
+			upper_solve (n, nrhs, lu, lda, b, ldb);
+		}
+
+		///det(A), with lu and swaps computed by lu_factorize
+		template <class T>
+		T
+		lu_determinant (std::size_t n, const T* lu, std::size_t lda,
+						std::size_t swaps)
+		{
+			T det = swaps % 2 ? static_cast<T> (-1) : static_cast<T> (1);
+			for (std::size_t i = 0; i < n; ++i)
+				det *= lu[i * lda + i];
+			return det;
+		}
+
+		///Type lu_solve_mixed factorizes T matrices in
+		template <class T>
+		struct LowerPrecision
+		{
+			typedef T type;
+		};
+
+		template <>
+		struct LowerPrecision<double>
+		{
+			typedef float type;
+		};
+
+		template <>
+		struct LowerPrecision<long double>
+		{
+			typedef double type;
+		};
+
+		///Solves AX = B, A n x n and B n x nrhs are left unchanged
+		///A is factorized in L, then each step solves AD = B - AX with the
+		///L factors, the residual B - AX being computed in T, and X += D
+		///Stops when ||B - AX|| <= ||X|| ||A|| eps sqrt(n) for all the
+		///columns (infinity norms, eps of T), as LAPACK dsgesv
+		///Returns false if A overflows L, or after OPL_LU_REFINE_ITERATIONS
+		///steps without convergence (ill-conditioned or singular A in L):
+		///X is then unspecified and the system must be solved in T
+		template <class L, class T>
+		bool
+		lu_solve_mixed (std::size_t n, std::size_t nrhs,
+						const T* a, std::size_t lda,
+						const T* b, std::size_t ldb,
+						T* x, std::size_t ldx)
+		{
+			T anrm = 0;
+			for (std::size_t i = 0; i < n; ++i)
+			{
+				T sum = 0;
+				for (std::size_t j = 0; j < n; ++j)
+					sum += std::abs (a[i * lda + j]);
+				anrm = std::max (anrm, sum);
+			}
+			if (!(anrm <= static_cast<T> (std::numeric_limits<L>::max ())))
+				return false;
+
+			std::vector<L> lu (n * n);
+			std::vector<std::size_t> piv (n);
+			for (std::size_t i = 0; i < n; ++i)
+				for (std::size_t j = 0; j < n; ++j)
+					lu[i * n + j] = static_cast<L> (a[i * lda + j]);
+			lu_factorize (n, lu.data (), n, piv.data ());
+
+			//w <- A^-1 r in L, x <- w (first step) or x + w
+			std::vector<L> w (n * nrhs);
+			auto correct = [&](const T* r, std::size_t ldr, bool first) {
+				for (std::size_t i = 0; i < n; ++i)
+					for (std::size_t j = 0; j < nrhs; ++j)
+						w[i * nrhs + j] = static_cast<L> (r[i * ldr + j]);
+				lu_solve (n, nrhs, lu.data (), n, piv.data (), w.data (), nrhs);
+				for (std::size_t i = 0; i < n; ++i)
+					for (std::size_t j = 0; j < nrhs; ++j)
+						x[i * ldx + j] = static_cast<T> (w[i * nrhs + j])
+							+ (first ? static_cast<T> (0) : x[i * ldx + j]);
+			};
+
+			correct (b, ldb, true);
+			T cte = anrm * std::numeric_limits<T>::epsilon ()
+				* std::sqrt (static_cast<T> (n));
+			std::vector<T> r (n * nrhs);
+
+			for (std::size_t it = 0; ; ++it)
+			{
+				for (std::size_t i = 0; i < n; ++i)
+					std::copy_n (b + i * ldb, nrhs, r.data () + i * nrhs);
+				gemm (n, nrhs, n, static_cast<T> (-1),
+					  a, lda, std::size_t (1), x, ldx, std::size_t (1),
+					  static_cast<T> (1), r.data (), nrhs, std::size_t (1));
+
+				bool done = true;
+				for (std::size_t j = 0; j < nrhs && done; ++j)
+				{
+					T xnrm = 0;
+					T rnrm = 0;
+					for (std::size_t i = 0; i < n; ++i)
+					{
+						xnrm = std::max (xnrm, std::abs (x[i * ldx + j]));
+						rnrm = std::max (rnrm, std::abs (r[i * nrhs + j]));
+					}
+					done = rnrm <= xnrm * cte;
+				}
+
+				if (done)
+					return true;
+				if (it == OPL_LU_REFINE_ITERATIONS)
+					return false;
+				correct (r.data (), nrhs, false);
+			}
+		}
+
+	}
+
+}
+
+#endif //!LU_HH_
@@ -0,0 +1,139 @@
+#include <algorithm>
+#include <stdexcept>
+#include <utility>
+#include "mapped-file.hh"
+#include "system.hh"
+
+#if defined (PLATFORM_UNIX_)
+# include <fcntl.h>
+# include <sys/mman.h>
+# include <sys/stat.h>
+# include <unistd.h>
+#endif
+
+
+namespace opl
+{
+
+	MappedFile::MappedFile (const std::string& path)
+		: data_ (nullptr)
+		, size_ (0)
+	{
+
+#if defined (PLATFORM_UNIX_)
+
+		int fd = open (path.c_str (), O_RDONLY);
+		if (fd < 0)
+			throw std::runtime_error ("MappedFile: cannot open " + path);
+
+		struct stat buffer;
+		if (fstat (fd, &buffer))
+		{
+			close (fd);
+			throw std::runtime_error ("MappedFile: cannot stat " + path);
+		}
+
+		size_ = buffer.st_size;
+		if (size_)
+		{
+			void* p = mmap (nullptr, size_, PROT_READ, MAP_SHARED, fd, 0);
+			if (p == MAP_FAILED)
+			{
+				close (fd);
+				throw std::runtime_error ("MappedFile: cannot map " + path);
+			}
+			data_ = static_cast<char*> (p);
+		}
+
+		//The mapping stays valid once the descriptor is closed
+		close (fd);
+
+#else
+
+		(void) path;
+		throw std::runtime_error ("MappedFile win not implemented");
+
+#endif
+
+	}
+
+	MappedFile::MappedFile (MappedFile&& f) noexcept
+		: data_ (f.data_)
+		, size_ (f.size_)
+	{
+		f.data_ = nullptr;
+		f.size_ = 0;
+	}
+
+	MappedFile&
+	MappedFile::operator= (MappedFile&& f) noexcept
+	{
+		std::swap (data_, f.data_);
+		std::swap (size_, f.size_);
+		return *this;
+	}
+
+	MappedFile::~MappedFile ()
+	{
+		unmap_ ();
+	}
+
+	const char*
+	MappedFile::data () const
+	{
+		return data_;
+	}
+
+	std::size_t
+	MappedFile::size () const
+	{
+		return size_;
+	}
+
+	void
+	MappedFile::will_need (std::size_t offset, std::size_t n) const
+	{
+		if (offset >= size_ || !n)
+			return;
+
+#if defined (PLATFORM_UNIX_)
+
+		//madvise needs a page aligned start
+		std::size_t page = sysconf (_SC_PAGESIZE);
+		std::size_t begin = offset / page * page;
+		std::size_t end = std::min (size_, offset + n);
+		madvise (data_ + begin, end - begin, MADV_WILLNEED);
+
+#endif
+
+	}
+
+	void
+	MappedFile::sequential () const
+	{
+
+#if defined (PLATFORM_UNIX_)
+
+		if (data_)
+			madvise (data_, size_, MADV_SEQUENTIAL);
+
+#endif
+
+	}
+
+	void
+	MappedFile::unmap_ ()
+	{
+
+#if defined (PLATFORM_UNIX_)
+
+		if (data_)
+			munmap (data_, size_);
+
+#endif
+
+		data_ = nullptr;
+		size_ = 0;
+	}
+
+}
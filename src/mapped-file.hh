@@ -0,0 +1,63 @@
+/** @file MappedFile class definition
+ *
+ * Read-only memory mapping of a whole file: pages are read from the disk
+ * when first accessed, and shared with the page cache instead of copied.
+ */
+
+#ifndef MAPPED_FILE_HH_
+# define MAPPED_FILE_HH_
+
+# include <cstddef>
+# include <string>
+
+namespace opl
+{
+
+	class MappedFile
+	{
+
+	public:
+		///Maps the file at path, throws std::runtime_error on failure
+		explicit MappedFile (const std::string& path);
+
+		///Takes ownership of the mapping of f, f is left empty
+		MappedFile (MappedFile&& f) noexcept;
+
+		MappedFile&
+		operator= (MappedFile&& f) noexcept;
+
+		MappedFile (const MappedFile&) = delete;
+
+		MappedFile&
+		operator= (const MappedFile&) = delete;
+
+		~MappedFile ();
+
+		///Start of the file, nullptr for an empty file
+		const char*
+		data () const;
+
+		///Size in bytes
+		std::size_t
+		size () const;
+
+		///Hints that the bytes [offset, offset + n) will be read soon
+		void
+		will_need (std::size_t offset, std::size_t n) const;
+
+		///Hints that the file will be read from start to end
+		void
+		sequential () const;
+
+	private:
+		void
+		unmap_ ();
+
+		char* data_;
+		std::size_t size_;
+
+	};
+
+}
+
+#endif //!MAPPED_FILE_HH_
@@ -0,0 +1,901 @@
+/** @file VectorView and MatrixView classes definition
+ *
+ * Views reference values stored elsewhere (a Vector, a Matrix, or any
+ * buffer), with a stride between consecutive values: rows, columns,
+ * diagonals, regions and transposes of a Matrix are views of its storage,
+ * without any copy.
+ * VectorView<T> and MatrixView<T> write through to the storage,
+ * VectorView<const T> and MatrixView<const T> are read-only.
+ * A view must not outlive its storage. Copying a view copies the reference,
+ * assigning to a view copies the values.
+ * Views are vector and matrix expressions: they take part in arithmetic
+ * and reductions like Vector and Matrix do.
+ */
+
+#ifndef MATRIX_VIEW_HH_
+# define MATRIX_VIEW_HH_
+
+# include <algorithm>
+# include <cassert>
+# include <cstddef>
+# include <iterator>
+# include <stdexcept>
+# include <type_traits>
+# include <vector>
+# include "expression.hh"
+# include "parallel.hh"
+
+namespace opl
+{
+
+	///Random access iterator over strided values
+	template <class T>
+	class StridedIterator
+	{
+
+	public:
+		typedef std::ptrdiff_t difference_type;
+		typedef std::remove_const_t<T> value_type;
+		typedef T& reference;
+		typedef T* pointer;
+		typedef std::random_access_iterator_tag iterator_category;
+
+		StridedIterator ()
+			: ptr_ (nullptr), stride_ (1)
+		{
+
+		}
+
+		StridedIterator (T* ptr, std::size_t stride)
+			: ptr_ (ptr), stride_ (static_cast<difference_type> (stride))
+		{
+
+		}
+
+		bool
+		operator== (const StridedIterator& it) const
+		{
+			return ptr_ == it.ptr_;
+		}
+
+		bool
+		operator!= (const StridedIterator& it) const
+		{
+			return ptr_ != it.ptr_;
+		}
+
+		bool
+		operator< (const StridedIterator& it) const
+		{
+			return ptr_ < it.ptr_;
+		}
+
+		bool
+		operator<= (const StridedIterator& it) const
+		{
+			return ptr_ <= it.ptr_;
+		}
+
+		bool
+		operator> (const StridedIterator& it) const
+		{
+			return ptr_ > it.ptr_;
+		}
+
+		bool
+		operator>= (const StridedIterator& it) const
+		{
+			return ptr_ >= it.ptr_;
+		}
+
+		StridedIterator&
+		operator++ ()
+		{
+			ptr_ += stride_;
+			return *this;
+		}
+
+		StridedIterator
+		operator++ (int)
+		{
+			StridedIterator it = *this;
+			ptr_ += stride_;
+			return it;
+		}
+
+		StridedIterator&
+		operator-- ()
+		{
+			ptr_ -= stride_;
+			return *this;
+		}
+
+		StridedIterator
+		operator-- (int)
+		{
+			StridedIterator it = *this;
+			ptr_ -= stride_;
+			return it;
+		}
+
+		StridedIterator&
+		operator+= (difference_type n)
+		{
+			ptr_ += n * stride_;
+			return *this;
+		}
+
+		StridedIterator
+		operator+ (difference_type n) const
+		{
+			return StridedIterator (*this) += n;
+		}
+
+		StridedIterator&
+		operator-= (difference_type n)
+		{
+			ptr_ -= n * stride_;
+			return *this;
+		}
+
+		StridedIterator
+		operator- (difference_type n) const
+		{
+			return StridedIterator (*this) -= n;
+		}
+
+		difference_type
+		operator- (const StridedIterator& it) const
+		{
+			return (ptr_ - it.ptr_) / stride_;
+		}
+
+		T&
+		operator* () const
+		{
+			return *ptr_;
+		}
+
+		T*
+		operator-> () const
+		{
+			return ptr_;
+		}
+
+		T&
+		operator[] (difference_type n) const
+		{
+			return ptr_[n * stride_];
+		}
+
+	private:
+		T* ptr_;
+		difference_type stride_;
+
+	};
+
+
+	template <class T>
+	class VectorView : public VectorExpr<VectorView<T>, std::remove_const_t<T>>
+	{
+
+	public:
+		typedef std::remove_const_t<T> value_type;
+		typedef std::size_t size_type;
+		typedef T& reference;
+		typedef T* pointer;
+		typedef StridedIterator<T> iterator;
+
+		VectorView (T* data, size_type size, size_type stride = 1);
+
+		///View of the whole vector v
+		template <class U, class = std::enable_if_t<
+							   std::is_same<const U, T>::value
+							   || std::is_same<U, T>::value>>
+		VectorView (Vector<U>& v);
+
+		template <class U, class = std::enable_if_t<
+							   std::is_same<const U, T>::value>>
+		VectorView (const Vector<U>& v);
+
+		///Read-only view of a mutable view
+		template <class U, class = std::enable_if_t<
+							   std::is_same<const U, T>::value>>
+		VectorView (const VectorView<U>& v);
+
+		VectorView (const VectorView& v) = default;
+
+		///Copies the values of v
+		VectorView&
+		operator= (const VectorView& v);
+
+		template <class E>
+		VectorView&
+		operator= (const VectorExpr<E, value_type>& e);
+
+		VectorView&
+		operator= (const value_type& x);
+
+		template <class E>
+		VectorView&
+		operator+= (const VectorExpr<E, value_type>& e);
+
+		template <class E>
+		VectorView&
+		operator-= (const VectorExpr<E, value_type>& e);
+
+		VectorView&
+		operator+= (const value_type& x);
+
+		VectorView&
+		operator-= (const value_type& x);
+
+		VectorView&
+		operator*= (const value_type& x);
+
+		VectorView&
+		operator/= (const value_type& x);
+
+		size_type
+		size () const;
+
+		///size () x 1, as for Vector in expressions
+		size_type
+		rows () const;
+
+		size_type
+		cols () const;
+
+		///Distance between two consecutive values in the storage
+		size_type
+		stride () const;
+
+		T*
+		data () const;
+
+		T&
+		operator[] (size_type i) const;
+
+		T&
+		at (size_type i) const;
+
+		iterator
+		begin () const;
+
+		iterator
+		end () const;
+
+		///Values i to i + n - 1
+		VectorView
+		segment (size_type i, size_type n) const;
+
+		///Returns true if evaluating into t must go through a temporary
+		bool
+		aliases (const ExprTarget<value_type>& t) const;
+
+	private:
+		template <class E, class Op>
+		void
+		evaluate_ (const E& e, Op op) const;
+
+		T* data_;
+		size_type size_;
+		size_type stride_;
+
+	};
+
+
+	template <class T>
+	class MatrixView : public MatrixExpr<MatrixView<T>, std::remove_const_t<T>>
+	{
+
+	public:
+		typedef std::remove_const_t<T> value_type;
+		typedef std::size_t size_type;
+		typedef T& reference;
+		typedef T* pointer;
+
+		///Value (i, j) is at data[i * row_stride + j * col_stride]
+		MatrixView (T* data, size_type rows, size_type cols,
+					size_type row_stride, size_type col_stride = 1);
+
+		///View of the whole matrix m
+		template <class U, StorageOrder O, class = std::enable_if_t<
+							   std::is_same<const U, T>::value
+							   || std::is_same<U, T>::value>>
+		MatrixView (Matrix<U, O>& m);
+
+		template <class U, StorageOrder O, class = std::enable_if_t<
+							   std::is_same<const U, T>::value>>
+		MatrixView (const Matrix<U, O>& m);
+
+		///Read-only view of a mutable view
+		template <class U, class = std::enable_if_t<
+							   std::is_same<const U, T>::value>>
+		MatrixView (const MatrixView<U>& m);
+
+		MatrixView (const MatrixView& m) = default;
+
+		///Copies the values of m
+		MatrixView&
+		operator= (const MatrixView& m);
+
+		template <class E>
+		MatrixView&
+		operator= (const MatrixExpr<E, value_type>& e);
+
+		MatrixView&
+		operator= (const value_type& x);
+
+		template <class E>
+		MatrixView&
+		operator+= (const MatrixExpr<E, value_type>& e);
+
+		template <class E>
+		MatrixView&
+		operator-= (const MatrixExpr<E, value_type>& e);
+
+		MatrixView&
+		operator+= (const value_type& x);
+
+		MatrixView&
+		operator-= (const value_type& x);
+
+		MatrixView&
+		operator*= (const value_type& x);
+
+		MatrixView&
+		operator/= (const value_type& x);
+
+		size_type
+		rows () const;
+
+		size_type
+		cols () const;
+
+		size_type
+		size () const;
+
+		size_type
+		row_stride () const;
+
+		size_type
+		col_stride () const;
+
+		T*
+		data () const;
+
+		///Value i in row-major order
+		T&
+		operator[] (size_type i) const;
+
+		T&
+		at (size_type i, size_type j) const;
+
+		VectorView<T>
+		row (size_type i) const;
+
+		VectorView<T>
+		col (size_type j) const;
+
+		VectorView<T>
+		diagonal () const;
+
+		///n x p block starting at (i0, j0)
+		MatrixView
+		region (size_type i0, size_type j0, size_type n, size_type p) const;
+
+		///Same values, rows and columns swapped
+		MatrixView
+		transpose () const;
+
+		///Returns true if evaluating into t must go through a temporary
+		bool
+		aliases (const ExprTarget<value_type>& t) const;
+
+	private:
+		template <class E, class Op>
+		void
+		evaluate_ (const E& e, Op op) const;
+
+		T* data_;
+		size_type rows_;
+		size_type cols_;
+		size_type rs_;
+		size_type cs_;
+
+	};
+
+	///Returns v itself, without any copy
+	template <class T>
+	const VectorView<T>&
+	evaluate (const VectorView<T>& v)
+	{
+		return v;
+	}
+
+	///Returns m itself, without any copy
+	template <class T>
+	const MatrixView<T>&
+	evaluate (const MatrixView<T>& m)
+	{
+		return m;
+	}
+
+
+	template <class T>
+	VectorView<T>::VectorView (T* data, size_type size, size_type stride)
+		: data_ (data)
+		, size_ (size)
+		, stride_ (stride)
+	{
+
+	}
+
+	template <class T>
+	template <class U, class>
+	VectorView<T>::VectorView (Vector<U>& v)
+		: VectorView (v.data (), v.size ())
+	{
+
+	}
+
+	template <class T>
+	template <class U, class>
+	VectorView<T>::VectorView (const Vector<U>& v)
+		: VectorView (v.data (), v.size ())
+	{
+
+	}
+
+	template <class T>
+	template <class U, class>
+	VectorView<T>::VectorView (const VectorView<U>& v)
+		: VectorView (v.data (), v.size (), v.stride ())
+	{
+
+	}
+
+	template <class T>
+	VectorView<T>&
+	VectorView<T>::operator= (const VectorView& v)
+	{
+		assert (size_ == v.size_);
+		evaluate_ (v, [](T& x, const value_type& y) { x = y; });
+		return *this;
+	}
+
+	template <class T>
+	template <class E>
+	VectorView<T>&
+	VectorView<T>::operator= (const VectorExpr<E, value_type>& e)
+	{
+		assert (size_ == e.size ());
+		evaluate_ (e.self (), [](T& x, const value_type& y) { x = y; });
+		return *this;
+	}
+
+	template <class T>
+	VectorView<T>&
+	VectorView<T>::operator= (const value_type& x)
+	{
+		for (size_type i = 0; i < size_; ++i)
+			data_[i * stride_] = x;
+		return *this;
+	}
+
+	template <class T>
+	template <class E>
+	VectorView<T>&
+	VectorView<T>::operator+= (const VectorExpr<E, value_type>& e)
+	{
+		assert (size_ == e.size ());
+		evaluate_ (e.self (), [](T& x, const value_type& y) { x += y; });
+		return *this;
+	}
+
+	template <class T>
+	template <class E>
+	VectorView<T>&
+	VectorView<T>::operator-= (const VectorExpr<E, value_type>& e)
+	{
+		assert (size_ == e.size ());
+		evaluate_ (e.self (), [](T& x, const value_type& y) { x -= y; });
+		return *this;
+	}
+
+	template <class T>
+	VectorView<T>&
+	VectorView<T>::operator+= (const value_type& x)
+	{
+		for (size_type i = 0; i < size_; ++i)
+			data_[i * stride_] += x;
+		return *this;
+	}
+
+	template <class T>
+	VectorView<T>&
+	VectorView<T>::operator-= (const value_type& x)
+	{
+		for (size_type i = 0; i < size_; ++i)
+			data_[i * stride_] -= x;
+		return *this;
+	}
+
+	template <class T>
+	VectorView<T>&
+	VectorView<T>::operator*= (const value_type& x)
+	{
+		for (size_type i = 0; i < size_; ++i)
+			data_[i * stride_] *= x;
+		return *this;
+	}
+
+	template <class T>
+	VectorView<T>&
+	VectorView<T>::operator/= (const value_type& x)
+	{
+		for (size_type i = 0; i < size_; ++i)
+			data_[i * stride_] /= x;
+		return *this;
+	}
+
+	template <class T>
+	typename VectorView<T>::size_type
+	VectorView<T>::size () const
+	{
+		return size_;
+	}
+
+	template <class T>
+	typename VectorView<T>::size_type
+	VectorView<T>::rows () const
+	{
+		return size_;
+	}
+
+	template <class T>
+	typename VectorView<T>::size_type
+	VectorView<T>::cols () const
+	{
+		return 1;
+	}
+
+	template <class T>
+	typename VectorView<T>::size_type
+	VectorView<T>::stride () const
+	{
+		return stride_;
+	}
+
+	template <class T>
+	T*
+	VectorView<T>::data () const
+	{
+		return data_;
+	}
+
+	template <class T>
+	T&
+	VectorView<T>::operator[] (size_type i) const
+	{
+		return data_[i * stride_];
+	}
+
+	template <class T>
+	T&
+	VectorView<T>::at (size_type i) const
+	{
+		if (i >= size_)
+			throw std::out_of_range ("VectorView out of range index");
+		return data_[i * stride_];
+	}
+
+	template <class T>
+	typename VectorView<T>::iterator
+	VectorView<T>::begin () const
+	{
+		return iterator (data_, stride_);
+	}
+
+	template <class T>
+	typename VectorView<T>::iterator
+	VectorView<T>::end () const
+	{
+		return iterator (data_ + size_ * stride_, stride_);
+	}
+
+	template <class T>
+	VectorView<T>
+	VectorView<T>::segment (size_type i, size_type n) const
+	{
+		assert (i + n <= size_);
+		return VectorView (data_ + i * stride_, n, stride_);
+	}
+
+	template <class T>
+	bool
+	VectorView<T>::aliases (const ExprTarget<value_type>& t) const
+	{
+		return t.conflicts (data_, size_, 1, stride_, 1);
+	}
+
+	template <class T>
+	template <class E, class Op>
+	void
+	VectorView<T>::evaluate_ (const E& e, Op op) const
+	{
+		const auto& expr = ExprOperand<E>::get (e);
+		if (expr.aliases (ExprTarget<value_type> (data_, size_, 1, stride_, 1)))
+		{
+			std::vector<value_type> tmp = evaluate_copy_ (expr);
+			evaluate_ (DenseExpr<VectorExpr, value_type> (tmp.data (), size_, 1),
+					   op);
+			return;
+		}
+
+		T* data = data_;
+		size_type stride = stride_;
+		parallel::for_range (size_, size_, [&](size_type i0, size_type i1) {
+				for (size_type i = i0; i < i1; ++i)
+					op (data[i * stride], expr[i]);
+			});
+	}
+
+
+	template <class T>
+	MatrixView<T>::MatrixView (T* data, size_type rows, size_type cols,
+							   size_type row_stride, size_type col_stride)
+		: data_ (data)
+		, rows_ (rows)
+		, cols_ (cols)
+		, rs_ (row_stride)
+		, cs_ (col_stride)
+	{
+
+	}
+
+	template <class T>
+	template <class U, StorageOrder O, class>
+	MatrixView<T>::MatrixView (Matrix<U, O>& m)
+		: MatrixView (m.data (), m.rows (), m.cols (), m.row_stride (),
+					  m.col_stride ())
+	{
+
+	}
+
+	template <class T>
+	template <class U, StorageOrder O, class>
+	MatrixView<T>::MatrixView (const Matrix<U, O>& m)
+		: MatrixView (m.data (), m.rows (), m.cols (), m.row_stride (),
+					  m.col_stride ())
+	{
+
+	}
+
+	template <class T>
+	template <class U, class>
+	MatrixView<T>::MatrixView (const MatrixView<U>& m)
+		: MatrixView (m.data (), m.rows (), m.cols (), m.row_stride (),
+					  m.col_stride ())
+	{
+
+	}
+
+	template <class T>
+	MatrixView<T>&
+	MatrixView<T>::operator= (const MatrixView& m)
+	{
+		assert (rows_ == m.rows_ && cols_ == m.cols_);
+		evaluate_ (m, [](T& x, const value_type& y) { x = y; });
+		return *this;
+	}
+
+	template <class T>
+	template <class E>
+	MatrixView<T>&
+	MatrixView<T>::operator= (const MatrixExpr<E, value_type>& e)
+	{
+		assert (rows_ == e.rows () && cols_ == e.cols ());
+		evaluate_ (e.self (), [](T& x, const value_type& y) { x = y; });
+		return *this;
+	}
+
+	template <class T>
+	MatrixView<T>&
+	MatrixView<T>::operator= (const value_type& x)
+	{
+		for (size_type i = 0; i < rows_; ++i)
+			row (i) = x;
+		return *this;
+	}
+
+	template <class T>
+	template <class E>
+	MatrixView<T>&
+	MatrixView<T>::operator+= (const MatrixExpr<E, value_type>& e)
+	{
+		assert (rows_ == e.rows () && cols_ == e.cols ());
+		evaluate_ (e.self (), [](T& x, const value_type& y) { x += y; });
+		return *this;
+	}
+
+	template <class T>
+	template <class E>
+	MatrixView<T>&
+	MatrixView<T>::operator-= (const MatrixExpr<E, value_type>& e)
+	{
+		assert (rows_ == e.rows () && cols_ == e.cols ());
+		evaluate_ (e.self (), [](T& x, const value_type& y) { x -= y; });
+		return *this;
+	}
+
+	template <class T>
+	MatrixView<T>&
+	MatrixView<T>::operator+= (const value_type& x)
+	{
+		for (size_type i = 0; i < rows_; ++i)
+			row (i) += x;
+		return *this;
+	}
+
+	template <class T>
+	MatrixView<T>&
+	MatrixView<T>::operator-= (const value_type& x)
+	{
+		for (size_type i = 0; i < rows_; ++i)
+			row (i) -= x;
+		return *this;
+	}
+
+	template <class T>
+	MatrixView<T>&
+	MatrixView<T>::operator*= (const value_type& x)
+	{
+		for (size_type i = 0; i < rows_; ++i)
+			row (i) *= x;
+		return *this;
+	}
+
+	template <class T>
+	MatrixView<T>&
+	MatrixView<T>::operator/= (const value_type& x)
+	{
+		for (size_type i = 0; i < rows_; ++i)
+			row (i) /= x;
+		return *this;
+	}
+
+	template <class T>
+	typename MatrixView<T>::size_type
+	MatrixView<T>::rows () const
+	{
+		return rows_;
+	}
+
+	template <class T>
+	typename MatrixView<T>::size_type
+	MatrixView<T>::cols () const
+	{
+		return cols_;
+	}
+
+	template <class T>
+	typename MatrixView<T>::size_type
+	MatrixView<T>::size () const
+	{
+		return rows_ * cols_;
+	}
+
+	template <class T>
+	typename MatrixView<T>::size_type
+	MatrixView<T>::row_stride () const
+	{
+		return rs_;
+	}
+
+	template <class T>
+	typename MatrixView<T>::size_type
+	MatrixView<T>::col_stride () const
+	{
+		return cs_;
+	}
+
+	template <class T>
+	T*
+	MatrixView<T>::data () const
+	{
+		return data_;
+	}
+
+	template <class T>
+	T&
+	MatrixView<T>::operator[] (size_type i) const
+	{
+		return data_[(i / cols_) * rs_ + (i % cols_) * cs_];
+	}
+
+	template <class T>
+	T&
+	MatrixView<T>::at (size_type i, size_type j) const
+	{
+		assert (i < rows_);
+		assert (j < cols_);
+		return data_[i * rs_ + j * cs_];
+	}
+
+	template <class T>
+	VectorView<T>
+	MatrixView<T>::row (size_type i) const
+	{
+		assert (i < rows_);
+		return VectorView<T> (data_ + i * rs_, cols_, cs_);
+	}
+
+	template <class T>
+	VectorView<T>
+	MatrixView<T>::col (size_type j) const
+	{
+		assert (j < cols_);
+		return VectorView<T> (data_ + j * cs_, rows_, rs_);
+	}
+
+	template <class T>
+	VectorView<T>
+	MatrixView<T>::diagonal () const
+	{
+		return VectorView<T> (data_, std::min (rows_, cols_), rs_ + cs_);
+	}
+
+	template <class T>
+	MatrixView<T>
+	MatrixView<T>::region (size_type i0, size_type j0,
+						   size_type n, size_type p) const
+	{
+		assert (i0 + n <= rows_);
+		assert (j0 + p <= cols_);
+		return MatrixView (data_ + i0 * rs_ + j0 * cs_, n, p, rs_, cs_);
+	}
+
+	template <class T>
+	MatrixView<T>
+	MatrixView<T>::transpose () const
+	{
+		return MatrixView (data_, cols_, rows_, cs_, rs_);
+	}
+
+	template <class T>
+	bool
+	MatrixView<T>::aliases (const ExprTarget<value_type>& t) const
+	{
+		return t.conflicts (data_, rows_, cols_, rs_, cs_);
+	}
+
+	template <class T>
+	template <class E, class Op>
+	void
+	MatrixView<T>::evaluate_ (const E& e, Op op) const
+	{
+		const auto& expr = ExprOperand<E>::get (e);
+		if (expr.aliases (ExprTarget<value_type> (data_, rows_, cols_, rs_, cs_)))
+		{
+			std::vector<value_type> tmp = evaluate_copy_ (expr);
+			evaluate_ (DenseExpr<MatrixExpr, value_type> (tmp.data (), rows_,
+														  cols_), op);
+			return;
+		}
+
+		//Row by row, so that the output is walked with a fixed stride
+		parallel::for_range (rows_, size (), [&](size_type i0, size_type i1) {
+				for (size_type i = i0; i < i1; ++i)
+				{
+					T* out = data_ + i * rs_;
+					for (size_type j = 0; j < cols_; ++j)
+						op (out[j * cs_], expr[i * cols_ + j]);
+				}
+			});
+	}
+
+}
+
+#endif //!MATRIX_VIEW_HH_
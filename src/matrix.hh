@@ -11,10 +11,20 @@
 # include <cassert>
 # include <algorithm>
 # include <iterator>
+# include <limits>
 # include <stdexcept>
 # include <iostream>
 # include <vector>
 # include "algo.hh"
+# include "gemm.hh"
+# include "lu.hh"
+# include "matrix-view.hh"
+# include "qr.hh"
+# include "transpose.hh"
+# include "eigen.hh"
+# include "parallel.hh"
+# include "storage.hh"
+# include "svd.hh"
 # include "vector.hh"
 # include "math.hh"
 # include "types.hh"
@@ -23,8 +33,13 @@
 namespace opl
 {
 
-	template<class T>
-	class Matrix
+	///Dense matrix, its values are stored by rows (row-major) by default
+	///or by columns (col_major). Linear sequences of values given to or
+	///returned by the matrix (constructors, assign, vector_get) are always
+	///in row-major order, only data () and the linear iterators expose
+	///the storage order.
+	template<class T, StorageOrder O>
+	class Matrix : public MatrixExpr<Matrix<T, O>, T>
 	{
 
 	public:
@@ -76,6 +91,17 @@ namespace opl
 
 		Matrix (const Matrix& v);
 
+		///Takes ownership of the storage of v, v is left empty
+		Matrix (Matrix&& v) noexcept;
+
+		///Copy of a matrix stored in another order, with a blocked transpose
+		template <StorageOrder P>
+		Matrix (const Matrix<T, P>& v);
+
+		///Evaluates the expression e in a single loop
+		template <class E>
+		Matrix (const MatrixExpr<E, T>& e);
+
 		~Matrix ();
 
 		Matrix&
@@ -84,9 +110,16 @@ namespace opl
 		Matrix&
 		operator= (const Matrix& v);
 
+		Matrix&
+		operator= (Matrix&& v) noexcept;
+
 		Matrix&
 		operator= (std::initializer_list<T> list);
 
+		template <class E>
+		Matrix&
+		operator= (const MatrixExpr<E, T>& e);
+
 		void
 		assign (const T& x);
 
@@ -99,6 +132,11 @@ namespace opl
 		void
 		assign (std::initializer_list<T> list);
 
+		///Evaluates the expression e directly in the matrix
+		template <class E>
+		void
+		assign (const MatrixExpr<E, T>& e);
+
 		void
 		assign (size_type rows, size_type cols,
 				std::initializer_list<T> list);
@@ -119,6 +157,14 @@ namespace opl
 		void
 		resize (size_type rows, size_type cols, const T& x);
 
+		///Makes sure n values can be stored without reallocation
+		void
+		reserve (size_type n);
+
+		///Releases the storage not used by the current values
+		void
+		shrink_to_fit ();
+
 		size_type
 		rows () const;
 
@@ -128,6 +174,9 @@ namespace opl
 		size_type
 		size () const;
 
+		size_type
+		capacity () const;
+
 		bool
 		empty () const;
 
@@ -143,6 +192,14 @@ namespace opl
 		const T*
 		data () const;
 
+		///Distance between (i, j) and (i + 1, j) in the storage
+		size_type
+		row_stride () const;
+
+		///Distance between (i, j) and (i, j + 1) in the storage
+		size_type
+		col_stride () const;
+
 		void
 		swap (Matrix& v);
 
@@ -164,18 +221,59 @@ namespace opl
 		Matrix
 		transpose () const;
 
+		///Square matrices are transposed without any allocation
+		Matrix&
+		transpose_in_place ();
+
+		///Views: reference the values of the matrix, without any copy
+		MatrixView<T>
+		view ();
+
+		MatrixView<const T>
+		view () const;
+
+		VectorView<T>
+		row_view (size_type row);
+
+		VectorView<const T>
+		row_view (size_type row) const;
+
+		VectorView<T>
+		col_view (size_type col);
+
+		VectorView<const T>
+		col_view (size_type col) const;
+
+		VectorView<T>
+		diagonal_view ();
+
+		VectorView<const T>
+		diagonal_view () const;
+
+		///n x p block starting at (i, j)
+		MatrixView<T>
+		region_view (size_type i, size_type j, size_type n, size_type p);
+
+		MatrixView<const T>
+		region_view (size_type i, size_type j, size_type n, size_type p) const;
+
+		MatrixView<T>
+		transpose_view ();
+
+		MatrixView<const T>
+		transpose_view () const;
+
 		bool
 		is_symmetric () const;
 
-		template<class U>
+		template<class U, StorageOrder P>
 		friend std::ostream&
-		operator<< (std::ostream& os, const Matrix<U>& v);
+		operator<< (std::ostream& os, const Matrix<U, P>& v);
 
 
 
-		template <class U>
 		friend bool
-		operator== (const Matrix<U>& a, const Matrix<U>& b)
+		operator== (const Matrix& a, const Matrix& b)
 		{
 			if (a.rows_ != b.rows_ || a.cols_ != b.cols_)
 				return false;
@@ -185,9 +283,8 @@ namespace opl
 			return true;
 		}
 
-		template <class U>
 		friend bool
-		operator!= (const Matrix<U>& a, const Matrix<U>& b)
+		operator!= (const Matrix& a, const Matrix& b)
 		{
 			if (a.rows_ != b.rows_ || a.cols_ != b.cols_)
 				return true;
@@ -210,21 +307,26 @@ namespace opl
 		Matrix
 		operator-- (int);
 
-		Matrix
-		operator- () const;
-
 		Matrix&
 		operator+= (const T& x);
 
 		Matrix&
 		operator+= (const Matrix& v);
 
+		template <class E>
+		Matrix&
+		operator+= (const MatrixExpr<E, T>& e);
+
 		Matrix&
 		operator-= (const T& x);
 
 		Matrix&
 		operator-= (const Matrix& v);
 
+		template <class E>
+		Matrix&
+		operator-= (const MatrixExpr<E, T>& e);
+
 		Matrix&
 		operator*= (const T& x);
 
@@ -239,187 +341,6 @@ namespace opl
 
 
 
-		template<class U>
-		friend Matrix
-		operator+ (const Matrix<U>& a, const Matrix<U>& b)
-		{
-			assert (a.rows_ == b.rows_ && a.cols_ == b.cols_);
-			Matrix<U> v (a.rows_, a.cols_);
-			for (size_t i = 0; i < a.size_; ++i)
-				v.data_[i] = a.data_[i] + b.data_[i];
-			return v;
-		}
-
-		template<class U>
-		friend Matrix
-		operator+ (const Matrix<U>& v, const U& x)
-		{
-			Matrix<U> u (v.rows_, v.cols_);
-			for (size_t i = 0; i < v.size_; ++i)
-				u.data_[i] = v.data_[i] + x;
-			return u;
-		}
-
-
-		template<class U>
-		friend Matrix
-		operator+ (const U& x, const Matrix<U>& v)
-		{
-			Matrix<U> u (v.rows_, v.cols_);
-			for (size_t i = 0; i < v.size_; ++i)
-				u.data_[i] = x + v.data_[i];
-			return u;
-		}
-
-
-
-		template<class U>
-		friend Matrix
-		operator- (const Matrix<U>& a, const Matrix<U>& b)
-		{
-		    assert (a.rows_ == b.rows_ && a.cols_ == b.cols_);
-			Matrix<U> v (a.rows_, a.cols_);
-			for (size_t i = 0; i < a.size_; ++i)
-				v.data_[i] = a.data_[i] - b.data_[i];
-			return v;
-		}
-
-		template<class U>
-		friend Matrix
-		operator- (const Matrix<U>& v, const U& x)
-		{
-			Matrix<U> u (v.rows_, v.cols_);
-			for (size_t i = 0; i < v.size_; ++i)
-				u.data_[i] = v.data_[i] - x;
-			return u;
-		}
-
-		template<class U>
-		friend Matrix
-		operator- (const U& x, const Matrix<U>& v)
-		{
-			Matrix<U> u (v.rows_, v.cols_);
-			for (size_t i = 0; i < v.size_; ++i)
-				u.data_[i] = x - v.data_[i];
-			return u;
-		}
-
-		template<class U>
-		friend Matrix
-		operator* (const Matrix<U>& v, const U& x)
-		{
-			Matrix<U> u (v.rows_, v.cols_);
-			for (size_t i = 0; i < v.size_; ++i)
-				u.data_[i] = v.data_[i] * x;
-			return u;
-		}
-
-		template<class U>
-		friend Matrix
-		operator* (const U& x, const Matrix<U>& v)
-		{
-			Matrix<U> u (v.rows_, v.cols_);
-			for (size_t i = 0; i < v.size_; ++i)
-				u.data_[i] = x * v.data_[i];
-			return u;
-		}
-
-		template<class U>
-		friend Matrix
-		operator/ (const Matrix<U>& v, const U& x)
-		{
-			Matrix<U> u (v.rows_, v.cols_);
-			for (size_t i = 0; i < v.size_; ++i)
-				u.data_[i] = v.data_[i] / x;
-			return u;
-		}
-
-		template<class U>
-		friend Matrix
-		operator/ (const U& x, const Matrix<U>& v)
-		{
-			Matrix<U> u (v.rows_, v.cols_);
-			for (size_t i = 0; i < v.size_; ++i)
-				u.data_[i] = x / v.data_[i];
-			return u;
-		}
-
-		template<class U>
-		friend Matrix
-		operator% (const Matrix<U>& v, const U& x)
-		{
-			Matrix<U> u (v.rows_, v.cols_);
-			for (size_t i = 0; i < v.size_; ++i)
-				u.data_[i] = v.data_[i] % x;
-			return u;
-		}
-
-		template<class U>
-		friend Matrix
-		operator% (const U& x, const Matrix<U>& v)
-		{
-			Matrix<U> u (v.rows_, v.cols_);
-			for (size_t i = 0; i < v.size_; ++i)
-				u.data_[i] = x % v.data_[i];
-			return u;
-		}
-
-		template <class U>
-		friend Matrix
-		operator* (const Matrix<U>& a, const Matrix<U>& b)
-		{
-			assert (a.cols_ == b.rows_);
-			Matrix m (a.rows_, b.cols_);
-
-			for (size_type i = 0; i < m.rows_; ++i)
-			{
-				for (size_type j = 0; j < m.cols_; ++j)
-				{
-					T val = 0;
-					for (size_type k = 0; k < a.cols_; ++k)
-						val += a.at (i, k) * b.at (k, j);
-					m.at (i ,j) = val;
-				}
-			}
-			return m;
-		}
-
-		template <class U>
-		friend Vector<U>
-		operator* (const Matrix<U>& a, const Vector<U>& b)
-		{
-			assert(a.cols_ == b.size ());
-			Vector<U> v (a.rows_);
-
-			for (size_type i = 0; i < a.rows_; ++i)
-			{
-				T val = 0;
-				for (size_type k = 0; k < a.cols_; ++k)
-					val += a.at (i, k) * b[k];
-				v[i] = val;
-			}
-
-			return v;
-		}
-
-		template <class U>
-		friend Vector<U>
-		operator* (const Vector<U>& a, const Matrix<U>& b)
-		{
-			assert(a.size () == b.rows_);
-			Vector<U> v (b.cols_);
-
-			for (size_type j = 0; j < b.cols_; ++j)
-			{
-				T val = 0;
-				for (size_type k = 0; k < b.rows_; ++k)
-					val += a[k] * b.at (k, j);
-				v[j] = val;
-			}
-
-			return v;
-		}
-
 		void
 		row_swap(size_type r1, size_type r2)
 	   	{
@@ -918,7 +839,7 @@ namespace opl
 		project_along_get (const Matrix& v) const
 		{
 		    assert (rows_ == v.rows_ && cols_ == v.cols_);
-			Matrix res (size_);
+			Matrix res (rows_, cols_);
 			algo::project_along (data_, data_ + size_, v.data_, res.data_);
 			return res;
 	   	}
@@ -1309,6 +1230,32 @@ namespace opl
 			return algo::interquartile_range (begin_row (r), end_row (r));
 		}
 
+		///Median of every row, the rows share one copy buffer per thread
+		Vector<T>
+		rows_median () const
+		{
+			Vector<T> res (rows_);
+			parallel::for_range (rows_, size_, [&](size_type i0, size_type i1) {
+					std::vector<T> buf;
+					for (size_type i = i0; i < i1; ++i)
+						res[i] = algo::median (begin_row (i), end_row (i), buf);
+				});
+			return res;
+		}
+
+		Vector<T>
+		rows_interquartile_range () const
+		{
+			Vector<T> res (rows_);
+			parallel::for_range (rows_, size_, [&](size_type i0, size_type i1) {
+					std::vector<T> buf;
+					for (size_type i = i0; i < i1; ++i)
+						res[i] = algo::interquartile_range (begin_row (i),
+															end_row (i), buf);
+				});
+			return res;
+		}
+
 		T
 		row_mode (size_type r) const
 		{
@@ -1644,6 +1591,32 @@ namespace opl
 			return algo::interquartile_range (begin_col (c), end_col (c));
 		}
 
+		///Median of every column, the columns share one copy buffer per thread
+		Vector<T>
+		cols_median () const
+		{
+			Vector<T> res (cols_);
+			parallel::for_range (cols_, size_, [&](size_type j0, size_type j1) {
+					std::vector<T> buf;
+					for (size_type j = j0; j < j1; ++j)
+						res[j] = algo::median (begin_col (j), end_col (j), buf);
+				});
+			return res;
+		}
+
+		Vector<T>
+		cols_interquartile_range () const
+		{
+			Vector<T> res (cols_);
+			parallel::for_range (cols_, size_, [&](size_type j0, size_type j1) {
+					std::vector<T> buf;
+					for (size_type j = j0; j < j1; ++j)
+						res[j] = algo::interquartile_range (begin_col (j),
+															end_col (j), buf);
+				});
+			return res;
+		}
+
 		T
 		col_mode (size_type c) const
 		{
@@ -2371,6 +2344,24 @@ namespace opl
 		typedef std::reverse_iterator<range_iterator> reverse_range_iterator;
 		typedef std::reverse_iterator<const_range_iterator> const_reverse_range_iterator;
 
+		///Rows are contiguous in row-major storage, columns in column-major
+		typedef std::conditional_t<O == StorageOrder::row_major,
+								   iterator, range_iterator> row_iterator;
+		typedef std::conditional_t<O == StorageOrder::row_major,
+								   const_iterator, const_range_iterator>
+		const_row_iterator;
+		typedef std::conditional_t<O == StorageOrder::col_major,
+								   iterator, range_iterator> col_iterator;
+		typedef std::conditional_t<O == StorageOrder::col_major,
+								   const_iterator, const_range_iterator>
+		const_col_iterator;
+		typedef std::reverse_iterator<row_iterator> reverse_row_iterator;
+		typedef std::reverse_iterator<const_row_iterator>
+		const_reverse_row_iterator;
+		typedef std::reverse_iterator<col_iterator> reverse_col_iterator;
+		typedef std::reverse_iterator<const_col_iterator>
+		const_reverse_col_iterator;
+
 
 		class region_iterator
 		{
@@ -2820,174 +2811,182 @@ namespace opl
 		}
 
 
-		iterator
+		row_iterator
 		begin_row (size_type row)
 		{
 			assert (row < rows_);
-			return iterator (data_ + row * cols_);
+			return line_<row_iterator> (data_ + row * row_stride (),
+										col_stride ());
 		}
 
-		const_iterator
+		const_row_iterator
 		begin_row (size_type row) const
 		{
-			assert(row < rows_);
-			return const_iterator (data_ + row * cols_);
+			assert (row < rows_);
+			return line_<const_row_iterator> (data_ + row * row_stride (),
+											  col_stride ());
 		}
 
-		const_iterator
+		const_row_iterator
 		cbegin_row (size_type row) const
 		{
-			assert(row < rows_);
-			return const_iterator (data_ + row * cols_);
+			assert (row < rows_);
+			return begin_row (row);
 		}
 
-		iterator
+		row_iterator
 		end_row (size_type row)
 		{
-			assert(row < rows_);
-			return iterator (data_ + (row + 1) * cols_);
+			assert (row < rows_);
+			T* end = data_ + row * row_stride () + cols_ * col_stride ();
+			return line_<row_iterator> (end, col_stride ());
 		}
 
-		const_iterator
+		const_row_iterator
 		end_row (size_type row) const
 		{
-			assert(row < rows_);
-			return const_iterator (data_ + (row + 1) * cols_);
+			assert (row < rows_);
+			T* end = data_ + row * row_stride () + cols_ * col_stride ();
+			return line_<const_row_iterator> (end, col_stride ());
 		}
 
-		const_iterator
+		const_row_iterator
 		cend_row (size_type row) const
 		{
-			assert(row < rows_);
-			return const_iterator (data_ + (row + 1) * cols_);
+			assert (row < rows_);
+			return end_row (row);
 		}
 
-		reverse_iterator
+		reverse_row_iterator
 		rbegin_row (size_type row)
 		{
-			assert(row < rows_);
-			return reverse_iterator (data_ + (row + 1) * cols_);
+			assert (row < rows_);
+			return reverse_row_iterator (end_row (row));
 		}
 
-		const_reverse_iterator
+		const_reverse_row_iterator
 		rbegin_row (size_type row) const
 		{
-			assert(row < rows_);
-			return const_reverse_iterator (data_ + (row + 1) * cols_);
+			assert (row < rows_);
+			return const_reverse_row_iterator (end_row (row));
 		}
 
-		const_reverse_iterator
+		const_reverse_row_iterator
 		crbegin_row (size_type row) const
 		{
-			assert(row < rows_);
-			return const_reverse_iterator (data_ + (row + 1) * cols_);
+			assert (row < rows_);
+			return rbegin_row (row);
 		}
 
-		reverse_iterator
+		reverse_row_iterator
 		rend_row (size_type row)
 		{
-			assert(row < rows_);
-			return reverse_iterator (data_ + row * cols_);
+			assert (row < rows_);
+			return reverse_row_iterator (begin_row (row));
 		}
 
-		const_reverse_iterator
+		const_reverse_row_iterator
 		rend_row (size_type row) const
 		{
-			assert(row < rows_);
-			return const_reverse_iterator (data_ + row * cols_);
+			assert (row < rows_);
+			return const_reverse_row_iterator (begin_row (row));
 		}
 
-		const_reverse_iterator
+		const_reverse_row_iterator
 		crend_row (size_type row) const
 		{
-			assert(row < rows_);
-			return const_reverse_iterator (data_ + row * cols_);
+			assert (row < rows_);
+			return rend_row (row);
 		}
 
 
 
-		range_iterator
+		col_iterator
 		begin_col (size_type col)
 		{
 			assert (col < cols_);
-			return range_iterator (data_ + col, cols_);
+			return line_<col_iterator> (data_ + col * col_stride (),
+										row_stride ());
 		}
 
-		const_range_iterator
+		const_col_iterator
 		begin_col (size_type col) const
 		{
 			assert (col < cols_);
-			return const_range_iterator (data_ + col, cols_);
+			return line_<const_col_iterator> (data_ + col * col_stride (),
+											  row_stride ());
 		}
 
-		const_range_iterator
+		const_col_iterator
 		cbegin_col (size_type col) const
 		{
 			assert (col < cols_);
-			return const_range_iterator (data_ + col, cols_);
+			return begin_col (col);
 		}
 
-		range_iterator
+		col_iterator
 		end_col (size_type col)
 		{
 			assert (col < cols_);
-			return range_iterator (data_ + col + size_, cols_);
+			T* end = data_ + col * col_stride () + rows_ * row_stride ();
+			return line_<col_iterator> (end, row_stride ());
 		}
 
-		const_range_iterator
+		const_col_iterator
 		end_col (size_type col) const
 		{
 			assert (col < cols_);
-			return const_range_iterator (data_ + col + size_, cols_);
+			T* end = data_ + col * col_stride () + rows_ * row_stride ();
+			return line_<const_col_iterator> (end, row_stride ());
 		}
 
-		const_range_iterator
+		const_col_iterator
 		cend_col (size_type col) const
 		{
 			assert (col < cols_);
-			return const_range_iterator (data_ + col + size_, cols_);
+			return end_col (col);
 		}
 
-		reverse_range_iterator
+		reverse_col_iterator
 		rbegin_col (size_type col)
 		{
 			assert (col < cols_);
-			return reverse_range_iterator (end_col (col));
+			return reverse_col_iterator (end_col (col));
 		}
 
-		const_reverse_range_iterator
+		const_reverse_col_iterator
 		rbegin_col (size_type col) const
 		{
 			assert (col < cols_);
-			return const_reverse_range_iterator (cend_col (col));
+			return const_reverse_col_iterator (end_col (col));
 		}
 
-		const_reverse_range_iterator
+		const_reverse_col_iterator
 		crbegin_col (size_type col) const
 		{
 			assert (col < cols_);
-			return const_reverse_range_iterator (cend_col (col));
+			return rbegin_col (col);
 		}
 
-		reverse_range_iterator
+		reverse_col_iterator
 		rend_col (size_type col)
 		{
 			assert (col < cols_);
-			return reverse_range_iterator (begin_col(col));
+			return reverse_col_iterator (begin_col (col));
 		}
 
-		const_reverse_range_iterator
+		const_reverse_col_iterator
 		rend_col (size_type col) const
 		{
 			assert (col < cols_);
-			return const_reverse_range_iterator (cbegin_col (col));
+			return const_reverse_col_iterator (begin_col (col));
 		}
 
-		const_reverse_range_iterator
+		const_reverse_col_iterator
 		crend_col (size_type col) const
 		{
 			assert (col < cols_);
-			return const_reverse_range_iterator (cbegin_col (col));
+			return rend_col (col);
 		}
 
 
@@ -3357,10 +3356,17 @@ namespace opl
 		//QR Decompositon
 
 		///Computes the QR decomposition using Householder projectors
+		///QrFactor (qr-factor.hh) keeps the factorization without forming Q
 		void
 		householder_qr_decomposition(Matrix &q, Matrix &r) const;
 
-		///Computes the shur Decompodition A = UTU*
+		///Computes the Hessenberg decomposition A = UHU*
+		void
+		hessenberg_decomposition (Matrix &u, Matrix &h) const;
+
+		///Computes the real shur Decompodition A = UTU*
+		///T is upper triangular, but for a 2x2 diagonal block
+		///per pair of complex eigeinvalues
 		void
 		qr_algorithm (Matrix &u, Matrix &t) const;
 
@@ -3373,11 +3379,11 @@ namespace opl
 		qr_solve_system (const Vector<T>& b) const;
 
 		///Returns X: MX = B using Householder QR decompositon
-		Matrix<T>
-		qr_solve_systems (const Matrix<T>& b) const;
+		Matrix
+		qr_solve_systems (const Matrix& b) const;
 
 		///Computes the inverse of M using Householder QR decomposition
-		Matrix<T>
+		Matrix
 		qr_inverse () const;
 
 		///Compute the least squares solution with M full rank
@@ -3394,9 +3400,19 @@ namespace opl
 		inverse_iteration (const T& value) const;
 
 		///Computes eigeinvalues and eigeinvectors
+		///A symmetric M gives decreasing values and orthonormal vectors
+		///Complex eigeinvalues only get their real part and a null vector
 		void
 		qr_eigein (Vector<T>& vals, varr_type& vects) const;
 
+		///Computes eigeinvalues only, decreasing if M is symmetric
+		Vector<T>
+		qr_eigein_values () const;
+
+		///Computes eigeinvalues only, as re + i im
+		void
+		qr_eigein_values (Vector<T>& re, Vector<T>& im) const;
+
 
 
 
@@ -3413,11 +3429,11 @@ namespace opl
 		cholesky_solve_system (const Vector<T>& b) const;
 
 		///Returns X: MX = B using cholesky decomposition
-		Matrix<T>
-		cholesky_solve_systems (const Matrix<T>& b) const;
+		Matrix
+		cholesky_solve_systems (const Matrix& b) const;
 
 		///Computes the inverse of M using cholesky decomposition
-		Matrix<T>
+		Matrix
 		cholesky_inverse () const;
 
 		///Returns det(M) using cholesky decomposition
@@ -3432,7 +3448,8 @@ namespace opl
 		lu_decomposition (Matrix& l, Matrix &u) const;
 
 
-		///Returns the number of rows permutations
+		///PM = LU, returns the number of rows permutations
+		///PluFactor (plu-factor.hh) keeps the factorization for reuse
 		size_type
 		plu_decomposition (Matrix& p, Matrix &l, Matrix& u) const;
 
@@ -3445,15 +3462,62 @@ namespace opl
 		plu_solve_system (const Vector<T>& b) const;
 
 		///Returns X: MX = B using the PLU decomposition
-		Matrix<T>
-		plu_solve_systems (const Matrix<T>& b) const;
+		Matrix
+		plu_solve_systems (const Matrix& b) const;
+
+		///Returns x: Mx = b, M being factorized in a lower precision then
+		///x refined in T (linalg::lu_solve_mixed)
+		///Falls back to plu_solve_system if the refinement doesn't converge
+		Vector<T>
+		plu_solve_system_mixed (const Vector<T>& b) const;
+
+		///Returns X: MX = B, as plu_solve_system_mixed
+		Matrix
+		plu_solve_systems_mixed (const Matrix& b) const;
 
 		///Comptes the inverse of M using the PLU decomposition
-		Matrix<T>
+		Matrix
 		plu_inverse () const;
 
 
 
+		//Singular value decomposition
+
+		///Thin SVD M = U diag(s) V^T by one-sided Jacobi rotations
+		///s is decreasing, U is m x r and V is n x r, r = min(m, n)
+		///Returns false if the rotations didn't converge
+		bool
+		svd (Matrix& u, Vector<T>& s, Matrix& v) const;
+
+		///Singular values, decreasing
+		///Asserts that the rotations converged
+		Vector<T>
+		svd_values () const;
+
+		///k largest singular triplets, by randomized SVD: much cheaper
+		///than svd when k is small, exact if M has rank <= k
+		///Returns false if the rotations didn't converge
+		bool
+		svd_truncated (size_type k, Matrix& u, Vector<T>& s, Matrix& v,
+					   size_type power = OPL_SVD_POWER_ITERATIONS) const;
+
+		///Moore-Penrose pseudo-inverse (n x m)
+		///Singular values under tol * s_max are taken as null, a negative
+		///tol stands for max(m, n) epsilon
+		Matrix
+		pseudo_inverse (T tol = -1) const;
+
+		///Least squares solution of minimum norm, M of any rank and shape
+		Vector<T>
+		svd_least_squares (const Vector<T>& b) const;
+
+		///Closest matrix of rank k (Eckart-Young), from the k first
+		///singular triplets of svd, or of svd_truncated if randomized
+		Matrix
+		low_rank_approximation (size_type k, bool randomized = false) const;
+
+
+
 
 
 
@@ -3463,20 +3527,59 @@ namespace opl
 		size_type rows_;
 		size_type cols_;
 		size_type size_;
+		size_type capacity_;
 
-		size_type
-		gauss_count_rank () const;
+		using storage_type_ = Storage<T>;
 
+		///Copies n values given in row-major order
+		template <class It>
 		void
-		householder_update_q (const Vector<T>& v, size_type n, size_type col);
+		copy_rows_ (It begin, size_type n);
 
+		///Calls op (at (i, j), e (i, j)) for all values, in a single loop
+		template <class E, class Op>
 		void
-		householder_update_r (const Vector<T>& v, size_type n, size_type p,
-							  size_type col);
+		evaluate_ (const E& e, Op op);
+
+		///Iterator on a row or a column, the plain iterators of contiguous
+		///lines ignore the stride
+		template <class It>
+		static It
+		line_ (T* ptr, size_type stride)
+		{
+			return line_ (ptr, stride, static_cast<It*> (nullptr));
+		}
+
+		static iterator
+		line_ (T* ptr, size_type, iterator*)
+		{
+			return iterator (ptr);
+		}
+
+		static const_iterator
+		line_ (T* ptr, size_type, const_iterator*)
+		{
+			return const_iterator (ptr);
+		}
+
+		static range_iterator
+		line_ (T* ptr, size_type stride, range_iterator*)
+		{
+			return range_iterator (ptr, stride);
+		}
+
+		static const_range_iterator
+		line_ (T* ptr, size_type stride, const_range_iterator*)
+		{
+			return const_range_iterator (ptr, stride);
+		}
+
+		size_type
+		gauss_count_rank () const;
 
-		static T
-		plu_get_determinant (const Matrix& u, size_type parity);
 
+		template <class U, StorageOrder P>
+		friend class Matrix;
 
 		friend class SerialManager<Matrix>;
 
@@ -3488,11 +3591,15 @@ namespace opl
 	using nmat_type = Matrix<n_type>;
 
 	template <class T>
-	class SerialManager<Matrix<T>>
+	using ColMatrix = Matrix<T, StorageOrder::col_major>;
+
+	///The values are written in the storage order of the matrix
+	template <class T, StorageOrder O>
+	class SerialManager<Matrix<T, O>>
 	{
 	public:
 		static void
-		pack (std::ostream& os, const Matrix<T>& data)
+		pack (std::ostream& os, const Matrix<T, O>& data)
 		{
 			serialize (os, data.rows_);
 			serialize (os, data.cols_);
@@ -3500,21 +3607,21 @@ namespace opl
 					  data.size_ * sizeof (T));
 		}
 
-		static Matrix<T>
+		static Matrix<T, O>
 		unpack (std::istream& is)
 		{
 			size_t rows = unserialize <size_t> (is);
 			size_t cols = unserialize <size_t> (is);
-			Matrix<T> m (rows, cols);
+			Matrix<T, O> m (rows, cols);
 			is.read (reinterpret_cast<char *> ( m.data_),
 					 m.size_ * sizeof (T));
 			return m;
 		}
 	};
 
-	template <class T>
-	Matrix<T>
-	Matrix<T>::id (size_type size)
+	template <class T, StorageOrder O>
+	Matrix<T, O>
+	Matrix<T, O>::id (size_type size)
 	{
 		Matrix m (size, size, static_cast<T> (0));
 		for (size_type i = 0; i < size; ++i)
@@ -3522,30 +3629,30 @@ namespace opl
 		return m;
 	}
 
-	template <class T>
-	Matrix<T>
-	Matrix<T>::null (size_type rows, size_type cols)
+	template <class T, StorageOrder O>
+	Matrix<T, O>
+	Matrix<T, O>::null (size_type rows, size_type cols)
 	{
 		return Matrix (rows, cols, static_cast<T> (0));
 	}
 
-	template <class T>
-	Matrix<T>
-	Matrix<T>::from_row_vector (const Vector<T>& v)
+	template <class T, StorageOrder O>
+	Matrix<T, O>
+	Matrix<T, O>::from_row_vector (const Vector<T>& v)
 	{
 		return Matrix (1, v.size_, v.data_);
 	}
 
-	template <class T>
-	Matrix<T>
-    Matrix<T>::from_col_vector (const Vector<T>& v)
+	template <class T, StorageOrder O>
+	Matrix<T, O>
+    Matrix<T, O>::from_col_vector (const Vector<T>& v)
 	{
 		return Matrix (v.size_, 1, v.data_);
 	}
 
-	template <class T>
-    Matrix<T>
-	Matrix<T>::from_rows_vectors (const varr_type& rows)
+	template <class T, StorageOrder O>
+    Matrix<T, O>
+	Matrix<T, O>::from_rows_vectors (const varr_type& rows)
 	{
 		if (rows.empty())
 			return Matrix {};
@@ -3559,9 +3666,9 @@ namespace opl
 		return m;
 	}
 
-	template <class T>
-	Matrix<T>
-	Matrix<T>::from_cols_vectors (const varr_type& cols)
+	template <class T, StorageOrder O>
+	Matrix<T, O>
+	Matrix<T, O>::from_cols_vectors (const varr_type& cols)
 	{
 		if (cols.empty())
 			return Matrix {};
@@ -3575,252 +3682,402 @@ namespace opl
 		return m;
 	}
 
-	template <class T>
+	template <class T, StorageOrder O>
 	template <class It>
-	Matrix<T>
-	Matrix<T>::from_row (It begin, It end)
+	Matrix<T, O>
+	Matrix<T, O>::from_row (It begin, It end)
 	{
 		return Matrix (1, end - begin, begin);
 	}
 
-	template <class T>
+	template <class T, StorageOrder O>
 	template <class It>
-	Matrix<T>
-	Matrix<T>::from_col (It begin, It end)
+	Matrix<T, O>
+	Matrix<T, O>::from_col (It begin, It end)
 	{
 		return Matrix (end - begin, 1, begin);
 	}
 
-	template <class T>
-	Matrix<T>::Matrix (size_type rows, size_type cols)
-		: rows_ (rows), cols_ (cols), size_ (rows * cols)
+	template <class T, StorageOrder O>
+	Matrix<T, O>::Matrix (size_type rows, size_type cols)
+		: rows_ (rows), cols_ (cols), size_ (rows * cols), capacity_ (size_)
 	{
-		data_ = new T[size_];
+		data_ = storage_type_::allocate (size_);
 	}
 
-	template <class T>
-	Matrix<T>::Matrix (size_type rows, size_type cols, const T& x)
+	template <class T, StorageOrder O>
+	Matrix<T, O>::Matrix (size_type rows, size_type cols, const T& x)
 		: Matrix (rows, cols)
 	{
 		std::fill (data_, data_ + size_, x);
 	}
 
-	template <class T>
+	template <class T, StorageOrder O>
 	template <class It>
-	Matrix<T>::Matrix (size_type rows, size_type cols, It begin)
+	Matrix<T, O>::Matrix (size_type rows, size_type cols, It begin)
 		: Matrix (rows, cols)
 	{
-		std::copy_n (begin, size_, data_);
+		copy_rows_ (begin, size_);
 	}
 
-	template <class T>
-	Matrix<T>::Matrix (size_type rows, size_type cols,
+	template <class T, StorageOrder O>
+	template <StorageOrder P>
+	Matrix<T, O>::Matrix (const Matrix<T, P>& v)
+		: Matrix (v.rows_, v.cols_)
+	{
+		if (O == P)
+			storage_type_::copy (v.data_, size_, data_);
+		else if (O == StorageOrder::col_major)
+			linalg::transpose (rows_, cols_, v.data_, cols_, data_, rows_);
+		else
+			linalg::transpose (cols_, rows_, v.data_, rows_, data_, cols_);
+	}
+
+	template <class T, StorageOrder O>
+	Matrix<T, O>::Matrix (size_type rows, size_type cols,
 					   std::initializer_list<T> list)
 		: Matrix (rows, cols, list.begin ())
 	{
 
 	}
 
-	template <class T>
-	Matrix<T>::Matrix (const Matrix& v)
-		: Matrix(v.rows_, v.cols_, v.data_)
+	template <class T, StorageOrder O>
+	Matrix<T, O>::Matrix (const Matrix& v)
+		: Matrix (v.rows_, v.cols_)
+	{
+		storage_type_::copy (v.data_, size_, data_);
+	}
+
+	template <class T, StorageOrder O>
+	Matrix<T, O>::Matrix (Matrix&& v) noexcept
+		: data_ (v.data_), rows_ (v.rows_), cols_ (v.cols_), size_ (v.size_)
+		, capacity_ (v.capacity_)
 	{
+		v.data_ = nullptr;
+		v.rows_ = 0;
+		v.cols_ = 0;
+		v.size_ = 0;
+		v.capacity_ = 0;
+	}
 
+	template <class T, StorageOrder O>
+	template <class E>
+	Matrix<T, O>::Matrix (const MatrixExpr<E, T>& e)
+		: Matrix (e.rows (), e.cols ())
+	{
+		evaluate_ (e.self (), [](T& x, const T& y) { x = y; });
 	}
 
-	template <class T>
-	Matrix<T>::~Matrix ()
+	template <class T, StorageOrder O>
+	Matrix<T, O>::~Matrix ()
 	{
-		delete data_;
+		storage_type_::deallocate (data_);
 	}
 
-	template <class T>
-	Matrix<T>&
-	Matrix<T>::operator= (const T& x)
+	template <class T, StorageOrder O>
+	Matrix<T, O>&
+	Matrix<T, O>::operator= (const T& x)
 	{
 		assign (x);
 		return *this;
 	}
 
-	template <class T>
-	Matrix<T>&
-	Matrix<T>::operator= (const Matrix& v)
+	template <class T, StorageOrder O>
+	Matrix<T, O>&
+	Matrix<T, O>::operator= (const Matrix& v)
 	{
-		assign (v);
+		if (this != &v)
+			assign (v);
 		return *this;
 	}
 
-	template <class T>
-	Matrix<T>&
-	Matrix<T>::operator= (std::initializer_list<T> list)
+	template <class T, StorageOrder O>
+	Matrix<T, O>&
+	Matrix<T, O>::operator= (Matrix&& v) noexcept
+	{
+		swap (v);
+		return *this;
+	}
+
+	template <class T, StorageOrder O>
+	Matrix<T, O>&
+	Matrix<T, O>::operator= (std::initializer_list<T> list)
 	{
 		assign (list);
 		return *this;
 	}
 
-	template <class T>
-	void
-	Matrix<T>::assign (const T& x)
+	template <class T, StorageOrder O>
+	template <class E>
+	Matrix<T, O>&
+	Matrix<T, O>::operator= (const MatrixExpr<E, T>& e)
 	{
-		std::fill (data_, data_ + size_, x);
+		assign (e);
+		return *this;
 	}
 
-	template <class T>
+	template <class T, StorageOrder O>
 	void
-	Matrix<T>::assign (size_type rows, size_type cols, const T& x)
+	Matrix<T, O>::assign (const T& x)
+	{
+		std::fill (data_, data_ + size_, x);
+	}
+
+	template <class T, StorageOrder O>
+	void
+	Matrix<T, O>::assign (size_type rows, size_type cols, const T& x)
 	{
 		resize (rows, cols, x);
 	}
 
-	template <class T>
+	template <class T, StorageOrder O>
 	void
-	Matrix<T>::assign (const Matrix& v)
+	Matrix<T, O>::assign (const Matrix& v)
 	{
 		resize (v.rows_, v.cols_);
-		std::copy_n (v.data_, size_, data_);
+		storage_type_::copy (v.data_, size_, data_);
 	}
 
-	template <class T>
+	template <class T, StorageOrder O>
 	void
-	Matrix<T>::assign (std::initializer_list<T> list)
+	Matrix<T, O>::assign (std::initializer_list<T> list)
 	{
-		std::copy (list.begin (), list.end (), data_);
+		copy_rows_ (list.begin (), list.size ());
 	}
 
-	template <class T>
+	template <class T, StorageOrder O>
+	template <class E>
 	void
-	Matrix<T>::assign (size_type rows, size_type cols,
+	Matrix<T, O>::assign (const MatrixExpr<E, T>& e)
+	{
+		const E& expr = e.self ();
+		resize (expr.rows (), expr.cols ());
+		evaluate_ (expr, [](T& x, const T& y) { x = y; });
+	}
+
+	template <class T, StorageOrder O>
+	void
+	Matrix<T, O>::assign (size_type rows, size_type cols,
 					   std::initializer_list<T> list)
 	{
 		resize (rows, cols);
-		std::copy (list.begin (), list.end (), data_);
+		copy_rows_ (list.begin (), list.size ());
 	}
 
-	template <class T>
+	template <class T, StorageOrder O>
 	template <class It>
 	void
-	Matrix<T>::assign (It begin, It end)
+	Matrix<T, O>::assign (It begin, It end)
 	{
-		std::copy (begin, end, data_);
+		copy_rows_ (begin, std::distance (begin, end));
 	}
 
-	template <class T>
+	template <class T, StorageOrder O>
 	template <class It>
 	void
-	Matrix<T>::assign (size_type rows, size_type cols, It begin)
+	Matrix<T, O>::assign (size_type rows, size_type cols, It begin)
 	{
 		resize (rows, cols);
-		std::copy_n (begin, size_, data_);
+		copy_rows_ (begin, size_);
 	}
 
-    template <class T>
+    template <class T, StorageOrder O>
 	void
-	Matrix<T>::resize (size_type rows, size_type cols)
+	Matrix<T, O>::resize (size_type rows, size_type cols)
 	{
 		size_type n = rows * cols;
-		if(n != size_)
+		if (n > capacity_)
 		{
-			delete data_;
-			data_ = new T[n];
-			size_ = n;
+			storage_type_::deallocate (data_);
+			data_ = nullptr;
+			capacity_ = 0;
+			data_ = storage_type_::allocate (n);
+			capacity_ = n;
 		}
+		size_ = n;
 		rows_ = rows;
 		cols_ = cols;
 	}
 
-	template <class T>
+	template <class T, StorageOrder O>
 	void
-	Matrix<T>::resize (size_type rows, size_type cols, const T& x)
+	Matrix<T, O>::resize (size_type rows, size_type cols, const T& x)
 	{
 		resize (rows, cols);
 		std::fill (data_, data_ + size_, x);
 	}
 
-	template <class T>
-	typename Matrix<T>::size_type
-	Matrix<T>::rows () const
+	template <class T, StorageOrder O>
+	void
+	Matrix<T, O>::reserve (size_type n)
+	{
+		if (n <= capacity_)
+			return;
+		data_ = storage_type_::reallocate (data_, size_, n);
+		capacity_ = n;
+	}
+
+	template <class T, StorageOrder O>
+	void
+	Matrix<T, O>::shrink_to_fit ()
+	{
+		if (size_ == capacity_)
+			return;
+		data_ = storage_type_::reallocate (data_, size_, size_);
+		capacity_ = size_;
+	}
+
+	template <class T, StorageOrder O>
+	typename Matrix<T, O>::size_type
+	Matrix<T, O>::rows () const
 	{
 		return rows_;
 	}
 
-	template <class T>
-	typename Matrix<T>::size_type
-	Matrix<T>::cols () const
+	template <class T, StorageOrder O>
+	typename Matrix<T, O>::size_type
+	Matrix<T, O>::cols () const
 	{
 		return cols_;
 	}
 
-	template <class T>
-	typename Matrix<T>::size_type
-	Matrix<T>::size () const
+	template <class T, StorageOrder O>
+	typename Matrix<T, O>::size_type
+	Matrix<T, O>::size () const
 	{
 		return size_;
 	}
 
+	template <class T, StorageOrder O>
+	typename Matrix<T, O>::size_type
+	Matrix<T, O>::capacity () const
+	{
+		return capacity_;
+	}
 
-	template <class T>
+
+	template <class T, StorageOrder O>
 	bool
-	Matrix<T>::empty () const
+	Matrix<T, O>::empty () const
 	{
 		return !size_;
 	}
 
-	template <class T>
-	typename Matrix<T>::reference
-	Matrix<T>::at (size_type i, size_type j)
+	template <class T, StorageOrder O>
+	typename Matrix<T, O>::reference
+	Matrix<T, O>::at (size_type i, size_type j)
 	{
 		assert(i < rows_);
 		assert(j < cols_);
-		return data_[i * cols_ + j];
+		return data_[i * row_stride () + j * col_stride ()];
 	}
 
-	template <class T>
-	typename Matrix<T>::const_reference
-	Matrix<T>::at (size_type i, size_type j) const
+	template <class T, StorageOrder O>
+	typename Matrix<T, O>::const_reference
+	Matrix<T, O>::at (size_type i, size_type j) const
 	{
 		assert(i < rows_);
 		assert(j < cols_);
-		return data_[i * cols_ + j];
+		return data_[i * row_stride () + j * col_stride ()];
 	}
 
-	template <class T>
+	template <class T, StorageOrder O>
 	T*
-	Matrix<T>::data ()
+	Matrix<T, O>::data ()
 	{
 		return data_;
 	}
 
-	template <class T>
+	template <class T, StorageOrder O>
 	const T*
-	Matrix<T>::data () const
+	Matrix<T, O>::data () const
 	{
 		return data_;
 	}
 
-	template <class T>
+	template <class T, StorageOrder O>
+	typename Matrix<T, O>::size_type
+	Matrix<T, O>::row_stride () const
+	{
+		return O == StorageOrder::row_major ? cols_ : 1;
+	}
+
+	template <class T, StorageOrder O>
+	typename Matrix<T, O>::size_type
+	Matrix<T, O>::col_stride () const
+	{
+		return O == StorageOrder::row_major ? 1 : rows_;
+	}
+
+	template <class T, StorageOrder O>
+	void
+	Matrix<T, O>::swap (Matrix& v)
+	{
+		std::swap (data_, v.data_);
+		std::swap (rows_, v.rows_);
+		std::swap (cols_, v.cols_);
+		std::swap (size_, v.size_);
+		std::swap (capacity_, v.capacity_);
+	}
+
+	template <class T, StorageOrder O>
+	template <class It>
 	void
-	Matrix<T>::swap (Matrix& v)
+	Matrix<T, O>::copy_rows_ (It begin, size_type n)
 	{
-		if (v.rows_ != rows_ || v.cols_ != cols_)
+		if (O == StorageOrder::row_major)
 		{
-			Matrix temp = v;
-			v.assign (*this);
-			assign (temp);
+			std::copy_n (begin, n, data_);
+			return;
 		}
-		else
-			std::swap_ranges (data_, data_ + size_, v.data_);
+		for (size_type k = 0; k < n; ++k, ++begin)
+			data_[k % cols_ * rows_ + k / cols_] = *begin;
 	}
 
-	template <class T>
+	template <class T, StorageOrder O>
+	template <class E, class Op>
+	void
+	Matrix<T, O>::evaluate_ (const E& e, Op op)
+	{
+		const auto& expr = ExprOperand<E>::get (e);
+		if (O == StorageOrder::row_major)
+		{
+			evaluate_into (expr, data_, op);
+			return;
+		}
+
+		if (expr.aliases (ExprTarget<T> (data_, rows_, cols_, 1, rows_)))
+		{
+			std::vector<T> tmp = evaluate_copy_ (expr);
+			evaluate_ (DenseExpr<MatrixExpr, T> (tmp.data (), rows_, cols_), op);
+			return;
+		}
+
+		//Column by column, e is read with a stride
+		T* data = data_;
+		size_type rows = rows_;
+		size_type cols = cols_;
+		parallel::for_range (cols, size_, [&](size_type j0, size_type j1) {
+				for (size_type j = j0; j < j1; ++j)
+					for (size_type i = 0; i < rows; ++i)
+						op (data[j * rows + i], expr[i * cols + j]);
+			});
+	}
+
+	template <class T, StorageOrder O>
 	Vector<T>
-	Matrix<T>::vector_get () const
+	Matrix<T, O>::vector_get () const
 	{
-		return Vector<T> (data_, data_ + size_);
+		if (O == StorageOrder::row_major)
+			return Vector<T> (data_, data_ + size_);
+		Vector<T> v (size_);
+		linalg::transpose (cols_, rows_, data_, rows_, v.data_, cols_);
+		return v;
 	}
 
-	template <class T>
+	template <class T, StorageOrder O>
 	Vector<T>
-	Matrix<T>::row_vector_get (size_type row) const
+	Matrix<T, O>::row_vector_get (size_type row) const
 	{
 		Vector<T> v (cols_);
 		for (size_type i = 0; i < cols_; ++i)
@@ -3828,9 +4085,9 @@ namespace opl
 		return v;
 	}
 
-	template <class T>
+	template <class T, StorageOrder O>
 	Vector<T>
-	Matrix<T>::col_vector_get (size_type col) const
+	Matrix<T, O>::col_vector_get (size_type col) const
 	{
 		Vector<T> v (rows_);
 		for (size_type i = 0; i < rows_; ++i)
@@ -3838,9 +4095,9 @@ namespace opl
 		return v;
 	}
 
-	template <class T>
-	typename Matrix<T>::varr_type
-	Matrix<T>::rows_vectors_get () const
+	template <class T, StorageOrder O>
+	typename Matrix<T, O>::varr_type
+	Matrix<T, O>::rows_vectors_get () const
 	{
 		varr_type arr (rows_);
 		for (size_type i = 0; i < rows_; ++i)
@@ -3848,9 +4105,9 @@ namespace opl
 		return arr;
 	}
 
-	template <class T>
-	typename Matrix<T>::varr_type
-	Matrix<T>::cols_vectors_get () const
+	template <class T, StorageOrder O>
+	typename Matrix<T, O>::varr_type
+	Matrix<T, O>::cols_vectors_get () const
 	{
 		varr_type arr (cols_);
 		for (size_type i = 0; i < cols_; ++i)
@@ -3858,27 +4115,148 @@ namespace opl
 		return arr;
 	}
 
-	template <class T>
-	Matrix<T>
-	Matrix<T>::transpose () const
+	template <class T, StorageOrder O>
+	Matrix<T, O>
+	Matrix<T, O>::transpose () const
 	{
 		Matrix m (cols_, rows_);
-		for (size_type i = 0; i < rows_; ++i)
-			for (size_type j = 0; j < cols_; ++j)
-				m.at (j, i) = at (i, j);
+		if (O == StorageOrder::row_major)
+			linalg::transpose (rows_, cols_, data_, cols_, m.data_, rows_);
+		else
+			linalg::transpose (cols_, rows_, data_, rows_, m.data_, cols_);
 		return m;
 	}
 
-	template <class T>
+	template <class T, StorageOrder O>
+	Matrix<T, O>&
+	Matrix<T, O>::transpose_in_place ()
+	{
+		if (rows_ == cols_)
+			linalg::transpose_in_place (rows_, data_, cols_);
+		else
+		{
+			Matrix m = transpose ();
+			swap (m);
+		}
+		return *this;
+	}
+
+	template <class T, StorageOrder O>
+	MatrixView<T>
+	Matrix<T, O>::view ()
+	{
+		return MatrixView<T> (data_, rows_, cols_, row_stride (),
+							  col_stride ());
+	}
+
+	template <class T, StorageOrder O>
+	MatrixView<const T>
+	Matrix<T, O>::view () const
+	{
+		return MatrixView<const T> (data_, rows_, cols_, row_stride (),
+									col_stride ());
+	}
+
+	template <class T, StorageOrder O>
+	VectorView<T>
+	Matrix<T, O>::row_view (size_type row)
+	{
+		assert (row < rows_);
+		return VectorView<T> (data_ + row * row_stride (), cols_,
+							  col_stride ());
+	}
+
+	template <class T, StorageOrder O>
+	VectorView<const T>
+	Matrix<T, O>::row_view (size_type row) const
+	{
+		assert (row < rows_);
+		return VectorView<const T> (data_ + row * row_stride (), cols_,
+									col_stride ());
+	}
+
+	template <class T, StorageOrder O>
+	VectorView<T>
+	Matrix<T, O>::col_view (size_type col)
+	{
+		assert (col < cols_);
+		return VectorView<T> (data_ + col * col_stride (), rows_,
+							  row_stride ());
+	}
+
+	template <class T, StorageOrder O>
+	VectorView<const T>
+	Matrix<T, O>::col_view (size_type col) const
+	{
+		assert (col < cols_);
+		return VectorView<const T> (data_ + col * col_stride (), rows_,
+									row_stride ());
+	}
+
+	template <class T, StorageOrder O>
+	VectorView<T>
+	Matrix<T, O>::diagonal_view ()
+	{
+		return VectorView<T> (data_, std::min (rows_, cols_),
+							  row_stride () + col_stride ());
+	}
+
+	template <class T, StorageOrder O>
+	VectorView<const T>
+	Matrix<T, O>::diagonal_view () const
+	{
+		return VectorView<const T> (data_, std::min (rows_, cols_),
+									row_stride () + col_stride ());
+	}
+
+	template <class T, StorageOrder O>
+	MatrixView<T>
+	Matrix<T, O>::region_view (size_type i, size_type j,
+						   size_type n, size_type p)
+	{
+		assert (i + n <= rows_);
+		assert (j + p <= cols_);
+		return MatrixView<T> (data_ + i * row_stride () + j * col_stride (),
+							  n, p, row_stride (), col_stride ());
+	}
+
+	template <class T, StorageOrder O>
+	MatrixView<const T>
+	Matrix<T, O>::region_view (size_type i, size_type j,
+						   size_type n, size_type p) const
+	{
+		assert (i + n <= rows_);
+		assert (j + p <= cols_);
+		return MatrixView<const T> (data_ + i * row_stride () + j * col_stride (),
+									n, p, row_stride (), col_stride ());
+	}
+
+	template <class T, StorageOrder O>
+	MatrixView<T>
+	Matrix<T, O>::transpose_view ()
+	{
+		return MatrixView<T> (data_, cols_, rows_, col_stride (),
+							  row_stride ());
+	}
+
+	template <class T, StorageOrder O>
+	MatrixView<const T>
+	Matrix<T, O>::transpose_view () const
+	{
+		return MatrixView<const T> (data_, cols_, rows_, col_stride (),
+									row_stride ());
+	}
+
+	template <class T, StorageOrder O>
 	bool
-	Matrix<T>::is_symmetric () const
+	Matrix<T, O>::is_symmetric () const
 	{
 		return rows_ == cols_ && equals (transpose ());
 	}
 
-	template<class T>
+	template<class T, StorageOrder O>
 	std::ostream&
-	operator<< (std::ostream& os, const Matrix<T>& v)
+	operator<< (std::ostream& os, const Matrix<T, O>& v)
 	{
 		os << "[";
 		for (size_t i = 0; i < v.rows_; ++i)
@@ -3896,18 +4274,18 @@ namespace opl
 		return os;
 	}
 
-	template <class T>
-	Matrix<T>&
-	Matrix<T>::operator++ ()
+	template <class T, StorageOrder O>
+	Matrix<T, O>&
+	Matrix<T, O>::operator++ ()
 	{
 		for (size_t i = 0; i < size_; ++i)
 			data_[i] += 1;
 		return *this;
 	}
 
-	template <class T>
-	Matrix<T>
-	Matrix<T>::operator++ (int)
+	template <class T, StorageOrder O>
+	Matrix<T, O>
+	Matrix<T, O>::operator++ (int)
 	{
 		Matrix temp (*this);
 		for (size_t i = 0; i < size_; ++i)
@@ -3915,18 +4293,18 @@ namespace opl
 		return temp;
 	}
 
-    template <class T>
-	Matrix<T>&
-	Matrix<T>::operator-- ()
+    template <class T, StorageOrder O>
+	Matrix<T, O>&
+	Matrix<T, O>::operator-- ()
 	{
 		for (size_t i = 0; i < size_; ++i)
 			data_[i] -= 1;
 		return *this;
 	}
 
-	template <class T>
-	Matrix<T>
-	Matrix<T>::operator-- (int)
+	template <class T, StorageOrder O>
+	Matrix<T, O>
+	Matrix<T, O>::operator-- (int)
 	{
 		Matrix temp (*this);
 		for (size_t i = 0; i < size_; ++i)
@@ -3934,102 +4312,119 @@ namespace opl
 		return temp;
 	}
 
-	template <class T>
-	Matrix<T>
-	Matrix<T>::operator- () const
+	template <class T, StorageOrder O>
+	Matrix<T, O>&
+	Matrix<T, O>::operator+= (const T& x)
 	{
-		Matrix neg (rows_, cols_);
 		for (size_t i = 0; i < size_; ++i)
-			neg.data_[i] = - data_[i];
-		return neg;
+			data_[i] += x;
+		return *this;
 	}
 
-	template <class T>
-	Matrix<T>&
-	Matrix<T>::operator+= (const T& x)
+	template <class T, StorageOrder O>
+	Matrix<T, O>&
+	Matrix<T, O>::operator+= (const Matrix& v)
 	{
-		for (size_t i = 0; i < size_; ++i)
-			data_[i] += x;
+		assert (rows_ == v.rows_ && cols_ == v.cols_);
+		evaluate_into (DenseExpr<MatrixExpr, T> (v.data_, rows_, cols_), data_,
+					   [](T& x, const T& y) { x += y; });
 		return *this;
 	}
 
-	template <class T>
-	Matrix<T>&
-	Matrix<T>::operator+= (const Matrix& v)
+	template <class T, StorageOrder O>
+	template <class E>
+	Matrix<T, O>&
+	Matrix<T, O>::operator+= (const MatrixExpr<E, T>& e)
 	{
-		assert (rows_ == v.rows_ && cols_ == v.cols_);
-		for (size_t i = 0; i < size_; ++i)
-			data_[i] += v.data_[i];
+		const E& expr = e.self ();
+		assert (rows_ == expr.rows () && cols_ == expr.cols ());
+		evaluate_ (expr, [](T& x, const T& y) { x += y; });
 		return *this;
 	}
 
-    template <class T>
-	Matrix<T>&
-	Matrix<T>::operator-= (const T& x)
+    template <class T, StorageOrder O>
+	Matrix<T, O>&
+	Matrix<T, O>::operator-= (const T& x)
 	{
 		for (size_t i = 0; i < size_; ++i)
 			data_[i] -= x;
 		return *this;
 	}
 
-	template <class T>
-	Matrix<T>&
-	Matrix<T>::operator-= (const Matrix& v)
+	template <class T, StorageOrder O>
+	Matrix<T, O>&
+	Matrix<T, O>::operator-= (const Matrix& v)
 	{
 	    assert (rows_ == v.rows_ && cols_ == v.cols_);
-		for (size_t i = 0; i < size_; ++i)
-			data_[i] -= v.data_[i];
+		evaluate_into (DenseExpr<MatrixExpr, T> (v.data_, rows_, cols_), data_,
+					   [](T& x, const T& y) { x -= y; });
+		return *this;
+	}
+
+	template <class T, StorageOrder O>
+	template <class E>
+	Matrix<T, O>&
+	Matrix<T, O>::operator-= (const MatrixExpr<E, T>& e)
+	{
+		const E& expr = e.self ();
+		assert (rows_ == expr.rows () && cols_ == expr.cols ());
+		evaluate_ (expr, [](T& x, const T& y) { x -= y; });
 		return *this;
 	}
 
-    template <class T>
-	Matrix<T>&
-	Matrix<T>::operator*= (const T& x)
+    template <class T, StorageOrder O>
+	Matrix<T, O>&
+	Matrix<T, O>::operator*= (const T& x)
 	{
 		for (size_t i = 0; i < size_; ++i)
 			data_[i] *= x;
 		return *this;
 	}
 
-	template <class T>
-	Matrix<T>&
-	Matrix<T>::operator/= (const T& x)
+	template <class T, StorageOrder O>
+	Matrix<T, O>&
+	Matrix<T, O>::operator/= (const T& x)
 	{
 		for (size_t i = 0; i < size_; ++i)
 			data_[i] /= x;
 		return *this;
 	}
 
-	template <class T>
-	Matrix<T>&
-	Matrix<T>::operator%= (const T& x)
+	template <class T, StorageOrder O>
+	Matrix<T, O>&
+	Matrix<T, O>::operator%= (const T& x)
 	{
 		for (size_t i = 0; i < size_; ++i)
 			data_[i] %= x;
 		return *this;
 	}
 
-	template <class T>
-	Matrix<T>&
-	Matrix<T>::operator*= (const Matrix& v)
+	template <class T, StorageOrder O>
+	Matrix<T, O>&
+	Matrix<T, O>::operator*= (const Matrix& v)
 	{
 		assert(cols_ == v.rows_);
-	    Matrix res = *this * v;
-		assign (res);
+		Matrix res (rows_, v.cols_);
+		linalg::gemm (rows_, v.cols_, cols_, static_cast<T> (1),
+					  data_, row_stride (), col_stride (),
+					  v.data_, v.row_stride (), v.col_stride (),
+					  static_cast<T> (0),
+					  res.data_, res.row_stride (), res.col_stride ());
+		swap (res);
 		return *this;
 	}
 
 
-	template <class T>
+	template <class T, StorageOrder O>
 	bool
-	Matrix<T>::is_id () const
+	Matrix<T, O>::is_id () const
 	{
 		return rows_ == cols_ && equals (id (rows_));
 	}
 
-	template <class T>
+	template <class T, StorageOrder O>
 	bool
-	Matrix<T>::is_inverse_of (const Matrix& m) const
+	Matrix<T, O>::is_inverse_of (const Matrix& m) const
 	{
 		return rows_ == cols_ && m.rows_ == m.cols_ && rows_ == m.rows_
 			&& (*this * m).is_id ();
@@ -4038,9 +4433,9 @@ namespace opl
 
 	//Traingular matrices
 
-	template <class T>
+	template <class T, StorageOrder O>
 	bool
-	Matrix<T>::is_lower_triangular () const
+	Matrix<T, O>::is_lower_triangular () const
 	{
 		if (rows_ != cols_)
 			return false;
@@ -4053,9 +4448,9 @@ namespace opl
 		return norm < static_cast<T> (1e-10);
 	}
 
-	template <class T>
+	template <class T, StorageOrder O>
 	bool
-	Matrix<T>::is_upper_triangular () const
+	Matrix<T, O>::is_upper_triangular () const
 	{
 		if (rows_ != cols_)
 			return false;
@@ -4068,9 +4463,9 @@ namespace opl
 		return norm < static_cast<T> (1e-10);
 	}
 
-	template <class T>
-	typename Matrix<T>::varr_type
-	Matrix<T>::lower_triangular_rows_get () const
+	template <class T, StorageOrder O>
+	typename Matrix<T, O>::varr_type
+	Matrix<T, O>::lower_triangular_rows_get () const
 	{
 		assert (rows_ == cols_);
 		varr_type rows (rows_);
@@ -4086,9 +4481,9 @@ namespace opl
 		return rows;
 	}
 
-	template <class T>
-	typename Matrix<T>::varr_type
-	Matrix<T>::lower_triangular_cols_get () const
+	template <class T, StorageOrder O>
+	typename Matrix<T, O>::varr_type
+	Matrix<T, O>::lower_triangular_cols_get () const
 	{
 		assert (rows_ == cols_);
 		varr_type cols (cols_);
@@ -4104,9 +4499,9 @@ namespace opl
 		return cols;
 	}
 
-	template <class T>
-	typename Matrix<T>::varr_type
-	Matrix<T>::upper_triangular_rows_get () const
+	template <class T, StorageOrder O>
+	typename Matrix<T, O>::varr_type
+	Matrix<T, O>::upper_triangular_rows_get () const
 	{
 		assert (rows_ == cols_);
 		varr_type rows (rows_);
@@ -4122,9 +4517,9 @@ namespace opl
 		return rows;
 	}
 
-	template <class T>
-	typename Matrix<T>::varr_type
-	Matrix<T>::upper_triangular_cols_get () const
+	template <class T, StorageOrder O>
+	typename Matrix<T, O>::varr_type
+	Matrix<T, O>::upper_triangular_cols_get () const
 	{
 		assert (rows_ == cols_);
 		varr_type cols (cols_);
@@ -4140,9 +4535,9 @@ namespace opl
 		return cols;
 	}
 
-	template <class T>
-	Matrix<T>
-	Matrix<T>::lower_triangular_from_rows (const varr_type& vals)
+	template <class T, StorageOrder O>
+	Matrix<T, O>
+	Matrix<T, O>::lower_triangular_from_rows (const varr_type& vals)
 	{
 		size_type n = vals.size ();
 		Matrix m = null (n, n);
@@ -4157,9 +4552,9 @@ namespace opl
 		return m;
 	}
 
-	template <class T>
-	Matrix<T>
-	Matrix<T>::lower_triangular_from_cols (const varr_type& vals)
+	template <class T, StorageOrder O>
+	Matrix<T, O>
+	Matrix<T, O>::lower_triangular_from_cols (const varr_type& vals)
 	{
 		size_type n = vals.size ();
 		Matrix m = null (n, n);
@@ -4174,9 +4569,9 @@ namespace opl
 		return m;
 	}
 
-	template <class T>
-	Matrix<T>
-	Matrix<T>::upper_triangular_from_rows (const varr_type& vals)
+	template <class T, StorageOrder O>
+	Matrix<T, O>
+	Matrix<T, O>::upper_triangular_from_rows (const varr_type& vals)
 	{
 		size_type n = vals.size ();
 		Matrix m = null (n, n);
@@ -4191,9 +4586,9 @@ namespace opl
 		return m;
 	}
 
-	template <class T>
-	Matrix<T>
-	Matrix<T>::upper_triangular_from_cols (const varr_type& vals)
+	template <class T, StorageOrder O>
+	Matrix<T, O>
+	Matrix<T, O>::upper_triangular_from_cols (const varr_type& vals)
 	{
 		size_type n = vals.size ();
 		Matrix m = null (n, n);
@@ -4208,9 +4603,9 @@ namespace opl
 		return m;
 	}
 
-	template <class T>
+	template <class T, StorageOrder O>
 	Vector<T>
-	Matrix<T>::lower_triangular_solve_system (const Vector<T>& b) const
+	Matrix<T, O>::lower_triangular_solve_system (const Vector<T>& b) const
 	{
 		assert (rows_ == cols_);
 		assert (rows_ == b.size_);
@@ -4228,9 +4623,9 @@ namespace opl
 		return x;
 	}
 
-	template <class T>
-	Matrix<T>
-	Matrix<T>::lower_triangular_solve_systems (const Matrix& b) const
+	template <class T, StorageOrder O>
+	Matrix<T, O>
+	Matrix<T, O>::lower_triangular_solve_systems (const Matrix& b) const
 	{
 		assert (rows_ == cols_);
 		assert (rows_ == b.rows_);
@@ -4252,9 +4647,9 @@ namespace opl
 		return x;
 	}
 
-	template <class T>
+	template <class T, StorageOrder O>
 	Vector<T>
-	Matrix<T>::upper_triangular_solve_system (const Vector<T>& b) const
+	Matrix<T, O>::upper_triangular_solve_system (const Vector<T>& b) const
 	{
 		assert (rows_ == cols_);
 		assert (rows_ == b.size_);
@@ -4272,9 +4667,9 @@ namespace opl
 		return x;
 	}
 
-	template <class T>
-	Matrix<T>
-	Matrix<T>::upper_triangular_solve_systems (const Matrix& b) const
+	template <class T, StorageOrder O>
+	Matrix<T, O>
+	Matrix<T, O>::upper_triangular_solve_systems (const Matrix& b) const
 	{
 		assert (rows_ == cols_);
 		assert (rows_ == b.rows_);
@@ -4295,25 +4690,25 @@ namespace opl
 		return x;
 	}
 
-	template <class T>
-	Matrix<T>
-	Matrix<T>::lower_triangular_inverse () const
+	template <class T, StorageOrder O>
+	Matrix<T, O>
+	Matrix<T, O>::lower_triangular_inverse () const
 	{
 		assert (rows_ == cols_);
 		return lower_triangular_solve_systems (id (rows_));
 	}
 
-	template <class T>
-	Matrix<T>
-	Matrix<T>::upper_triangular_inverse () const
+	template <class T, StorageOrder O>
+	Matrix<T, O>
+	Matrix<T, O>::upper_triangular_inverse () const
 	{
 		assert (rows_ == cols_);
 		return upper_triangular_solve_systems (id (rows_));
 	}
 
-	template <class T>
+	template <class T, StorageOrder O>
 	T
-	Matrix<T>::triangular_determinant () const
+	Matrix<T, O>::triangular_determinant () const
 	{
 		assert (rows_ == cols_);
 		T det = static_cast<T> (1);
@@ -4322,9 +4717,9 @@ namespace opl
 		return det;
 	}
 
-	template <class T>
+	template <class T, StorageOrder O>
 	bool
-	Matrix<T>::triangular_is_inversible () const
+	Matrix<T, O>::triangular_is_inversible () const
 	{
 		assert (rows_ == cols_);
 		return triangular_determinant() > static_cast<T> (1e-10);
@@ -4336,9 +4731,9 @@ namespace opl
 
 	//Diagonal matrices
 
-	template <class T>
+	template <class T, StorageOrder O>
 	bool
-	Matrix<T>::is_diagonal () const
+	Matrix<T, O>::is_diagonal () const
 	{
 		assert (rows_ == cols_);
 		T val = static_cast<T> (0);
@@ -4350,9 +4745,9 @@ namespace opl
 	}
 
 
-	template <class T>
+	template <class T, StorageOrder O>
 	Vector<T>
-	Matrix<T>::diagonal_to_vector () const
+	Matrix<T, O>::diagonal_to_vector () const
 	{
 		assert (rows_ == cols_);
 		Vector<T> v (rows_);
@@ -4361,9 +4756,9 @@ namespace opl
 		return v;
 	}
 
-	template <class T>
-	Matrix<T>
-	Matrix<T>::diagonal_from_vector (const Vector<T>& it)
+	template <class T, StorageOrder O>
+	Matrix<T, O>
+	Matrix<T, O>::diagonal_from_vector (const Vector<T>& it)
 	{
 		size_type n = it.size_;
 		Matrix m (null (n, n));
@@ -4372,10 +4767,10 @@ namespace opl
 		return m;
 	}
 
-	template <class T>
+	template <class T, StorageOrder O>
 	template <class It>
-	Matrix<T>
-	Matrix<T>::diagonal_from_it (It begin, It end)
+	Matrix<T, O>
+	Matrix<T, O>::diagonal_from_it (It begin, It end)
 	{
 		size_type n = end - begin;
 		Matrix m (null (n, n));
@@ -4387,9 +4782,9 @@ namespace opl
 	}
 
 
-	template <class T>
-	Matrix<T>
-	Matrix<T>::gauss_to_echelon_form () const
+	template <class T, StorageOrder O>
+	Matrix<T, O>
+	Matrix<T, O>::gauss_to_echelon_form () const
 	{
 		Matrix m (*this);
 		size_type n = rows_;
@@ -4410,15 +4805,16 @@ namespace opl
 
 			if(m.at (j, j))
 			{
-
-				for(size_type i = j + 1; i < n; ++i)
-				{
-					T multiplier = m.at (i, j) / m.at (j, j);
-					m.at (i, j) = 0;
-					for(size_type k = j + 1; k < p; ++k)
-						m.at (i, k) = m.at (i, k) - multiplier * m.at (j, k);
-				}
-
+				parallel::for_range (n - j - 1, (n - j) * (p - j),
+									 [&](size_type i0, size_type i1) {
+					for(size_type i = j + 1 + i0; i < j + 1 + i1; ++i)
+					{
+						T multiplier = m.at (i, j) / m.at (j, j);
+						m.at (i, j) = 0;
+						for(size_type k = j + 1; k < p; ++k)
+							m.at (i, k) = m.at (i, k) - multiplier * m.at (j, k);
+					}
+				});
 			}
 
 			else
@@ -4433,9 +4829,9 @@ namespace opl
 		return m;
 	}
 
-	template <class T>
-	Matrix<T>
-	Matrix<T>::gauss_to_echelon_form (Matrix& perm) const
+	template <class T, StorageOrder O>
+	Matrix<T, O>
+	Matrix<T, O>::gauss_to_echelon_form (Matrix& perm) const
 	{
 		Matrix m (*this);
 		size_type n = rows_;
@@ -4461,19 +4857,20 @@ namespace opl
 
 			if(m.at (j, j))
 			{
+				parallel::for_range (n - j - 1, (n - j) * (p + n - j),
+									 [&](size_type i0, size_type i1) {
+					for(size_type i = j + 1 + i0; i < j + 1 + i1; ++i)
+					{
+						T multiplier = m.at (i, j) / m.at (j, j);
+						m.at (i, j) = 0;
+						for (size_type k = j + 1; k < p; ++k)
+							m.at (i, k) = m.at (i, k) - multiplier * m.at (j, k);
 
-				for(size_type i = j + 1; i < n; ++i)
-				{
-					T multiplier = m.at (i, j) / m.at (j, j);
-					m.at (i, j) = 0;
-					for (size_type k = j + 1; k < p; ++k)
-						m.at (i, k) = m.at (i, k) - multiplier * m.at (j, k);
-
-					for (size_type k = 0; k < n; ++k)
-						perm. at (i, k) = perm.at (i, k) - multiplier
-							* perm.at (j, k);
-				}
-
+						for (size_type k = 0; k < n; ++k)
+							perm. at (i, k) = perm.at (i, k) - multiplier
+								* perm.at (j, k);
+					}
+				});
 			}
 
 			else
@@ -4492,16 +4889,16 @@ namespace opl
 		return m;
 	}
 
-    template <class T>
-	typename Matrix<T>::size_type
-	Matrix<T>::gauss_rank () const
+    template <class T, StorageOrder O>
+	typename Matrix<T, O>::size_type
+	Matrix<T, O>::gauss_rank () const
 	{
 		return gauss_to_echelon_form ().gauss_count_rank ();
 	}
 
-    template <class T>
-	typename Matrix<T>::varr_type
-	Matrix<T>::gauss_row_base () const
+    template <class T, StorageOrder O>
+	typename Matrix<T, O>::varr_type
+	Matrix<T, O>::gauss_row_base () const
 	{
 		Matrix m = gauss_to_echelon_form ();
 		size_type rank = m.gauss_count_rank();
@@ -4513,17 +4910,17 @@ namespace opl
 	}
 
 
-	template <class T>
-	typename Matrix<T>::varr_type
-	Matrix<T>::gauss_col_base () const
+	template <class T, StorageOrder O>
+	typename Matrix<T, O>::varr_type
+	Matrix<T, O>::gauss_col_base () const
 	{
 		return transpose ().gauss_row_base ();
 	}
 
 
-	template <class T>
-	typename Matrix<T>::varr_type
-	Matrix<T>::gauss_null_base () const
+	template <class T, StorageOrder O>
+	typename Matrix<T, O>::varr_type
+	Matrix<T, O>::gauss_null_base () const
 	{
 		Matrix m = transpose ();
 		Matrix p;
@@ -4538,9 +4935,9 @@ namespace opl
 		return bs;
 	}
 
-    template <class T>
-	Matrix<T>
-	Matrix<T>::gauss_inverse () const
+    template <class T, StorageOrder O>
+	Matrix<T, O>
+	Matrix<T, O>::gauss_inverse () const
 	{
 		assert(rows_ == cols_);
 		size_type n = rows_;
@@ -4585,9 +4982,9 @@ namespace opl
 		return res;
 	}
 
-	template <class T>
-	typename Matrix<T>::size_type
-	Matrix<T>::gauss_count_rank () const
+	template <class T, StorageOrder O>
+	typename Matrix<T, O>::size_type
+	Matrix<T, O>::gauss_count_rank () const
 	{
 		size_type n = rows_;
 		size_type p = cols_;
@@ -4604,16 +5001,16 @@ namespace opl
 	///Orthogonalisation
 
 
-	template <class T>
+	template <class T, StorageOrder O>
 	bool
-	Matrix<T>::is_orthogonal () const
+	Matrix<T, O>::is_orthogonal () const
 	{
 		return rows_ == cols_ && is_inverse_of (transpose ());
 	}
 
-	template <class T>
-	Matrix<T>
-	Matrix<T>::outter_product (const Vector<T>& a, const Vector<T>& b)
+	template <class T, StorageOrder O>
+	Matrix<T, O>
+	Matrix<T, O>::outter_product (const Vector<T>& a, const Vector<T>& b)
 	{
 		size_type n = a.size_;
 		size_type p = b.size_;
@@ -4626,23 +5023,23 @@ namespace opl
 		return m;
 	}
 
-	template <class T>
-	typename Matrix<T>::varr_type
-	Matrix<T>::row_basis () const
+	template <class T, StorageOrder O>
+	typename Matrix<T, O>::varr_type
+	Matrix<T, O>::row_basis () const
 	{
 	    return Vector<T>::basis_get (rows_vectors_get ());
 	}
 
-	template <class T>
-	typename Matrix<T>::varr_type
-	Matrix<T>::col_basis () const
+	template <class T, StorageOrder O>
+	typename Matrix<T, O>::varr_type
+	Matrix<T, O>::col_basis () const
 	{
 		return Vector<T>::basis_get (cols_vectors_get ());
 	}
 
-	template <class T>
-	typename Matrix<T>::size_type
-	Matrix<T>::rank () const
+	template <class T, StorageOrder O>
+	typename Matrix<T, O>::size_type
+	Matrix<T, O>::rank () const
 	{
 		if (rows_ > cols_)
 			return Vector<T>::rank (rows_vectors_get ());
@@ -4650,9 +5047,9 @@ namespace opl
 			return Vector<T>::rank (cols_vectors_get ());
 	}
 
-	template <class T>
-	typename Matrix<T>::varr_type
-	Matrix<T>::null_basis () const
+	template <class T, StorageOrder O>
+	typename Matrix<T, O>::varr_type
+	Matrix<T, O>::null_basis () const
 	{
 		size_type p = cols_;
 		varr_type set = cols_vectors_get ();
@@ -4683,9 +5080,9 @@ namespace opl
 		return basis;
 	}
 
-	template <class T>
+	template <class T, StorageOrder O>
 	void
-	Matrix<T>::gram_schmidt_qr_decomposition (Matrix &q, Matrix &r) const
+	Matrix<T, O>::gram_schmidt_qr_decomposition (Matrix &q, Matrix &r) const
 	{
 		size_type p = cols_;
 		varr_type set = cols_vectors_get ();
@@ -4711,9 +5108,9 @@ namespace opl
 		}
 	}
 
-	template <class T>
+	template <class T, StorageOrder O>
 	Vector <T>
-	Matrix<T>::qr_solver (const Vector<T>& b) const
+	Matrix<T, O>::qr_solver (const Vector<T>& b) const
 	{
 		Matrix q;
 		Matrix r;
@@ -4727,171 +5124,169 @@ namespace opl
 
 	//QR Decomposition
 
-	template <class T>
+    template <class T, StorageOrder O>
 	void
-	Matrix<T>::householder_update_q (const Vector<T>& v, size_type n,
-									 size_type col)
+	Matrix<T, O>::householder_qr_decomposition(Matrix &q, Matrix &r) const
 	{
-		Vector<T> x (n);
-		for (size_type i = 0; i < n; ++i)
+		if (O == StorageOrder::col_major)
 		{
-			T val = 0;
-			for (size_type j = 0; j < n - col; ++j)
-				val += at (i, j + col) * v.data_[j];
-			x.data_[i] = val;
+			Matrix<T> rq;
+			Matrix<T> rr;
+			Matrix<T> (*this).householder_qr_decomposition (rq, rr);
+			q = Matrix (rq);
+			r = Matrix (rr);
+			return;
 		}
 
-		for (size_type i = 0; i < n; ++i)
-			for (size_type j = 0; j < n - col; ++j)
-				at (i, j + col) -= 2 * x.data_[i] * v.data_[j];
+		size_type n = rows_;
+		size_type p = cols_;
+		r = *this;
+		Vector<T> tau (std::min (n, p));
+		Vector<T> t (linalg::qr_t_size (n, p));
+		linalg::qr_factorize (n, p, r.data_, p, tau.data_, t.data_);
+
+		q = Matrix (n, n);
+		linalg::qr_form_q (n, p, r.data_, p, t.data_, n, q.data_, n);
+		for (size_type i = 1; i < n; ++i)
+			for (size_type j = 0; j < i && j < p; ++j)
+				r.at (i, j) = 0;
 	}
 
-	template <class T>
+	template <class T, StorageOrder O>
 	void
-	Matrix<T>::householder_update_r (const Vector<T>& v, size_type n,
-									 size_type p, size_type col)
+	Matrix<T, O>::hessenberg_decomposition (Matrix &u, Matrix &h) const
 	{
-		Vector<T> x (p - col);
-		for (size_type j = 0; j < p - col; ++j)
+		assert (rows_ == cols_);
+		if (O == StorageOrder::col_major)
 		{
-			T val = 0;
-			for (size_type i = 0; i < n - col; ++i)
-				val += v.data_[i] * at (i + col, j + col);
-			x.data_[j] = val;
+			Matrix<T> ru;
+			Matrix<T> rh;
+			Matrix<T> (*this).hessenberg_decomposition (ru, rh);
+			u = Matrix (ru);
+			h = Matrix (rh);
+			return;
 		}
 
-		for (size_type i = 0; i < n - col; ++i)
-			for (size_type j = 0; j < p - col; ++j)
-				at (i + col, j + col) -= 2 * v.data_[i] * x.data_[j];
+		size_type n = rows_;
+		h = *this;
+		u = Matrix (n, n);
+		linalg::hessenberg_reduce (n, h.data_, n, u.data_, n);
 	}
 
-    template <class T>
+	template <class T, StorageOrder O>
 	void
-	Matrix<T>::householder_qr_decomposition(Matrix &q, Matrix &r) const
+	Matrix<T, O>::qr_algorithm (Matrix &u, Matrix &t) const
 	{
-		size_type n = rows_;
-		size_type p = cols_;
-		q = id (n);
-		r = *this;
-
-		for (size_type j = 0; j < n && j < p; ++j)
+		assert (rows_ == cols_);
+		if (O == StorageOrder::col_major)
 		{
-			Vector<T> v (n - j);
-			for (size_type i = j; i < n; ++i)
-				v.data_ [i - j] = r.at (i, j);
-
-			T s = v.data_[0] > 0 ? static_cast<T> (1) : static_cast<T> (-1);
-			T norm = v.norm ();
-			v.data_[0] -= s * norm;
-
-			if (!v.is_null ())
-			{
-				v.normalize ();
-				r.householder_update_r (v, n, p, j);
-				q.householder_update_q (v, n, j);
-			}
+			Matrix<T> ru;
+			Matrix<T> rt;
+			Matrix<T> (*this).qr_algorithm (ru, rt);
+			u = Matrix (ru);
+			t = Matrix (rt);
+			return;
 		}
-	}
 
-	template <class T>
-	void
-	Matrix<T>::qr_algorithm (Matrix &u, Matrix &t) const
-	{
-		assert (rows_ == cols_);
 		size_type n = rows_;
 
-		Matrix q;
-		Matrix r;
-		u = id (n);
-		t = *this;
-
-		size_type k = 0;
-		while (k < 100 && !t.is_upper_triangular ())
-		{
-		    t.householder_qr_decomposition (q, r);
-			t = r * q;
-			u *= q;
-			++k;
-		}
+		hessenberg_decomposition (u, t);
+		Vector<T> re (n);
+		Vector<T> im (n);
+		bool ok = linalg::hessenberg_qr (n, t.data_, n, u.data_, n,
+										 re.data_, im.data_);
+		assert (ok);
+		(void) ok;
 	}
 
-    template <class T>
+    template <class T, StorageOrder O>
 	T
-	Matrix<T>::qr_determinant () const
+	Matrix<T, O>::qr_determinant () const
 	{
 		assert (rows_ == cols_);
-		Matrix q;
-		Matrix r;
-		householder_qr_decomposition (q, r);
-		return r.triangular_determinant ();
+		size_type n = rows_;
+
+		//Column-major storage holds M^T in row-major order,
+		//det(M^T) = det(M) so it is factorized as is
+		Matrix qr (*this);
+		Vector<T> tau (n);
+		Vector<T> t (linalg::qr_t_size (n, n));
+		linalg::qr_factorize (n, n, qr.data_, n, tau.data_, t.data_);
+
+		//Each non trivial reflector has a determinant of -1
+		T det = 1;
+		for (size_type i = 0; i < n; ++i)
+			det *= tau.data_[i] == static_cast<T> (0) ? qr.at (i, i) : -qr.at (i, i);
+		return det;
 	}
 
-    template <class T>
+    template <class T, StorageOrder O>
 	Vector<T>
-	Matrix<T>::qr_solve_system (const Vector<T>& b) const
+	Matrix<T, O>::qr_solve_system (const Vector<T>& b) const
 	{
 		assert (rows_ == cols_);
 		assert (rows_ == b.size_);
-
-		Matrix q;
-		Matrix r;
-		householder_qr_decomposition (q, r);
-
-		Matrix qt = q.transpose ();
-		Vector<T> b0 =qt * b;
-		return r.upper_triangular_solve_system (b0);
+		return qr_least_squares (b);
 	}
 
-    template <class T>
-	Matrix<T>
-	Matrix<T>::qr_solve_systems (const Matrix<T>& b) const
+    template <class T, StorageOrder O>
+	Matrix<T, O>
+	Matrix<T, O>::qr_solve_systems (const Matrix& b) const
 	{
 		assert (rows_ == cols_);
-		assert (b.rows_ == b.cols_);
 		assert (rows_ == b.rows_);
+		if (O == StorageOrder::col_major)
+			return Matrix (Matrix<T> (*this).qr_solve_systems (Matrix<T> (b)));
 
-		Matrix q;
-		Matrix r;
-		householder_qr_decomposition (q, r);
+		size_type n = rows_;
+		Matrix qr (*this);
+		Vector<T> tau (n);
+		Vector<T> t (linalg::qr_t_size (n, n));
+		linalg::qr_factorize (n, n, qr.data_, n, tau.data_, t.data_);
 
-		Matrix qt = q.transpose ();
-		Matrix b0 = qt * b;
-		return r.upper_triangular_solve_systems(b0);
+		Matrix x (b);
+		linalg::qr_solve (n, n, qr.data_, n, t.data_, x.cols_, x.data_, x.cols_);
+		return x;
 	}
 
-    template <class T>
-	Matrix<T>
-	Matrix<T>::qr_inverse () const
+    template <class T, StorageOrder O>
+	Matrix<T, O>
+	Matrix<T, O>::qr_inverse () const
 	{
 		assert (rows_ == cols_);
 		return qr_solve_systems (id (rows_));
 	}
 
-	template <class T>
+	template <class T, StorageOrder O>
 	Vector<T>
-	Matrix<T>::qr_least_squares (const Vector<T>& b) const
+	Matrix<T, O>::qr_least_squares (const Vector<T>& b) const
 	{
 		assert (rows_ >= cols_);
 		assert (rows_ == b.size_);
+		if (O == StorageOrder::col_major)
+			return Matrix<T> (*this).qr_least_squares (b);
 
 		size_type n = rows_;
 		size_type p = cols_;
-		Matrix q;
-		Matrix r;
-		householder_qr_decomposition (q, r);
-		Vector<T> y = q.region_matrix (0, 0, n, p).transpose() * b;
-		Matrix r1 = r.region_matrix (0, 0, p, p);
-
-		return r1.upper_triangular_solve_system (y);
+		Matrix qr (*this);
+		Vector<T> tau (p);
+		Vector<T> t (linalg::qr_t_size (n, p));
+		linalg::qr_factorize (n, p, qr.data_, p, tau.data_, t.data_);
+
+		Vector<T> y (b);
+		linalg::qr_solve (n, p, qr.data_, p, t.data_, size_type (1),
+						  y.data_, size_type (1));
+		y.resize (p);
+		return y;
 	}
 
 
 	//Eigein values / vectors
 
 
-	template <class T>
+	template <class T, StorageOrder O>
 	Vector<T>
-	Matrix<T>::inverse_iteration (const T& value) const
+	Matrix<T, O>::inverse_iteration (const T& value) const
 	{
 		assert (rows_ == cols_);
 		size_type n = rows_;
@@ -4907,57 +5302,161 @@ namespace opl
 	}
 
 
-	template <class T>
+	template <class T, StorageOrder O>
 	void
-	Matrix<T>::qr_eigein (Vector<T>& vals, varr_type& vects) const
+	Matrix<T, O>::qr_eigein (Vector<T>& vals, varr_type& vects) const
 	{
 		assert(rows_ == cols_);
+		if (O == StorageOrder::col_major)
+		{
+			Matrix<T> (*this).qr_eigein (vals, vects);
+			return;
+		}
+
 		size_type n = rows_;
+		vals = Vector<T> (n);
+		vects.resize (n);
+
+		if (is_symmetric ())
+		{
+			Matrix a (*this);
+			Matrix z (n, n);
+			Vector<T> e (n);
+			linalg::tridiagonal_reduce (n, a.data_, n, vals.data_, e.data_,
+										z.data_, n);
+			bool ok = linalg::tridiagonal_qr (n, vals.data_, e.data_, z.data_, n);
+			assert (ok);
+			(void) ok;
+
+			std::vector<size_type> order (n);
+			for (size_type i = 0; i < n; ++i)
+				order[i] = i;
+			std::sort (order.begin (), order.end (),
+					   [&](size_type i, size_type j) {
+						   return vals.data_[i] > vals.data_[j];
+					   });
+
+			Vector<T> sorted (n);
+			for (size_type i = 0; i < n; ++i)
+			{
+				sorted.data_[i] = vals.data_[order[i]];
+				vects[i] = Vector<T> (z.begin_row (order[i]), z.end_row (order[i]));
+			}
+			vals.swap (sorted);
+			return;
+		}
+
 		Matrix u;
 		Matrix t;
+		hessenberg_decomposition (u, t);
+		Vector<T> im (n);
+		bool ok = linalg::hessenberg_qr (n, t.data_, n, u.data_, n,
+										 vals.data_, im.data_);
+		assert (ok);
+		(void) ok;
 
-		qr_algorithm (u, t);
-		vals = t.diagonal_to_vector ();
-		vects.resize (n);
+		Vector<T> y (n);
+		for (size_type k = 0; k < n; ++k)
+		{
+			vects[k] = Vector<T> (n, static_cast<T> (0));
+			if (im.data_[k] != static_cast<T> (0))
+				continue;
 
-		for (size_type i = 0; i < n; ++i)
-			vects[i] = inverse_iteration (vals[i]);
+			linalg::schur_eigenvector (n, t.data_, n, k, y.data_);
+			linalg::gemv (n, k + 1, static_cast<T> (1), u.data_, n, size_type (1),
+						  y.data_, size_type (1), static_cast<T> (0),
+						  vects[k].data_, size_type (1));
+			vects[k].normalize ();
+		}
+	}
+
+	template <class T, StorageOrder O>
+	Vector<T>
+	Matrix<T, O>::qr_eigein_values () const
+	{
+		assert(rows_ == cols_);
+		size_type n = rows_;
+		Vector<T> re (n);
+		Vector<T> im (n);
+		qr_eigein_values (re, im);
+		return re;
+	}
+
+	template <class T, StorageOrder O>
+	void
+	Matrix<T, O>::qr_eigein_values (Vector<T>& re, Vector<T>& im) const
+	{
+		assert(rows_ == cols_);
+		size_type n = rows_;
+
+		//M^T, in column-major storage, has the same eigeinvalues
+		Matrix a (*this);
+		re = Vector<T> (n);
+		im = Vector<T> (n, static_cast<T> (0));
+		bool ok;
+
+		if (is_symmetric ())
+		{
+			linalg::tridiagonal_reduce (n, a.data_, n, re.data_, im.data_,
+										static_cast<T*> (nullptr), n);
+			ok = linalg::tridiagonal_qr (n, re.data_, im.data_,
+										 static_cast<T*> (nullptr), n);
+			std::fill (im.data_, im.data_ + n, static_cast<T> (0));
+			std::sort (re.data_, re.data_ + n, [](const T& x, const T& y) {
+					return x > y;
+				});
+		}
+		else
+		{
+			linalg::hessenberg_reduce (n, a.data_, n,
+									   static_cast<T*> (nullptr), n);
+			ok = linalg::hessenberg_qr (n, a.data_, n, static_cast<T*> (nullptr), n,
+										re.data_, im.data_);
+		}
+
+		assert (ok);
+		(void) ok;
 	}
 
 
 	//Cholesky decomposition
 
-	template <class T>
-	Matrix<T>
-	Matrix<T>::cholesky_decomposition () const
+	template <class T, StorageOrder O>
+	Matrix<T, O>
+	Matrix<T, O>::cholesky_decomposition () const
 	{
 		assert(rows_ == cols_);
 
 		size_type n = rows_;
-		Matrix l (n, n);
+		Matrix l (n, n, static_cast<T> (0));
 
-		for(size_type i = 0; i < n; ++i)
+		//Column by column: once l (j, j) is known,
+		//the values below it only depend on the previous columns
+		for (size_type j = 0; j < n; ++j)
 		{
-			for(size_type j = 0; j <= i; ++j)
-			{
-
-				T val = at (i, j);
-				for (size_type k = 0; k < j; ++k)
-					val -= l.at (i, k) * l.at (j, k);
+			T diag = at (j, j);
+			for (size_type k = 0; k < j; ++k)
+				diag -= l.at (j, k) * l.at (j, k);
+			l.at (j, j) = std::sqrt (diag);
 
-				if( i == j)
-					l.at (i, j) = std::sqrt (val);
-				else
+			parallel::for_range (n - j - 1, (n - j) * j,
+								 [&](size_type i0, size_type i1) {
+				for (size_type i = j + 1 + i0; i < j + 1 + i1; ++i)
+				{
+					T val = at (i, j);
+					for (size_type k = 0; k < j; ++k)
+						val -= l.at (i, k) * l.at (j, k);
 					l.at (i, j) = val / l.at (j, j);
-			}
+				}
+			});
 		}
 
 		return l;
 	}
 
-	template <class T>
+	template <class T, StorageOrder O>
 	void
-	Matrix<T>::cholesky_ldl_decomposition (Matrix &l, Matrix &d) const
+	Matrix<T, O>::cholesky_ldl_decomposition (Matrix &l, Matrix &d) const
 	{
 		assert (rows_ == cols_);
 		size_type n = rows_;
@@ -4981,9 +5480,9 @@ namespace opl
 		}
 	}
 
-    template <class T>
+    template <class T, StorageOrder O>
 	Vector<T>
-	Matrix<T>::cholesky_solve_system (const Vector<T>& b) const
+	Matrix<T, O>::cholesky_solve_system (const Vector<T>& b) const
 	{
 		assert (rows_ == cols_);
 
@@ -4994,9 +5493,9 @@ namespace opl
 		return lt.upper_triangular_solve_system (y);
 	}
 
-    template <class T>
-	Matrix<T>
-	Matrix<T>::cholesky_solve_systems (const Matrix<T>& b) const
+    template <class T, StorageOrder O>
+	Matrix<T, O>
+	Matrix<T, O>::cholesky_solve_systems (const Matrix& b) const
 	{
 		assert (rows_ == cols_);
 
@@ -5007,17 +5506,17 @@ namespace opl
 		return lt.upper_triangular_solve_systems (y);
 	}
 
-    template <class T>
-	Matrix<T>
-	Matrix<T>::cholesky_inverse () const
+    template <class T, StorageOrder O>
+	Matrix<T, O>
+	Matrix<T, O>::cholesky_inverse () const
 	{
 		assert (rows_ == cols_);
 		return cholesky_solve_systems (id (rows_));
 	}
 
-	template <class T>
+	template <class T, StorageOrder O>
 	T
-	Matrix<T>::cholesky_determinant () const
+	Matrix<T, O>::cholesky_determinant () const
 	{
 		T det = cholesky_decomposition().triangular_determinant ();
 		return det * det;
@@ -5025,26 +5524,11 @@ namespace opl
 
 
 
-	template <class T>
-	T
-	Matrix<T>::plu_get_determinant (const Matrix& u, size_type parity)
-	{
-		assert (u.rows_ == u.cols_);
-		size_type n = u.rows_;
-
-		T det = static_cast<T> (math::powm1 (static_cast <int> (parity)));
-
-		for (size_type i = 0; i < n; ++i)
-			det *= u.at (i, i);
-		return det;
-	}
-
-
 	//LU Decomposition
 
-	template <class T>
+	template <class T, StorageOrder O>
 	void
-	Matrix<T>::lu_decomposition (Matrix& l, Matrix &u) const
+	Matrix<T, O>::lu_decomposition (Matrix& l, Matrix &u) const
 	{
 		assert(rows_ == cols_);
 		size_type n = rows_;
@@ -5053,162 +5537,340 @@ namespace opl
 
 		for (size_type j = 0; j < n; ++j)
 		{
-			for (size_type i = j + 1; i < n; ++i)
-			{
-				T num = u.at (i, j);
-			    T den = u.at (j, j);
-				T val = num || den ? num / den : static_cast<T> (0);
-				u.at (i, j) = static_cast<T> (0);
-
-				for (size_type k = j + 1; k < n; ++k)
-					u.at (i, k) -= val * u.at (j, k);
-				l.at (i, j) = val;
-			}
+			parallel::for_range (n - j - 1, (n - j) * (n - j),
+								 [&](size_type i0, size_type i1) {
+				for (size_type i = j + 1 + i0; i < j + 1 + i1; ++i)
+				{
+					T num = u.at (i, j);
+					T den = u.at (j, j);
+					T val = num || den ? num / den : static_cast<T> (0);
+					u.at (i, j) = static_cast<T> (0);
+
+					for (size_type k = j + 1; k < n; ++k)
+						u.at (i, k) -= val * u.at (j, k);
+					l.at (i, j) = val;
+				}
+			});
 		}
 	}
 
 
-    template <class T>
-	typename Matrix<T>::size_type
-	Matrix<T>::plu_decomposition (Matrix& p, Matrix &l, Matrix& u) const
+    template <class T, StorageOrder O>
+	typename Matrix<T, O>::size_type
+	Matrix<T, O>::plu_decomposition (Matrix& p, Matrix &l, Matrix& u) const
 	{
 		assert(rows_ == cols_);
-		size_type n = rows_;
-		size_type parity = 0;
-		p = id (n);
-		l = id (n);
-		u = *this;
-
-		for (size_type j = 0; j < n; ++j)
+		if (O == StorageOrder::col_major)
 		{
+			Matrix<T> rp;
+			Matrix<T> rl;
+			Matrix<T> ru;
+			size_type parity = Matrix<T> (*this).plu_decomposition (rp, rl, ru);
+			p = Matrix (rp);
+			l = Matrix (rl);
+			u = Matrix (ru);
+			return parity;
+		}
 
-			size_type pivot = j;
-			for (size_type i = j + 1; i < n; ++i)
-				if (std::abs (u.at (i, j)) > std::abs (u.at (pivot, j)))
-					pivot = i;
-
-			if (pivot != j)
-			{
-				++parity;
-				std::swap_ranges (p.begin_row (j), p.end_row (j),
-								  p.begin_row (pivot));
-				std::swap_ranges (l.begin_row (j), l.end_row (j),
-								  l.begin_row (pivot));
-				std::swap_ranges (u.begin_row (j), u.end_row (j),
-								  u.begin_row (pivot));
-			}
-
+		size_type n = rows_;
+		std::vector<size_type> piv (n);
+		u = *this;
+		size_type parity = linalg::lu_factorize (n, u.data_, n, piv.data ());
 
-			for (size_type i = j + 1; i < n; ++i)
+		l = id (n);
+		for (size_type i = 0; i < n; ++i)
+			for (size_type j = 0; j < i; ++j)
 			{
-				T num = u.at (i, j);
-				T den = u.at (j, j);
-				T val = num || den ? num / den : static_cast<T> (0);
-				u.at (i, j) = 0;
-				for (size_type k = j + 1; k < n; ++k)
-					u.at (i, k) -= val * u.at (j, k);
-				l.at (i, j) = val;
+				l.at (i, j) = u.at (i, j);
+				u.at (i, j) = static_cast<T> (0);
 			}
-		}
 
+		p = id (n);
+		for (size_type i = 0; i < n; ++i)
+			if (piv[i] != i)
+				std::swap_ranges (p.begin_row (i), p.end_row (i),
+								  p.begin_row (piv[i]));
 		return parity;
 	}
 
-    template <class T>
+    template <class T, StorageOrder O>
 	T
-	Matrix<T>::plu_determinant () const
+	Matrix<T, O>::plu_determinant () const
 	{
 		assert(rows_ == cols_);
-		Matrix p;
-		Matrix l;
-		Matrix u;
-		size_type parity = plu_decomposition (p, l, u);
-		return plu_get_determinant (u, parity);
+		size_type n = rows_;
+		std::vector<size_type> piv (n);
+
+		//det(M^T) = det(M), column-major storage is factorized as is
+		Matrix lu (*this);
+		size_type parity = linalg::lu_factorize (n, lu.data_, n, piv.data ());
+		return linalg::lu_determinant (n, lu.data_, n, parity);
 	}
 
-    template <class T>
+    template <class T, StorageOrder O>
 	Vector<T>
-	Matrix<T>::plu_solve_system (const Vector<T>& b) const
+	Matrix<T, O>::plu_solve_system (const Vector<T>& b) const
 	{
 		assert(rows_ == cols_);
 		assert(rows_ == b.size_);
+		if (O == StorageOrder::col_major)
+			return Matrix<T> (*this).plu_solve_system (b);
+
 		size_type n = rows_;
-		Matrix p;
-		Matrix l;
-		Matrix u;
-	    plu_decomposition (p, l, u);
-		Vector<T> b0 = p * b;
-		Vector<T> x (n);
-		Vector<T> y (n);
+		std::vector<size_type> piv (n);
+		Matrix lu (*this);
+		linalg::lu_factorize (n, lu.data_, n, piv.data ());
 
-		for (size_type i = 0; i < n; ++i)
-		{
-			T val = b0.data_[i];
-			for (size_type k = 0; k < i; ++k)
-				val -= l.at (i, k) * y.data_[k];
-			y.data_[i] = val;
-		}
+		Vector<T> x (b);
+		linalg::lu_solve (n, size_type (1), lu.data_, n, piv.data (),
+						  x.data_, size_type (1));
+		return x;
+	}
 
-		for (size_type i = n - 1; i < n; --i)
-		{
-			T val = y.data_[i];
-			for (size_type k = i + 1; k < n; ++k)
-				val -= u.at (i, k) * x.data_[k];
-			x.data_[i] = val / u.at (i, i);
-		}
+	template <class T, StorageOrder O>
+	Matrix<T, O>
+	Matrix<T, O>::plu_solve_systems (const Matrix& b) const
+	{
+		assert (rows_ == cols_);
+		assert (rows_ == b.rows_);
+		if (O == StorageOrder::col_major)
+			return Matrix (Matrix<T> (*this).plu_solve_systems (Matrix<T> (b)));
 
+		size_type n = rows_;
+		std::vector<size_type> piv (n);
+		Matrix lu (*this);
+		linalg::lu_factorize (n, lu.data_, n, piv.data ());
+
+		Matrix x (b);
+		linalg::lu_solve (n, x.cols_, lu.data_, n, piv.data (),
+						  x.data_, x.cols_);
 		return x;
 	}
 
-	template <class T>
-	Matrix<T>
-	Matrix<T>::plu_solve_systems (const Matrix<T>& b) const
+	template <class T, StorageOrder O>
+	Vector<T>
+	Matrix<T, O>::plu_solve_system_mixed (const Vector<T>& b) const
+	{
+		assert (rows_ == cols_);
+		assert (rows_ == b.size_);
+		if (O == StorageOrder::col_major)
+			return Matrix<T> (*this).plu_solve_system_mixed (b);
+
+		size_type n = rows_;
+		Vector<T> x (n);
+		if (linalg::lu_solve_mixed<typename linalg::LowerPrecision<T>::type>
+			(n, size_type (1), data_, n, b.data_, size_type (1),
+			 x.data_, size_type (1)))
+			return x;
+		return plu_solve_system (b);
+	}
+
+	template <class T, StorageOrder O>
+	Matrix<T, O>
+	Matrix<T, O>::plu_solve_systems_mixed (const Matrix& b) const
 	{
 		assert (rows_ == cols_);
-		assert (b.rows_ == b.cols_);
 		assert (rows_ == b.rows_);
+		if (O == StorageOrder::col_major)
+			return Matrix (Matrix<T> (*this).plu_solve_systems_mixed
+						   (Matrix<T> (b)));
+
 		size_type n = rows_;
-		Matrix p;
-		Matrix l;
-		Matrix u;
-		plu_decomposition (p, l, u);
-		Matrix b0 = p * b;
-		Matrix y (n, n);
-		Matrix x (n, n);
+		Matrix x (n, b.cols_);
+		if (linalg::lu_solve_mixed<typename linalg::LowerPrecision<T>::type>
+			(n, b.cols_, data_, n, b.data_, b.cols_, x.data_, x.cols_))
+			return x;
+		return plu_solve_systems (b);
+	}
 
-		for (size_type j = 0; j < n; ++j)
+    template <class T, StorageOrder O>
+	Matrix<T, O>
+	Matrix<T, O>::plu_inverse () const
+	{
+		assert (rows_ == cols_);
+		return plu_solve_systems (id (rows_));
+	}
+
+
+
+	//Singular value decomposition
+
+	template <class T, StorageOrder O>
+	bool
+	Matrix<T, O>::svd (Matrix& u, Vector<T>& s, Matrix& v) const
+	{
+		if (O == StorageOrder::col_major)
 		{
-			for(size_type i = 0; i < n; ++i)
-			{
-				T val = b0.at (i, j);
-				for(size_type k = 0; k < i; ++k)
-					val -= l.at(i, k) * y.at (k, j);
-				y.at (i, j) = val;
-			}
+			Matrix<T> ru;
+			Matrix<T> rv;
+			bool res = Matrix<T> (*this).svd (ru, s, rv);
+			u = Matrix (ru);
+			v = Matrix (rv);
+			return res;
 		}
 
-		for (size_type j = 0; j < n; ++j)
-		{
-			for(size_type i = n - 1; i < n; --i)
-			{
-				T val = y.at (i, j);
-				for (size_type k = i + 1; k < n; ++k)
-					val -= u.at (i, k) * x.at (k, j);
-				x.at (i, j) = val / u.at (i, i);
-			}
+		size_type r = std::min (rows_, cols_);
+		u = Matrix (rows_, r);
+		v = Matrix (cols_, r);
+		s.resize (r);
+		return linalg::jacobi_svd (rows_, cols_, data_, cols_, u.data_, r,
+								   s.data_, v.data_, r);
+	}
+
+	template <class T, StorageOrder O>
+	Vector<T>
+	Matrix<T, O>::svd_values () const
+	{
+		//Column-major storage is M^T, which has the same singular values
+		bool col = O == StorageOrder::col_major;
+		size_type m = col ? cols_ : rows_;
+		size_type n = col ? rows_ : cols_;
+		Vector<T> s (std::min (m, n));
+		bool ok = linalg::jacobi_svd (m, n, data_, n,
+									  static_cast<T*> (nullptr), size_type (0),
+									  s.data_,
+									  static_cast<T*> (nullptr), size_type (0));
+		assert (ok);
+		(void) ok;
+		return s;
+	}
+
+	template <class T, StorageOrder O>
+	bool
+	Matrix<T, O>::svd_truncated (size_type k, Matrix& u, Vector<T>& s,
+								 Matrix& v, size_type power) const
+	{
+		assert (k <= std::min (rows_, cols_));
+		if (O == StorageOrder::col_major)
+		{
+			Matrix<T> ru;
+			Matrix<T> rv;
+			bool res = Matrix<T> (*this).svd_truncated (k, ru, s, rv, power);
+			u = Matrix (ru);
+			v = Matrix (rv);
+			return res;
 		}
 
-		return x;
+		u = Matrix (rows_, k);
+		v = Matrix (cols_, k);
+		s.resize (k);
+		return linalg::randomized_svd (rows_, cols_, data_, cols_, k, u.data_,
+									   k, s.data_, v.data_, k, power);
+	}
+
+	template <class T, StorageOrder O>
+	Matrix<T, O>
+	Matrix<T, O>::pseudo_inverse (T tol) const
+	{
+		Matrix u;
+		Matrix v;
+		Vector<T> s;
+		bool ok = svd (u, s, v);
+		assert (ok);
+		(void) ok;
+
+		//M+ = V S+ U^T, over the singular values kept
+		size_type r = s.size_;
+		if (tol < 0)
+			tol = std::max (rows_, cols_) * std::numeric_limits<T>::epsilon ();
+		T cut = r ? tol * s.data_[0] : static_cast<T> (0);
+		size_type k = 0;
+		while (k < r && s.data_[k] > cut)
+			++k;
+
+		Matrix vs (cols_, k);
+		for (size_type i = 0; i < cols_; ++i)
+			for (size_type j = 0; j < k; ++j)
+				vs.at (i, j) = v.at (i, j) / s.data_[j];
+		Matrix res (cols_, rows_);
+		linalg::gemm (cols_, rows_, k, static_cast<T> (1),
+					  vs.data_, vs.row_stride (), vs.col_stride (),
+					  u.data_, u.col_stride (), u.row_stride (),
+					  static_cast<T> (0), res.data_, res.row_stride (),
+					  res.col_stride ());
+		return res;
+	}
+
+	template <class T, StorageOrder O>
+	Vector<T>
+	Matrix<T, O>::svd_least_squares (const Vector<T>& b) const
+	{
+		assert (rows_ == b.size_);
+		return pseudo_inverse () * b;
+	}
+
+	template <class T, StorageOrder O>
+	Matrix<T, O>
+	Matrix<T, O>::low_rank_approximation (size_type k, bool randomized) const
+	{
+		k = std::min (k, std::min (rows_, cols_));
+		Matrix u;
+		Matrix v;
+		Vector<T> s;
+		bool ok = randomized ? svd_truncated (k, u, s, v) : svd (u, s, v);
+		assert (ok);
+		(void) ok;
+
+		//U_k diag(s_k) V_k^T
+		for (size_type i = 0; i < rows_; ++i)
+			for (size_type j = 0; j < k; ++j)
+				u.at (i, j) *= s.data_[j];
+		Matrix res (rows_, cols_);
+		linalg::gemm (rows_, cols_, k, static_cast<T> (1),
+					  u.data_, u.row_stride (), u.col_stride (),
+					  v.data_, v.col_stride (), v.row_stride (),
+					  static_cast<T> (0), res.data_, res.row_stride (),
+					  res.col_stride ());
+		return res;
 	}
 
-    template <class T>
+
+	///Matrix product, operands are evaluated at most once before gemm
+	///Views are multiplied in place, with their strides
+	template <class L, class R, class T>
 	Matrix<T>
-	Matrix<T>::plu_inverse () const
+	operator* (const MatrixExpr<L, T>& a, const MatrixExpr<R, T>& b)
 	{
-		assert (rows_ == cols_);
-		return plu_solve_systems (id (rows_));
+		const auto& ma = evaluate (a.self ());
+		const auto& mb = evaluate (b.self ());
+		assert (ma.cols () == mb.rows ());
+		Matrix<T> m (ma.rows (), mb.cols ());
+		linalg::gemm (ma.rows (), mb.cols (), ma.cols (), static_cast<T> (1),
+					  ma.data (), ma.row_stride (), ma.col_stride (),
+					  mb.data (), mb.row_stride (), mb.col_stride (),
+					  static_cast<T> (0), m.data (), m.cols (), size_t (1));
+		return m;
+	}
+
+	template <class E, class F, class T>
+	Vector<T>
+	operator* (const MatrixExpr<E, T>& a, const VectorExpr<F, T>& b)
+	{
+		const auto& ma = evaluate (a.self ());
+		const auto& vb = evaluate (b.self ());
+		assert (ma.cols () == vb.size ());
+		Vector<T> v (ma.rows ());
+		linalg::gemv (ma.rows (), ma.cols (), static_cast<T> (1),
+					  ma.data (), ma.row_stride (), ma.col_stride (),
+					  vb.data (), vb.stride (),
+					  static_cast<T> (0), v.data (), 1);
+		return v;
 	}
 
+	template <class E, class F, class T>
+	Vector<T>
+	operator* (const VectorExpr<E, T>& a, const MatrixExpr<F, T>& b)
+	{
+		const auto& va = evaluate (a.self ());
+		const auto& mb = evaluate (b.self ());
+		assert (va.size () == mb.rows ());
+		Vector<T> v (mb.cols ());
+		linalg::gemv (mb.cols (), mb.rows (), static_cast<T> (1),
+					  mb.data (), mb.col_stride (), mb.row_stride (),
+					  va.data (), va.stride (),
+					  static_cast<T> (0), v.data (), 1);
+		return v;
+	}
 
 }
 
@@ -0,0 +1,172 @@
+/** @file Blocked orthogonalization of sets of vectors
+ *
+ * The k vectors of size d are the rows of a row-major k x d matrix V, so a
+ * whole set is one contiguous block.
+ * cgs2_orthonormalize is a block classical Gram-Schmidt with
+ * reorthogonalization (BCGS2): each block of OPL_ORTHO_BLOCK vectors is
+ * projected twice against all the previous ones with two gemm calls, then
+ * orthonormalized inside the block, again twice. Two passes of classical
+ * Gram-Schmidt give a Q orthogonal to the working precision, as modified
+ * Gram-Schmidt would, but with matrix products instead of one dot product
+ * per pair of vectors.
+ * tsqr_r only computes R, with a tall-skinny QR: V^T is split in chunks of
+ * rows factorized in parallel, then the stacked R factors are factorized.
+ * projected_norms reduces V to the k x k R^T this way, which has the same
+ * Gram matrix, before orthogonalizing it: the cost of the d dimensions
+ * is paid once, by the parallel QR.
+ * The projected norm of vector i is its norm once projected on the
+ * orthogonal of the previous ones, and the vector is dependent when its
+ * squared norm falls under tol.
+ */
+
+#ifndef ORTHOGONALIZATION_HH_
+# define ORTHOGONALIZATION_HH_
+
+# include <algorithm>
+# include <cmath>
+# include <cstddef>
+# include <vector>
+# include "gemm.hh"
+# include "parallel.hh"
+# include "qr.hh"
+# include "simd-reduce.hh"
+# include "transpose.hh"
+
+///Number of vectors projected at once by cgs2_orthonormalize
+# define OPL_ORTHO_BLOCK 32
+
+namespace opl
+{
+
+	namespace linalg
+	{
+
+		///V <- Q, the rows of Q orthonormal, null for dependent vectors
+		///R (k x k) gets the coefficients: v_i = sum_j R(j, i) q_j,
+		///R(i, i) = 0 for a dependent vector
+		///Returns the rank of the set
+		template <class T>
+		std::size_t
+		cgs2_orthonormalize (std::size_t k, std::size_t d, T* v,
+							 std::size_t ldv, T* r, std::size_t ldr, T tol)
+		{
+			constexpr std::size_t nb = OPL_ORTHO_BLOCK;
+			std::vector<T> c (nb * k);
+			std::size_t rank = 0;
+			for (std::size_t i = 0; i < k; ++i)
+				std::fill_n (r + i * ldr, k, static_cast<T> (0));
+
+			for (std::size_t j0 = 0; j0 < k; j0 += nb)
+			{
+				std::size_t jb = std::min (nb, k - j0);
+				T* vb = v + j0 * ldv;
+
+				//C = Vb Q^T, Vb -= C Q, against the j0 previous vectors
+				for (int pass = 0; pass < 2 && j0; ++pass)
+				{
+					gemm (jb, j0, d, static_cast<T> (1),
+						  vb, ldv, std::size_t (1), v, std::size_t (1), ldv,
+						  static_cast<T> (0), c.data (), j0, std::size_t (1));
+					gemm (jb, d, j0, static_cast<T> (-1),
+						  c.data (), j0, std::size_t (1), v, ldv, std::size_t (1),
+						  static_cast<T> (1), vb, ldv, std::size_t (1));
+					for (std::size_t i = 0; i < jb; ++i)
+						for (std::size_t l = 0; l < j0; ++l)
+							r[l * ldr + j0 + i] += c[i * j0 + l];
+				}
+
+				for (std::size_t i = j0; i < j0 + jb; ++i)
+				{
+					T* vi = v + i * ldv;
+					for (int pass = 0; pass < 2; ++pass)
+					{
+						for (std::size_t l = j0; l < i; ++l)
+							c[l - j0] = simd::dot (v + l * ldv, vi, d);
+						for (std::size_t l = j0; l < i; ++l)
+						{
+							simd::axpy (d, -c[l - j0], v + l * ldv, vi);
+							r[l * ldr + i] += c[l - j0];
+						}
+					}
+
+					T nrm = simd::norm_square (vi, d);
+					if (nrm < tol)
+					{
+						std::fill_n (vi, d, static_cast<T> (0));
+						continue;
+					}
+					nrm = std::sqrt (nrm);
+					r[i * ldr + i] = nrm;
+					for (std::size_t j = 0; j < d; ++j)
+						vi[j] /= nrm;
+					++rank;
+				}
+			}
+
+			return rank;
+		}
+
+		///R (k x k, upper triangular) of V^T = QR
+		///The diagonal may be negative
+		template <class T>
+		void
+		tsqr_r (std::size_t k, std::size_t d, const T* v, std::size_t ldv,
+				T* r, std::size_t ldr)
+		{
+			//Each chunk has at least k rows, so its R is a full k x k
+			std::size_t p = k ? std::min (parallel::chunks (k * k * d), d / k)
+				: 0;
+			p = std::max (p, std::size_t (1));
+			std::vector<T> stack (p * k * k, static_cast<T> (0));
+
+			auto factor = [k](std::size_t m, T* a, T* res) {
+				std::vector<T> tau (std::min (m, k));
+				std::vector<T> t (qr_t_size (m, k));
+				qr_factorize (m, k, a, k, tau.data (), t.data ());
+				for (std::size_t i = 0; i < std::min (m, k); ++i)
+					std::copy (a + i * k + i, a + i * k + k, res + i * k + i);
+			};
+
+			parallel::run (p, [&](std::size_t c) {
+					std::size_t c0 = d * c / p;
+					std::size_t m = d * (c + 1) / p - c0;
+					std::vector<T> a (m * k);
+					transpose (k, m, v + c0, ldv, a.data (), k);
+					factor (m, a.data (), stack.data () + c * k * k);
+				});
+
+			std::vector<T> res (k * k, static_cast<T> (0));
+			if (p > 1)
+				factor (p * k, stack.data (), res.data ());
+			else
+				res.swap (stack);
+
+			for (std::size_t i = 0; i < k; ++i)
+				std::copy_n (res.data () + i * k, k, r + i * ldr);
+		}
+
+		///Projected norm of each vector in norms, 0 for dependent ones
+		///Returns the rank of the set
+		///Householder QR doesn't give them directly on rank-deficient sets:
+		///after a null pivot its diagonal no longer holds projected norms
+		template <class T>
+		std::size_t
+		projected_norms (std::size_t k, std::size_t d, const T* v,
+						 std::size_t ldv, T* norms, T tol)
+		{
+			std::vector<T> r (k * k);
+			std::vector<T> rt (k * k);
+			tsqr_r (k, d, v, ldv, r.data (), k);
+			transpose (k, k, r.data (), k, rt.data (), k);
+			std::size_t rank = cgs2_orthonormalize (k, k, rt.data (), k,
+													r.data (), k, tol);
+			for (std::size_t i = 0; i < k; ++i)
+				norms[i] = r[i * k + i];
+			return rank;
+		}
+
+	}
+
+}
+
+#endif //!ORTHOGONALIZATION_HH_
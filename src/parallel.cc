@@ -0,0 +1,71 @@
+#include <memory>
+#include <thread>
+#include "parallel.hh"
+#include "thread-pool.hh"
+
+namespace opl
+{
+
+	namespace parallel
+	{
+
+		namespace
+		{
+			std::unique_ptr<ThreadPool> pool;
+			std::size_t min_work = OPL_PARALLEL_THRESHOLD;
+		}
+
+		void
+		set_threads (std::size_t n)
+		{
+			if (!n)
+				n = std::max (1u, std::thread::hardware_concurrency ());
+			if (n == threads ())
+				return;
+
+			pool.reset ();
+			if (n > 1)
+				pool.reset (new ThreadPool (n));
+		}
+
+		std::size_t
+		threads ()
+		{
+			return pool ? pool->size () : 1;
+		}
+
+		void
+		set_threshold (std::size_t work)
+		{
+			min_work = work;
+		}
+
+		std::size_t
+		threshold ()
+		{
+			return min_work;
+		}
+
+		std::size_t
+		chunks (std::size_t work)
+		{
+			if (!pool || work < min_work || ThreadPool::in_worker ())
+				return 1;
+			return pool->size ();
+		}
+
+		void
+		run (std::size_t tasks, TaskRef f)
+		{
+			if (!pool || ThreadPool::in_worker ())
+			{
+				for (std::size_t i = 0; i < tasks; ++i)
+					f (i);
+				return;
+			}
+			pool->run (tasks, f);
+		}
+
+	}
+
+}
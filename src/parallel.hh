@@ -0,0 +1,71 @@
+/** @file Opt-in multi-threaded backend of the linear algebra code
+ *
+ * Operations ask chunks () how many pieces their work should be split in.
+ * It stays 1 (serial) until set_threads () is called with more than one
+ * thread, for work under threshold (), and inside a worker thread.
+ * Chunks only split independent outputs, so results match the serial path
+ * up to the order of floating-point additions.
+ */
+
+#ifndef PARALLEL_HH_
+#define PARALLEL_HH_
+
+# include <algorithm>
+# include <cstddef>
+# include "task-ref.hh"
+
+///Default minimum work, in multiply-adds, before an operation is split
+# define OPL_PARALLEL_THRESHOLD 65536
+
+namespace opl
+{
+
+	namespace parallel
+	{
+
+		///Sets the number of threads used, 0 means one per core
+		///1 (the default) disables the backend
+		///Must not be called while a parallel operation runs
+		void
+		set_threads (std::size_t n);
+
+		std::size_t
+		threads ();
+
+		///Operations with less work than this stay serial
+		void
+		set_threshold (std::size_t work);
+
+		std::size_t
+		threshold ();
+
+		///Number of pieces an operation of the given work is split in
+		std::size_t
+		chunks (std::size_t work);
+
+		///Calls f (0), ..., f (tasks - 1) on the thread pool
+		///f is passed by reference, the call allocates nothing
+		void
+		run (std::size_t tasks, TaskRef f);
+
+		///Calls f (begin, end) on disjoint ranges covering [0, n)
+		///work is the total cost of the operation, in multiply-adds
+		template <class F>
+		void
+		for_range (std::size_t n, std::size_t work, F f)
+		{
+			std::size_t c = std::min (chunks (work), n);
+			if (c <= 1)
+			{
+				f (std::size_t (0), n);
+				return;
+			}
+
+			run (c, [&](std::size_t t) { f (n * t / c, n * (t + 1) / c); });
+		}
+
+	}
+
+}
+
+#endif //!PARALLEL_HH_
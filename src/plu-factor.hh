@@ -0,0 +1,282 @@
+/** @file PluFactor class definition
+ */
+
+#ifndef PLU_FACTOR_HH_
+# define PLU_FACTOR_HH_
+
+# include <cassert>
+# include <cstddef>
+# include <utility>
+# include <vector>
+# include "lu.hh"
+# include "matrix.hh"
+# include "vector.hh"
+
+namespace opl
+{
+
+	/// PLU factorization of a square matrix, PA = LU
+	/// L and U share a single matrix and P is stored as a pivot vector,
+	/// so it can be solved against any number of right-hand sides
+	/// without factorizing again
+	template <class T>
+	class PluFactor
+	{
+
+	public:
+		using size_type = std::size_t;
+
+		PluFactor ();
+
+		explicit PluFactor (const Matrix<T>& a);
+
+		///Factorizes the storage of a, without any copy
+		explicit PluFactor (Matrix<T>&& a);
+
+		///Factorizes a, reusing the current storage when possible
+		void
+		factorize (const Matrix<T>& a);
+
+		void
+		factorize (Matrix<T>&& a);
+
+		size_type
+		size () const;
+
+		///Returns true if U has a zero pivot
+		bool
+		is_singular () const;
+
+		T
+		determinant () const;
+
+		///Returns x: Ax = b
+		Vector<T>
+		solve_system (const Vector<T>& b) const;
+
+		///Returns X: AX = B
+		Matrix<T>
+		solve_systems (const Matrix<T>& b) const;
+
+		///b <- x: Ax = b
+		void
+		solve_in_place (Vector<T>& b) const;
+
+		///B <- X: AX = B
+		void
+		solve_in_place (Matrix<T>& b) const;
+
+		Matrix<T>
+		inverse () const;
+
+		///Unit lower triangular factor
+		Matrix<T>
+		l_get () const;
+
+		///Upper triangular factor
+		Matrix<T>
+		u_get () const;
+
+		///Permutation matrix
+		Matrix<T>
+		p_get () const;
+
+		///L (strictly below the diagonal) and U, packed in one matrix
+		const Matrix<T>&
+		lu () const;
+
+		///Row i was swapped with row pivots ()[i] at step i
+		const std::vector<size_type>&
+		pivots () const;
+
+		///Number of rows interchanges
+		size_type
+		swaps () const;
+
+	private:
+		void
+		factorize_ ();
+
+		Matrix<T> lu_;
+		std::vector<size_type> piv_;
+		size_type swaps_;
+
+	};
+
+	template <class T>
+	PluFactor<T>::PluFactor ()
+		: swaps_ (0)
+	{
+
+	}
+
+	template <class T>
+	PluFactor<T>::PluFactor (const Matrix<T>& a)
+		: lu_ (a)
+	{
+		factorize_ ();
+	}
+
+	template <class T>
+	PluFactor<T>::PluFactor (Matrix<T>&& a)
+		: lu_ (std::move (a))
+	{
+		factorize_ ();
+	}
+
+	template <class T>
+	void
+	PluFactor<T>::factorize (const Matrix<T>& a)
+	{
+		lu_ = a;
+		factorize_ ();
+	}
+
+	template <class T>
+	void
+	PluFactor<T>::factorize (Matrix<T>&& a)
+	{
+		lu_ = std::move (a);
+		factorize_ ();
+	}
+
+	template <class T>
+	typename PluFactor<T>::size_type
+	PluFactor<T>::size () const
+	{
+		return lu_.rows ();
+	}
+
+	template <class T>
+	bool
+	PluFactor<T>::is_singular () const
+	{
+		for (size_type i = 0; i < size (); ++i)
+			if (lu_.at (i, i) == static_cast<T> (0))
+				return true;
+		return false;
+	}
+
+	template <class T>
+	T
+	PluFactor<T>::determinant () const
+	{
+		return linalg::lu_determinant (size (), lu_.data (), size (), swaps_);
+	}
+
+	template <class T>
+	Vector<T>
+	PluFactor<T>::solve_system (const Vector<T>& b) const
+	{
+		Vector<T> x (b);
+		solve_in_place (x);
+		return x;
+	}
+
+	template <class T>
+	Matrix<T>
+	PluFactor<T>::solve_systems (const Matrix<T>& b) const
+	{
+		Matrix<T> x (b);
+		solve_in_place (x);
+		return x;
+	}
+
+	template <class T>
+	void
+	PluFactor<T>::solve_in_place (Vector<T>& b) const
+	{
+		assert (b.size () == size ());
+		linalg::lu_solve (size (), size_type (1), lu_.data (), size (),
+						  piv_.data (), b.data (), size_type (1));
+	}
+
+	template <class T>
+	void
+	PluFactor<T>::solve_in_place (Matrix<T>& b) const
+	{
+		assert (b.rows () == size ());
+		linalg::lu_solve (size (), b.cols (), lu_.data (), size (),
+						  piv_.data (), b.data (), b.cols ());
+	}
+
+	template <class T>
+	Matrix<T>
+	PluFactor<T>::inverse () const
+	{
+		Matrix<T> x = Matrix<T>::id (size ());
+		solve_in_place (x);
+		return x;
+	}
+
+	template <class T>
+	Matrix<T>
+	PluFactor<T>::l_get () const
+	{
+		size_type n = size ();
+		Matrix<T> l = Matrix<T>::id (n);
+		for (size_type i = 0; i < n; ++i)
+			for (size_type j = 0; j < i; ++j)
+				l.at (i, j) = lu_.at (i, j);
+		return l;
+	}
+
+	template <class T>
+	Matrix<T>
+	PluFactor<T>::u_get () const
+	{
+		size_type n = size ();
+		Matrix<T> u (n, n, static_cast<T> (0));
+		for (size_type i = 0; i < n; ++i)
+			for (size_type j = i; j < n; ++j)
+				u.at (i, j) = lu_.at (i, j);
+		return u;
+	}
+
+	template <class T>
+	Matrix<T>
+	PluFactor<T>::p_get () const
+	{
+		size_type n = size ();
+		Matrix<T> p = Matrix<T>::id (n);
+		for (size_type i = 0; i < n; ++i)
+			if (piv_[i] != i)
+				std::swap_ranges (p.begin_row (i), p.end_row (i),
+								  p.begin_row (piv_[i]));
+		return p;
+	}
+
+	template <class T>
+	const Matrix<T>&
+	PluFactor<T>::lu () const
+	{
+		return lu_;
+	}
+
+	template <class T>
+	const std::vector<typename PluFactor<T>::size_type>&
+	PluFactor<T>::pivots () const
+	{
+		return piv_;
+	}
+
+	template <class T>
+	typename PluFactor<T>::size_type
+	PluFactor<T>::swaps () const
+	{
+		return swaps_;
+	}
+
+	template <class T>
+	void
+	PluFactor<T>::factorize_ ()
+	{
+		assert (lu_.rows () == lu_.cols ());
+		piv_.resize (size ());
+		swaps_ = linalg::lu_factorize (size (), lu_.data (), size (),
+									   piv_.data ());
+	}
+
+}
+
+#endif //!PLU_FACTOR_HH_
@@ -0,0 +1,245 @@
+/** @file Preconditioners of the Krylov solvers
+ *
+ * A preconditioner M approximates A and provides apply (r, z): z <- M^-1 r.
+ * apply never allocates, z has the size of r.
+ */
+
+#ifndef PRECONDITIONER_HH_
+# define PRECONDITIONER_HH_
+
+# include <cassert>
+# include <cmath>
+# include <cstddef>
+# include <vector>
+# include "matrix.hh"
+# include "sparse-matrix.hh"
+# include "vector.hh"
+
+namespace opl
+{
+
+	/// M = I
+	template <class T>
+	class IdentityPreconditioner
+	{
+
+	public:
+		void
+		apply (const Vector<T>& r, Vector<T>& z) const;
+
+	};
+
+	/// M = diag(A)
+	template <class T>
+	class JacobiPreconditioner
+	{
+
+	public:
+		using size_type = std::size_t;
+
+		explicit JacobiPreconditioner (const Matrix<T>& a);
+		explicit JacobiPreconditioner (const SparseMatrix<T>& a);
+
+		///Takes the diagonal of A
+		explicit JacobiPreconditioner (const Vector<T>& diag);
+
+		void
+		apply (const Vector<T>& r, Vector<T>& z) const;
+
+	private:
+		void
+		invert_ ();
+
+		Vector<T> inv_diag_;
+
+	};
+
+	/// M = LL^T, with L the zero fill-in incomplete Cholesky factor of the
+	/// SPD A: L has the pattern of the lower triangle of A
+	/// A non-positive pivot is replaced by the diagonal value of A
+	template <class T>
+	class IncompleteCholesky
+	{
+
+	public:
+		using size_type = std::size_t;
+
+		explicit IncompleteCholesky (const SparseMatrix<T>& a);
+
+		void
+		apply (const Vector<T>& r, Vector<T>& z) const;
+
+		///L, in CSR storage
+		const SparseMatrix<T>&
+		l_get () const;
+
+	private:
+		SparseMatrix<T> l_;
+
+	};
+
+	template <class T>
+	void
+	IdentityPreconditioner<T>::apply (const Vector<T>& r, Vector<T>& z) const
+	{
+		z.assign (r);
+	}
+
+	template <class T>
+	JacobiPreconditioner<T>::JacobiPreconditioner (const Matrix<T>& a)
+		: inv_diag_ (a.diagonal_to_vector ())
+	{
+		invert_ ();
+	}
+
+	template <class T>
+	JacobiPreconditioner<T>::JacobiPreconditioner (const SparseMatrix<T>& a)
+		: inv_diag_ (a.diagonal_to_vector ())
+	{
+		invert_ ();
+	}
+
+	template <class T>
+	JacobiPreconditioner<T>::JacobiPreconditioner (const Vector<T>& diag)
+		: inv_diag_ (diag)
+	{
+		invert_ ();
+	}
+
+	template <class T>
+	void
+	JacobiPreconditioner<T>::apply (const Vector<T>& r, Vector<T>& z) const
+	{
+		assert (r.size () == inv_diag_.size ());
+		z.resize (r.size ());
+		const T* d = inv_diag_.data ();
+		const T* rp = r.data ();
+		T* zp = z.data ();
+		for (size_type i = 0; i < r.size (); ++i)
+			zp[i] = d[i] * rp[i];
+	}
+
+	template <class T>
+	void
+	JacobiPreconditioner<T>::invert_ ()
+	{
+		//A zero diagonal value leaves its unknown unscaled
+		T* d = inv_diag_.data ();
+		for (size_type i = 0; i < inv_diag_.size (); ++i)
+			d[i] = d[i] == static_cast<T> (0) ? static_cast<T> (1) : 1 / d[i];
+	}
+
+	template <class T>
+	IncompleteCholesky<T>::IncompleteCholesky (const SparseMatrix<T>& a)
+	{
+		assert (a.rows () == a.cols ());
+		size_type n = a.rows ();
+		SparseMatrix<T> csr = a.to_csr ();
+		const std::vector<size_type>& aptr = csr.pointers ();
+		const std::vector<size_type>& aidx = csr.indices ();
+		const std::vector<T>& aval = csr.values ();
+
+		//Lower triangle of A, the diagonal is stored last in each row
+		std::vector<size_type> ptr (n + 1, 0);
+		std::vector<size_type> idx;
+		std::vector<T> val;
+		idx.reserve (aidx.size () / 2 + n);
+		val.reserve (aidx.size () / 2 + n);
+		for (size_type i = 0; i < n; ++i)
+		{
+			T diag = 0;
+			for (size_type p = aptr[i]; p < aptr[i + 1] && aidx[p] <= i; ++p)
+			{
+				if (aidx[p] == i)
+					diag = aval[p];
+				else
+				{
+					idx.push_back (aidx[p]);
+					val.push_back (aval[p]);
+				}
+			}
+			idx.push_back (i);
+			val.push_back (diag);
+			ptr[i + 1] = idx.size ();
+		}
+
+		//Row by row: L_ik = (A_ik - L_i,:k . L_k,:k) / L_kk,
+		//the dot product only runs on the common pattern of rows i and k
+		for (size_type i = 0; i < n; ++i)
+		{
+			size_type d = ptr[i + 1] - 1;
+			for (size_type p = ptr[i]; p < d; ++p)
+			{
+				size_type k = idx[p];
+				T sum = val[p];
+				size_type q = ptr[i];
+				size_type s = ptr[k];
+				size_type kd = ptr[k + 1] - 1;
+				while (q < p && s < kd)
+				{
+					if (idx[q] < idx[s])
+						++q;
+					else if (idx[q] > idx[s])
+						++s;
+					else
+						sum -= val[q++] * val[s++];
+				}
+				val[p] = sum / val[kd];
+			}
+
+			T sum = val[d];
+			for (size_type p = ptr[i]; p < d; ++p)
+				sum -= val[p] * val[p];
+			if (sum <= static_cast<T> (0))
+				sum = std::abs (val[d]) > static_cast<T> (0) ? std::abs (val[d])
+					: static_cast<T> (1);
+			val[d] = std::sqrt (sum);
+		}
+
+		l_ = SparseMatrix<T> (n, n, SparseFormat::csr, std::move (ptr),
+							  std::move (idx), std::move (val));
+	}
+
+	template <class T>
+	void
+	IncompleteCholesky<T>::apply (const Vector<T>& r, Vector<T>& z) const
+	{
+		size_type n = l_.rows ();
+		assert (r.size () == n);
+		const std::vector<size_type>& ptr = l_.pointers ();
+		const std::vector<size_type>& idx = l_.indices ();
+		const std::vector<T>& val = l_.values ();
+		z.assign (r);
+		T* zp = z.data ();
+
+		//Ly = r
+		for (size_type i = 0; i < n; ++i)
+		{
+			size_type d = ptr[i + 1] - 1;
+			T sum = zp[i];
+			for (size_type p = ptr[i]; p < d; ++p)
+				sum -= val[p] * zp[idx[p]];
+			zp[i] = sum / val[d];
+		}
+
+		//L^T z = y, column by column
+		for (size_type i = n - 1; i < n; --i)
+		{
+			size_type d = ptr[i + 1] - 1;
+			zp[i] /= val[d];
+			T zi = zp[i];
+			for (size_type p = ptr[i]; p < d; ++p)
+				zp[idx[p]] -= val[p] * zi;
+		}
+	}
+
+	template <class T>
+	const SparseMatrix<T>&
+	IncompleteCholesky<T>::l_get () const
+	{
+		return l_;
+	}
+
+}
+
+#endif //!PRECONDITIONER_HH_
@@ -0,0 +1,337 @@
+/** @file QrFactor class definition
+ */
+
+#ifndef QR_FACTOR_HH_
+# define QR_FACTOR_HH_
+
+# include <algorithm>
+# include <cassert>
+# include <cstddef>
+# include <utility>
+# include <vector>
+# include "matrix.hh"
+# include "qr.hh"
+# include "vector.hh"
+
+namespace opl
+{
+
+	/// Householder QR factorization of a m x n matrix, m >= n, A = QR
+	/// R and the reflectors share a single matrix, Q is only formed on request
+	/// Repeated least squares solves only cost Q^T b and a triangular solve
+	template <class T>
+	class QrFactor
+	{
+
+	public:
+		using size_type = std::size_t;
+
+		QrFactor ();
+
+		explicit QrFactor (const Matrix<T>& a);
+
+		///Factorizes the storage of a, without any copy
+		explicit QrFactor (Matrix<T>&& a);
+
+		///Factorizes a, reusing the current storage when possible
+		void
+		factorize (const Matrix<T>& a);
+
+		void
+		factorize (Matrix<T>&& a);
+
+		size_type
+		rows () const;
+
+		size_type
+		cols () const;
+
+		///Returns true if R has a zero on its diagonal
+		bool
+		is_rank_deficient () const;
+
+		///det(A), A square
+		T
+		determinant () const;
+
+		///Returns x: Ax = b, A square
+		Vector<T>
+		solve_system (const Vector<T>& b) const;
+
+		///Returns X: AX = B, A square
+		Matrix<T>
+		solve_systems (const Matrix<T>& b) const;
+
+		///Returns x minimizing ||Ax - b||, A full rank
+		Vector<T>
+		least_squares (const Vector<T>& b) const;
+
+		///Returns X minimizing ||AX - B|| column by column, A full rank
+		Matrix<T>
+		least_squares (const Matrix<T>& b) const;
+
+		///Inverse of A, A square
+		Matrix<T>
+		inverse () const;
+
+		///b <- Q^T b
+		void
+		apply_qt (Vector<T>& b) const;
+
+		///B <- Q^T B
+		void
+		apply_qt (Matrix<T>& b) const;
+
+		///b <- Q b
+		void
+		apply_q (Vector<T>& b) const;
+
+		///B <- Q B
+		void
+		apply_q (Matrix<T>& b) const;
+
+		///Orthogonal factor, rows x rows
+		Matrix<T>
+		q_get () const;
+
+		///First cols columns of Q, rows x cols
+		Matrix<T>
+		thin_q_get () const;
+
+		///Upper triangular factor, cols x cols
+		Matrix<T>
+		r_get () const;
+
+		///R on and above the diagonal, the reflectors below it
+		const Matrix<T>&
+		qr () const;
+
+		///Scaling factors of the reflectors
+		const std::vector<T>&
+		tau () const;
+
+	private:
+		void
+		factorize_ ();
+
+		Matrix<T> qr_;
+		std::vector<T> tau_;
+		std::vector<T> t_;
+
+	};
+
+	template <class T>
+	QrFactor<T>::QrFactor ()
+	{
+
+	}
+
+	template <class T>
+	QrFactor<T>::QrFactor (const Matrix<T>& a)
+		: qr_ (a)
+	{
+		factorize_ ();
+	}
+
+	template <class T>
+	QrFactor<T>::QrFactor (Matrix<T>&& a)
+		: qr_ (std::move (a))
+	{
+		factorize_ ();
+	}
+
+	template <class T>
+	void
+	QrFactor<T>::factorize (const Matrix<T>& a)
+	{
+		qr_ = a;
+		factorize_ ();
+	}
+
+	template <class T>
+	void
+	QrFactor<T>::factorize (Matrix<T>&& a)
+	{
+		qr_ = std::move (a);
+		factorize_ ();
+	}
+
+	template <class T>
+	typename QrFactor<T>::size_type
+	QrFactor<T>::rows () const
+	{
+		return qr_.rows ();
+	}
+
+	template <class T>
+	typename QrFactor<T>::size_type
+	QrFactor<T>::cols () const
+	{
+		return qr_.cols ();
+	}
+
+	template <class T>
+	bool
+	QrFactor<T>::is_rank_deficient () const
+	{
+		for (size_type i = 0; i < cols (); ++i)
+			if (qr_.at (i, i) == static_cast<T> (0))
+				return true;
+		return false;
+	}
+
+	template <class T>
+	T
+	QrFactor<T>::determinant () const
+	{
+		assert (rows () == cols ());
+		T det = 1;
+		for (size_type i = 0; i < cols (); ++i)
+			det *= tau_[i] == static_cast<T> (0) ? qr_.at (i, i) : -qr_.at (i, i);
+		return det;
+	}
+
+	template <class T>
+	Vector<T>
+	QrFactor<T>::solve_system (const Vector<T>& b) const
+	{
+		assert (rows () == cols ());
+		return least_squares (b);
+	}
+
+	template <class T>
+	Matrix<T>
+	QrFactor<T>::solve_systems (const Matrix<T>& b) const
+	{
+		assert (rows () == cols ());
+		return least_squares (b);
+	}
+
+	template <class T>
+	Vector<T>
+	QrFactor<T>::least_squares (const Vector<T>& b) const
+	{
+		assert (b.size () == rows ());
+		Vector<T> x (b);
+		linalg::qr_solve (rows (), cols (), qr_.data (), cols (), t_.data (),
+						  size_type (1), x.data (), size_type (1));
+		x.resize (cols ());
+		return x;
+	}
+
+	template <class T>
+	Matrix<T>
+	QrFactor<T>::least_squares (const Matrix<T>& b) const
+	{
+		assert (b.rows () == rows ());
+		Matrix<T> x (b);
+		linalg::qr_solve (rows (), cols (), qr_.data (), cols (), t_.data (),
+						  x.cols (), x.data (), x.cols ());
+		if (rows () != cols ())
+			x = x.region_matrix (0, 0, cols (), x.cols ());
+		return x;
+	}
+
+	template <class T>
+	Matrix<T>
+	QrFactor<T>::inverse () const
+	{
+		return solve_systems (Matrix<T>::id (rows ()));
+	}
+
+	template <class T>
+	void
+	QrFactor<T>::apply_qt (Vector<T>& b) const
+	{
+		assert (b.size () == rows ());
+		linalg::qr_apply_qt (rows (), cols (), qr_.data (), cols (), t_.data (),
+							 size_type (1), b.data (), size_type (1));
+	}
+
+	template <class T>
+	void
+	QrFactor<T>::apply_qt (Matrix<T>& b) const
+	{
+		assert (b.rows () == rows ());
+		linalg::qr_apply_qt (rows (), cols (), qr_.data (), cols (), t_.data (),
+							 b.cols (), b.data (), b.cols ());
+	}
+
+	template <class T>
+	void
+	QrFactor<T>::apply_q (Vector<T>& b) const
+	{
+		assert (b.size () == rows ());
+		linalg::qr_apply_q (rows (), cols (), qr_.data (), cols (), t_.data (),
+							size_type (1), b.data (), size_type (1));
+	}
+
+	template <class T>
+	void
+	QrFactor<T>::apply_q (Matrix<T>& b) const
+	{
+		assert (b.rows () == rows ());
+		linalg::qr_apply_q (rows (), cols (), qr_.data (), cols (), t_.data (),
+							b.cols (), b.data (), b.cols ());
+	}
+
+	template <class T>
+	Matrix<T>
+	QrFactor<T>::q_get () const
+	{
+		Matrix<T> q (rows (), rows ());
+		linalg::qr_form_q (rows (), cols (), qr_.data (), cols (), t_.data (),
+						   rows (), q.data (), rows ());
+		return q;
+	}
+
+	template <class T>
+	Matrix<T>
+	QrFactor<T>::thin_q_get () const
+	{
+		Matrix<T> q (rows (), cols ());
+		linalg::qr_form_q (rows (), cols (), qr_.data (), cols (), t_.data (),
+						   cols (), q.data (), cols ());
+		return q;
+	}
+
+	template <class T>
+	Matrix<T>
+	QrFactor<T>::r_get () const
+	{
+		size_type p = cols ();
+		Matrix<T> r (p, p, static_cast<T> (0));
+		for (size_type i = 0; i < p; ++i)
+			for (size_type j = i; j < p; ++j)
+				r.at (i, j) = qr_.at (i, j);
+		return r;
+	}
+
+	template <class T>
+	const Matrix<T>&
+	QrFactor<T>::qr () const
+	{
+		return qr_;
+	}
+
+	template <class T>
+	const std::vector<T>&
+	QrFactor<T>::tau () const
+	{
+		return tau_;
+	}
+
+	template <class T>
+	void
+	QrFactor<T>::factorize_ ()
+	{
+		assert (qr_.rows () >= qr_.cols ());
+		tau_.resize (cols ());
+		t_.resize (linalg::qr_t_size (rows (), cols ()));
+		linalg::qr_factorize (rows (), cols (), qr_.data (), cols (),
+							  tau_.data (), t_.data ());
+	}
+
+}
+
+#endif //!QR_FACTOR_HH_
@@ -0,0 +1,275 @@
+/** @file In-place blocked Householder QR factorization
+ *
+ * The m x n row-major matrix A is overwritten by R and the Householder
+ * vectors (A = QR): R on and above the diagonal, the vector v_j of the
+ * reflector H_j = I - tau_j v_j v_j^T below it, with an implicit 1 on the
+ * diagonal. Q = H_0 H_1 ... H_k-1 is never formed unless asked for.
+ * Reflectors are grouped by panels of OPL_QR_BLOCK columns in the compact
+ * WY form H_j0 ... H_j1-1 = I - V T V^T, so applying Q or Q^T to a matrix
+ * is two gemm calls per panel.
+ * The T matrices are kept next to the factorization: the panel starting at
+ * column j0 has its jb x jb upper triangular T at t + j0 * OPL_QR_BLOCK,
+ * with a row stride of OPL_QR_BLOCK.
+ */
+
+#ifndef QR_HH_
+# define QR_HH_
+
+# include <algorithm>
+# include <cmath>
+# include <cstddef>
+# include <vector>
+# include "gemm.hh"
+# include "triangular.hh"
+
+///Panel width of the blocked QR
+# define OPL_QR_BLOCK 32
+
+namespace opl
+{
+
+	namespace linalg
+	{
+
+		///Size of the T buffer for a m x n factorization
+		inline std::size_t
+		qr_t_size (std::size_t m, std::size_t n)
+		{
+			return std::min (m, n) * OPL_QR_BLOCK;
+		}
+
+		///C <- (I - V T V^T) C, or (I - V T^T V^T) C if trans
+		///V is m x jb, unit lower trapezoidal, stored below the diagonal of v
+		///C is m x nc, v_buf and w_buf hold m * jb and jb * nc values
+		template <class T>
+		void
+		qr_apply_block_ (std::size_t m, std::size_t jb, const T* v,
+						 std::size_t ldv, const T* t, bool trans,
+						 std::size_t nc, T* c, std::size_t ldc,
+						 T* v_buf, T* w_buf)
+		{
+			constexpr std::size_t ldt = OPL_QR_BLOCK;
+			if (!nc)
+				return;
+
+			for (std::size_t i = 0; i < m; ++i)
+				for (std::size_t j = 0; j < jb; ++j)
+					v_buf[i * jb + j] = i > j ? v[i * ldv + j]
+						: i == j ? static_cast<T> (1) : static_cast<T> (0);
+
+			//W <- V^T C
+			gemm (jb, nc, m, static_cast<T> (1),
+				  v_buf, std::size_t (1), jb,
+				  c, ldc, std::size_t (1),
+				  static_cast<T> (0), w_buf, nc, std::size_t (1));
+
+			//W <- T W or T^T W, in place
+			if (trans)
+				for (std::size_t i = jb - 1; i < jb; --i)
+				{
+					T* wi = w_buf + i * nc;
+					T tii = t[i * ldt + i];
+					for (std::size_t c2 = 0; c2 < nc; ++c2)
+						wi[c2] *= tii;
+					for (std::size_t q = 0; q < i; ++q)
+					{
+						T tqi = t[q * ldt + i];
+						const T* wq = w_buf + q * nc;
+						for (std::size_t c2 = 0; c2 < nc; ++c2)
+							wi[c2] += tqi * wq[c2];
+					}
+				}
+			else
+				for (std::size_t i = 0; i < jb; ++i)
+				{
+					T* wi = w_buf + i * nc;
+					T tii = t[i * ldt + i];
+					for (std::size_t c2 = 0; c2 < nc; ++c2)
+						wi[c2] *= tii;
+					for (std::size_t q = i + 1; q < jb; ++q)
+					{
+						T tiq = t[i * ldt + q];
+						const T* wq = w_buf + q * nc;
+						for (std::size_t c2 = 0; c2 < nc; ++c2)
+							wi[c2] += tiq * wq[c2];
+					}
+				}
+
+			//C <- C - V W
+			gemm (m, nc, jb, static_cast<T> (-1),
+				  v_buf, jb, std::size_t (1),
+				  w_buf, nc, std::size_t (1),
+				  static_cast<T> (1), c, ldc, std::size_t (1));
+		}
+
+		///Factorizes A in place
+		///tau holds min(m, n) values, t holds qr_t_size (m, n) values
+		template <class T>
+		void
+		qr_factorize (std::size_t m, std::size_t n, T* a, std::size_t lda,
+					  T* tau, T* t)
+		{
+			constexpr std::size_t nb = OPL_QR_BLOCK;
+			std::size_t k = std::min (m, n);
+			std::vector<T> w (nb);
+			std::vector<T> v_buf;
+			std::vector<T> w_buf;
+
+			for (std::size_t j0 = 0; j0 < k; j0 += nb)
+			{
+				std::size_t jb = std::min (nb, k - j0);
+				std::size_t j1 = j0 + jb;
+				T* tb = t + j0 * nb;
+
+				//Unblocked factorization of the panel A[j0:m, j0:j1]
+				for (std::size_t j = j0; j < j1; ++j)
+				{
+					T alpha = a[j * lda + j];
+					T xnorm2 = 0;
+					for (std::size_t i = j + 1; i < m; ++i)
+						xnorm2 += a[i * lda + j] * a[i * lda + j];
+
+					if (xnorm2 == static_cast<T> (0))
+					{
+						tau[j] = 0;
+						continue;
+					}
+
+					T norm = std::sqrt (alpha * alpha + xnorm2);
+					T beta = alpha >= 0 ? -norm : norm;
+					tau[j] = (beta - alpha) / beta;
+					T scale = 1 / (alpha - beta);
+					for (std::size_t i = j + 1; i < m; ++i)
+						a[i * lda + j] *= scale;
+					a[j * lda + j] = beta;
+
+					//A[j:m, j+1:j1] <- H_j A[j:m, j+1:j1]
+					for (std::size_t c = j + 1; c < j1; ++c)
+						w[c - j0] = a[j * lda + c];
+					for (std::size_t i = j + 1; i < m; ++i)
+					{
+						const T* ai = a + i * lda;
+						for (std::size_t c = j + 1; c < j1; ++c)
+							w[c - j0] += ai[j] * ai[c];
+					}
+					for (std::size_t c = j + 1; c < j1; ++c)
+						w[c - j0] *= tau[j];
+					for (std::size_t c = j + 1; c < j1; ++c)
+						a[j * lda + c] -= w[c - j0];
+					for (std::size_t i = j + 1; i < m; ++i)
+					{
+						T* ai = a + i * lda;
+						for (std::size_t c = j + 1; c < j1; ++c)
+							ai[c] -= ai[j] * w[c - j0];
+					}
+				}
+
+				//T of the panel, column by column:
+				//T[0:i, i] = -tau_i T[0:i, 0:i] V[:, 0:i]^T v_i
+				for (std::size_t i = 0; i < jb; ++i)
+				{
+					std::size_t ji = j0 + i;
+					for (std::size_t r = 0; r < i; ++r)
+						w[r] = a[ji * lda + j0 + r];
+					for (std::size_t p = ji + 1; p < m; ++p)
+					{
+						const T* ap = a + p * lda + j0;
+						for (std::size_t r = 0; r < i; ++r)
+							w[r] += ap[r] * ap[i];
+					}
+
+					for (std::size_t r = 0; r < i; ++r)
+					{
+						T val = 0;
+						for (std::size_t q = r; q < i; ++q)
+							val += tb[r * nb + q] * w[q];
+						tb[r * nb + i] = -tau[ji] * val;
+					}
+					tb[i * nb + i] = tau[ji];
+					for (std::size_t r = i + 1; r < jb; ++r)
+						tb[r * nb + i] = 0;
+				}
+
+				//A[j0:m, j1:n] <- (I - V T^T V^T) A[j0:m, j1:n]
+				if (j1 < n)
+				{
+					v_buf.resize ((m - j0) * jb);
+					w_buf.resize (jb * (n - j1));
+					qr_apply_block_ (m - j0, jb, a + j0 * lda + j0, lda, tb, true,
+									 n - j1, a + j0 * lda + j1, lda,
+									 v_buf.data (), w_buf.data ());
+				}
+			}
+		}
+
+		///C <- Q^T C, with a and t computed by qr_factorize
+		///C is m x nc, row-major
+		template <class T>
+		void
+		qr_apply_qt (std::size_t m, std::size_t n, const T* a, std::size_t lda,
+					 const T* t, std::size_t nc, T* c, std::size_t ldc)
+		{
+			constexpr std::size_t nb = OPL_QR_BLOCK;
+			std::size_t k = std::min (m, n);
+			std::vector<T> v_buf (m * std::min (nb, k));
+			std::vector<T> w_buf (std::min (nb, k) * nc);
+
+			for (std::size_t j0 = 0; j0 < k; j0 += nb)
+			{
+				std::size_t jb = std::min (nb, k - j0);
+				qr_apply_block_ (m - j0, jb, a + j0 * lda + j0, lda, t + j0 * nb,
+								 true, nc, c + j0 * ldc, ldc,
+								 v_buf.data (), w_buf.data ());
+			}
+		}
+
+		///C <- Q C, with a and t computed by qr_factorize
+		///C is m x nc, row-major
+		template <class T>
+		void
+		qr_apply_q (std::size_t m, std::size_t n, const T* a, std::size_t lda,
+					const T* t, std::size_t nc, T* c, std::size_t ldc)
+		{
+			constexpr std::size_t nb = OPL_QR_BLOCK;
+			std::size_t k = std::min (m, n);
+			std::vector<T> v_buf (m * std::min (nb, k));
+			std::vector<T> w_buf (std::min (nb, k) * nc);
+
+			for (std::size_t j0 = k ? (k - 1) / nb * nb : 0; j0 < k; j0 -= nb)
+			{
+				std::size_t jb = std::min (nb, k - j0);
+				qr_apply_block_ (m - j0, jb, a + j0 * lda + j0, lda, t + j0 * nb,
+								 false, nc, c + j0 * ldc, ldc,
+								 v_buf.data (), w_buf.data ());
+			}
+		}
+
+		///Q[:, 0:nq] in q (m x nq), with a and t computed by qr_factorize
+		template <class T>
+		void
+		qr_form_q (std::size_t m, std::size_t n, const T* a, std::size_t lda,
+				   const T* t, std::size_t nq, T* q, std::size_t ldq)
+		{
+			for (std::size_t i = 0; i < m; ++i)
+				for (std::size_t j = 0; j < nq; ++j)
+					q[i * ldq + j] = i == j ? static_cast<T> (1)
+						: static_cast<T> (0);
+			qr_apply_q (m, n, a, lda, t, nq, q, ldq);
+		}
+
+		///Least squares solution of AX = B, A full column rank (m >= n)
+		///B is m x nrhs, X is written to its n first rows
+		template <class T>
+		void
+		qr_solve (std::size_t m, std::size_t n, const T* a, std::size_t lda,
+				  const T* t, std::size_t nrhs, T* b, std::size_t ldb)
+		{
+			qr_apply_qt (m, n, a, lda, t, nrhs, b, ldb);
+			upper_solve (n, nrhs, a, lda, b, ldb);
+		}
+
+	}
+
+}
+
+#endif //!QR_HH_
@@ -0,0 +1,746 @@
+/** @file Vectorized reductions over contiguous arrays
+ *
+ * Every reduction keeps 4 independent accumulators of one SIMD register
+ * each, so consecutive additions don't wait for each other, and folds
+ * them at the end.
+ * float and double use SSE2 or AVX registers depending on the target flags
+ * (-msse2, -mavx, -mfma), other arithmetic types use 4 scalar accumulators.
+ * The order of the additions differs from a plain loop: results may differ
+ * in the last bits. sum_pairwise and sum_kahan bound the rounding error
+ * for long arrays (sum_kahan is defeated by -ffast-math).
+ * Ops also has the comparisons and lane selection needed by branch-free
+ * kernels, such as the batched factorizations of batch-matrix.hh.
+ */
+
+#ifndef SIMD_REDUCE_HH_
+# define SIMD_REDUCE_HH_
+
+# include <cstddef>
+# include <cmath>
+
+# if defined (__AVX__)
+#  include <immintrin.h>
+#  define OPL_SIMD_AVX
+# elif defined (__SSE2__)
+#  include <emmintrin.h>
+#  define OPL_SIMD_SSE2
+# endif
+
+///Under this number of values, sum_pairwise doesn't split any more
+# define OPL_SIMD_PAIRWISE_BLOCK 256
+
+namespace opl
+{
+
+	namespace simd
+	{
+
+		///One lane operations, used for types without SIMD registers and
+		///for the values left after the last full register
+		template <class T>
+		struct Scalar
+		{
+			typedef T reg;
+			typedef bool mask;
+			static constexpr std::size_t width = 1;
+
+			static reg
+			zero ()
+			{
+				return static_cast<T> (0);
+			}
+
+			static reg
+			set1 (T x)
+			{
+				return x;
+			}
+
+			static reg
+			load (const T* p)
+			{
+				return *p;
+			}
+
+			static void
+			store (T* p, reg a)
+			{
+				*p = a;
+			}
+
+			static reg
+			add (reg a, reg b)
+			{
+				return a + b;
+			}
+
+			static reg
+			sub (reg a, reg b)
+			{
+				return a - b;
+			}
+
+			static reg
+			mul (reg a, reg b)
+			{
+				return a * b;
+			}
+
+			static reg
+			fmadd (reg a, reg b, reg c)
+			{
+				return a * b + c;
+			}
+
+			static reg
+			abs (reg a)
+			{
+				return std::abs (a);
+			}
+
+			static reg
+			div (reg a, reg b)
+			{
+				return a / b;
+			}
+
+			static reg
+			sqrt (reg a)
+			{
+				return std::sqrt (a);
+			}
+
+			static mask
+			gt (reg a, reg b)
+			{
+				return a > b;
+			}
+
+			static mask
+			eq (reg a, reg b)
+			{
+				return a == b;
+			}
+
+			///a where m is set, b elsewhere
+			static reg
+			select (mask m, reg a, reg b)
+			{
+				return m ? a : b;
+			}
+		};
+
+		///Register type and operations for the type T
+		template <class T>
+		struct Ops : Scalar<T>
+		{
+
+		};
+
+# if defined (OPL_SIMD_AVX)
+
+		template <>
+		struct Ops<double>
+		{
+			typedef __m256d reg;
+			typedef __m256d mask;
+			static constexpr std::size_t width = 4;
+
+			static reg
+			zero ()
+			{
+				return _mm256_setzero_pd ();
+			}
+
+			static reg
+			set1 (double x)
+			{
+				return _mm256_set1_pd (x);
+			}
+
+			static reg
+			load (const double* p)
+			{
+				return _mm256_loadu_pd (p);
+			}
+
+			static void
+			store (double* p, reg a)
+			{
+				_mm256_storeu_pd (p, a);
+			}
+
+			static reg
+			add (reg a, reg b)
+			{
+				return _mm256_add_pd (a, b);
+			}
+
+			static reg
+			sub (reg a, reg b)
+			{
+				return _mm256_sub_pd (a, b);
+			}
+
+			static reg
+			mul (reg a, reg b)
+			{
+				return _mm256_mul_pd (a, b);
+			}
+
+			static reg
+			fmadd (reg a, reg b, reg c)
+			{
+#  if defined (__FMA__)
+				return _mm256_fmadd_pd (a, b, c);
+#  else
+				return _mm256_add_pd (_mm256_mul_pd (a, b), c);
+#  endif
+			}
+
+			static reg
+			abs (reg a)
+			{
+				return _mm256_andnot_pd (_mm256_set1_pd (-0.0), a);
+			}
+
+			static reg
+			div (reg a, reg b)
+			{
+				return _mm256_div_pd (a, b);
+			}
+
+			static reg
+			sqrt (reg a)
+			{
+				return _mm256_sqrt_pd (a);
+			}
+
+			static mask
+			gt (reg a, reg b)
+			{
+				return _mm256_cmp_pd (a, b, _CMP_GT_OQ);
+			}
+
+			static mask
+			eq (reg a, reg b)
+			{
+				return _mm256_cmp_pd (a, b, _CMP_EQ_OQ);
+			}
+
+			static reg
+			select (mask m, reg a, reg b)
+			{
+				return _mm256_blendv_pd (b, a, m);
+			}
+		};
+
+		template <>
+		struct Ops<float>
+		{
+			typedef __m256 reg;
+			typedef __m256 mask;
+			static constexpr std::size_t width = 8;
+
+			static reg
+			zero ()
+			{
+				return _mm256_setzero_ps ();
+			}
+
+			static reg
+			set1 (float x)
+			{
+				return _mm256_set1_ps (x);
+			}
+
+			static reg
+			load (const float* p)
+			{
+				return _mm256_loadu_ps (p);
+			}
+
+			static void
+			store (float* p, reg a)
+			{
+				_mm256_storeu_ps (p, a);
+			}
+
+			static reg
+			add (reg a, reg b)
+			{
+				return _mm256_add_ps (a, b);
+			}
+
+			static reg
+			sub (reg a, reg b)
+			{
+				return _mm256_sub_ps (a, b);
+			}
+
+			static reg
+			mul (reg a, reg b)
+			{
+				return _mm256_mul_ps (a, b);
+			}
+
+			static reg
+			fmadd (reg a, reg b, reg c)
+			{
+#  if defined (__FMA__)
+				return _mm256_fmadd_ps (a, b, c);
+#  else
+				return _mm256_add_ps (_mm256_mul_ps (a, b), c);
+#  endif
+			}
+
+			static reg
+			abs (reg a)
+			{
+				return _mm256_andnot_ps (_mm256_set1_ps (-0.0f), a);
+			}
+
+			static reg
+			div (reg a, reg b)
+			{
+				return _mm256_div_ps (a, b);
+			}
+
+			static reg
+			sqrt (reg a)
+			{
+				return _mm256_sqrt_ps (a);
+			}
+
+			static mask
+			gt (reg a, reg b)
+			{
+				return _mm256_cmp_ps (a, b, _CMP_GT_OQ);
+			}
+
+			static mask
+			eq (reg a, reg b)
+			{
+				return _mm256_cmp_ps (a, b, _CMP_EQ_OQ);
+			}
+
+			static reg
+			select (mask m, reg a, reg b)
+			{
+				return _mm256_blendv_ps (b, a, m);
+			}
+		};
+
+# elif defined (OPL_SIMD_SSE2)
+
+		template <>
+		struct Ops<double>
+		{
+			typedef __m128d reg;
+			typedef __m128d mask;
+			static constexpr std::size_t width = 2;
+
+			static reg
+			zero ()
+			{
+				return _mm_setzero_pd ();
+			}
+
+			static reg
+			set1 (double x)
+			{
+				return _mm_set1_pd (x);
+			}
+
+			static reg
+			load (const double* p)
+			{
+				return _mm_loadu_pd (p);
+			}
+
+			static void
+			store (double* p, reg a)
+			{
+				_mm_storeu_pd (p, a);
+			}
+
+			static reg
+			add (reg a, reg b)
+			{
+				return _mm_add_pd (a, b);
+			}
+
+			static reg
+			sub (reg a, reg b)
+			{
+				return _mm_sub_pd (a, b);
+			}
+
+			static reg
+			mul (reg a, reg b)
+			{
+				return _mm_mul_pd (a, b);
+			}
+
+			static reg
+			fmadd (reg a, reg b, reg c)
+			{
+				return add (mul (a, b), c);
+			}
+
+			static reg
+			abs (reg a)
+			{
+				return _mm_andnot_pd (_mm_set1_pd (-0.0), a);
+			}
+
+			static reg
+			div (reg a, reg b)
+			{
+				return _mm_div_pd (a, b);
+			}
+
+			static reg
+			sqrt (reg a)
+			{
+				return _mm_sqrt_pd (a);
+			}
+
+			static mask
+			gt (reg a, reg b)
+			{
+				return _mm_cmpgt_pd (a, b);
+			}
+
+			static mask
+			eq (reg a, reg b)
+			{
+				return _mm_cmpeq_pd (a, b);
+			}
+
+			static reg
+			select (mask m, reg a, reg b)
+			{
+				return _mm_or_pd (_mm_and_pd (m, a), _mm_andnot_pd (m, b));
+			}
+		};
+
+		template <>
+		struct Ops<float>
+		{
+			typedef __m128 reg;
+			typedef __m128 mask;
+			static constexpr std::size_t width = 4;
+
+			static reg
+			zero ()
+			{
+				return _mm_setzero_ps ();
+			}
+
+			static reg
+			set1 (float x)
+			{
+				return _mm_set1_ps (x);
+			}
+
+			static reg
+			load (const float* p)
+			{
+				return _mm_loadu_ps (p);
+			}
+
+			static void
+			store (float* p, reg a)
+			{
+				_mm_storeu_ps (p, a);
+			}
+
+			static reg
+			add (reg a, reg b)
+			{
+				return _mm_add_ps (a, b);
+			}
+
+			static reg
+			sub (reg a, reg b)
+			{
+				return _mm_sub_ps (a, b);
+			}
+
+			static reg
+			mul (reg a, reg b)
+			{
+				return _mm_mul_ps (a, b);
+			}
+
+			static reg
+			fmadd (reg a, reg b, reg c)
+			{
+				return add (mul (a, b), c);
+			}
+
+			static reg
+			abs (reg a)
+			{
+				return _mm_andnot_ps (_mm_set1_ps (-0.0f), a);
+			}
+
+			static reg
+			div (reg a, reg b)
+			{
+				return _mm_div_ps (a, b);
+			}
+
+			static reg
+			sqrt (reg a)
+			{
+				return _mm_sqrt_ps (a);
+			}
+
+			static mask
+			gt (reg a, reg b)
+			{
+				return _mm_cmpgt_ps (a, b);
+			}
+
+			static mask
+			eq (reg a, reg b)
+			{
+				return _mm_cmpeq_ps (a, b);
+			}
+
+			static reg
+			select (mask m, reg a, reg b)
+			{
+				return _mm_or_ps (_mm_and_ps (m, a), _mm_andnot_ps (m, b));
+			}
+		};
+
+# endif
+
+		///Sum of the lanes of a
+		template <class T>
+		T
+		fold_ (typename Ops<T>::reg a)
+		{
+			constexpr std::size_t w = Ops<T>::width;
+			T lanes[w];
+			Ops<T>::store (lanes, a);
+			T res = lanes[0];
+			for (std::size_t i = 1; i < w; ++i)
+				res += lanes[i];
+			return res;
+		}
+
+		///Accumulates vf (acc, i) over the full registers of [0, n), with 4
+		///accumulators, and sf (acc, i) over the values left
+		template <class T, class VF, class SF>
+		T
+		reduce_ (std::size_t n, VF vf, SF sf)
+		{
+			using S = Ops<T>;
+			constexpr std::size_t w = S::width;
+			typename S::reg a0 = S::zero ();
+			typename S::reg a1 = S::zero ();
+			typename S::reg a2 = S::zero ();
+			typename S::reg a3 = S::zero ();
+			std::size_t i = 0;
+			for (; i + 4 * w <= n; i += 4 * w)
+			{
+				a0 = vf (a0, i);
+				a1 = vf (a1, i + w);
+				a2 = vf (a2, i + 2 * w);
+				a3 = vf (a3, i + 3 * w);
+			}
+			for (; i + w <= n; i += w)
+				a0 = vf (a0, i);
+			T res = fold_<T> (S::add (S::add (a0, a1), S::add (a2, a3)));
+			for (; i < n; ++i)
+				res = sf (res, i);
+			return res;
+		}
+
+		template <class T>
+		T
+		sum (const T* x, std::size_t n)
+		{
+			using S = Ops<T>;
+			return reduce_<T> (n,
+							   [x](typename S::reg a, std::size_t i) {
+								   return S::add (a, S::load (x + i));
+							   },
+							   [x](T a, std::size_t i) { return a + x[i]; });
+		}
+
+		template <class T>
+		T
+		sum_abs (const T* x, std::size_t n)
+		{
+			using S = Ops<T>;
+			return reduce_<T> (n,
+							   [x](typename S::reg a, std::size_t i) {
+								   return S::add (a, S::abs (S::load (x + i)));
+							   },
+							   [x](T a, std::size_t i) {
+								   return a + std::abs (x[i]);
+							   });
+		}
+
+		template <class T>
+		T
+		norm_square (const T* x, std::size_t n)
+		{
+			using S = Ops<T>;
+			return reduce_<T> (n,
+							   [x](typename S::reg a, std::size_t i) {
+								   typename S::reg v = S::load (x + i);
+								   return S::fmadd (v, v, a);
+							   },
+							   [x](T a, std::size_t i) { return a + x[i] * x[i]; });
+		}
+
+		template <class T>
+		T
+		dot (const T* x, const T* y, std::size_t n)
+		{
+			using S = Ops<T>;
+			return reduce_<T> (n,
+							   [x, y](typename S::reg a, std::size_t i) {
+								   return S::fmadd (S::load (x + i),
+													S::load (y + i), a);
+							   },
+							   [x, y](T a, std::size_t i) {
+								   return a + x[i] * y[i];
+							   });
+		}
+
+		template <class T>
+		T
+		distance_square (const T* x, const T* y, std::size_t n)
+		{
+			using S = Ops<T>;
+			return reduce_<T> (n,
+							   [x, y](typename S::reg a, std::size_t i) {
+								   typename S::reg d = S::sub (S::load (x + i),
+															   S::load (y + i));
+								   return S::fmadd (d, d, a);
+							   },
+							   [x, y](T a, std::size_t i) {
+								   return a + (x[i] - y[i]) * (x[i] - y[i]);
+							   });
+		}
+
+		template <class T>
+		T
+		product (const T* x, std::size_t n)
+		{
+			using S = Ops<T>;
+			constexpr std::size_t w = S::width;
+			typename S::reg a0 = S::set1 (static_cast<T> (1));
+			typename S::reg a1 = a0;
+			std::size_t i = 0;
+			for (; i + 2 * w <= n; i += 2 * w)
+			{
+				a0 = S::mul (a0, S::load (x + i));
+				a1 = S::mul (a1, S::load (x + i + w));
+			}
+			T lanes[w];
+			S::store (lanes, S::mul (a0, a1));
+			T res = lanes[0];
+			for (std::size_t j = 1; j < w; ++j)
+				res *= lanes[j];
+			for (; i < n; ++i)
+				res *= x[i];
+			return res;
+		}
+
+		///y <- y + ax
+		template <class T>
+		void
+		axpy (std::size_t n, T a, const T* x, T* y)
+		{
+			using S = Ops<T>;
+			constexpr std::size_t w = S::width;
+			typename S::reg va = S::set1 (a);
+			std::size_t i = 0;
+			for (; i + w <= n; i += w)
+				S::store (y + i, S::fmadd (va, S::load (x + i), S::load (y + i)));
+			for (; i < n; ++i)
+				y[i] += a * x[i];
+		}
+
+		///z <- x + ay
+		template <class T>
+		void
+		axpy (std::size_t n, const T* x, T a, const T* y, T* z)
+		{
+			using S = Ops<T>;
+			constexpr std::size_t w = S::width;
+			typename S::reg va = S::set1 (a);
+			std::size_t i = 0;
+			for (; i + w <= n; i += w)
+				S::store (z + i, S::fmadd (va, S::load (y + i), S::load (x + i)));
+			for (; i < n; ++i)
+				z[i] = x[i] + a * y[i];
+		}
+
+		///Sum of halves, recursively: the error grows with log(n) instead of n
+		template <class T>
+		T
+		sum_pairwise (const T* x, std::size_t n)
+		{
+			constexpr std::size_t w = Ops<T>::width;
+			if (n <= OPL_SIMD_PAIRWISE_BLOCK)
+				return sum (x, n);
+			std::size_t h = n / 2 / w * w;
+			return sum_pairwise (x, h) + sum_pairwise (x + h, n - h);
+		}
+
+		///Compensated sum: the error doesn't grow with n
+		template <class T>
+		T
+		sum_kahan (const T* x, std::size_t n)
+		{
+			using S = Ops<T>;
+			constexpr std::size_t w = S::width;
+			typename S::reg s = S::zero ();
+			typename S::reg c = S::zero ();
+			std::size_t i = 0;
+			for (; i + w <= n; i += w)
+			{
+				typename S::reg y = S::sub (S::load (x + i), c);
+				typename S::reg t = S::add (s, y);
+				c = S::sub (S::sub (t, s), y);
+				s = t;
+			}
+
+			//Each lane holds s - c, the lanes and the values left are
+			//summed with the same compensation
+			T sl[w];
+			T cl[w];
+			S::store (sl, s);
+			S::store (cl, c);
+			T res = 0;
+			T comp = 0;
+			auto add = [&](T v) {
+				T y = v - comp;
+				T t = res + y;
+				comp = (t - res) - y;
+				res = t;
+			};
+			for (std::size_t j = 0; j < w; ++j)
+			{
+				add (sl[j]);
+				add (-cl[j]);
+			}
+			for (; i < n; ++i)
+				add (x[i]);
+			return res;
+		}
+
+	}
+
+}
+
+#endif //!SIMD_REDUCE_HH_
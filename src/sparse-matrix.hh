@@ -0,0 +1,794 @@
+/** @file SparseMatrix and SparseBuilder classes definition
+ *
+ * Compressed storage: the values of each major line (rows for CSR, columns
+ * for CSC) are stored one line after another, sorted by minor index.
+ * Line k holds the values val[ptr[k]] ... val[ptr[k+1] - 1], at the minor
+ * indexes idx[ptr[k]] ... idx[ptr[k+1] - 1].
+ * The CSR storage of A is the CSC storage of its transpose, so converting
+ * between both and transposing are the same counting sort.
+ */
+
+#ifndef SPARSE_MATRIX_HH_
+# define SPARSE_MATRIX_HH_
+
+# include <algorithm>
+# include <cassert>
+# include <cstddef>
+# include <iostream>
+# include <stdexcept>
+# include <utility>
+# include <vector>
+# include "matrix.hh"
+# include "parallel.hh"
+# include "serialization.hh"
+# include "vector.hh"
+
+namespace opl
+{
+
+	enum class SparseFormat : unsigned char
+	{
+		csr,
+		csc
+	};
+
+	namespace linalg
+	{
+
+		///y[i, :] <- sum of val[p] x[idx[p], :], for p in line i
+		///Lines are split between threads by number of values
+		template <class T>
+		void
+		sparse_gather (std::size_t lines, const std::size_t* ptr,
+					   const std::size_t* idx, const T* val,
+					   std::size_t nrhs, const T* x, std::size_t ldx,
+					   T* y, std::size_t ldy)
+		{
+			auto gather = [&](std::size_t i0, std::size_t i1) {
+				for (std::size_t i = i0; i < i1; ++i)
+				{
+					T* yi = y + i * ldy;
+					std::fill (yi, yi + nrhs, static_cast<T> (0));
+					for (std::size_t p = ptr[i]; p < ptr[i + 1]; ++p)
+					{
+						T a = val[p];
+						const T* xj = x + idx[p] * ldx;
+						for (std::size_t c = 0; c < nrhs; ++c)
+							yi[c] += a * xj[c];
+					}
+				}
+			};
+
+			std::size_t nnz = ptr[lines];
+			std::size_t chunks = std::min (parallel::chunks (nnz * nrhs), lines);
+			if (chunks <= 1)
+			{
+				gather (0, lines);
+				return;
+			}
+
+			parallel::run (chunks, [&](std::size_t t) {
+					std::size_t i0 = std::upper_bound (ptr, ptr + lines,
+													   nnz * t / chunks) - ptr - 1;
+					std::size_t i1 = t + 1 == chunks ? lines
+						: std::upper_bound (ptr, ptr + lines,
+											nnz * (t + 1) / chunks) - ptr - 1;
+					if (t == 0)
+						i0 = 0;
+					gather (i0, i1);
+				});
+		}
+
+		///y <- 0, then y[idx[p], :] += val[p] x[j, :], for p in line j
+		///y is out x nrhs. Threads scatter into their own copy of y
+		template <class T>
+		void
+		sparse_scatter (std::size_t lines, std::size_t out,
+						const std::size_t* ptr, const std::size_t* idx,
+						const T* val, std::size_t nrhs, const T* x,
+						std::size_t ldx, T* y, std::size_t ldy)
+		{
+			auto scatter = [&](std::size_t j0, std::size_t j1, T* dst,
+							   std::size_t ld) {
+				for (std::size_t j = j0; j < j1; ++j)
+				{
+					const T* xj = x + j * ldx;
+					for (std::size_t p = ptr[j]; p < ptr[j + 1]; ++p)
+					{
+						T a = val[p];
+						T* yi = dst + idx[p] * ld;
+						for (std::size_t c = 0; c < nrhs; ++c)
+							yi[c] += a * xj[c];
+					}
+				}
+			};
+
+			for (std::size_t i = 0; i < out; ++i)
+				std::fill (y + i * ldy, y + i * ldy + nrhs, static_cast<T> (0));
+
+			std::size_t nnz = ptr[lines];
+			std::size_t chunks = std::min (parallel::chunks (nnz * nrhs), lines);
+			if (chunks <= 1)
+			{
+				scatter (0, lines, y, ldy);
+				return;
+			}
+
+			std::vector<T> partial ((chunks - 1) * out * nrhs,
+									static_cast<T> (0));
+			parallel::run (chunks, [&](std::size_t t) {
+					std::size_t j0 = lines * t / chunks;
+					std::size_t j1 = lines * (t + 1) / chunks;
+					if (t == 0)
+						scatter (j0, j1, y, ldy);
+					else
+						scatter (j0, j1, partial.data () + (t - 1) * out * nrhs,
+								 nrhs);
+				});
+
+			parallel::for_range (out, out * nrhs * chunks,
+								 [&](std::size_t i0, std::size_t i1) {
+					for (std::size_t t = 1; t < chunks; ++t)
+					{
+						const T* src = partial.data () + (t - 1) * out * nrhs;
+						for (std::size_t i = i0; i < i1; ++i)
+							for (std::size_t c = 0; c < nrhs; ++c)
+								y[i * ldy + c] += src[i * nrhs + c];
+					}
+				});
+		}
+
+	}
+
+	template <class T>
+	class SparseMatrix;
+
+	template <class T>
+	class SerialManager<SparseMatrix<T>>;
+
+	/// Sparse matrix in compressed row (CSR) or column (CSC) storage
+	template <class T>
+	class SparseMatrix
+	{
+
+	public:
+		typedef T value_type;
+		typedef std::size_t size_type;
+
+		///Null rows x cols matrix
+		SparseMatrix (size_type rows = 0, size_type cols = 0,
+					  SparseFormat format = SparseFormat::csr);
+
+		///Takes the compressed arrays, with sorted minor indexes in each line
+		SparseMatrix (size_type rows, size_type cols, SparseFormat format,
+					  std::vector<size_type> ptr, std::vector<size_type> idx,
+					  std::vector<T> val);
+
+		///Keeps the non-zero values of m
+		explicit SparseMatrix (const Matrix<T>& m,
+							   SparseFormat format = SparseFormat::csr);
+
+		size_type
+		rows () const;
+
+		size_type
+		cols () const;
+
+		///Number of stored values
+		size_type
+		nnz () const;
+
+		SparseFormat
+		format () const;
+
+		bool
+		is_csr () const;
+
+		bool
+		is_csc () const;
+
+		///Returns the value at (i, j), 0 if not stored
+		T
+		at (size_type i, size_type j) const;
+
+		///Start of each major line in indices () and values ()
+		const std::vector<size_type>&
+		pointers () const;
+
+		///Minor index of each value
+		const std::vector<size_type>&
+		indices () const;
+
+		const std::vector<T>&
+		values () const;
+
+		///The pattern is fixed, but values can be changed
+		std::vector<T>&
+		values ();
+
+		///Same matrix in CSR storage
+		SparseMatrix
+		to_csr () const;
+
+		///Same matrix in CSC storage
+		SparseMatrix
+		to_csc () const;
+
+		///Transpose, in the same storage
+		SparseMatrix
+		transpose () const;
+
+		Matrix<T>
+		to_matrix () const;
+
+		///Diagonal values, 0 where not stored
+		Vector<T>
+		diagonal_to_vector () const;
+
+		///y <- Ax, y is resized if needed
+		void
+		apply (const Vector<T>& x, Vector<T>& y) const;
+
+		///y <- A^T x, y is resized if needed
+		void
+		apply_transpose (const Vector<T>& x, Vector<T>& y) const;
+
+		///Y <- AX
+		void
+		apply (const Matrix<T>& x, Matrix<T>& y) const;
+
+		Vector<T>
+		transpose_product (const Vector<T>& x) const;
+
+		friend std::ostream&
+		operator<< (std::ostream& os, const SparseMatrix& m)
+		{
+			os << m.rows_ << "x" << m.cols_ << " (" << m.nnz () << "):\n";
+			for (size_type k = 0; k < m.major_ (); ++k)
+				for (size_type p = m.ptr_[k]; p < m.ptr_[k + 1]; ++p)
+				{
+					size_type i = m.is_csr () ? k : m.idx_[p];
+					size_type j = m.is_csr () ? m.idx_[p] : k;
+					os << "(" << i << ", " << j << ") " << m.val_[p] << "\n";
+				}
+			return os;
+		}
+
+	private:
+		size_type
+		major_ () const;
+
+		size_type
+		minor_ () const;
+
+		///Counting sort of the arrays by minor index:
+		///compressed arrays of the same values along the other dimension
+		void
+		swap_major_ (std::vector<size_type>& ptr, std::vector<size_type>& idx,
+					 std::vector<T>& val) const;
+
+		///y <- A x or A^T x, x and y row-major with nrhs columns
+		void
+		product_ (bool trans, size_type nrhs, const T* x, T* y) const;
+
+		size_type rows_;
+		size_type cols_;
+		SparseFormat format_;
+		std::vector<size_type> ptr_;
+		std::vector<size_type> idx_;
+		std::vector<T> val_;
+
+		friend class SerialManager<SparseMatrix>;
+
+	};
+
+	/// Coordinate (COO) list of values, compressed into a SparseMatrix
+	/// Values can be added in any order, duplicates are summed
+	template <class T>
+	class SparseBuilder
+	{
+
+	public:
+		typedef std::size_t size_type;
+
+		SparseBuilder (size_type rows, size_type cols);
+
+		void
+		reserve (size_type n);
+
+		///A[i, j] += x
+		void
+		add (size_type i, size_type j, const T& x);
+
+		///Number of values added
+		size_type
+		size () const;
+
+		void
+		clear ();
+
+		///Compressed matrix in O(size () + rows + cols)
+		SparseMatrix<T>
+		build (SparseFormat format = SparseFormat::csr) const;
+
+	private:
+		size_type rows_;
+		size_type cols_;
+		std::vector<size_type> i_;
+		std::vector<size_type> j_;
+		std::vector<T> val_;
+
+	};
+
+	template <class T>
+	Vector<T>
+	operator* (const SparseMatrix<T>& a, const Vector<T>& x)
+	{
+		Vector<T> y (a.rows ());
+		a.apply (x, y);
+		return y;
+	}
+
+	template <class T>
+	Matrix<T>
+	operator* (const SparseMatrix<T>& a, const Matrix<T>& x)
+	{
+		Matrix<T> y (a.rows (), x.cols ());
+		a.apply (x, y);
+		return y;
+	}
+
+	template <class T>
+	class SerialManager<SparseMatrix<T>>
+	{
+	public:
+		static void
+		pack (std::ostream& os, const SparseMatrix<T>& data)
+		{
+			serialize (os, data.rows_);
+			serialize (os, data.cols_);
+			serialize (os, data.format_);
+			serialize (os, data.nnz ());
+			os.write (reinterpret_cast<const char *> (data.ptr_.data ()),
+					  data.ptr_.size () * sizeof (size_t));
+			os.write (reinterpret_cast<const char *> (data.idx_.data ()),
+					  data.idx_.size () * sizeof (size_t));
+			os.write (reinterpret_cast<const char *> (data.val_.data ()),
+					  data.val_.size () * sizeof (T));
+		}
+
+		static SparseMatrix<T>
+		unpack (std::istream& is)
+		{
+			SparseMatrix<T> m;
+			m.rows_ = unserialize<size_t> (is);
+			m.cols_ = unserialize<size_t> (is);
+			m.format_ = unserialize<SparseFormat> (is);
+			size_t nnz = unserialize<size_t> (is);
+			m.ptr_.resize (m.major_ () + 1);
+			m.idx_.resize (nnz);
+			m.val_.resize (nnz);
+			is.read (reinterpret_cast<char *> (m.ptr_.data ()),
+					 m.ptr_.size () * sizeof (size_t));
+			is.read (reinterpret_cast<char *> (m.idx_.data ()),
+					 nnz * sizeof (size_t));
+			is.read (reinterpret_cast<char *> (m.val_.data ()),
+					 nnz * sizeof (T));
+			return m;
+		}
+	};
+
+	template <class T>
+	SparseMatrix<T>::SparseMatrix (size_type rows, size_type cols,
+								   SparseFormat format)
+		: rows_ (rows)
+		, cols_ (cols)
+		, format_ (format)
+		, ptr_ (major_ () + 1, 0)
+	{
+
+	}
+
+	template <class T>
+	SparseMatrix<T>::SparseMatrix (size_type rows, size_type cols,
+								   SparseFormat format,
+								   std::vector<size_type> ptr,
+								   std::vector<size_type> idx,
+								   std::vector<T> val)
+		: rows_ (rows)
+		, cols_ (cols)
+		, format_ (format)
+		, ptr_ (std::move (ptr))
+		, idx_ (std::move (idx))
+		, val_ (std::move (val))
+	{
+		assert (ptr_.size () == major_ () + 1);
+		assert (ptr_[0] == 0);
+		assert (ptr_.back () == idx_.size ());
+		assert (idx_.size () == val_.size ());
+	}
+
+	template <class T>
+	SparseMatrix<T>::SparseMatrix (const Matrix<T>& m, SparseFormat format)
+		: rows_ (m.rows ())
+		, cols_ (m.cols ())
+		, format_ (format)
+		, ptr_ (major_ () + 1, 0)
+	{
+		for (size_type k = 0; k < major_ (); ++k)
+		{
+			for (size_type l = 0; l < minor_ (); ++l)
+			{
+				const T& x = is_csr () ? m.at (k, l) : m.at (l, k);
+				if (x != static_cast<T> (0))
+				{
+					idx_.push_back (l);
+					val_.push_back (x);
+				}
+			}
+			ptr_[k + 1] = idx_.size ();
+		}
+	}
+
+	template <class T>
+	typename SparseMatrix<T>::size_type
+	SparseMatrix<T>::rows () const
+	{
+		return rows_;
+	}
+
+	template <class T>
+	typename SparseMatrix<T>::size_type
+	SparseMatrix<T>::cols () const
+	{
+		return cols_;
+	}
+
+	template <class T>
+	typename SparseMatrix<T>::size_type
+	SparseMatrix<T>::nnz () const
+	{
+		return val_.size ();
+	}
+
+	template <class T>
+	SparseFormat
+	SparseMatrix<T>::format () const
+	{
+		return format_;
+	}
+
+	template <class T>
+	bool
+	SparseMatrix<T>::is_csr () const
+	{
+		return format_ == SparseFormat::csr;
+	}
+
+	template <class T>
+	bool
+	SparseMatrix<T>::is_csc () const
+	{
+		return format_ == SparseFormat::csc;
+	}
+
+	template <class T>
+	T
+	SparseMatrix<T>::at (size_type i, size_type j) const
+	{
+		if (i >= rows_ || j >= cols_)
+			throw std::out_of_range {"Invalid index"};
+
+		size_type k = is_csr () ? i : j;
+		size_type l = is_csr () ? j : i;
+		auto begin = idx_.begin () + ptr_[k];
+		auto end = idx_.begin () + ptr_[k + 1];
+		auto it = std::lower_bound (begin, end, l);
+		if (it == end || *it != l)
+			return 0;
+		return val_[it - idx_.begin ()];
+	}
+
+	template <class T>
+	const std::vector<typename SparseMatrix<T>::size_type>&
+	SparseMatrix<T>::pointers () const
+	{
+		return ptr_;
+	}
+
+	template <class T>
+	const std::vector<typename SparseMatrix<T>::size_type>&
+	SparseMatrix<T>::indices () const
+	{
+		return idx_;
+	}
+
+	template <class T>
+	const std::vector<T>&
+	SparseMatrix<T>::values () const
+	{
+		return val_;
+	}
+
+	template <class T>
+	std::vector<T>&
+	SparseMatrix<T>::values ()
+	{
+		return val_;
+	}
+
+	template <class T>
+	SparseMatrix<T>
+	SparseMatrix<T>::to_csr () const
+	{
+		if (is_csr ())
+			return *this;
+
+		SparseMatrix res;
+		swap_major_ (res.ptr_, res.idx_, res.val_);
+		res.rows_ = rows_;
+		res.cols_ = cols_;
+		res.format_ = SparseFormat::csr;
+		return res;
+	}
+
+	template <class T>
+	SparseMatrix<T>
+	SparseMatrix<T>::to_csc () const
+	{
+		if (is_csc ())
+			return *this;
+
+		SparseMatrix res;
+		swap_major_ (res.ptr_, res.idx_, res.val_);
+		res.rows_ = rows_;
+		res.cols_ = cols_;
+		res.format_ = SparseFormat::csc;
+		return res;
+	}
+
+	template <class T>
+	SparseMatrix<T>
+	SparseMatrix<T>::transpose () const
+	{
+		SparseMatrix res;
+		swap_major_ (res.ptr_, res.idx_, res.val_);
+		res.rows_ = cols_;
+		res.cols_ = rows_;
+		res.format_ = format_;
+		return res;
+	}
+
+	template <class T>
+	Matrix<T>
+	SparseMatrix<T>::to_matrix () const
+	{
+		Matrix<T> m (rows_, cols_, static_cast<T> (0));
+		for (size_type k = 0; k < major_ (); ++k)
+			for (size_type p = ptr_[k]; p < ptr_[k + 1]; ++p)
+			{
+				if (is_csr ())
+					m.at (k, idx_[p]) = val_[p];
+				else
+					m.at (idx_[p], k) = val_[p];
+			}
+		return m;
+	}
+
+	template <class T>
+	Vector<T>
+	SparseMatrix<T>::diagonal_to_vector () const
+	{
+		size_type n = std::min (rows_, cols_);
+		Vector<T> d (n, static_cast<T> (0));
+		for (size_type k = 0; k < n; ++k)
+			d[k] = at (k, k);
+		return d;
+	}
+
+	template <class T>
+	void
+	SparseMatrix<T>::apply (const Vector<T>& x, Vector<T>& y) const
+	{
+		assert (x.size () == cols_);
+		assert (&x != &y);
+		y.resize (rows_);
+		product_ (false, 1, x.data (), y.data ());
+	}
+
+	template <class T>
+	void
+	SparseMatrix<T>::apply_transpose (const Vector<T>& x, Vector<T>& y) const
+	{
+		assert (x.size () == rows_);
+		assert (&x != &y);
+		y.resize (cols_);
+		product_ (true, 1, x.data (), y.data ());
+	}
+
+	template <class T>
+	void
+	SparseMatrix<T>::apply (const Matrix<T>& x, Matrix<T>& y) const
+	{
+		assert (x.rows () == cols_);
+		assert (&x != &y);
+		if (y.rows () != rows_ || y.cols () != x.cols ())
+			y = Matrix<T> (rows_, x.cols ());
+		product_ (false, x.cols (), x.data (), y.data ());
+	}
+
+	template <class T>
+	Vector<T>
+	SparseMatrix<T>::transpose_product (const Vector<T>& x) const
+	{
+		Vector<T> y (cols_);
+		apply_transpose (x, y);
+		return y;
+	}
+
+	template <class T>
+	typename SparseMatrix<T>::size_type
+	SparseMatrix<T>::major_ () const
+	{
+		return is_csr () ? rows_ : cols_;
+	}
+
+	template <class T>
+	typename SparseMatrix<T>::size_type
+	SparseMatrix<T>::minor_ () const
+	{
+		return is_csr () ? cols_ : rows_;
+	}
+
+	template <class T>
+	void
+	SparseMatrix<T>::swap_major_ (std::vector<size_type>& ptr,
+								  std::vector<size_type>& idx,
+								  std::vector<T>& val) const
+	{
+		size_type n = minor_ ();
+		ptr.assign (n + 1, 0);
+		idx.resize (nnz ());
+		val.resize (nnz ());
+
+		for (size_type p = 0; p < nnz (); ++p)
+			++ptr[idx_[p] + 1];
+		for (size_type l = 0; l < n; ++l)
+			ptr[l + 1] += ptr[l];
+
+		//Walking the lines in order keeps the new minor indexes sorted
+		std::vector<size_type> next (ptr.begin (), ptr.end () - 1);
+		for (size_type k = 0; k < major_ (); ++k)
+			for (size_type p = ptr_[k]; p < ptr_[k + 1]; ++p)
+			{
+				size_type q = next[idx_[p]]++;
+				idx[q] = k;
+				val[q] = val_[p];
+			}
+	}
+
+	template <class T>
+	void
+	SparseMatrix<T>::product_ (bool trans, size_type nrhs, const T* x,
+							   T* y) const
+	{
+		//CSR A and CSC A^T read a line per output value, the others scatter
+		if (is_csr () != trans)
+			linalg::sparse_gather (major_ (), ptr_.data (), idx_.data (),
+								   val_.data (), nrhs, x, nrhs, y, nrhs);
+		else
+			linalg::sparse_scatter (major_ (), minor_ (), ptr_.data (),
+									idx_.data (), val_.data (), nrhs, x, nrhs,
+									y, nrhs);
+	}
+
+	template <class T>
+	SparseBuilder<T>::SparseBuilder (size_type rows, size_type cols)
+		: rows_ (rows)
+		, cols_ (cols)
+	{
+
+	}
+
+	template <class T>
+	void
+	SparseBuilder<T>::reserve (size_type n)
+	{
+		i_.reserve (n);
+		j_.reserve (n);
+		val_.reserve (n);
+	}
+
+	template <class T>
+	void
+	SparseBuilder<T>::add (size_type i, size_type j, const T& x)
+	{
+		assert (i < rows_);
+		assert (j < cols_);
+		i_.push_back (i);
+		j_.push_back (j);
+		val_.push_back (x);
+	}
+
+	template <class T>
+	typename SparseBuilder<T>::size_type
+	SparseBuilder<T>::size () const
+	{
+		return val_.size ();
+	}
+
+	template <class T>
+	void
+	SparseBuilder<T>::clear ()
+	{
+		i_.clear ();
+		j_.clear ();
+		val_.clear ();
+	}
+
+	template <class T>
+	SparseMatrix<T>
+	SparseBuilder<T>::build (SparseFormat format) const
+	{
+		bool csr = format == SparseFormat::csr;
+		const std::vector<size_type>& major = csr ? i_ : j_;
+		const std::vector<size_type>& minor = csr ? j_ : i_;
+		size_type nmajor = csr ? rows_ : cols_;
+		size_type nminor = csr ? cols_ : rows_;
+		size_type n = size ();
+
+		//Stable counting sorts, by minor index then by major index
+		std::vector<size_type> by_minor (nminor + 1, 0);
+		for (size_type p = 0; p < n; ++p)
+			++by_minor[minor[p] + 1];
+		for (size_type l = 0; l < nminor; ++l)
+			by_minor[l + 1] += by_minor[l];
+		std::vector<size_type> order (n);
+		for (size_type p = 0; p < n; ++p)
+			order[by_minor[minor[p]]++] = p;
+
+		std::vector<size_type> ptr (nmajor + 1, 0);
+		for (size_type p = 0; p < n; ++p)
+			++ptr[major[p] + 1];
+		for (size_type k = 0; k < nmajor; ++k)
+			ptr[k + 1] += ptr[k];
+		std::vector<size_type> next (ptr.begin (), ptr.end () - 1);
+		std::vector<size_type> idx (n);
+		std::vector<T> val (n);
+		for (size_type q = 0; q < n; ++q)
+		{
+			size_type p = order[q];
+			size_type dst = next[major[p]]++;
+			idx[dst] = minor[p];
+			val[dst] = val_[p];
+		}
+
+		//Duplicates are now next to each other
+		size_type out = 0;
+		for (size_type k = 0; k < nmajor; ++k)
+		{
+			size_type begin = ptr[k];
+			ptr[k] = out;
+			for (size_type p = begin; p < ptr[k + 1]; ++p)
+			{
+				if (out > ptr[k] && idx[out - 1] == idx[p])
+					val[out - 1] += val[p];
+				else
+				{
+					idx[out] = idx[p];
+					val[out] = val[p];
+					++out;
+				}
+			}
+		}
+		ptr[nmajor] = out;
+		idx.resize (out);
+		val.resize (out);
+
+		return SparseMatrix<T> (rows_, cols_, format, std::move (ptr),
+								std::move (idx), std::move (val));
+	}
+
+}
+
+#endif //!SPARSE_MATRIX_HH_
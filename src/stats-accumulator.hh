@@ -0,0 +1,556 @@
+/** @file StatsAccumulator and QuantileSketch classes definition
+ *
+ * Single-pass statistics over streams of values.
+ * Accumulators are mergeable: each thread (or machine) fills its own, and
+ * the partial states are merged at the end, with the same result as one
+ * accumulator fed with every value, up to rounding.
+ * Mean and variance use Welford's update, and Chan's formula to merge,
+ * without the cancellation of E[x^2] - E[x]^2. They are computed in double
+ * for integer values, as by algo::variance.
+ * Quantiles are approximated by a KLL sketch: O(k log(n / k)) memory, and a
+ * rank error around 0.6 / k of the number of values (rarely above 3 / k).
+ */
+
+#ifndef STATS_ACCUMULATOR_HH_
+# define STATS_ACCUMULATOR_HH_
+
+# include <algorithm>
+# include <cassert>
+# include <cmath>
+# include <cstddef>
+# include <cstdint>
+# include <limits>
+# include <utility>
+# include <vector>
+# include "algo.hh"
+# include "serialization.hh"
+
+namespace opl
+{
+
+	template <class T>
+	class SerialManager;
+
+	/// KLL quantile sketch
+	/// Level h holds values of weight 2^h, when a level is full it is sorted
+	/// and one value out of two moves up, lower levels have smaller capacities
+	/// The sketch is deterministic: same values in the same order, same state
+	template <class T>
+	class QuantileSketch
+	{
+
+	public:
+		using size_type = std::size_t;
+
+		///k sets the accuracy (rank error around 0.6 / k) and the memory
+		explicit QuantileSketch (size_type k = 200);
+
+		void
+		add (const T& x);
+
+		///Adds the values of s, s may have a different k
+		void
+		merge (const QuantileSketch& s);
+
+		///Number of values added
+		size_type
+		count () const;
+
+		///Number of values stored
+		size_type
+		stored () const;
+
+		size_type
+		k () const;
+
+		bool
+		empty () const;
+
+		///Approximate value at rank q * count (), q in [0, 1]
+		T
+		quantile (double q) const;
+
+		///Approximate fraction of the values smaller than x
+		double
+		rank (const T& x) const;
+
+		void
+		clear ();
+
+	private:
+		size_type
+		capacity_ (size_type level) const;
+
+		void
+		compress_ ();
+
+		size_type k_;
+		size_type n_;
+		std::vector<std::vector<T>> levels_;
+
+		///xorshift state, picks the half kept by each compaction
+		std::uint64_t seed_;
+
+		friend class SerialManager<QuantileSketch>;
+
+	};
+
+	/// Count, mean, variance, min, max and quantiles of a stream of values
+	template <class T = double>
+	class StatsAccumulator
+	{
+
+	public:
+		using size_type = std::size_t;
+		///Type of the mean and variance: T if floating point, else double
+		using stat_type = algo::variance_type_<T>;
+
+		///k is the accuracy parameter of the quantile sketch
+		explicit StatsAccumulator (size_type k = 200);
+
+		void
+		add (const T& x);
+
+		template <class It>
+		void
+		add (It begin, It end);
+
+		///Adds the values of acc
+		void
+		merge (const StatsAccumulator& acc);
+
+		size_type
+		count () const;
+
+		bool
+		empty () const;
+
+		stat_type
+		mean () const;
+
+		///Population variance, same as algo::variance
+		stat_type
+		variance () const;
+
+		///Unbiased variance: sum of squared deviations / (n - 1)
+		stat_type
+		sample_variance () const;
+
+		stat_type
+		standard_deviation () const;
+
+		T
+		min () const;
+
+		T
+		max () const;
+
+		stat_type
+		sum () const;
+
+		///Approximate value at rank q * count (), q in [0, 1]
+		T
+		quantile (double q) const;
+
+		T
+		median () const;
+
+		const QuantileSketch<T>&
+		sketch () const;
+
+		void
+		clear ();
+
+	private:
+		size_type n_;
+		stat_type mean_;
+		stat_type m2_;
+		T min_;
+		T max_;
+		QuantileSketch<T> sketch_;
+
+		friend class SerialManager<StatsAccumulator>;
+
+	};
+
+	template <class T>
+	class SerialManager<QuantileSketch<T>>
+	{
+	public:
+		static void
+		pack (std::ostream& os, const QuantileSketch<T>& data)
+		{
+			serialize (os, data.k_);
+			serialize (os, data.n_);
+			serialize (os, data.seed_);
+			serialize (os, data.levels_.size ());
+			for (const auto& level : data.levels_)
+			{
+				serialize (os, level.size ());
+				os.write (reinterpret_cast<const char *> (level.data ()),
+						  level.size () * sizeof (T));
+			}
+		}
+
+		static QuantileSketch<T>
+		unpack (std::istream& is)
+		{
+			QuantileSketch<T> s (unserialize<size_t> (is));
+			s.n_ = unserialize<size_t> (is);
+			s.seed_ = unserialize<std::uint64_t> (is);
+			s.levels_.resize (unserialize<size_t> (is));
+			for (auto& level : s.levels_)
+			{
+				level.resize (unserialize<size_t> (is));
+				is.read (reinterpret_cast<char *> (level.data ()),
+						 level.size () * sizeof (T));
+			}
+			return s;
+		}
+	};
+
+	template <class T>
+	class SerialManager<StatsAccumulator<T>>
+	{
+	public:
+		static void
+		pack (std::ostream& os, const StatsAccumulator<T>& data)
+		{
+			serialize (os, data.n_);
+			serialize (os, data.mean_);
+			serialize (os, data.m2_);
+			serialize (os, data.min_);
+			serialize (os, data.max_);
+			serialize (os, data.sketch_);
+		}
+
+		static StatsAccumulator<T>
+		unpack (std::istream& is)
+		{
+			StatsAccumulator<T> acc;
+			acc.n_ = unserialize<size_t> (is);
+			using stat_type = typename StatsAccumulator<T>::stat_type;
+			acc.mean_ = unserialize<stat_type> (is);
+			acc.m2_ = unserialize<stat_type> (is);
+			acc.min_ = unserialize<T> (is);
+			acc.max_ = unserialize<T> (is);
+			acc.sketch_ = unserialize<QuantileSketch<T>> (is);
+			return acc;
+		}
+	};
+
+
+	template <class T>
+	QuantileSketch<T>::QuantileSketch (size_type k)
+		: k_ (k)
+		, n_ (0)
+		, levels_ (1)
+		, seed_ (0x9e3779b97f4a7c15)
+	{
+		assert (k >= 2);
+	}
+
+	template <class T>
+	void
+	QuantileSketch<T>::add (const T& x)
+	{
+		levels_[0].push_back (x);
+		++n_;
+		if (levels_[0].size () >= capacity_ (0))
+			compress_ ();
+	}
+
+	template <class T>
+	void
+	QuantileSketch<T>::merge (const QuantileSketch& s)
+	{
+		//Inserting a level into itself would read it while it grows
+		if (&s == this)
+		{
+			merge (QuantileSketch (s));
+			return;
+		}
+
+		if (levels_.size () < s.levels_.size ())
+			levels_.resize (s.levels_.size ());
+		for (size_type h = 0; h < s.levels_.size (); ++h)
+			levels_[h].insert (levels_[h].end (), s.levels_[h].begin (),
+							   s.levels_[h].end ());
+		n_ += s.n_;
+		compress_ ();
+	}
+
+	template <class T>
+	typename QuantileSketch<T>::size_type
+	QuantileSketch<T>::count () const
+	{
+		return n_;
+	}
+
+	template <class T>
+	typename QuantileSketch<T>::size_type
+	QuantileSketch<T>::stored () const
+	{
+		size_type res = 0;
+		for (const auto& level : levels_)
+			res += level.size ();
+		return res;
+	}
+
+	template <class T>
+	typename QuantileSketch<T>::size_type
+	QuantileSketch<T>::k () const
+	{
+		return k_;
+	}
+
+	template <class T>
+	bool
+	QuantileSketch<T>::empty () const
+	{
+		return !n_;
+	}
+
+	template <class T>
+	T
+	QuantileSketch<T>::quantile (double q) const
+	{
+		assert (n_);
+		std::vector<std::pair<T, size_type>> items;
+		items.reserve (stored ());
+		for (size_type h = 0; h < levels_.size (); ++h)
+			for (const T& x : levels_[h])
+				items.emplace_back (x, size_type (1) << h);
+		std::sort (items.begin (), items.end (),
+				   [](const std::pair<T, size_type>& a,
+					  const std::pair<T, size_type>& b) {
+					   return a.first < b.first;
+				   });
+
+		//First value whose cumulated weight goes past the rank
+		double target = q * static_cast<double> (n_);
+		size_type cum = 0;
+		for (const auto& item : items)
+		{
+			cum += item.second;
+			if (static_cast<double> (cum) > target)
+				return item.first;
+		}
+		return items.back ().first;
+	}
+
+	template <class T>
+	double
+	QuantileSketch<T>::rank (const T& x) const
+	{
+		if (!n_)
+			return 0;
+		size_type below = 0;
+		for (size_type h = 0; h < levels_.size (); ++h)
+			for (const T& y : levels_[h])
+				if (y < x)
+					below += size_type (1) << h;
+		return static_cast<double> (below) / static_cast<double> (n_);
+	}
+
+	template <class T>
+	void
+	QuantileSketch<T>::clear ()
+	{
+		*this = QuantileSketch (k_);
+	}
+
+	template <class T>
+	typename QuantileSketch<T>::size_type
+	QuantileSketch<T>::capacity_ (size_type level) const
+	{
+		//k (2/3)^depth, depth counted from the top level
+		double depth = static_cast<double> (levels_.size () - 1 - level);
+		double cap = std::ceil (k_ * std::pow (2. / 3., depth));
+		return std::max (size_type (2), static_cast<size_type> (cap));
+	}
+
+	template <class T>
+	void
+	QuantileSketch<T>::compress_ ()
+	{
+		for (size_type h = 0; h < levels_.size (); ++h)
+		{
+			if (levels_[h].size () < capacity_ (h))
+				continue;
+			if (h + 1 == levels_.size ())
+				levels_.emplace_back ();
+
+			//With an odd size, the last value stays at its level. The kept
+			//half (even or odd positions) is random, so the rank errors of
+			//successive compactions don't add up in the same direction
+			seed_ ^= seed_ << 13;
+			seed_ ^= seed_ >> 7;
+			seed_ ^= seed_ << 17;
+			size_type offset = seed_ & 1;
+			std::vector<T>& level = levels_[h];
+			std::vector<T>& up = levels_[h + 1];
+			std::sort (level.begin (), level.end ());
+			size_type pairs = level.size () / 2;
+			for (size_type i = 0; i < pairs; ++i)
+				up.push_back (level[2 * i + offset]);
+			if (level.size () % 2)
+				level[0] = level.back ();
+			level.resize (level.size () % 2);
+		}
+	}
+
+
+	template <class T>
+	StatsAccumulator<T>::StatsAccumulator (size_type k)
+		: n_ (0)
+		, mean_ (0)
+		, m2_ (0)
+		, min_ (std::numeric_limits<T>::max ())
+		, max_ (std::numeric_limits<T>::lowest ())
+		, sketch_ (k)
+	{
+
+	}
+
+	template <class T>
+	void
+	StatsAccumulator<T>::add (const T& x)
+	{
+		++n_;
+		stat_type y = static_cast<stat_type> (x);
+		stat_type delta = y - mean_;
+		mean_ += delta / static_cast<stat_type> (n_);
+		m2_ += delta * (y - mean_);
+		min_ = std::min (min_, x);
+		max_ = std::max (max_, x);
+		sketch_.add (x);
+	}
+
+	template <class T>
+	template <class It>
+	void
+	StatsAccumulator<T>::add (It begin, It end)
+	{
+		for (It i = begin; i != end; ++i)
+			add (*i);
+	}
+
+	template <class T>
+	void
+	StatsAccumulator<T>::merge (const StatsAccumulator& acc)
+	{
+		if (!acc.n_)
+			return;
+		if (!n_)
+		{
+			*this = acc;
+			return;
+		}
+
+		stat_type na = static_cast<stat_type> (n_);
+		stat_type nb = static_cast<stat_type> (acc.n_);
+		stat_type n = na + nb;
+		stat_type delta = acc.mean_ - mean_;
+		mean_ += delta * (nb / n);
+		m2_ += acc.m2_ + delta * delta * (na * nb / n);
+		n_ += acc.n_;
+		min_ = std::min (min_, acc.min_);
+		max_ = std::max (max_, acc.max_);
+		sketch_.merge (acc.sketch_);
+	}
+
+	template <class T>
+	typename StatsAccumulator<T>::size_type
+	StatsAccumulator<T>::count () const
+	{
+		return n_;
+	}
+
+	template <class T>
+	bool
+	StatsAccumulator<T>::empty () const
+	{
+		return !n_;
+	}
+
+	template <class T>
+	typename StatsAccumulator<T>::stat_type
+	StatsAccumulator<T>::mean () const
+	{
+		return mean_;
+	}
+
+	template <class T>
+	typename StatsAccumulator<T>::stat_type
+	StatsAccumulator<T>::variance () const
+	{
+		return n_ ? m2_ / static_cast<stat_type> (n_) : stat_type (0);
+	}
+
+	template <class T>
+	typename StatsAccumulator<T>::stat_type
+	StatsAccumulator<T>::sample_variance () const
+	{
+		return n_ > 1 ? m2_ / static_cast<stat_type> (n_ - 1) : stat_type (0);
+	}
+
+	template <class T>
+	typename StatsAccumulator<T>::stat_type
+	StatsAccumulator<T>::standard_deviation () const
+	{
+		return std::sqrt (variance ());
+	}
+
+	template <class T>
+	T
+	StatsAccumulator<T>::min () const
+	{
+		return min_;
+	}
+
+	template <class T>
+	T
+	StatsAccumulator<T>::max () const
+	{
+		return max_;
+	}
+
+	template <class T>
+	typename StatsAccumulator<T>::stat_type
+	StatsAccumulator<T>::sum () const
+	{
+		return mean_ * static_cast<stat_type> (n_);
+	}
+
+	template <class T>
+	T
+	StatsAccumulator<T>::quantile (double q) const
+	{
+		return sketch_.quantile (q);
+	}
+
+	template <class T>
+	T
+	StatsAccumulator<T>::median () const
+	{
+		return sketch_.quantile (0.5);
+	}
+
+	template <class T>
+	const QuantileSketch<T>&
+	StatsAccumulator<T>::sketch () const
+	{
+		return sketch_;
+	}
+
+	template <class T>
+	void
+	StatsAccumulator<T>::clear ()
+	{
+		*this = StatsAccumulator (sketch_.k ());
+	}
+
+}
+
+#endif //!STATS_ACCUMULATOR_HH_
@@ -0,0 +1,139 @@
+/** @file Raw buffer management used by Vector and Matrix
+ */
+
+#ifndef STORAGE_HH_
+# define STORAGE_HH_
+
+# include <cstddef>
+# include <cstdlib>
+# include <cstring>
+# include <algorithm>
+# include <new>
+# include <type_traits>
+
+namespace opl
+{
+
+# ifdef OPL_STORAGE_STATS
+	///Number of buffers allocated since the start of the program
+	inline std::size_t&
+	storage_allocations ()
+	{
+		static std::size_t count = 0;
+		return count;
+	}
+# endif
+
+	///Allocates, grows and releases arrays of T
+	///Trivial types go through malloc / realloc / memcpy,
+	///other types through new[] / delete[] and element-wise copies
+	template <class T, bool Trivial = std::is_trivial<T>::value>
+	class Storage
+	{
+
+	public:
+		static T*
+		allocate (std::size_t n)
+		{
+			count_ ();
+			return new T[n];
+		}
+
+		static void
+		deallocate (T* p)
+		{
+			delete[] p;
+		}
+
+		///Returns a buffer of n elements holding the keep first elements of p
+		///p is released
+		static T*
+		reallocate (T* p, std::size_t keep, std::size_t n)
+		{
+			T* res = allocate (n);
+			std::move (p, p + std::min (keep, n), res);
+			deallocate (p);
+			return res;
+		}
+
+		static void
+		copy (const T* begin, std::size_t n, T* out)
+		{
+			std::copy_n (begin, n, out);
+		}
+
+	private:
+		static void
+		count_ ()
+		{
+# ifdef OPL_STORAGE_STATS
+			++storage_allocations ();
+# endif
+		}
+	};
+
+	template <class T>
+	class Storage<T, true>
+	{
+
+	public:
+		static T*
+		allocate (std::size_t n)
+		{
+			if (!n)
+				return nullptr;
+			count_ ();
+			void* p = std::malloc (n * sizeof (T));
+			if (!p)
+				throw std::bad_alloc ();
+			return static_cast<T*> (p);
+		}
+
+		static void
+		deallocate (T* p)
+		{
+			std::free (p);
+		}
+
+		///Returns a buffer of n elements holding the keep first elements of p
+		///p is released, realloc may extend it in place
+		static T*
+		reallocate (T* p, std::size_t keep, std::size_t n)
+		{
+			if (!n)
+			{
+				deallocate (p);
+				return nullptr;
+			}
+			if (!p || !keep)
+			{
+				deallocate (p);
+				return allocate (n);
+			}
+			count_ ();
+			void* res = std::realloc (p, n * sizeof (T));
+			if (!res)
+				throw std::bad_alloc ();
+			return static_cast<T*> (res);
+		}
+
+		static void
+		copy (const T* begin, std::size_t n, T* out)
+		{
+			if (n)
+				std::memcpy (out, begin, n * sizeof (T));
+		}
+
+	private:
+		static void
+		count_ ()
+		{
+# ifdef OPL_STORAGE_STATS
+			++storage_allocations ();
+# endif
+		}
+	};
+
+}
+
+#endif //!STORAGE_HH_
@@ -0,0 +1,234 @@
+/** @file Strassen-Winograd matrix products
+ *
+ * C <- AB for square n x n operands, with 7 half-size products and 15
+ * additions per level instead of 8 products: O(n^2.81) multiply-adds.
+ * Recursion stops at the crossover size, where the packed gemm kernel
+ * takes over. Sizes that can't be halved down to the crossover are padded
+ * with zeros once, at the top level.
+ * The schedule (Boyer, Dumas, Pernet, Zhou, "Memory efficient scheduling of
+ * Strassen-Winograd's matrix multiplication algorithm") only needs two
+ * temporaries per level, the quadrants of C holding the other ones: the
+ * whole workspace is allocated in one arena before the recursion.
+ * Results differ from gemm by a rounding error growing faster with the
+ * number of levels: ||error|| is bounded by a small multiple of
+ * n^2.58 eps ||A|| ||B|| instead of n eps ||A|| ||B||.
+ */
+
+#ifndef STRASSEN_HH_
+# define STRASSEN_HH_
+
+# include <cassert>
+# include <cstddef>
+# include <vector>
+# include "gemm.hh"
+# include "matrix.hh"
+
+///Size under which Strassen products recurse no more
+# define OPL_STRASSEN_CROSSOVER 512
+
+namespace opl
+{
+
+	namespace linalg
+	{
+
+		///Levels and padded size used for n at the given crossover
+		inline std::size_t
+		strassen_size_ (std::size_t n, std::size_t crossover,
+						std::size_t& levels)
+		{
+			levels = 0;
+			std::size_t m = n;
+			while (m > crossover)
+			{
+				m = (m + 1) / 2;
+				++levels;
+			}
+			return m << levels;
+		}
+
+		///Workspace of strassen_ for size n, in values
+		inline std::size_t
+		strassen_workspace_ (std::size_t n, std::size_t levels)
+		{
+			std::size_t res = 0;
+			for (; levels; --levels)
+			{
+				n /= 2;
+				res += 2 * n * n;
+			}
+			return res;
+		}
+
+		///Z <- X + Y (sign 1) or X - Y (sign -1), h x h
+		template <class T>
+		void
+		strassen_add_ (std::size_t h, int sign,
+					   const T* x, std::size_t rsx, std::size_t csx,
+					   const T* y, std::size_t rsy, std::size_t csy,
+					   T* z, std::size_t rsz, std::size_t csz)
+		{
+			parallel::for_range (h, h * h, [&](std::size_t i0, std::size_t i1) {
+					for (std::size_t i = i0; i < i1; ++i)
+					{
+						const T* xi = x + i * rsx;
+						const T* yi = y + i * rsy;
+						T* zi = z + i * rsz;
+						if (sign > 0)
+							for (std::size_t j = 0; j < h; ++j)
+								zi[j * csz] = xi[j * csx] + yi[j * csy];
+						else
+							for (std::size_t j = 0; j < h; ++j)
+								zi[j * csz] = xi[j * csx] - yi[j * csy];
+					}
+				});
+		}
+
+		///C <- AB, n x n, n = q 2^levels, work holds
+		///strassen_workspace_ (n, levels) values
+		template <class T>
+		void
+		strassen_ (std::size_t n, std::size_t levels,
+				   const T* a, std::size_t rsa, std::size_t csa,
+				   const T* b, std::size_t rsb, std::size_t csb,
+				   T* c, std::size_t rsc, std::size_t csc, T* work)
+		{
+			if (!levels)
+			{
+				gemm (n, n, n, static_cast<T> (1), a, rsa, csa, b, rsb, csb,
+					  static_cast<T> (0), c, rsc, csc);
+				return;
+			}
+
+			std::size_t h = n / 2;
+			const T* a11 = a;
+			const T* a12 = a + h * csa;
+			const T* a21 = a + h * rsa;
+			const T* a22 = a21 + h * csa;
+			const T* b11 = b;
+			const T* b12 = b + h * csb;
+			const T* b21 = b + h * rsb;
+			const T* b22 = b21 + h * csb;
+			T* c11 = c;
+			T* c12 = c + h * csc;
+			T* c21 = c + h * rsc;
+			T* c22 = c21 + h * csc;
+			T* x = work;
+			T* y = work + h * h;
+			T* next = work + 2 * h * h;
+			std::size_t one = 1;
+
+			auto add = [&](int sign, const T* p, std::size_t rsp, std::size_t csp,
+						   const T* q, std::size_t rsq, std::size_t csq,
+						   T* r, std::size_t rsr, std::size_t csr) {
+				strassen_add_ (h, sign, p, rsp, csp, q, rsq, csq, r, rsr, csr);
+			};
+			auto mul = [&](const T* p, std::size_t rsp, std::size_t csp,
+						   const T* q, std::size_t rsq, std::size_t csq,
+						   T* r, std::size_t rsr, std::size_t csr) {
+				strassen_ (h, levels - 1, p, rsp, csp, q, rsq, csq, r, rsr, csr,
+						   next);
+			};
+
+			//S3 = A11 - A21, T3 = B22 - B12, P7 = S3 T3
+			add (-1, a11, rsa, csa, a21, rsa, csa, x, h, one);
+			add (-1, b22, rsb, csb, b12, rsb, csb, y, h, one);
+			mul (x, h, one, y, h, one, c21, rsc, csc);
+			//S1 = A21 + A22, T1 = B12 - B11, P5 = S1 T1
+			add (1, a21, rsa, csa, a22, rsa, csa, x, h, one);
+			add (-1, b12, rsb, csb, b11, rsb, csb, y, h, one);
+			mul (x, h, one, y, h, one, c22, rsc, csc);
+			//S2 = S1 - A11, T2 = B22 - T1, P6 = S2 T2
+			add (-1, x, h, one, a11, rsa, csa, x, h, one);
+			add (-1, b22, rsb, csb, y, h, one, y, h, one);
+			mul (x, h, one, y, h, one, c12, rsc, csc);
+			//S4 = A12 - S2, P3 = S4 B22
+			add (-1, a12, rsa, csa, x, h, one, x, h, one);
+			mul (x, h, one, b22, rsb, csb, c11, rsc, csc);
+			//P1 = A11 B11
+			mul (a11, rsa, csa, b11, rsb, csb, x, h, one);
+			//U2 = P1 + P6, U3 = U2 + P7, U4 = U2 + P5
+			add (1, x, h, one, c12, rsc, csc, c12, rsc, csc);
+			add (1, c12, rsc, csc, c21, rsc, csc, c21, rsc, csc);
+			add (1, c12, rsc, csc, c22, rsc, csc, c12, rsc, csc);
+			//U7 = U3 + P5 = C22, U5 = U4 + P3 = C12
+			add (1, c21, rsc, csc, c22, rsc, csc, c22, rsc, csc);
+			add (1, c12, rsc, csc, c11, rsc, csc, c12, rsc, csc);
+			//T4 = T2 - B21, P4 = A22 T4, U6 = U3 - P4 = C21
+			add (-1, y, h, one, b21, rsb, csb, y, h, one);
+			mul (a22, rsa, csa, y, h, one, c11, rsc, csc);
+			add (-1, c21, rsc, csc, c11, rsc, csc, c21, rsc, csc);
+			//P2 = A12 B21, U1 = P1 + P2 = C11
+			mul (a12, rsa, csa, b21, rsb, csb, c11, rsc, csc);
+			add (1, x, h, one, c11, rsc, csc, c11, rsc, csc);
+		}
+
+		///C <- AB, n x n operands described as for gemm
+		///Sizes up to crossover (at least 1) run gemm directly
+		///C must not overlap A or B
+		template <class T>
+		void
+		strassen_gemm (std::size_t n,
+					   const T* a, std::size_t rsa, std::size_t csa,
+					   const T* b, std::size_t rsb, std::size_t csb,
+					   T* c, std::size_t rsc, std::size_t csc,
+					   std::size_t crossover = OPL_STRASSEN_CROSSOVER)
+		{
+			assert (crossover);
+			std::size_t levels;
+			std::size_t p = strassen_size_ (n, crossover, levels);
+			std::size_t ws = strassen_workspace_ (p, levels);
+
+			if (p == n)
+			{
+				std::vector<T> work (ws);
+				strassen_ (n, levels, a, rsa, csa, b, rsb, csb, c, rsc, csc,
+						   work.data ());
+				return;
+			}
+
+			//Zero padding to p x p, in the same arena
+			std::vector<T> work (ws + 3 * p * p, static_cast<T> (0));
+			T* pa = work.data () + ws;
+			T* pb = pa + p * p;
+			T* pc = pb + p * p;
+			for (std::size_t i = 0; i < n; ++i)
+				for (std::size_t j = 0; j < n; ++j)
+				{
+					pa[i * p + j] = a[i * rsa + j * csa];
+					pb[i * p + j] = b[i * rsb + j * csb];
+				}
+
+			strassen_ (p, levels, pa, p, std::size_t (1), pb, p, std::size_t (1),
+					   pc, p, std::size_t (1), work.data ());
+
+			for (std::size_t i = 0; i < n; ++i)
+				for (std::size_t j = 0; j < n; ++j)
+					c[i * rsc + j * csc] = pc[i * p + j];
+		}
+
+	}
+
+	///AB with Strassen-Winograd products, for square operands
+	///Other shapes use the usual product
+	template <class T, StorageOrder O>
+	Matrix<T, O>
+	strassen_product (const Matrix<T, O>& a, const Matrix<T, O>& b,
+					  std::size_t crossover = OPL_STRASSEN_CROSSOVER)
+	{
+		assert (a.cols () == b.rows ());
+		std::size_t n = a.rows ();
+		if (a.cols () != n || b.cols () != n)
+			return Matrix<T, O> (a * b);
+
+		Matrix<T, O> c (n, n);
+		linalg::strassen_gemm (n, a.data (), a.row_stride (), a.col_stride (),
+							   b.data (), b.row_stride (), b.col_stride (),
+							   c.data (), c.row_stride (), c.col_stride (),
+							   crossover);
+		return c;
+	}
+
+}
+
+#endif //!STRASSEN_HH_
@@ -0,0 +1,296 @@
+/** @file Singular value decompositions of row-major matrices
+ *
+ * jacobi_svd is a one-sided Jacobi SVD (Hestenes): plane rotations are
+ * applied to pairs of columns until they are all orthogonal, the column
+ * norms are then the singular values. It never forms A^T A, so small
+ * singular values keep their relative accuracy.
+ * A is first reduced to R by a QR factorization, and the rotations work on
+ * the columns of R^T, the rows of R: they converge in fewer sweeps than on
+ * A, on vectors of n values instead of m (Drmac, Veselic).
+ * A sweep visits the pairs in round-robin order: each round is a set of
+ * disjoint pairs, rotated in parallel.
+ * randomized_svd approximates the k largest singular triplets: the range
+ * of A is sampled with a Gaussian matrix (range finder), refined with power
+ * iterations, and the small projected matrix goes through jacobi_svd
+ * (Halko, Martinsson, Tropp, "Finding structure with randomness").
+ */
+
+#ifndef SVD_HH_
+# define SVD_HH_
+
+# include <algorithm>
+# include <cmath>
+# include <cstddef>
+# include <limits>
+# include <numeric>
+# include <random>
+# include <vector>
+# include "gemm.hh"
+# include "parallel.hh"
+# include "qr.hh"
+# include "simd-reduce.hh"
+# include "transpose.hh"
+
+///Maximum number of Jacobi sweeps
+# define OPL_SVD_SWEEPS 30
+
+///Extra samples of the randomized range finder
+# define OPL_SVD_OVERSAMPLING 10
+
+///Default power iterations of randomized_svd
+# define OPL_SVD_POWER_ITERATIONS 2
+
+namespace opl
+{
+
+	namespace linalg
+	{
+
+		///x <- cx - sy, y <- sx + cy
+		template <class T>
+		void
+		rotate_ (std::size_t n, T c, T s, T* x, T* y)
+		{
+			using S = simd::Ops<T>;
+			constexpr std::size_t w = S::width;
+			typename S::reg vc = S::set1 (c);
+			typename S::reg vs = S::set1 (s);
+			std::size_t j = 0;
+			for (; j + w <= n; j += w)
+			{
+				typename S::reg xj = S::load (x + j);
+				typename S::reg yj = S::load (y + j);
+				S::store (x + j, S::sub (S::mul (vc, xj), S::mul (vs, yj)));
+				S::store (y + j, S::fmadd (vs, xj, S::mul (vc, yj)));
+			}
+			for (; j < n; ++j)
+			{
+				T xj = x[j];
+				x[j] = c * xj - s * y[j];
+				y[j] = s * xj + c * y[j];
+			}
+		}
+
+		///Rotates the rows of W (n x m) until they are orthogonal, the same
+		///rotations are applied to the rows of VT (n x n)
+		///Returns false if OPL_SVD_SWEEPS sweeps weren't enough
+		template <class T>
+		bool
+		jacobi_rows_ (std::size_t n, std::size_t m, T* w, T* vt)
+		{
+			const T tol = std::numeric_limits<T>::epsilon ()
+				* std::sqrt (static_cast<T> (m));
+			std::size_t np = n + n % 2;
+			std::vector<std::size_t> players (np);
+			std::iota (players.begin (), players.end (), std::size_t (0));
+			std::vector<char> rotated (np / 2);
+			std::vector<T> norms (n);
+
+			for (std::size_t sweep = 0; sweep < OPL_SVD_SWEEPS; ++sweep)
+			{
+				//Squared norms are updated by the rotations, and computed
+				//again at each sweep against the rounding drift
+				for (std::size_t i = 0; i < n; ++i)
+					norms[i] = simd::norm_square (w + i * m, m);
+				bool done = true;
+				for (std::size_t round = 0; round + 1 < np; ++round)
+				{
+					parallel::for_range (np / 2, np / 2 * (3 * m + 2 * n),
+										 [&](std::size_t i0, std::size_t i1) {
+							for (std::size_t i = i0; i < i1; ++i)
+							{
+								std::size_t p = players[i];
+								std::size_t q = players[np - 1 - i];
+								rotated[i] = 0;
+								if (p >= n || q >= n)
+									continue;
+
+								T* wp = w + p * m;
+								T* wq = w + q * m;
+								T alpha = norms[p];
+								T beta = norms[q];
+								T gamma = simd::dot (wp, wq, m);
+								if (!(std::abs (gamma) > tol * std::sqrt (alpha * beta)))
+									continue;
+
+								T zeta = (beta - alpha) / (2 * gamma);
+								T t = (zeta < 0 ? -1 : 1)
+									/ (std::abs (zeta) + std::sqrt (1 + zeta * zeta));
+								T c = 1 / std::sqrt (1 + t * t);
+								T s = c * t;
+								rotate_ (m, c, s, wp, wq);
+								rotate_ (n, c, s, vt + p * n, vt + q * n);
+								norms[p] = alpha - t * gamma;
+								norms[q] = beta + t * gamma;
+								rotated[i] = 1;
+							}
+						});
+
+					for (char r : rotated)
+						done = done && !r;
+					//Player 0 stays, the others move one place
+					std::rotate (players.begin () + 1, players.end () - 1,
+								 players.end ());
+				}
+				if (done)
+					return true;
+			}
+			return false;
+		}
+
+		///Thin SVD A = U diag(s) V^T of the m x n matrix A
+		///r = min(m, n): U is m x r, s gets r decreasing values, V is n x r
+		///u or v may be null when not needed
+		///The columns of V (of U if m < n) for null singular values are null
+		///Returns false if the rotations didn't converge (s is then only
+		///an approximation)
+		template <class T>
+		bool
+		jacobi_svd (std::size_t m, std::size_t n, const T* a, std::size_t lda,
+					T* u, std::size_t ldu, T* s, T* v, std::size_t ldv)
+		{
+			if (m < n)
+			{
+				//A^T = V S U^T
+				std::vector<T> at (n * m);
+				transpose (m, n, a, lda, at.data (), m);
+				return jacobi_svd (n, m, at.data (), m, v, ldv, s, u, ldu);
+			}
+
+			std::vector<T> qr (m * n);
+			std::vector<T> tau (n);
+			std::vector<T> t (qr_t_size (m, n));
+			for (std::size_t i = 0; i < m; ++i)
+				std::copy_n (a + i * lda, n, qr.data () + i * n);
+			qr_factorize (m, n, qr.data (), n, tau.data (), t.data ());
+
+			//R^T W = Y, Y orthogonal columns: R = W S Y'^T with Y' = Y S^-1
+			//The rows of w are the columns of R^T, vt holds W^T
+			std::vector<T> w (n * n, static_cast<T> (0));
+			std::vector<T> vt (n * n, static_cast<T> (0));
+			for (std::size_t i = 0; i < n; ++i)
+			{
+				std::copy (qr.data () + i * n + i, qr.data () + i * n + n,
+						   w.data () + i * n + i);
+				vt[i * n + i] = static_cast<T> (1);
+			}
+
+			bool res = jacobi_rows_ (n, n, w.data (), vt.data ());
+
+			std::vector<T> norms (n);
+			for (std::size_t i = 0; i < n; ++i)
+				norms[i] = std::sqrt (simd::norm_square (w.data () + i * n, n));
+			std::vector<std::size_t> order (n);
+			std::iota (order.begin (), order.end (), std::size_t (0));
+			std::stable_sort (order.begin (), order.end (),
+							  [&](std::size_t i, std::size_t j) {
+								  return norms[i] > norms[j];
+							  });
+
+			//V[:, j] = Y'[:, k], U = Q [W; 0], k = order[j]
+			std::vector<T> uq (u ? m * n : 0, static_cast<T> (0));
+			for (std::size_t j = 0; j < n; ++j)
+			{
+				std::size_t k = order[j];
+				T sk = norms[k];
+				s[j] = sk;
+				const T* wk = w.data () + k * n;
+				if (v)
+					for (std::size_t i = 0; i < n; ++i)
+						v[i * ldv + j] = sk > 0 ? wk[i] / sk : static_cast<T> (0);
+				if (u)
+					for (std::size_t i = 0; i < n; ++i)
+						uq[i * n + j] = vt[k * n + i];
+			}
+
+			if (u)
+			{
+				qr_apply_q (m, n, qr.data (), n, t.data (), n, uq.data (), n);
+				for (std::size_t i = 0; i < m; ++i)
+					std::copy_n (uq.data () + i * n, n, u + i * ldu);
+			}
+			return res;
+		}
+
+		///Q (m x l) <- orthonormal basis of the columns of Y (m x l, m >= l)
+		template <class T>
+		void
+		orthonormal_basis_ (std::size_t m, std::size_t l, T* y, T* q)
+		{
+			std::vector<T> tau (l);
+			std::vector<T> t (qr_t_size (m, l));
+			qr_factorize (m, l, y, l, tau.data (), t.data ());
+			qr_form_q (m, l, y, l, t.data (), l, q, l);
+		}
+
+		///k largest singular triplets of the m x n matrix A, k <= min(m, n)
+		///U is m x k, s gets k decreasing values, V is n x k
+		///The range of A is sampled with k + oversampling Gaussian vectors,
+		///then power iterations multiply by (A A^T) to separate the
+		///singular values, at the cost of two passes over A each
+		///Returns false if the Jacobi SVD of the projection didn't converge
+		template <class T>
+		bool
+		randomized_svd (std::size_t m, std::size_t n, const T* a,
+						std::size_t lda, std::size_t k,
+						T* u, std::size_t ldu, T* s, T* v, std::size_t ldv,
+						std::size_t power = OPL_SVD_POWER_ITERATIONS,
+						std::size_t oversampling = OPL_SVD_OVERSAMPLING,
+						unsigned long seed = 5489)
+		{
+			std::size_t r = std::min (m, n);
+			std::size_t l = std::min (k + oversampling, r);
+			if (!k)
+				return true;
+
+			std::mt19937 gen (seed);
+			std::normal_distribution<double> normal;
+			std::vector<T> omega (n * l);
+			for (T& x : omega)
+				x = static_cast<T> (normal (gen));
+
+			std::vector<T> y (m * l);
+			std::vector<T> z (n * l);
+			std::vector<T> q (m * l);
+			std::vector<T> qz (n * l);
+			std::size_t one = 1;
+			gemm (m, l, n, static_cast<T> (1), a, lda, one, omega.data (), l, one,
+				  static_cast<T> (0), y.data (), l, one);
+			orthonormal_basis_ (m, l, y.data (), q.data ());
+
+			for (std::size_t it = 0; it < power; ++it)
+			{
+				//Z = A^T Q, Y = A Z, both orthonormalized against rounding
+				gemm (n, l, m, static_cast<T> (1), a, one, lda, q.data (), l, one,
+					  static_cast<T> (0), z.data (), l, one);
+				orthonormal_basis_ (n, l, z.data (), qz.data ());
+				gemm (m, l, n, static_cast<T> (1), a, lda, one, qz.data (), l, one,
+					  static_cast<T> (0), y.data (), l, one);
+				orthonormal_basis_ (m, l, y.data (), q.data ());
+			}
+
+			//B = Q^T A (l x n), B = Ub S V^T, U = Q Ub
+			std::vector<T> b (l * n);
+			gemm (l, n, m, static_cast<T> (1), q.data (), one, l, a, lda, one,
+				  static_cast<T> (0), b.data (), n, one);
+			std::vector<T> ub (l * l);
+			std::vector<T> sb (l);
+			std::vector<T> vb (n * l);
+			bool res = jacobi_svd (l, n, b.data (), n, ub.data (), l, sb.data (),
+								   vb.data (), l);
+
+			std::copy_n (sb.data (), k, s);
+			if (u)
+				gemm (m, k, l, static_cast<T> (1), q.data (), l, one,
+					  ub.data (), l, one, static_cast<T> (0), u, ldu, one);
+			if (v)
+				for (std::size_t i = 0; i < n; ++i)
+					std::copy_n (vb.data () + i * l, k, v + i * ldv);
+			return res;
+		}
+
+	}
+
+}
+
+#endif //!SVD_HH_
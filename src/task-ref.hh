@@ -0,0 +1,50 @@
+/** @file TaskRef class definition
+ */
+
+#ifndef TASK_REF_HH_
+#define TASK_REF_HH_
+
+# include <cstddef>
+# include <type_traits>
+
+namespace opl
+{
+
+	///Non-owning reference to a callable taking a task index
+	///Unlike std::function, building one never allocates: the callable
+	///must outlive the TaskRef, as for a lambda passed to a call
+	class TaskRef
+	{
+
+	public:
+		template <class F,
+				  class = typename std::enable_if<
+					  !std::is_same<typename std::decay<F>::type,
+									TaskRef>::value>::type>
+		TaskRef (F&& f)
+			: obj_ (const_cast<void*> (static_cast<const void*> (&f)))
+			, call_ (&call_impl_<typename std::remove_reference<F>::type>)
+		{}
+
+		void
+		operator() (std::size_t i) const
+		{
+			call_ (obj_, i);
+		}
+
+	private:
+		template <class F>
+		static void
+		call_impl_ (void* obj, std::size_t i)
+		{
+			(*static_cast<F*> (obj)) (i);
+		}
+
+		void* obj_;
+		void (*call_) (void*, std::size_t);
+
+	};
+
+}
+
+#endif //!TASK_REF_HH_
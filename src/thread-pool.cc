@@ -0,0 +1,113 @@
+#include "thread-pool.hh"
+
+namespace opl
+{
+
+	namespace
+	{
+		thread_local bool is_worker = false;
+	}
+
+	ThreadPool::ThreadPool (std::size_t threads)
+		: batch_ (nullptr)
+		, generation_ (0)
+		, active_ (0)
+		, stop_ (false)
+	{
+		for (std::size_t i = 1; i < threads; ++i)
+			workers_.emplace_back (&ThreadPool::worker_loop_, this);
+	}
+
+	ThreadPool::~ThreadPool ()
+	{
+		{
+			std::lock_guard<std::mutex> lock (mutex_);
+			stop_ = true;
+		}
+		wake_.notify_all ();
+		for (auto& t : workers_)
+			t.join ();
+	}
+
+	std::size_t
+	ThreadPool::size () const
+	{
+		return workers_.size () + 1;
+	}
+
+	void
+	ThreadPool::run (std::size_t tasks, TaskRef f)
+	{
+		if (!tasks)
+			return;
+
+		std::lock_guard<std::mutex> run_lock (run_mutex_);
+		Batch batch {f, tasks, {0}};
+
+		{
+			std::lock_guard<std::mutex> lock (mutex_);
+			batch_ = &batch;
+			++generation_;
+		}
+		wake_.notify_all ();
+
+		//Nested parallel calls from the tasks run serially
+		bool was_worker = is_worker;
+		is_worker = true;
+		work_ (batch);
+		is_worker = was_worker;
+
+		//No worker may join the batch once it is unpublished,
+		//wait for the ones still running a task
+		std::unique_lock<std::mutex> lock (mutex_);
+		batch_ = nullptr;
+		idle_.wait (lock, [this] { return !active_; });
+	}
+
+	bool
+	ThreadPool::in_worker ()
+	{
+		return is_worker;
+	}
+
+	void
+	ThreadPool::worker_loop_ ()
+	{
+		is_worker = true;
+		std::size_t seen = 0;
+		std::unique_lock<std::mutex> lock (mutex_);
+
+		while (true)
+		{
+			wake_.wait (lock, [&] {
+					return stop_ || (batch_ && generation_ != seen);
+				});
+			if (stop_)
+				return;
+
+			seen = generation_;
+			Batch* batch = batch_;
+			++active_;
+			lock.unlock ();
+
+			work_ (*batch);
+
+			lock.lock ();
+			if (!--active_)
+				idle_.notify_all ();
+		}
+	}
+
+	void
+	ThreadPool::work_ (Batch& batch)
+	{
+		while (true)
+		{
+			std::size_t i = batch.next++;
+			if (i >= batch.tasks)
+				return;
+			batch.f (i);
+		}
+	}
+
+}
@@ -0,0 +1,72 @@
+/** @file ThreadPool class definition
+ */
+
+#ifndef THREAD_POOL_HH_
+#define THREAD_POOL_HH_
+
+# include <atomic>
+# include <condition_variable>
+# include <cstddef>
+# include <mutex>
+# include <thread>
+# include <vector>
+# include "task-ref.hh"
+
+namespace opl
+{
+
+	/// Fixed set of worker threads running batches of indexed tasks
+	/// The thread calling run () takes part in the batch
+	class ThreadPool
+	{
+
+	public:
+		///Spawns threads - 1 workers
+		ThreadPool (std::size_t threads);
+		~ThreadPool ();
+
+		ThreadPool (const ThreadPool&) = delete;
+		ThreadPool& operator= (const ThreadPool&) = delete;
+
+		///Number of threads running a batch, caller included
+		std::size_t
+		size () const;
+
+		///Calls f (0), ..., f (tasks - 1) and returns once they are all done
+		///Batches submitted from several threads are run one after another
+		void
+		run (std::size_t tasks, TaskRef f);
+
+		///Returns true when called from a thread running a batch task
+		static bool
+		in_worker ();
+
+	private:
+		struct Batch
+		{
+			TaskRef f;
+			std::size_t tasks;
+			std::atomic<std::size_t> next;
+		};
+
+		void
+		worker_loop_ ();
+
+		static void
+		work_ (Batch& batch);
+
+		std::vector<std::thread> workers_;
+		std::mutex run_mutex_;
+		std::mutex mutex_;
+		std::condition_variable wake_;
+		std::condition_variable idle_;
+		Batch* batch_;
+		std::size_t generation_;
+		std::size_t active_;
+		bool stop_;
+
+	};
+
+}
+
+#endif //!THREAD_POOL_HH_
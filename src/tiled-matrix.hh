@@ -0,0 +1,1023 @@
+/** @file TiledMatrix class definition
+ *
+ * Matrix stored on disk as square tiles, for data larger than the memory.
+ * Tiles are b x b (zero padded on the last tile row / column), stored one
+ * after the other in a BlockFile, in row-major order of the tiles.
+ * A bounded LRU cache keeps the tiles in memory: a tile is read when first
+ * accessed, and written back when evicted, if modified.
+ * Tiles handed out by tile () are pinned: they are not evicted while the
+ * handle lives. prefetch () queues the read of a tile on the IoWorker
+ * shared by the program, so the algorithms below overlap the disk reads of the next tiles with the
+ * computations on the current ones.
+ * The linalg functions at the end (gemm, transpose, Cholesky and LU) work
+ * tile by tile with the in-memory kernels, and only keep a few tiles
+ * pinned at once (the LU also keeps one column panel in memory).
+ */
+
+#ifndef TILED_MATRIX_HH_
+# define TILED_MATRIX_HH_
+
+# include <algorithm>
+# include <cassert>
+# include <cmath>
+# include <cstddef>
+# include <cstdint>
+# include <cstring>
+# include <exception>
+# include <list>
+# include <memory>
+# include <stdexcept>
+# include <string>
+# include <type_traits>
+# include <unordered_map>
+# include <vector>
+# include "block-file.hh"
+# include "gemm.hh"
+# include "io-worker.hh"
+# include "matrix.hh"
+# include "parallel.hh"
+# include "transpose.hh"
+# include "triangular.hh"
+
+///Default side of the tiles
+# define OPL_TILE_SIZE 256
+
+///Default number of tiles kept in memory
+# define OPL_TILE_CACHE 64
+
+namespace opl
+{
+
+	template <class T>
+	class TiledMatrix
+	{
+		static_assert (std::is_trivially_copyable<T>::value,
+					   "tiles are stored as raw bytes");
+
+		struct Entry_;
+
+	public:
+		typedef T value_type;
+		typedef std::size_t size_type;
+
+		///Tile pinned in the cache, U is T or const T
+		///The values of row i start at data () + i * ld ()
+		template <class U>
+		class TileRef
+		{
+
+		public:
+			TileRef (TileRef&& t) noexcept;
+
+			TileRef (const TileRef&) = delete;
+
+			TileRef&
+			operator= (const TileRef&) = delete;
+
+			///Unpins the tile
+			~TileRef ();
+
+			U*
+			data () const;
+
+			size_type
+			rows () const;
+
+			size_type
+			cols () const;
+
+			///Distance between two rows: the tile size
+			size_type
+			ld () const;
+
+			U&
+			at (size_type i, size_type j) const;
+
+			MatrixView<U>
+			view () const;
+
+		private:
+			friend class TiledMatrix;
+
+			TileRef (Entry_* e, size_type rows, size_type cols, size_type ld);
+
+			Entry_* e_;
+			size_type rows_;
+			size_type cols_;
+			size_type ld_;
+
+		};
+
+		typedef TileRef<T> Tile;
+		typedef TileRef<const T> ConstTile;
+
+		///Creates the file at path for a rows x cols null matrix
+		///cache is the number of tiles kept in memory, at least 4
+		TiledMatrix (const std::string& path, size_type rows, size_type cols,
+					 size_type tile = OPL_TILE_SIZE,
+					 size_type cache = OPL_TILE_CACHE);
+
+		///Opens a matrix written by an other TiledMatrix
+		static TiledMatrix
+		open (const std::string& path, size_type cache = OPL_TILE_CACHE);
+
+		TiledMatrix (TiledMatrix&& m) = default;
+
+		///Writes back the modified tiles, see flush ()
+		~TiledMatrix ();
+
+		size_type
+		rows () const;
+
+		size_type
+		cols () const;
+
+		size_type
+		size () const;
+
+		///Side of the tiles
+		size_type
+		tile_size () const;
+
+		///Number of tiles on a column
+		size_type
+		tile_rows () const;
+
+		///Number of tiles on a row
+		size_type
+		tile_cols () const;
+
+		///Maximum number of tiles in memory
+		size_type
+		cache_size () const;
+
+		///Value (i, j), reads its tile if not in the cache
+		T
+		at (size_type i, size_type j) const;
+
+		void
+		set (size_type i, size_type j, const T& x);
+
+		///Tile (i, j), marked as modified
+		Tile
+		tile (size_type i, size_type j);
+
+		ConstTile
+		tile (size_type i, size_type j) const;
+
+		ConstTile
+		ctile (size_type i, size_type j) const;
+
+		///Starts reading tile (i, j) in the background
+		///Ignored if the tile is cached or the cache is full of pinned tiles
+		void
+		prefetch (size_type i, size_type j) const;
+
+		///Writes back the modified tiles
+		///Throws std::runtime_error if a write or a prefetch fails, once
+		///every prefetch is done and every other tile written
+		void
+		flush ();
+
+		///Copies m, of the same dimensions, tile by tile
+		template <StorageOrder O>
+		void
+		assign (const Matrix<T, O>& m);
+
+		///Loads the whole matrix in memory
+		Matrix<T>
+		matrix_get () const;
+
+	private:
+		struct Entry_
+		{
+			std::vector<T> data;
+			size_type key;
+			size_type pins;
+			bool dirty;
+			///Prefetch read not waited for yet, 0 if none
+			IoWorker::ticket_type pending;
+			typename std::list<size_type>::iterator lru;
+		};
+
+		struct Header_
+		{
+			char magic[8];
+			std::uint32_t version;
+			std::uint32_t value_size;
+			std::uint64_t rows;
+			std::uint64_t cols;
+			std::uint64_t tile;
+			char padding[24];
+		};
+
+		static_assert (sizeof (Header_) == 64, "Header_ must not be padded");
+
+		TiledMatrix (std::unique_ptr<BlockFile> file, const Header_& h,
+					 size_type cache);
+
+		size_type
+		offset_ (size_type key) const;
+
+		///Cached entry of tile key, read or waited for if needed, pinned
+		Entry_*
+		acquire_ (size_type key, bool write) const;
+
+		///New entry for key, nullptr if all the cached tiles are pinned
+		Entry_*
+		insert_ (size_type key) const;
+
+		///Evicts the least recently used tile not pinned
+		bool
+		evict_ () const;
+
+		///Drops e from the cache, its buffer becomes the spare one
+		void
+		remove_ (Entry_& e) const;
+
+		///Waits for the prefetch of e, if any
+		void
+		wait_ (Entry_& e) const;
+
+		void
+		store_ (Entry_& e) const;
+
+		std::unique_ptr<BlockFile> file_;
+		size_type rows_;
+		size_type cols_;
+		size_type b_;
+		size_type cache_;
+
+		///Most recently used tiles first
+		mutable std::list<size_type> lru_;
+		mutable std::unordered_map<size_type, std::unique_ptr<Entry_>> tiles_;
+
+		///Buffer of the last evicted tile, reused by the next one
+		mutable std::vector<T> spare_;
+
+	};
+
+
+	template <class T>
+	template <class U>
+	TiledMatrix<T>::TileRef<U>::TileRef (Entry_* e, size_type rows,
+										 size_type cols, size_type ld)
+		: e_ (e)
+		, rows_ (rows)
+		, cols_ (cols)
+		, ld_ (ld)
+	{
+
+	}
+
+	template <class T>
+	template <class U>
+	TiledMatrix<T>::TileRef<U>::TileRef (TileRef&& t) noexcept
+		: e_ (t.e_)
+		, rows_ (t.rows_)
+		, cols_ (t.cols_)
+		, ld_ (t.ld_)
+	{
+		t.e_ = nullptr;
+	}
+
+	template <class T>
+	template <class U>
+	TiledMatrix<T>::TileRef<U>::~TileRef ()
+	{
+		if (e_)
+			--e_->pins;
+	}
+
+	template <class T>
+	template <class U>
+	U*
+	TiledMatrix<T>::TileRef<U>::data () const
+	{
+		return e_->data.data ();
+	}
+
+	template <class T>
+	template <class U>
+	typename TiledMatrix<T>::size_type
+	TiledMatrix<T>::TileRef<U>::rows () const
+	{
+		return rows_;
+	}
+
+	template <class T>
+	template <class U>
+	typename TiledMatrix<T>::size_type
+	TiledMatrix<T>::TileRef<U>::cols () const
+	{
+		return cols_;
+	}
+
+	template <class T>
+	template <class U>
+	typename TiledMatrix<T>::size_type
+	TiledMatrix<T>::TileRef<U>::ld () const
+	{
+		return ld_;
+	}
+
+	template <class T>
+	template <class U>
+	U&
+	TiledMatrix<T>::TileRef<U>::at (size_type i, size_type j) const
+	{
+		assert (i < rows_);
+		assert (j < cols_);
+		return data ()[i * ld_ + j];
+	}
+
+	template <class T>
+	template <class U>
+	MatrixView<U>
+	TiledMatrix<T>::TileRef<U>::view () const
+	{
+		return MatrixView<U> (data (), rows_, cols_, ld_);
+	}
+
+
+	template <class T>
+	TiledMatrix<T>::TiledMatrix (const std::string& path,
+								 size_type rows, size_type cols,
+								 size_type tile, size_type cache)
+		: file_ (new BlockFile (path, true))
+		, rows_ (rows)
+		, cols_ (cols)
+		, b_ (tile)
+		, cache_ (cache)
+	{
+		assert (tile);
+		assert (cache >= 4);
+		Header_ h {};
+		std::memcpy (h.magic, "OPLTILED", 8);
+		h.version = 1;
+		h.value_size = sizeof (T);
+		h.rows = rows;
+		h.cols = cols;
+		h.tile = tile;
+		file_->write (0, &h, sizeof (h));
+		file_->resize (offset_ (tile_rows () * tile_cols ()));
+	}
+
+	template <class T>
+	TiledMatrix<T>::TiledMatrix (std::unique_ptr<BlockFile> file,
+								 const Header_& h, size_type cache)
+		: file_ (std::move (file))
+		, rows_ (h.rows)
+		, cols_ (h.cols)
+		, b_ (h.tile)
+		, cache_ (cache)
+	{
+		assert (cache >= 4);
+	}
+
+	template <class T>
+	TiledMatrix<T>
+	TiledMatrix<T>::open (const std::string& path, size_type cache)
+	{
+		std::unique_ptr<BlockFile> file (new BlockFile (path, false));
+		Header_ h;
+		if (file->size () < sizeof (h))
+			throw std::runtime_error ("TiledMatrix: truncated file " + path);
+		file->read (0, &h, sizeof (h));
+		if (std::memcmp (h.magic, "OPLTILED", 8) || h.version != 1
+			|| h.value_size != sizeof (T) || !h.tile)
+			throw std::runtime_error ("TiledMatrix: not a tiled matrix of T "
+									  + path);
+
+		TiledMatrix m (std::move (file), h, cache);
+		if (m.file_->size () < m.offset_ (m.tile_rows () * m.tile_cols ()))
+			throw std::runtime_error ("TiledMatrix: truncated file " + path);
+		return m;
+	}
+
+	template <class T>
+	TiledMatrix<T>::~TiledMatrix ()
+	{
+		//Write errors can only be seen by calling flush () before
+		try
+		{
+			flush ();
+		}
+		catch (const std::runtime_error&)
+		{
+
+		}
+	}
+
+	template <class T>
+	typename TiledMatrix<T>::size_type
+	TiledMatrix<T>::rows () const
+	{
+		return rows_;
+	}
+
+	template <class T>
+	typename TiledMatrix<T>::size_type
+	TiledMatrix<T>::cols () const
+	{
+		return cols_;
+	}
+
+	template <class T>
+	typename TiledMatrix<T>::size_type
+	TiledMatrix<T>::size () const
+	{
+		return rows_ * cols_;
+	}
+
+	template <class T>
+	typename TiledMatrix<T>::size_type
+	TiledMatrix<T>::tile_size () const
+	{
+		return b_;
+	}
+
+	template <class T>
+	typename TiledMatrix<T>::size_type
+	TiledMatrix<T>::tile_rows () const
+	{
+		return (rows_ + b_ - 1) / b_;
+	}
+
+	template <class T>
+	typename TiledMatrix<T>::size_type
+	TiledMatrix<T>::tile_cols () const
+	{
+		return (cols_ + b_ - 1) / b_;
+	}
+
+	template <class T>
+	typename TiledMatrix<T>::size_type
+	TiledMatrix<T>::cache_size () const
+	{
+		return cache_;
+	}
+
+	template <class T>
+	T
+	TiledMatrix<T>::at (size_type i, size_type j) const
+	{
+		assert (i < rows_);
+		assert (j < cols_);
+		ConstTile t = tile (i / b_, j / b_);
+		return t.at (i % b_, j % b_);
+	}
+
+	template <class T>
+	void
+	TiledMatrix<T>::set (size_type i, size_type j, const T& x)
+	{
+		assert (i < rows_);
+		assert (j < cols_);
+		Tile t = tile (i / b_, j / b_);
+		t.at (i % b_, j % b_) = x;
+	}
+
+	template <class T>
+	typename TiledMatrix<T>::Tile
+	TiledMatrix<T>::tile (size_type i, size_type j)
+	{
+		assert (i < tile_rows ());
+		assert (j < tile_cols ());
+		return Tile (acquire_ (i * tile_cols () + j, true),
+					 std::min (b_, rows_ - i * b_),
+					 std::min (b_, cols_ - j * b_), b_);
+	}
+
+	template <class T>
+	typename TiledMatrix<T>::ConstTile
+	TiledMatrix<T>::tile (size_type i, size_type j) const
+	{
+		assert (i < tile_rows ());
+		assert (j < tile_cols ());
+		return ConstTile (acquire_ (i * tile_cols () + j, false),
+						  std::min (b_, rows_ - i * b_),
+						  std::min (b_, cols_ - j * b_), b_);
+	}
+
+	template <class T>
+	typename TiledMatrix<T>::ConstTile
+	TiledMatrix<T>::ctile (size_type i, size_type j) const
+	{
+		return tile (i, j);
+	}
+
+	template <class T>
+	void
+	TiledMatrix<T>::prefetch (size_type i, size_type j) const
+	{
+		if (i >= tile_rows () || j >= tile_cols ())
+			return;
+		size_type key = i * tile_cols () + j;
+		if (tiles_.count (key))
+			return;
+		Entry_* e = insert_ (key);
+		if (!e)
+			return;
+
+		e->pending = IoWorker::shared ().read (*file_, offset_ (key),
+											   e->data.data (),
+											   b_ * b_ * sizeof (T));
+	}
+
+	template <class T>
+	void
+	TiledMatrix<T>::flush ()
+	{
+		if (!file_)
+			return;
+
+		//No read may still target a buffer when this returns, the
+		//tiles that failed to read are dropped
+		std::exception_ptr error;
+		std::vector<size_type> failed;
+		for (auto& kv : tiles_)
+			try
+			{
+				wait_ (*kv.second);
+			}
+			catch (const std::runtime_error&)
+			{
+				if (!error)
+					error = std::current_exception ();
+				failed.push_back (kv.first);
+			}
+		for (size_type key : failed)
+			remove_ (*tiles_[key]);
+
+		for (auto& kv : tiles_)
+			try
+			{
+				store_ (*kv.second);
+			}
+			catch (const std::runtime_error&)
+			{
+				if (!error)
+					error = std::current_exception ();
+			}
+
+		if (error)
+			std::rethrow_exception (error);
+	}
+
+	template <class T>
+	template <StorageOrder O>
+	void
+	TiledMatrix<T>::assign (const Matrix<T, O>& m)
+	{
+		assert (m.rows () == rows_ && m.cols () == cols_);
+		for (size_type ti = 0; ti < tile_rows (); ++ti)
+			for (size_type tj = 0; tj < tile_cols (); ++tj)
+			{
+				Tile t = tile (ti, tj);
+				for (size_type i = 0; i < t.rows (); ++i)
+					for (size_type j = 0; j < t.cols (); ++j)
+						t.at (i, j) = m.at (ti * b_ + i, tj * b_ + j);
+			}
+	}
+
+	template <class T>
+	Matrix<T>
+	TiledMatrix<T>::matrix_get () const
+	{
+		Matrix<T> m (rows_, cols_);
+		for (size_type ti = 0; ti < tile_rows (); ++ti)
+			for (size_type tj = 0; tj < tile_cols (); ++tj)
+			{
+				prefetch (ti, tj + 1);
+				ConstTile t = tile (ti, tj);
+				for (size_type i = 0; i < t.rows (); ++i)
+					std::copy_n (t.data () + i * b_, t.cols (),
+								 &m.at (ti * b_ + i, tj * b_));
+			}
+		return m;
+	}
+
+	template <class T>
+	typename TiledMatrix<T>::size_type
+	TiledMatrix<T>::offset_ (size_type key) const
+	{
+		return sizeof (Header_) + key * b_ * b_ * sizeof (T);
+	}
+
+	template <class T>
+	typename TiledMatrix<T>::Entry_*
+	TiledMatrix<T>::acquire_ (size_type key, bool write) const
+	{
+		auto it = tiles_.find (key);
+		bool cached = it != tiles_.end ();
+		Entry_* e;
+		if (cached)
+		{
+			e = it->second.get ();
+			lru_.splice (lru_.begin (), lru_, e->lru);
+		}
+		else
+		{
+			e = insert_ (key);
+			if (!e)
+				throw std::runtime_error ("TiledMatrix: all cached tiles "
+										  "are pinned");
+		}
+
+		//A tile that failed to read is not cached, the next access
+		//reads it again
+		try
+		{
+			if (!cached)
+				file_->read (offset_ (key), e->data.data (),
+							 b_ * b_ * sizeof (T));
+			wait_ (*e);
+		}
+		catch (const std::runtime_error&)
+		{
+			remove_ (*e);
+			throw;
+		}
+		++e->pins;
+		e->dirty = e->dirty || write;
+		return e;
+	}
+
+	template <class T>
+	typename TiledMatrix<T>::Entry_*
+	TiledMatrix<T>::insert_ (size_type key) const
+	{
+		if (tiles_.size () >= cache_ && !evict_ ())
+			return nullptr;
+
+		std::unique_ptr<Entry_> e (new Entry_ ());
+		e->data.swap (spare_);
+		e->data.resize (b_ * b_);
+		e->key = key;
+		e->pins = 0;
+		e->dirty = false;
+		e->pending = 0;
+		lru_.push_front (key);
+		e->lru = lru_.begin ();
+		Entry_* res = e.get ();
+		tiles_.emplace (key, std::move (e));
+		return res;
+	}
+
+	template <class T>
+	bool
+	TiledMatrix<T>::evict_ () const
+	{
+		for (auto it = lru_.rbegin (); it != lru_.rend (); ++it)
+		{
+			auto t = tiles_.find (*it);
+			Entry_& e = *t->second;
+			if (e.pins)
+				continue;
+
+			//A failed prefetch only loses a tile nobody has used yet
+			try
+			{
+				wait_ (e);
+			}
+			catch (const std::runtime_error&)
+			{
+				remove_ (e);
+				return true;
+			}
+			store_ (e);
+			remove_ (e);
+			return true;
+		}
+		return false;
+	}
+
+	template <class T>
+	void
+	TiledMatrix<T>::remove_ (Entry_& e) const
+	{
+		spare_.swap (e.data);
+		lru_.erase (e.lru);
+		tiles_.erase (e.key);
+	}
+
+	template <class T>
+	void
+	TiledMatrix<T>::wait_ (Entry_& e) const
+	{
+		if (!e.pending)
+			return;
+		IoWorker::ticket_type t = e.pending;
+		e.pending = 0;
+		IoWorker::shared ().wait (t);
+	}
+
+	template <class T>
+	void
+	TiledMatrix<T>::store_ (Entry_& e) const
+	{
+		if (!e.dirty)
+			return;
+		file_->write (offset_ (e.key), e.data.data (), b_ * b_ * sizeof (T));
+		e.dirty = false;
+	}
+
+
+	namespace linalg
+	{
+
+		///C <- alpha AB + beta C, the matrices have the same tile size
+		///C must not be A or B
+		template <class T>
+		void
+		gemm (T alpha, const TiledMatrix<T>& a, const TiledMatrix<T>& b,
+			  T beta, TiledMatrix<T>& c)
+		{
+			assert (a.cols () == b.rows ());
+			assert (c.rows () == a.rows () && c.cols () == b.cols ());
+			assert (a.tile_size () == b.tile_size ()
+					&& a.tile_size () == c.tile_size ());
+			assert (&c != &a && &c != &b);
+
+			std::size_t ld = c.tile_size ();
+			for (std::size_t i = 0; i < c.tile_rows (); ++i)
+				for (std::size_t j = 0; j < c.tile_cols (); ++j)
+				{
+					auto ct = c.tile (i, j);
+					T* cd = ct.data ();
+					for (std::size_t r = 0; r < ct.rows (); ++r)
+						for (std::size_t s = 0; s < ct.cols (); ++s)
+							cd[r * ld + s] = beta == static_cast<T> (0)
+								? static_cast<T> (0) : beta * cd[r * ld + s];
+
+					for (std::size_t k = 0; k < a.tile_cols (); ++k)
+					{
+						a.prefetch (i, k + 1);
+						b.prefetch (k + 1, j);
+						auto at = a.tile (i, k);
+						auto bt = b.tile (k, j);
+						gemm (ct.rows (), ct.cols (), at.cols (), alpha,
+							  at.data (), ld, std::size_t (1),
+							  bt.data (), ld, std::size_t (1),
+							  static_cast<T> (1), cd, ld, std::size_t (1));
+					}
+				}
+		}
+
+		///B <- A^T, the matrices have the same tile size
+		template <class T>
+		void
+		transpose (const TiledMatrix<T>& a, TiledMatrix<T>& b)
+		{
+			assert (b.rows () == a.cols () && b.cols () == a.rows ());
+			assert (a.tile_size () == b.tile_size ());
+			assert (&a != &b);
+
+			std::size_t ld = a.tile_size ();
+			for (std::size_t i = 0; i < a.tile_rows (); ++i)
+				for (std::size_t j = 0; j < a.tile_cols (); ++j)
+				{
+					a.prefetch (i, j + 1);
+					auto src = a.tile (i, j);
+					auto dst = b.tile (j, i);
+					transpose (src.rows (), src.cols (), src.data (), ld,
+							   dst.data (), ld);
+				}
+		}
+
+		///B <- B L^-T, L lower triangular n x n, B m x n
+		template <class T>
+		void
+		lower_transpose_right_solve_ (std::size_t m, std::size_t n,
+									  const T* l, std::size_t ldl,
+									  T* b, std::size_t ldb)
+		{
+			parallel::for_range (m, m * n * n / 2,
+								 [&](std::size_t i0, std::size_t i1) {
+					for (std::size_t i = i0; i < i1; ++i)
+					{
+						T* bi = b + i * ldb;
+						for (std::size_t j = 0; j < n; ++j)
+						{
+							const T* lj = l + j * ldl;
+							T val = bi[j];
+							for (std::size_t k = 0; k < j; ++k)
+								val -= bi[k] * lj[k];
+							bi[j] = val / lj[j];
+						}
+					}
+				});
+		}
+
+		///Unblocked Cholesky of a n x n tile, the upper part is zeroed
+		template <class T>
+		bool
+		cholesky_tile_ (std::size_t n, T* a, std::size_t lda)
+		{
+			for (std::size_t j = 0; j < n; ++j)
+			{
+				T* aj = a + j * lda;
+				T d = aj[j];
+				for (std::size_t k = 0; k < j; ++k)
+					d -= aj[k] * aj[k];
+				if (!(d > static_cast<T> (0)))
+					return false;
+				aj[j] = std::sqrt (d);
+				std::fill (aj + j + 1, aj + n, static_cast<T> (0));
+
+				for (std::size_t i = j + 1; i < n; ++i)
+				{
+					T* ai = a + i * lda;
+					T val = ai[j];
+					for (std::size_t k = 0; k < j; ++k)
+						val -= ai[k] * aj[k];
+					ai[j] = val / aj[j];
+				}
+			}
+			return true;
+		}
+
+		///A <- L, A = LL^T, the tiles above the diagonal are zeroed
+		///Returns false if A isn't symmetric positive definite, A is then
+		///left partially factorized
+		template <class T>
+		bool
+		cholesky_factorize (TiledMatrix<T>& a)
+		{
+			assert (a.rows () == a.cols ());
+			std::size_t nt = a.tile_rows ();
+			std::size_t ld = a.tile_size ();
+
+			for (std::size_t k = 0; k < nt; ++k)
+			{
+				{
+					auto akk = a.tile (k, k);
+					if (!cholesky_tile_ (akk.rows (), akk.data (), ld))
+						return false;
+				}
+
+				for (std::size_t i = k + 1; i < nt; ++i)
+				{
+					a.prefetch (i + 1, k);
+					auto lkk = a.ctile (k, k);
+					auto aik = a.tile (i, k);
+					lower_transpose_right_solve_ (aik.rows (), aik.cols (),
+												  lkk.data (), ld,
+												  aik.data (), ld);
+					auto akj = a.tile (k, i);
+					std::fill (akj.data (), akj.data () + ld * ld,
+							   static_cast<T> (0));
+				}
+
+				//Trailing lower tiles: A(i, j) -= L(i, k) L(j, k)^T
+				for (std::size_t j = k + 1; j < nt; ++j)
+				{
+					auto ljk = a.ctile (j, k);
+					for (std::size_t i = j; i < nt; ++i)
+					{
+						a.prefetch (i + 1, k);
+						a.prefetch (i + 1, j);
+						auto lik = a.ctile (i, k);
+						auto aij = a.tile (i, j);
+						gemm (aij.rows (), aij.cols (), lik.cols (),
+							  static_cast<T> (-1),
+							  lik.data (), ld, std::size_t (1),
+							  ljk.data (), std::size_t (1), ld,
+							  static_cast<T> (1), aij.data (), ld,
+							  std::size_t (1));
+					}
+				}
+			}
+			return true;
+		}
+
+		///Swaps rows r1 and r2 in the tile column j
+		template <class T>
+		void
+		tile_row_swap_ (TiledMatrix<T>& a, std::size_t j,
+						std::size_t r1, std::size_t r2)
+		{
+			std::size_t b = a.tile_size ();
+			auto t1 = a.tile (r1 / b, j);
+			T* p1 = t1.data () + r1 % b * b;
+			if (r1 / b == r2 / b)
+				std::swap_ranges (p1, p1 + t1.cols (), t1.data () + r2 % b * b);
+			else
+			{
+				auto t2 = a.tile (r2 / b, j);
+				std::swap_ranges (p1, p1 + t1.cols (), t2.data () + r2 % b * b);
+			}
+		}
+
+		///PA = LU in place, as lu_factorize for in-memory matrices
+		///Each column of tiles is factorized in a memory panel (n x b) with
+		///partial pivoting, the interchanges are then applied to the other
+		///tile columns, and the trailing tiles updated one gemm at a time
+		///Returns the number of row interchanges
+		template <class T>
+		std::size_t
+		lu_factorize (TiledMatrix<T>& a, std::vector<std::size_t>& piv)
+		{
+			assert (a.rows () == a.cols ());
+			std::size_t n = a.rows ();
+			std::size_t nt = a.tile_rows ();
+			std::size_t b = a.tile_size ();
+			std::size_t swaps = 0;
+			std::vector<T> panel;
+			piv.resize (n);
+
+			for (std::size_t k = 0; k < nt; ++k)
+			{
+				std::size_t r0 = k * b;
+				std::size_t kb = std::min (b, n - r0);
+				std::size_t m = n - r0;
+
+				//Gathers A[r0:n, r0:r0+kb]
+				panel.resize (m * kb);
+				for (std::size_t i = k; i < nt; ++i)
+				{
+					a.prefetch (i + 1, k);
+					auto t = a.ctile (i, k);
+					for (std::size_t r = 0; r < t.rows (); ++r)
+						std::copy_n (t.data () + r * b, kb,
+									 panel.data () + ((i - k) * b + r) * kb);
+				}
+
+				for (std::size_t j = 0; j < kb; ++j)
+				{
+					std::size_t p = j;
+					for (std::size_t i = j + 1; i < m; ++i)
+						if (std::abs (panel[i * kb + j])
+							> std::abs (panel[p * kb + j]))
+							p = i;
+					piv[r0 + j] = r0 + p;
+					if (p != j)
+					{
+						std::swap_ranges (panel.data () + j * kb,
+										  panel.data () + (j + 1) * kb,
+										  panel.data () + p * kb);
+						++swaps;
+					}
+
+					T d = panel[j * kb + j];
+					if (d == static_cast<T> (0))
+						continue;
+					const T* uj = panel.data () + j * kb;
+					parallel::for_range (m - j - 1, (m - j) * (kb - j),
+										 [&](std::size_t i0, std::size_t i1) {
+							for (std::size_t i = j + 1 + i0; i < j + 1 + i1; ++i)
+							{
+								T* ai = panel.data () + i * kb;
+								T lij = ai[j] / d;
+								ai[j] = lij;
+								for (std::size_t c = j + 1; c < kb; ++c)
+									ai[c] -= lij * uj[c];
+							}
+						});
+				}
+
+				for (std::size_t i = k; i < nt; ++i)
+				{
+					auto t = a.tile (i, k);
+					for (std::size_t r = 0; r < t.rows (); ++r)
+						std::copy_n (panel.data () + ((i - k) * b + r) * kb, kb,
+									 t.data () + r * b);
+				}
+
+				for (std::size_t j = 0; j < nt; ++j)
+					if (j != k)
+						for (std::size_t r = r0; r < r0 + kb; ++r)
+							if (piv[r] != r)
+								tile_row_swap_ (a, j, r, piv[r]);
+
+				//U(k, j) <- L(k, k)^-1 A(k, j), A(i, j) -= L(i, k) U(k, j)
+				for (std::size_t j = k + 1; j < nt; ++j)
+				{
+					auto lkk = a.ctile (k, k);
+					auto ukj = a.tile (k, j);
+					lower_unit_solve (kb, ukj.cols (), lkk.data (), b,
+									  ukj.data (), b);
+					for (std::size_t i = k + 1; i < nt; ++i)
+					{
+						a.prefetch (i + 1, k);
+						a.prefetch (i + 1, j);
+						auto lik = a.ctile (i, k);
+						auto aij = a.tile (i, j);
+						gemm (aij.rows (), aij.cols (), kb, static_cast<T> (-1),
+							  lik.data (), b, std::size_t (1),
+							  ukj.data (), b, std::size_t (1),
+							  static_cast<T> (1), aij.data (), b,
+							  std::size_t (1));
+					}
+				}
+			}
+
+			return swaps;
+		}
+
+	}
+
+}
+
+#endif //!TILED_MATRIX_HH_
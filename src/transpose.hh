@@ -0,0 +1,259 @@
+/** @file Cache-blocked matrix transposition
+ *
+ * The out-of-place transpose splits the larger dimension in two until the
+ * block fits in the L1 cache (cache-oblivious recursion), then copies it
+ * with b x b register micro-transposes: rows are read and columns written
+ * a tile at a time instead of one value at a time.
+ * The in-place transpose of a square matrix swaps block (I, J) with the
+ * transpose of block (J, I) through a small buffer.
+ * float and double use SSE or AVX micro-transposes depending on the target
+ * flags (-msse2, -mavx), other types use a generic one.
+ * With the parallel backend enabled, row bands are shared between threads.
+ */
+
+#ifndef TRANSPOSE_HH_
+# define TRANSPOSE_HH_
+
+# include <cstddef>
+# include <algorithm>
+# include "parallel.hh"
+
+# if defined (__AVX__)
+#  include <immintrin.h>
+#  define OPL_TRANSPOSE_AVX
+# elif defined (__SSE2__)
+#  include <emmintrin.h>
+#  define OPL_TRANSPOSE_SSE2
+# endif
+
+///Side of the blocks transposed without recursion, must be a multiple of 8
+# define OPL_TRANSPOSE_BLOCK 32
+
+namespace opl
+{
+
+	namespace linalg
+	{
+
+		///b x b micro-transpose for the type T
+		template <class T>
+		struct TransposeKernel
+		{
+			static constexpr std::size_t b = 4;
+
+			///dst <- src^T, src and dst are b x b
+			static void
+			run (const T* src, std::size_t lds, T* dst, std::size_t ldd)
+			{
+				for (std::size_t i = 0; i < b; ++i)
+					for (std::size_t j = 0; j < b; ++j)
+						dst[j * ldd + i] = src[i * lds + j];
+			}
+		};
+
+# if defined (OPL_TRANSPOSE_AVX)
+
+		template <>
+		struct TransposeKernel<double>
+		{
+			static constexpr std::size_t b = 4;
+
+			static void
+			run (const double* src, std::size_t lds, double* dst, std::size_t ldd)
+			{
+				__m256d r0 = _mm256_loadu_pd (src);
+				__m256d r1 = _mm256_loadu_pd (src + lds);
+				__m256d r2 = _mm256_loadu_pd (src + 2 * lds);
+				__m256d r3 = _mm256_loadu_pd (src + 3 * lds);
+				__m256d t0 = _mm256_unpacklo_pd (r0, r1);
+				__m256d t1 = _mm256_unpackhi_pd (r0, r1);
+				__m256d t2 = _mm256_unpacklo_pd (r2, r3);
+				__m256d t3 = _mm256_unpackhi_pd (r2, r3);
+				_mm256_storeu_pd (dst, _mm256_permute2f128_pd (t0, t2, 0x20));
+				_mm256_storeu_pd (dst + ldd, _mm256_permute2f128_pd (t1, t3, 0x20));
+				_mm256_storeu_pd (dst + 2 * ldd,
+								  _mm256_permute2f128_pd (t0, t2, 0x31));
+				_mm256_storeu_pd (dst + 3 * ldd,
+								  _mm256_permute2f128_pd (t1, t3, 0x31));
+			}
+		};
+
+		template <>
+		struct TransposeKernel<float>
+		{
+			static constexpr std::size_t b = 8;
+
+			static void
+			run (const float* src, std::size_t lds, float* dst, std::size_t ldd)
+			{
+				__m256 t[8];
+				__m256 s[8];
+				for (std::size_t i = 0; i < 8; i += 2)
+				{
+					__m256 r0 = _mm256_loadu_ps (src + i * lds);
+					__m256 r1 = _mm256_loadu_ps (src + (i + 1) * lds);
+					t[i] = _mm256_unpacklo_ps (r0, r1);
+					t[i + 1] = _mm256_unpackhi_ps (r0, r1);
+				}
+				for (std::size_t i = 0; i < 8; i += 4)
+				{
+					s[i] = _mm256_shuffle_ps (t[i], t[i + 2], _MM_SHUFFLE (1, 0, 1, 0));
+					s[i + 1] = _mm256_shuffle_ps (t[i], t[i + 2],
+												  _MM_SHUFFLE (3, 2, 3, 2));
+					s[i + 2] = _mm256_shuffle_ps (t[i + 1], t[i + 3],
+												  _MM_SHUFFLE (1, 0, 1, 0));
+					s[i + 3] = _mm256_shuffle_ps (t[i + 1], t[i + 3],
+												  _MM_SHUFFLE (3, 2, 3, 2));
+				}
+				for (std::size_t i = 0; i < 4; ++i)
+				{
+					_mm256_storeu_ps (dst + i * ldd,
+									  _mm256_permute2f128_ps (s[i], s[i + 4], 0x20));
+					_mm256_storeu_ps (dst + (i + 4) * ldd,
+									  _mm256_permute2f128_ps (s[i], s[i + 4], 0x31));
+				}
+			}
+		};
+
+# elif defined (OPL_TRANSPOSE_SSE2)
+
+		template <>
+		struct TransposeKernel<double>
+		{
+			static constexpr std::size_t b = 2;
+
+			static void
+			run (const double* src, std::size_t lds, double* dst, std::size_t ldd)
+			{
+				__m128d r0 = _mm_loadu_pd (src);
+				__m128d r1 = _mm_loadu_pd (src + lds);
+				_mm_storeu_pd (dst, _mm_unpacklo_pd (r0, r1));
+				_mm_storeu_pd (dst + ldd, _mm_unpackhi_pd (r0, r1));
+			}
+		};
+
+		template <>
+		struct TransposeKernel<float>
+		{
+			static constexpr std::size_t b = 4;
+
+			static void
+			run (const float* src, std::size_t lds, float* dst, std::size_t ldd)
+			{
+				__m128 r0 = _mm_loadu_ps (src);
+				__m128 r1 = _mm_loadu_ps (src + lds);
+				__m128 r2 = _mm_loadu_ps (src + 2 * lds);
+				__m128 r3 = _mm_loadu_ps (src + 3 * lds);
+				_MM_TRANSPOSE4_PS (r0, r1, r2, r3);
+				_mm_storeu_ps (dst, r0);
+				_mm_storeu_ps (dst + ldd, r1);
+				_mm_storeu_ps (dst + 2 * ldd, r2);
+				_mm_storeu_ps (dst + 3 * ldd, r3);
+			}
+		};
+
+# endif
+
+		///b <- a^T for a block small enough for the L1 cache
+		template <class T>
+		void
+		transpose_block_ (std::size_t m, std::size_t n,
+						  const T* a, std::size_t lda, T* b, std::size_t ldb)
+		{
+			constexpr std::size_t kb = TransposeKernel<T>::b;
+			std::size_t mt = m - m % kb;
+			std::size_t nt = n - n % kb;
+			for (std::size_t i = 0; i < mt; i += kb)
+			{
+				for (std::size_t j = 0; j < nt; j += kb)
+					TransposeKernel<T>::run (a + i * lda + j, lda,
+											 b + j * ldb + i, ldb);
+				for (std::size_t ii = i; ii < i + kb; ++ii)
+					for (std::size_t j = nt; j < n; ++j)
+						b[j * ldb + ii] = a[ii * lda + j];
+			}
+			for (std::size_t i = mt; i < m; ++i)
+				for (std::size_t j = 0; j < n; ++j)
+					b[j * ldb + i] = a[i * lda + j];
+		}
+
+		template <class T>
+		void
+		transpose_rec_ (std::size_t m, std::size_t n,
+						const T* a, std::size_t lda, T* b, std::size_t ldb)
+		{
+			constexpr std::size_t kb = TransposeKernel<T>::b;
+			if (m <= OPL_TRANSPOSE_BLOCK && n <= OPL_TRANSPOSE_BLOCK)
+				transpose_block_ (m, n, a, lda, b, ldb);
+
+			//Halves are rounded to the micro-transpose size
+			else if (m >= n)
+			{
+				std::size_t m1 = m / 2 / kb * kb;
+				transpose_rec_ (m1, n, a, lda, b, ldb);
+				transpose_rec_ (m - m1, n, a + m1 * lda, lda, b + m1, ldb);
+			}
+			else
+			{
+				std::size_t n1 = n / 2 / kb * kb;
+				transpose_rec_ (m, n1, a, lda, b, ldb);
+				transpose_rec_ (m, n - n1, a + n1, lda, b + n1 * ldb, ldb);
+			}
+		}
+
+		///B <- A^T
+		///A is m x n with leading dimension lda, B is n x m with leading
+		///dimension ldb. A and B must not overlap
+		template <class T>
+		void
+		transpose (std::size_t m, std::size_t n,
+				   const T* a, std::size_t lda, T* b, std::size_t ldb)
+		{
+			parallel::for_range (m, m * n, [&](std::size_t i0, std::size_t i1) {
+					transpose_rec_ (i1 - i0, n, a + i0 * lda, lda, b + i0, ldb);
+				});
+		}
+
+		///A <- A^T, A is n x n with leading dimension lda
+		template <class T>
+		void
+		transpose_in_place (std::size_t n, T* a, std::size_t lda)
+		{
+			constexpr std::size_t nb = OPL_TRANSPOSE_BLOCK;
+			std::size_t blocks = (n + nb - 1) / nb;
+
+			//Block row I swaps the blocks (I, J) and (J, I) for J >= I:
+			//every pair is owned by a single block row
+			parallel::for_range (blocks, n * n / 2 + 1,
+								 [&](std::size_t b0, std::size_t b1) {
+					T buf[nb * nb];
+					for (std::size_t bi = b0; bi < b1; ++bi)
+					{
+						std::size_t i0 = bi * nb;
+						std::size_t ni = std::min (nb, n - i0);
+						T* diag = a + i0 * lda + i0;
+						transpose_block_ (ni, ni, diag, lda, buf, nb);
+						for (std::size_t i = 0; i < ni; ++i)
+							std::copy (buf + i * nb, buf + i * nb + ni,
+									   diag + i * lda);
+
+						for (std::size_t j0 = i0 + nb; j0 < n; j0 += nb)
+						{
+							std::size_t nj = std::min (nb, n - j0);
+							T* up = a + i0 * lda + j0;
+							T* low = a + j0 * lda + i0;
+							transpose_block_ (ni, nj, up, lda, buf, nb);
+							transpose_block_ (nj, ni, low, lda, up, lda);
+							for (std::size_t j = 0; j < nj; ++j)
+								std::copy (buf + j * nb, buf + j * nb + ni,
+										   low + j * lda);
+						}
+					}
+				});
+		}
+
+	}
+
+}
+
+#endif //!TRANSPOSE_HH_
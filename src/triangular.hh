@@ -0,0 +1,71 @@
+/** @file Triangular solves on packed factors
+ *
+ * B <- T^-1 B for a row-major triangular T (n x n) and a row-major B
+ * (n x nrhs), as left by the LU and QR factorizations.
+ * Right-hand sides are independent, so they are split between threads.
+ */
+
+#ifndef TRIANGULAR_HH_
+# define TRIANGULAR_HH_
+
+# include <cstddef>
+# include "parallel.hh"
+
+namespace opl
+{
+
+	namespace linalg
+	{
+
+		///B <- L^-1 B, L unit lower triangular, its diagonal is not read
+		template <class T>
+		void
+		lower_unit_solve (std::size_t n, std::size_t nrhs, const T* l,
+						  std::size_t ldl, T* b, std::size_t ldb)
+		{
+			parallel::for_range (nrhs, n * n * nrhs / 2,
+								 [&](std::size_t c0, std::size_t c1) {
+					for (std::size_t i = 1; i < n; ++i)
+					{
+						T* bi = b + i * ldb;
+						for (std::size_t k = 0; k < i; ++k)
+						{
+							T lik = l[i * ldl + k];
+							const T* bk = b + k * ldb;
+							for (std::size_t c = c0; c < c1; ++c)
+								bi[c] -= lik * bk[c];
+						}
+					}
+				});
+		}
+
+		///B <- U^-1 B, U upper triangular
+		template <class T>
+		void
+		upper_solve (std::size_t n, std::size_t nrhs, const T* u,
+					 std::size_t ldu, T* b, std::size_t ldb)
+		{
+			parallel::for_range (nrhs, n * n * nrhs / 2,
+								 [&](std::size_t c0, std::size_t c1) {
+					for (std::size_t i = n - 1; i < n; --i)
+					{
+						T* bi = b + i * ldb;
+						for (std::size_t k = i + 1; k < n; ++k)
+						{
+							T uik = u[i * ldu + k];
+							const T* bk = b + k * ldb;
+							for (std::size_t c = c0; c < c1; ++c)
+								bi[c] -= uik * bk[c];
+						}
+						T uii = u[i * ldu + i];
+						for (std::size_t c = c0; c < c1; ++c)
+							bi[c] /= uii;
+					}
+				});
+		}
+
+	}
+
+}
+
+#endif //!TRIANGULAR_HH_
@@ -12,6 +12,10 @@
 # include <iostream>
 # include <vector>
 # include "algo.hh"
+# include "expression.hh"
+# include "matrix-view.hh"
+# include "orthogonalization.hh"
+# include "storage.hh"
 # include "serialization.hh"
 # include "math.hh"
 # include "types.hh"
@@ -19,11 +23,11 @@
 namespace opl
 {
 
-	template<class T>
+	template<class T, StorageOrder O>
 	class Matrix;
 
 	template<class T>
-	class Vector
+	class Vector : public VectorExpr<Vector<T>, T>
 	{
 
 	public:
@@ -44,6 +48,14 @@ namespace opl
 
 		Vector (std::initializer_list<T> list);
 		Vector (const Vector& v);
+
+		///Takes ownership of the storage of v, v is left empty
+		Vector (Vector&& v) noexcept;
+
+		///Evaluates the expression e in a single loop
+		template <class E>
+		Vector (const VectorExpr<E, T>& e);
+
 		~Vector ();
 
 		Vector&
@@ -52,9 +64,16 @@ namespace opl
 		Vector&
 		operator= (const Vector& v);
 
+		Vector&
+		operator= (Vector&& v) noexcept;
+
 		Vector&
 		operator= (std::initializer_list<T> list);
 
+		template <class E>
+		Vector&
+		operator= (const VectorExpr<E, T>& e);
+
 		void
 		assign (const T& x);
 
@@ -64,21 +83,38 @@ namespace opl
 		void
 		assign (std::initializer_list<T> list);
 
+		///Evaluates the expression e directly in the vector
+		template <class E>
+		void
+		assign (const VectorExpr<E, T>& e);
+
 		template <class It>
 		void
 		assign (It begin, It end);
 
-		///Resize and recopy the vector, new values are unitialized
+		///Resize the vector, new values are unitialized
+		///The storage is only reallocated if n is greater than the capacity
 		void
 		resize (size_type n);
 
-		///Resizes and recopy the vector, new values are set to x
+		///Resizes the vector, new values are set to x
 		void
 		resize (size_type n, const T& x);
 
+		///Makes sure n values can be stored without reallocation
+		void
+		reserve (size_type n);
+
+		///Releases the storage not used by the current values
+		void
+		shrink_to_fit ();
+
 		size_type
 		size () const;
 
+		size_type
+		capacity () const;
+
 		bool
 		empty () const;
 
@@ -100,6 +136,23 @@ namespace opl
 		const T*
 		data () const;
 
+		///Distance between two consecutive values in the storage
+		size_type
+		stride () const;
+
+		///Views: reference the values of the vector, without any copy
+		VectorView<T>
+		view ();
+
+		VectorView<const T>
+		view () const;
+
+		///Values i to i + n - 1
+		VectorView<T>
+		segment_view (size_type i, size_type n);
+
+		VectorView<const T>
+		segment_view (size_type i, size_type n) const;
 
 		void
 		swap (Vector& v);
@@ -110,9 +163,8 @@ namespace opl
 
 
 
-		template <class U>
 		friend bool
-		operator== (const Vector<U>& a, const Vector<U>& b)
+		operator== (const Vector& a, const Vector& b)
 		{
 			if (a.size_ != b.size_)
 				return false;
@@ -122,9 +174,8 @@ namespace opl
 			return true;
 		}
 
-		template <class U>
 		friend bool
-		operator!= (const Vector<U>& a, const Vector<U>& b)
+		operator!= (const Vector& a, const Vector& b)
 		{
 			if (a.size_ != b.size_)
 				return true;
@@ -147,21 +198,26 @@ namespace opl
 		Vector
 		operator-- (int);
 
-		Vector
-		operator- () const;
-
 		Vector&
 		operator+= (const T& x);
 
 		Vector&
 		operator+= (const Vector& v);
 
+		template <class E>
+		Vector&
+		operator+= (const VectorExpr<E, T>& e);
+
 		Vector&
 		operator-= (const T& x);
 
 		Vector&
 		operator-= (const Vector& v);
 
+		template <class E>
+		Vector&
+		operator-= (const VectorExpr<E, T>& e);
+
 		Vector&
 		operator*= (const T& x);
 
@@ -173,131 +229,6 @@ namespace opl
 
 
 
-		template<class U>
-		friend Vector
-		operator+ (const Vector<U>& a, const Vector<U>& b)
-		{
-			assert (a.size_ == b.size_);
-			Vector<U> v (a.size_);
-			for (size_t i = 0; i < a.size_; ++i)
-				v.data_[i] = a.data_[i] + b.data_[i];
-			return v;
-		}
-
-		template<class U>
-		friend Vector
-		operator+ (const Vector<U>& v, const U& x)
-		{
-			Vector<U> u (v.size_);
-			for (size_t i = 0; i < v.size_; ++i)
-				u.data_[i] = v.data_[i] + x;
-			return u;
-		}
-
-
-		template<class U>
-		friend Vector
-		operator+ (const U& x, const Vector<U>& v)
-		{
-			Vector<U> u (v.size_);
-			for (size_t i = 0; i < v.size_; ++i)
-				u.data_[i] = x + v.data_[i];
-			return u;
-		}
-
-
-
-		template<class U>
-		friend Vector
-		operator- (const Vector<U>& a, const Vector<U>& b)
-		{
-			assert (a.size_ == b.size_);
-			Vector<U> v (a.size_);
-			for (size_t i = 0; i < a.size_; ++i)
-				v.data_[i] = a.data_[i] - b.data_[i];
-			return v;
-		}
-
-		template<class U>
-		friend Vector
-		operator- (const Vector<U>& v, const U& x)
-		{
-			Vector<U> u (v.size_);
-			for (size_t i = 0; i < v.size_; ++i)
-				u.data_[i] = v.data_[i] - x;
-			return u;
-		}
-
-		template<class U>
-		friend Vector
-		operator- (const U& x, const Vector<U>& v)
-		{
-			Vector<U> u (v.size_);
-			for (size_t i = 0; i < v.size_; ++i)
-				u.data_[i] = x - v.data_[i];
-			return u;
-		}
-
-		template<class U>
-		friend Vector
-		operator* (const Vector<U>& v, const U& x)
-		{
-			Vector<U> u (v.size_);
-			for (size_t i = 0; i < v.size_; ++i)
-				u.data_[i] = v.data_[i] * x;
-			return u;
-		}
-
-		template<class U>
-		friend Vector
-		operator* (const U& x, const Vector<U>& v)
-		{
-			Vector<U> u (v.size_);
-			for (size_t i = 0; i < v.size_; ++i)
-				u.data_[i] = x * v.data_[i];
-			return u;
-		}
-
-		template<class U>
-		friend Vector
-		operator/ (const Vector<U>& v, const U& x)
-		{
-			Vector<U> u (v.size_);
-			for (size_t i = 0; i < v.size_; ++i)
-				u.data_[i] = v.data_[i] / x;
-			return u;
-		}
-
-		template<class U>
-		friend Vector
-		operator/ (const U& x, const Vector<U>& v)
-		{
-			Vector<U> u (v.size_);
-			for (size_t i = 0; i < v.size_; ++i)
-				u.data_[i] = x / v.data_[i];
-			return u;
-		}
-
-		template<class U>
-		friend Vector
-		operator% (const Vector<U>& v, const U& x)
-		{
-			Vector<U> u (v.size_);
-			for (size_t i = 0; i < v.size_; ++i)
-				u.data_[i] = v.data_[i] % x;
-			return u;
-		}
-
-		template<class U>
-		friend Vector
-		operator% (const U& x, const Vector<U>& v)
-		{
-			Vector<U> u (v.size_);
-			for (size_t i = 0; i < v.size_; ++i)
-				u.data_[i] = x % v.data_[i];
-			return u;
-		}
-
 		void
 		increment()
 		{
@@ -1284,12 +1215,25 @@ namespace opl
 	private:
 		T* data_;
 		size_type size_;
+		size_type capacity_;
 
 		///Resize the vector without copying the old values
 		void
 		resize_mem_ (size_type n);
 
-		friend class Matrix<T>;
+		///Values of the vectors of set, one per row of a row-major matrix
+		static std::vector<T>
+		pack_ (const std::vector<Vector>& set);
+
+		///Norm of each vector projected on the orthogonal of the previous
+		///ones, by linalg::projected_norms
+		static std::vector<T>
+		projected_norms_ (const std::vector<Vector>& set);
+
+		using storage_type_ = Storage<T>;
+
+		template <class U, StorageOrder O>
+		friend class Matrix;
 
 		friend class SerialManager<Vector>;
 
@@ -1326,9 +1270,11 @@ namespace opl
 
 	template <class T>
 	Vector<T>::Vector (size_type count)
-		: size_ (count)
+		: data_ (storage_type_::allocate (count))
+		, size_ (count)
+		, capacity_ (count)
 	{
-		data_ = new T[count];
+
 	}
 
 	template <class T>
@@ -1357,13 +1303,33 @@ namespace opl
 	Vector<T>::Vector (const Vector& v)
 		: Vector (v.size_)
 	{
-		std::copy_n (v.data_, v.size_, data_);
+		storage_type_::copy (v.data_, v.size_, data_);
+	}
+
+	template <class T>
+	Vector<T>::Vector (Vector&& v) noexcept
+		: data_ (v.data_)
+		, size_ (v.size_)
+		, capacity_ (v.capacity_)
+	{
+		v.data_ = nullptr;
+		v.size_ = 0;
+		v.capacity_ = 0;
+	}
+
+	template <class T>
+	template <class E>
+	Vector<T>::Vector (const VectorExpr<E, T>& e)
+		: Vector (e.size ())
+	{
+		const E& expr = e.self ();
+		evaluate_into (expr, data_, [](T& x, const T& y) { x = y; });
 	}
 
 	template <class T>
 	Vector<T>::~Vector ()
 	{
-		delete data_;
+		storage_type_::deallocate (data_);
 	}
 
 	template <class T>
@@ -1378,7 +1344,18 @@ namespace opl
 	Vector<T>&
 	Vector<T>::operator= (const Vector& v)
 	{
-		assign (v);
+		if (this != &v)
+			assign (v);
+		return *this;
+	}
+
+	template <class T>
+	Vector<T>&
+	Vector<T>::operator= (Vector&& v) noexcept
+	{
+		std::swap (data_, v.data_);
+		std::swap (size_, v.size_);
+		std::swap (capacity_, v.capacity_);
 		return *this;
 	}
 
@@ -1390,6 +1367,15 @@ namespace opl
 		return *this;
 	}
 
+	template <class T>
+	template <class E>
+	Vector<T>&
+	Vector<T>::operator= (const VectorExpr<E, T>& e)
+	{
+		assign (e);
+		return *this;
+	}
+
 	template <class T>
 	void
 	Vector<T>::assign (const T& x)
@@ -1402,7 +1388,7 @@ namespace opl
 	Vector<T>::assign (const Vector& v)
 	{
 		resize_mem_ (v.size_);
-		std::copy_n (v.data_, v.size_, data_);
+		storage_type_::copy (v.data_, v.size_, data_);
 	}
 
 	template <class T>
@@ -1412,6 +1398,16 @@ namespace opl
 		assign (list.begin (), list.end ());
 	}
 
+	template <class T>
+	template <class E>
+	void
+	Vector<T>::assign (const VectorExpr<E, T>& e)
+	{
+		const E& expr = e.self ();
+		resize_mem_ (expr.size ());
+		evaluate_into (expr, data_, [](T& x, const T& y) { x = y; });
+	}
+
 	template <class T>
 	template <class It>
 	void
@@ -1425,12 +1421,7 @@ namespace opl
 	void
 	Vector<T>::resize (size_type n)
 	{
-		if(n == size_)
-			return;
-		T* new_data = new T[n];
-		std::copy_n (data_, std::min (n, size_), new_data);
-		delete data_;
-		data_ = new_data;
+		reserve (n);
 		size_ = n;
 	}
 
@@ -1438,18 +1429,32 @@ namespace opl
 	void
 	Vector<T>::resize (size_type n, const T& x)
 	{
-		if(n == size_)
-			return;
-		T* new_data = new T[n];
-		std::copy_n (data_, std::min (n, size_), new_data);
-		delete data_;
-		data_ = new_data;
-
+		reserve (n);
 		if (n > size_)
 			std::fill (data_ + size_, data_ + n, x);
 		size_ = n;
 	}
 
+	template <class T>
+	void
+	Vector<T>::reserve (size_type n)
+	{
+		if (n <= capacity_)
+			return;
+		data_ = storage_type_::reallocate (data_, size_, n);
+		capacity_ = n;
+	}
+
+	template <class T>
+	void
+	Vector<T>::shrink_to_fit ()
+	{
+		if (size_ == capacity_)
+			return;
+		data_ = storage_type_::reallocate (data_, size_, size_);
+		capacity_ = size_;
+	}
+
 
 	template <class T>
 	typename Vector<T>::size_type
@@ -1458,6 +1463,13 @@ namespace opl
 		return size_;
 	}
 
+	template <class T>
+	typename Vector<T>::size_type
+	Vector<T>::capacity () const
+	{
+		return capacity_;
+	}
+
 	template <class T>
 	bool
 	Vector<T>::empty () const
@@ -1514,18 +1526,50 @@ namespace opl
 		return data_;
 	}
 
+	template <class T>
+	typename Vector<T>::size_type
+	Vector<T>::stride () const
+	{
+		return 1;
+	}
+
+	template <class T>
+	VectorView<T>
+	Vector<T>::view ()
+	{
+		return VectorView<T> (data_, size_);
+	}
+
+	template <class T>
+	VectorView<const T>
+	Vector<T>::view () const
+	{
+		return VectorView<const T> (data_, size_);
+	}
+
+	template <class T>
+	VectorView<T>
+	Vector<T>::segment_view (size_type i, size_type n)
+	{
+		assert (i + n <= size_);
+		return VectorView<T> (data_ + i, n);
+	}
+
+	template <class T>
+	VectorView<const T>
+	Vector<T>::segment_view (size_type i, size_type n) const
+	{
+		assert (i + n <= size_);
+		return VectorView<const T> (data_ + i, n);
+	}
+
 	template <class T>
 	void
 	Vector<T>::swap (Vector& v)
 	{
-		if (v.size_ != size_)
-		{
-			Vector temp = v;
-			v.assign (*this);
-			assign (temp);
-		}
-		else
-			std::swap_ranges (data_, data_ + size_, v.data_);
+		std::swap (data_, v.data_);
+		std::swap (size_, v.size_);
+		std::swap (capacity_, v.capacity_);
 	}
 
 	template <class T>
@@ -1581,16 +1625,6 @@ namespace opl
 		return temp;
 	}
 
-	template <class T>
-	Vector<T>
-	Vector<T>::operator- () const
-	{
-		Vector neg (size_);
-		for (size_t i = 0; i < size_; ++i)
-			neg.data_[i] = - data_[i];
-		return neg;
-	}
-
 	template <class T>
 	Vector<T>&
 	Vector<T>::operator+= (const T& x)
@@ -1605,8 +1639,18 @@ namespace opl
 	Vector<T>::operator+= (const Vector& v)
 	{
 		assert (size_ == v.size_);
-		for (size_t i = 0; i < size_; ++i)
-			data_[i] += v.data_[i];
+		evaluate_into (v, data_, [](T& x, const T& y) { x += y; });
+		return *this;
+	}
+
+	template <class T>
+	template <class E>
+	Vector<T>&
+	Vector<T>::operator+= (const VectorExpr<E, T>& e)
+	{
+		const E& expr = e.self ();
+		assert (size_ == expr.size ());
+		evaluate_into (expr, data_, [](T& x, const T& y) { x += y; });
 		return *this;
 	}
 
@@ -1624,8 +1668,18 @@ namespace opl
 	Vector<T>::operator-= (const Vector& v)
 	{
 		assert (size_ == v.size_);
-		for (size_t i = 0; i < size_; ++i)
-			data_[i] -= v.data_[i];
+		evaluate_into (v, data_, [](T& x, const T& y) { x -= y; });
+		return *this;
+	}
+
+	template <class T>
+	template <class E>
+	Vector<T>&
+	Vector<T>::operator-= (const VectorExpr<E, T>& e)
+	{
+		const E& expr = e.self ();
+		assert (size_ == expr.size ());
+		evaluate_into (expr, data_, [](T& x, const T& y) { x -= y; });
 		return *this;
 	}
 
@@ -1657,16 +1711,46 @@ namespace opl
 	}
 
 
+	template <class T>
+	std::vector<T>
+	Vector<T>::pack_ (const std::vector<Vector>& set)
+	{
+		size_t d = set.empty () ? 0 : set[0].size_;
+		std::vector<T> res (set.size () * d);
+		for (size_t i = 0; i < set.size (); ++i)
+		{
+			assert (set[i].size_ == d);
+			std::copy_n (set[i].data_, d, res.data () + i * d);
+		}
+		return res;
+	}
+
+	template <class T>
+	std::vector<T>
+	Vector<T>::projected_norms_ (const std::vector<Vector>& set)
+	{
+		size_t n = set.size ();
+		size_t d = n ? set[0].size_ : 0;
+		std::vector<T> v = pack_ (set);
+		std::vector<T> res (n);
+		linalg::projected_norms (n, d, v.data (), d, res.data (),
+								 static_cast<T> (OPL_ALGO_ZERO));
+		return res;
+	}
+
 	template <class T>
 	void
 	Vector<T>::resize_mem_ (size_type n)
 	{
-		if(n != size_)
+		if (n > capacity_)
 		{
-			delete data_;
-			data_ = new T[n];
-			size_ = n;
+			storage_type_::deallocate (data_);
+			data_ = nullptr;
+			capacity_ = 0;
+			data_ = storage_type_::allocate (n);
+			capacity_ = n;
 		}
+		size_ = n;
 	}
 
 	template <class T>
@@ -1744,14 +1828,31 @@ namespace opl
 	Vector<T>::orthogonalize (const std::vector<Vector>& set,
 							  std::vector<Vector>& coeffs)
 	{
+		//Blocked CGS2 on the packed set: res[i] = R(i, i) q_i and
+		//coeffs[i][j] = R(j, i) / R(j, j), as project_orthogonal_get
 		size_t n = set.size ();
+		size_t d = n ? set[0].size_ : 0;
+		std::vector<T> q = pack_ (set);
+		std::vector<T> r (n * n);
+		linalg::cgs2_orthonormalize (n, d, q.data (), d, r.data (), n,
+									 static_cast<T> (OPL_ALGO_ZERO));
+
 		std::vector<Vector> res (n);
 		coeffs.resize (n);
-
 		for (size_t i = 0; i < n; ++i)
 		{
-			std::vector<Vector> subset (res.begin (), res.begin () + i);
-			res[i] = set[i].project_orthogonal_get (subset, coeffs[i]);
+			T rii = r[i * n + i];
+			res[i].resize_mem_ (d);
+			for (size_t k = 0; k < d; ++k)
+				res[i].data_[k] = rii * q[i * d + k];
+
+			coeffs[i].resize_mem_ (i + 1);
+			for (size_t j = 0; j < i; ++j)
+			{
+				T rjj = r[j * n + j];
+				coeffs[i].data_[j] = rjj == 0 ? 0 : r[j * n + i] / rjj;
+			}
+			coeffs[i].data_[i] = 1;
 		}
 
 		return res;
@@ -1779,17 +1880,12 @@ namespace opl
 	std::vector<Vector<T>>
 	Vector<T>::subset_basis_get (const std::vector<Vector>& set)
 	{
-		size_t n = set.size ();
-		std::vector<Vector> coeffs;
-		std::vector<Vector> orth = orthogonalize (set, coeffs);
+		std::vector<T> norms = projected_norms_ (set);
 		std::vector<Vector> base;
 
-		for(size_t i = 0; i < n; ++i)
-		{
-			Vector v = orth[i];
-			if(!v.is_null ())
+		for(size_t i = 0; i < set.size (); ++i)
+			if (norms[i] != 0)
 				base.push_back (set[i]);
-		}
 		return base;
 	}
 
@@ -1797,7 +1893,10 @@ namespace opl
 	size_t
 	Vector<T>::rank (const std::vector<Vector>& set)
 	{
-		return basis_get (set).size ();
+		std::vector<T> norms = projected_norms_ (set);
+		return std::count_if (norms.begin (), norms.end (), [](const T& x) {
+				return x != 0;
+			});
 	}
 
 	template <class T>
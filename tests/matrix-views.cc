@@ -0,0 +1,144 @@
+/** @file Vector and matrix views in expressions and assignments
+ */
+
+#include <cmath>
+#include <cstdio>
+#include "matrix.hh"
+#include "matrix-view.hh"
+
+using namespace opl;
+
+namespace
+{
+
+	int failures = 0;
+
+	template <class V>
+	void
+	check_vector (const char* name, const V& v,
+				  std::initializer_list<double> expected)
+	{
+		std::size_t i = 0;
+		bool ok = v.size () == expected.size ();
+		for (double x : expected)
+			ok = ok && std::abs (v[i++] - x) < 1e-12;
+		if (!ok)
+		{
+			std::printf ("%s: wrong values\n", name);
+			++failures;
+		}
+	}
+
+	template <class M>
+	void
+	check_matrix (const char* name, const M& m,
+				  std::initializer_list<double> expected)
+	{
+		std::size_t i = 0;
+		bool ok = m.rows () * m.cols () == expected.size ();
+		for (double x : expected)
+		{
+			ok = ok && std::abs (m.at (i / m.cols (), i % m.cols ()) - x) < 1e-12;
+			++i;
+		}
+		if (!ok)
+		{
+			std::printf ("%s: wrong values\n", name);
+			++failures;
+		}
+	}
+
+	///3 x 3 matrix holding 0 to 8
+	Matrix<double>
+	iota_matrix ()
+	{
+		Matrix<double> m (3, 3);
+		for (std::size_t i = 0; i < 9; ++i)
+			m.at (i / 3, i % 3) = static_cast<double> (i);
+		return m;
+	}
+
+}
+
+int
+main ()
+{
+	Matrix<double> g = iota_matrix ();
+	const Matrix<double>& cg = g;
+	Vector<double> v {1, 2, 3, 4};
+
+	Vector<double> r = g.row_view (0) + g.row_view (1);
+	check_vector ("row + row", r, {3, 5, 7});
+	r = g.row_view (2) + Vector<double> {1, 1, 1};
+	check_vector ("row + vector", r, {7, 8, 9});
+	r = Vector<double> {1, 1, 1} - g.col_view (1);
+	check_vector ("vector - col", r, {0, -3, -6});
+	r = 2.0 * g.row_view (1);
+	check_vector ("scalar * row", r, {6, 8, 10});
+	r = g.col_view (2) * 2.0;
+	check_vector ("col * scalar", r, {4, 10, 16});
+	r = cg.diagonal_view () + 1.0;
+	check_vector ("const diagonal + scalar", r, {1, 5, 9});
+	r = v.segment_view (1, 3) + g.row_view (0);
+	check_vector ("segment + row", r, {2, 4, 6});
+	r = -(v.segment_view (0, 3) - g.col_view (0));
+	check_vector ("-(segment - col)", r, {-1, 1, 3});
+
+	Vector<double> w (4, 0.0);
+	w.segment_view (1, 3) = g.row_view (2) - g.row_view (0);
+	check_vector ("segment = row - row", w, {0, 6, 6, 6});
+	g.row_view (0) += 10.0 * g.col_view (0);
+	check_vector ("row += scalar * col", g.row_view (0), {0, 31, 62});
+
+	g = iota_matrix ();
+	Matrix<double> s = g.transpose_view () + g.region_view (0, 0, 3, 3);
+	check_matrix ("transpose + region", s, {0, 4, 8, 4, 8, 12, 8, 12, 16});
+	s = 2.0 * cg.region_view (1, 1, 2, 2);
+	check_matrix ("scalar * const region", s, {8, 10, 14, 16});
+
+	//The right-hand sides read the destination at other positions
+	Matrix<double> m = iota_matrix ();
+	m = m.transpose_view ();
+	check_matrix ("m = transpose view", m, {0, 3, 6, 1, 4, 7, 2, 5, 8});
+	m = iota_matrix ();
+	m = m.transpose_view () + m;
+	check_matrix ("m = transpose view + m", m, {0, 4, 8, 4, 8, 12, 8, 12, 16});
+	m = iota_matrix ();
+	m += 2.0 * m.transpose_view ();
+	check_matrix ("m += 2 transpose view", m, {0, 7, 14, 5, 12, 19, 10, 17, 24});
+	m = iota_matrix ();
+	m.region_view (1, 1, 2, 2) = m.region_view (0, 0, 2, 2);
+	check_matrix ("overlapping regions", m, {0, 1, 2, 3, 0, 1, 6, 3, 4});
+	m = iota_matrix ();
+	m.region_view (0, 0, 2, 2) = m.region_view (1, 1, 2, 2);
+	check_matrix ("overlapping regions, backward", m, {4, 5, 2, 7, 8, 5, 6, 7, 8});
+	m = iota_matrix ();
+	m.transpose_view () = m;
+	check_matrix ("transpose view = m", m, {0, 3, 6, 1, 4, 7, 2, 5, 8});
+	m = iota_matrix ();
+	m.row_view (1) = m.col_view (1);
+	check_matrix ("row = col", m, {0, 1, 2, 1, 4, 7, 6, 7, 8});
+	m = iota_matrix ();
+	m.diagonal_view () = m.row_view (0) + m.diagonal_view ();
+	check_matrix ("diagonal = row + diagonal", m, {0, 1, 2, 3, 5, 5, 6, 7, 10});
+
+	Matrix<double, StorageOrder::col_major> c (iota_matrix ());
+	c = c.transpose_view ();
+	check_matrix ("col-major m = transpose view", c,
+				  {0, 3, 6, 1, 4, 7, 2, 5, 8});
+
+	Vector<double> u {1, 2, 3, 4, 5};
+	u.segment_view (1, 4) = u.segment_view (0, 4);
+	check_vector ("overlapping segments", u, {1, 1, 2, 3, 4});
+	u = Vector<double> {1, 2, 3, 4, 5};
+	u = u.segment_view (1, 4) + 1.0;
+	check_vector ("u = own segment", u, {3, 4, 5, 6});
+	u = Vector<double> {1, 2, 3, 4, 5};
+	u += u;
+	check_vector ("u += u", u, {2, 4, 6, 8, 10});
+
+	if (failures)
+		return 1;
+	std::printf ("matrix-views: OK\n");
+	return 0;
+}
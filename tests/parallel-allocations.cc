@@ -0,0 +1,77 @@
+/** @file Allocations of the parallel backend
+ *
+ * Counts the calls to operator new made while for_range and run hand work
+ * to the thread pool: the tasks are passed by reference, so splitting an
+ * operation allocates nothing.
+ */
+
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+#include <vector>
+#include "parallel.hh"
+
+using namespace opl;
+
+namespace
+{
+
+	std::atomic<std::size_t> allocations {0};
+
+}
+
+void*
+operator new (std::size_t n)
+{
+	++allocations;
+	void* res = std::malloc (n ? n : 1);
+	if (!res)
+		throw std::bad_alloc ();
+	return res;
+}
+
+void
+operator delete (void* p) noexcept
+{
+	std::free (p);
+}
+
+void
+operator delete (void* p, std::size_t) noexcept
+{
+	std::free (p);
+}
+
+int
+main ()
+{
+	parallel::set_threads (4);
+	parallel::set_threshold (0);
+	std::vector<double> v (1000, 1.0);
+	std::vector<double> sums (4, 0.0);
+
+	std::size_t start = allocations;
+	for (int rep = 0; rep < 100; ++rep)
+	{
+		parallel::for_range (v.size (), v.size (),
+							 [&](std::size_t b, std::size_t e) {
+								 for (std::size_t i = b; i < e; ++i)
+									 v[i] *= 1.5;
+							 });
+		parallel::run (sums.size (), [&](std::size_t t) {
+				sums[t] += v[t];
+			});
+	}
+	std::size_t count = allocations - start;
+	parallel::set_threads (1);
+
+	if (count)
+	{
+		std::printf ("parallel-allocations: %zu allocations, 0 expected\n",
+					 count);
+		return 1;
+	}
+	std::printf ("parallel-allocations: OK\n");
+	return 0;
+}
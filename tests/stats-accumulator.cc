@@ -0,0 +1,87 @@
+/** @file StatsAccumulator and QuantileSketch
+ *
+ * Integer streams have the same mean and variance as the double ones,
+ * merges match one accumulator fed with every value, and the state
+ * survives serialization.
+ */
+
+#include <cmath>
+#include <cstdio>
+#include <sstream>
+#include <vector>
+#include "stats-accumulator.hh"
+
+using namespace opl;
+
+namespace
+{
+
+	int failures = 0;
+
+	void
+	check (const char* name, double x, double expected)
+	{
+		if (std::abs (x - expected) > 1e-12 * (1 + std::abs (expected)))
+		{
+			std::printf ("%s: %g, %g expected\n", name, x, expected);
+			++failures;
+		}
+	}
+
+}
+
+int
+main ()
+{
+	StatsAccumulator<int> a;
+	std::vector<int> v {1, 2, 3, 4};
+	a.add (v.begin (), v.end ());
+	check ("int mean", a.mean (), 2.5);
+	check ("int variance", a.variance (), 1.25);
+	check ("int sample variance", a.sample_variance (), 5. / 3.);
+	check ("int standard deviation", a.standard_deviation (),
+		   std::sqrt (1.25));
+	check ("int sum", a.sum (), 10);
+	check ("int min", a.min (), 1);
+	check ("int max", a.max (), 4);
+
+	StatsAccumulator<int> b;
+	b.add (7);
+	b.add (8);
+	a.merge (b);
+	check ("int merged mean", a.mean (), 25. / 6.);
+	check ("int merged variance", a.variance (), 233. / 36.);
+
+	std::stringstream ss;
+	serialize (ss, a);
+	StatsAccumulator<int> c = unserialize<StatsAccumulator<int>> (ss);
+	check ("unserialized count", c.count (), 6);
+	check ("unserialized mean", c.mean (), a.mean ());
+	check ("unserialized variance", c.variance (), a.variance ());
+
+	StatsAccumulator<double> d;
+	for (int i = 0; i < 1000; ++i)
+		d.add (i);
+	d.merge (d);
+	check ("self merge count", d.count (), 2000);
+	check ("self merge mean", d.mean (), 499.5);
+	check ("self merge variance", d.variance (), (1000. * 1000. - 1) / 12.);
+
+	//A cleared sketch compacts as a new one
+	QuantileSketch<double> s (16);
+	QuantileSketch<double> t (16);
+	for (int i = 0; i < 1000; ++i)
+		s.add (i);
+	s.clear ();
+	for (int i = 0; i < 1000; ++i)
+	{
+		s.add (i * 7 % 1000);
+		t.add (i * 7 % 1000);
+	}
+	check ("cleared sketch", s.quantile (0.5), t.quantile (0.5));
+
+	if (failures)
+		return 1;
+	std::printf ("stats-accumulator: OK\n");
+	return 0;
+}
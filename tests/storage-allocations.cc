@@ -0,0 +1,132 @@
+/** @file Buffers allocated by Vector and Matrix pipelines
+ *
+ * Counts the Vector and Matrix buffers (storage_allocations) allocated by
+ * moves and decomposition pipelines: results are handed over, never
+ * copied, and assignments reuse the storage they already have.
+ */
+
+#define OPL_STORAGE_STATS
+
+#include <cstdio>
+#include <utility>
+#include "matrix.hh"
+#include "plu-factor.hh"
+#include "qr-factor.hh"
+
+using namespace opl;
+
+namespace
+{
+
+	int failures = 0;
+
+	void
+	check_count (const char* name, std::size_t start, std::size_t expected)
+	{
+		std::size_t count = storage_allocations () - start;
+		if (count != expected)
+		{
+			std::printf ("%s: %zu buffers allocated, %zu expected\n", name,
+						 count, expected);
+			++failures;
+		}
+	}
+
+}
+
+int
+main ()
+{
+	const std::size_t n = 64;
+	Matrix<double> a (n, n);
+	for (std::size_t i = 0; i < n; ++i)
+		for (std::size_t j = 0; j < n; ++j)
+			a.at (i, j) = i == j ? static_cast<double> (n) : 1.0 / (1 + i + j);
+	Vector<double> b (n, 1.0);
+	Matrix<double> bs (n, 3, 1.0);
+	std::size_t start;
+
+	start = storage_allocations ();
+	{
+		Vector<double> v (std::move (b));
+		b = std::move (v);
+		Matrix<double> m (std::move (a));
+		a = std::move (m);
+		a.swap (m);
+		m.swap (a);
+	}
+	check_count ("moves and swaps", start, 0);
+
+	//The result only
+	start = storage_allocations ();
+	{
+		Matrix<double> t = a.transpose ();
+	}
+	check_count ("transpose", start, 1);
+
+	//LU factors and the solution
+	start = storage_allocations ();
+	{
+		Vector<double> x = a.plu_solve_system (b);
+	}
+	check_count ("plu_solve_system", start, 2);
+
+	start = storage_allocations ();
+	{
+		Matrix<double> x = a.plu_solve_systems (bs);
+	}
+	check_count ("plu_solve_systems", start, 2);
+
+	//Identity, LU factors and the inverse
+	start = storage_allocations ();
+	{
+		Matrix<double> inv = a.plu_inverse ();
+	}
+	check_count ("plu_inverse", start, 3);
+
+	//QR factors, tau, T, and the solution
+	start = storage_allocations ();
+	{
+		Matrix<double> x = a.qr_solve_systems (bs);
+	}
+	check_count ("qr_solve_systems", start, 4);
+
+	start = storage_allocations ();
+	{
+		Matrix<double> inv = a.qr_inverse ();
+	}
+	check_count ("qr_inverse", start, 5);
+
+	//The factorization takes over the moved copy
+	start = storage_allocations ();
+	{
+		PluFactor<double> lu {Matrix<double> (a)};
+		Vector<double> x (b);
+		lu.solve_in_place (x);
+	}
+	check_count ("PluFactor", start, 2);
+
+	start = storage_allocations ();
+	{
+		QrFactor<double> qr {Matrix<double> (a)};
+	}
+	check_count ("QrFactor", start, 1);
+
+	//Assignments and shrinking resizes keep the buffer
+	start = storage_allocations ();
+	{
+		Matrix<double> m (n, n);
+		m = a;
+		m = a.transpose ();
+		Vector<double> v (n);
+		v.resize (n / 2);
+		v.resize (n);
+		v = b;
+	}
+	check_count ("storage reuse", start, 3);
+
+	if (failures)
+		return 1;
+	std::printf ("storage-allocations: OK\n");
+	return 0;
+}
@@ -0,0 +1,109 @@
+/** @file Read failures of TiledMatrix
+ *
+ * Truncates the file under an open TiledMatrix: the tiles past the end
+ * can't be read, and every access to them must throw, whether the read
+ * was direct or a prefetch, instead of handing out a stale buffer.
+ */
+
+#include <cstdio>
+#include <stdexcept>
+#include <string>
+#include <unistd.h>
+#include "tiled-matrix.hh"
+
+using namespace opl;
+
+namespace
+{
+
+	int failures = 0;
+
+	void
+	check (const char* name, bool ok)
+	{
+		if (!ok)
+		{
+			std::printf ("%s: failed\n", name);
+			++failures;
+		}
+	}
+
+	template <class F>
+	bool
+	throws (F f)
+	{
+		try
+		{
+			f ();
+		}
+		catch (const std::runtime_error&)
+		{
+			return true;
+		}
+		return false;
+	}
+
+}
+
+int
+main ()
+{
+	const std::size_t n = 64;
+	const std::size_t b = 8;
+	std::string path = "/tmp/opl-tiled-matrix-errors-"
+		+ std::to_string (getpid ()) + ".t";
+
+	{
+		TiledMatrix<double> m (path, n, n, b, 4);
+		for (std::size_t i = 0; i < n; ++i)
+			for (std::size_t j = 0; j < n; ++j)
+				m.set (i, j, static_cast<double> (i + j + 1));
+	}
+
+	{
+		TiledMatrix<double> m = TiledMatrix<double>::open (path, 4);
+		//Header and the first 4 tile rows only
+		if (truncate (path.c_str (), 64 + 4 * 8 * b * b * sizeof (double)))
+		{
+			std::printf ("tiled-matrix-errors: can't truncate %s\n",
+						 path.c_str ());
+			return 1;
+		}
+
+		check ("valid tile", m.at (3, 4) == 8);
+		check ("read error", throws ([&] { m.at (40, 40); }));
+		check ("read error again", throws ([&] { m.at (40, 40); }));
+
+		m.prefetch (6, 0);
+		check ("prefetch error", throws ([&] { m.at (48, 0); }));
+		check ("prefetch error again", throws ([&] { m.at (48, 0); }));
+
+		//Evicting failed prefetches drops them
+		for (std::size_t i = 4; i < 8; ++i)
+			m.prefetch (i, 1);
+		check ("after evictions", m.at (10, 20) == 31);
+
+		m.set (1, 2, 42);
+		for (std::size_t i = 5; i < 8; ++i)
+			m.prefetch (i, 2);
+		check ("flush error", throws ([&] { m.flush (); }));
+		m.flush ();
+		check ("written tile", m.at (1, 2) == 42);
+		m.prefetch (7, 7);
+	}
+
+	//The missing tiles read as zeros again
+	if (truncate (path.c_str (), 64 + n * n * sizeof (double)))
+		return 1;
+
+	{
+		TiledMatrix<double> m = TiledMatrix<double>::open (path, 4);
+		check ("reopened", m.at (1, 2) == 42 && m.at (30, 30) == 61);
+	}
+	std::remove (path.c_str ());
+
+	if (failures)
+		return 1;
+	std::printf ("tiled-matrix-errors: OK\n");
+	return 0;
+}